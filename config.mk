@@ -5,6 +5,8 @@ export OMPI_CXX = clang++
 WITH_ALUCELL ?= off
 WITH_FREEFEM ?= off
 WITH_GMSH    ?= off
+WITH_ZLIB    ?= off
+WITH_PROFILING ?= off
 
 ifeq ($(WITH_ALUCELL),on)
   MODULES += -DENABLE_ALUCELL
@@ -18,6 +20,14 @@ ifeq ($(WITH_GMSH),on)
   MODULES += -DENABLE_GMSH
 endif
 
+ifeq ($(WITH_ZLIB),on)
+  MODULES += -DENABLE_ZLIB
+endif
+
+ifeq ($(WITH_PROFILING),on)
+  MODULES += -DENABLE_PROFILING
+endif
+
 CXX = mpicxx
 DEPS_BIN = g++
 DEPSFLAGS = -I$(SITE_INCLUDE_DIR) -I$(SITE_PETSC_INCLUDE_DIR) -I$(SITE_LAPACK_INCLUDE_DIR) \
@@ -31,6 +41,9 @@ LDFLAGS += -Wall -Wextra \
 	   -L$(SITE_PETSC_LIB_DIR) -L$(SITE_LAPACK_LIB_DIR) -L./lib/ -L$(SITE_LIB_DIR)
 
 LDLIBS = -lpetsc -llapacke -lalucelldb -Wl,-all_load -ltfel
+ifeq ($(WITH_ZLIB),on)
+  LDLIBS += -lz
+endif
 AR = ar
 ARFLAGS = rc
 MKDIR = mkdir
@@ -52,6 +65,8 @@ SOURCES = \
 	src/core/cell.cpp \
 	src/core/mesh.cpp \
 	src/core/fe.cpp \
+	src/core/scheduler.cpp \
+	src/core/static_condensation.cpp \
 	src/protocols/stokes_2d/driven_cavity.cpp \
 	src/protocols/steady_advection_diffusion_2d/step.cpp \
 	src/protocols/unsteady_advection_diffusion_2d/rotating_hill.cpp \
@@ -78,7 +93,24 @@ SOURCES = \
 	test/mesh_data.cpp \
 	test/stokes_2d_p2_p1.cpp \
 	test/navier_stokes_2d_p2_p1.cpp \
-	test/fe_derivative_form.cpp
+	test/fe_derivative_form.cpp \
+	test/benchmark.cpp \
+	test/profiler.cpp \
+	test/scheduler.cpp \
+	test/distributed_poisson.cpp \
+	test/partition.cpp \
+	test/reference_tensor.cpp \
+	test/operator_cache.cpp \
+	test/l2_projector.cpp \
+	test/static_condensation.cpp \
+	test/tabulation.cpp \
+	test/expression_cache.cpp \
+	test/automatic_quadrature.cpp \
+	test/fused_assembly.cpp \
+	test/newton.cpp \
+	test/small_tensor.cpp \
+	test/dof_coordinates.cpp \
+	test/probe.cpp
 
 HEADERS = \
 	include/tfel/tfel.hpp \
@@ -111,12 +143,25 @@ HEADERS = \
 	include/tfel/formulations/unsteady_diffusion_2d.hpp \
 	include/tfel/utility/importer.hpp \
 	include/tfel/utility/alucell_importer.hpp \
+	include/tfel/utility/gmsh_importer.hpp \
 	include/tfel/core/vector_operation.hpp \
 	include/tfel/core/subdomain.hpp \
 	include/tfel/core/mesh_data.hpp \
 	include/tfel/core/operator.hpp \
 	include/tfel/core/dictionary.hpp \
-	include/tfel/core/solver.hpp
+	include/tfel/core/solver.hpp \
+	include/tfel/core/profiler.hpp \
+	include/tfel/core/scheduler.hpp \
+	include/tfel/core/distributed.hpp \
+	include/tfel/core/partition.hpp \
+	include/tfel/core/reference_tensor.hpp \
+	include/tfel/core/operator_cache.hpp \
+	include/tfel/core/static_condensation.hpp \
+	include/tfel/core/tabulation.hpp \
+	include/tfel/core/fused_assembly.hpp \
+	include/tfel/core/newton.hpp \
+	include/tfel/core/small_tensor.hpp \
+	include/tfel/core/probe.hpp
 
 
 BIN = \
@@ -147,7 +192,24 @@ BIN = \
 	bin/main \
 	bin/test_stokes_2d_p2_p1 \
 	bin/test_navier_stokes_2d_p2_p1 \
-	bin/test_fe_derivative_form
+	bin/test_fe_derivative_form \
+	bin/test_benchmark \
+	bin/test_profiler \
+	bin/test_scheduler \
+	bin/test_distributed_poisson \
+	bin/test_partition \
+	bin/test_reference_tensor \
+	bin/test_operator_cache \
+	bin/test_l2_projector \
+	bin/test_static_condensation \
+	bin/test_tabulation \
+	bin/test_expression_cache \
+	bin/test_automatic_quadrature \
+	bin/test_fused_assembly \
+	bin/test_newton \
+	bin/test_small_tensor \
+	bin/test_dof_coordinates \
+	bin/test_probe
 
 bin/test_finite_element_space: build/test/finite_element_space.o 
 bin/main: build/src/main.o 
@@ -177,6 +239,31 @@ bin/test_mesh_data: build/test/mesh_data.o
 bin/test_stokes_2d_p2_p1: build/test/stokes_2d_p2_p1.o
 bin/test_navier_stokes_2d_p2_p1: build/test/navier_stokes_2d_p2_p1.o
 bin/test_fe_derivative_form: build/test/fe_derivative_form.o
+bin/test_benchmark: build/test/benchmark.o
+bin/test_profiler: build/test/profiler.o
+bin/test_scheduler: build/test/scheduler.o
+bin/test_distributed_poisson: build/test/distributed_poisson.o
+bin/test_partition: build/test/partition.o
+bin/test_reference_tensor: build/test/reference_tensor.o
+bin/test_operator_cache: build/test/operator_cache.o
+bin/test_l2_projector: build/test/l2_projector.o
+bin/test_static_condensation: build/test/static_condensation.o
+bin/test_tabulation: build/test/tabulation.o
+bin/test_expression_cache: build/test/expression_cache.o
+bin/test_automatic_quadrature: build/test/automatic_quadrature.o
+bin/test_fused_assembly: build/test/fused_assembly.o
+bin/test_newton: build/test/newton.o
+bin/test_small_tensor: build/test/small_tensor.o
+bin/test_dof_coordinates: build/test/dof_coordinates.o
+bin/test_probe: build/test/probe.o
+
+# the gmsh importer, and its test, are only built with WITH_GMSH=on
+ifeq ($(WITH_GMSH),on)
+  SOURCES += test/gmsh_import.cpp
+  BIN += bin/test_gmsh_import
+endif
+
+bin/test_gmsh_import: build/test/gmsh_import.o
 
 LIB = lib/libtfel.a
 
@@ -186,4 +273,6 @@ lib/libtfel.a: \
 	build/src/core/quadrature.o \
 	build/src/core/cell.o \
 	build/src/core/dictionary.o \
-	build/src/core/solver.o
+	build/src/core/solver.o \
+	build/src/core/scheduler.o \
+	build/src/core/static_condensation.o
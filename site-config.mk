@@ -17,3 +17,5 @@ LDFLAGS = -O2
 WITH_ALUCELL = on
 WITH_FREEFEM = off
 WITH_GMSH = off
+WITH_ZLIB = off
+WITH_PROFILING = off
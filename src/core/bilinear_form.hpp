@@ -1,6 +1,10 @@
 #ifndef _BILINEAR_FORM_H_
 #define _BILINEAR_FORM_H_
 
+#include "profiler.hpp"
+#include "scheduler.hpp"
+#include "small_tensor.hpp"
+
 enum class algebraic_block {test_block, trial_block};
 
 template<typename test_fes_type, typename trial_fes_type>
@@ -14,7 +18,8 @@ public:
       a(te_fes.get_dof_number() + algebraic_equation_number,
         tr_fes.get_dof_number() + algebraic_dof_number),
       a_eq_number(algebraic_equation_number),
-      a_dof_number(algebraic_dof_number) {
+      a_dof_number(algebraic_dof_number),
+      condensation(false) {
     clear();
   }
 
@@ -28,19 +33,114 @@ public:
     typedef typename trial_fes_type::fe_type trial_fe_type;
     typedef typename T::quadrature_type quadrature_type;
     typedef typename T::cell_type cell_type;
-    using form_type = typename T::form_type;
 
     const auto& m(integration_proxy.m);
 
+    profiler::scope assembly_scope("bilinear_form::assembly");
+
+    // integrands with constant coefficients over the cells are
+    // assembled with the precomputed reference tensors
+    std::vector<reference_monomial> terms;
+    const bool use_reference_tensor(T::point_set_number == 1
+				    and expand_reference_monomials(integration_proxy.f, terms));
+    const reference_geometry geometry(use_reference_tensor ?
+				      reference_geometry(terms, 0, 1, cell_type::n_dimension) :
+				      reference_geometry());
+
+    const std::size_t n_test_dof(test_fe_type::n_dof_per_element);
+    const std::size_t n_trial_dof(trial_fe_type::n_dof_per_element);
+
+    // the element matrices of a batch of cells are computed in
+    // parallel, and scattered in the cell order
+    const std::size_t n_element(m.get_cell_number());
+    const std::size_t batch_size(std::max<std::size_t>(1, std::min<std::size_t>(n_element,
+									   1024 * parallel::get_thread_number())));
+    array<double> a_els{batch_size, n_test_dof, n_trial_dof};
+
+    for (std::size_t k_batch(0); k_batch < n_element; k_batch += batch_size) {
+      const std::size_t k_batch_end(std::min(k_batch + batch_size, n_element));
+
+      parallel::parallel_for(k_batch, k_batch_end,
+			     [&, this](std::size_t k_begin, std::size_t k_end) {
+			       if (use_reference_tensor)
+				 this->assemble_reference_range(a_els, k_batch, k_begin, k_end,
+								integration_proxy, geometry);
+			       else
+				 this->assemble_element_range<T>(a_els, k_batch, k_begin, k_end,
+								 integration_proxy);
+			     });
+
+      for (std::size_t k(k_batch); k < k_batch_end; ++k) {
+	profiler::phase scatter_phase("scatter");
+	add_element_matrix(integration_proxy.get_global_cell_id(k), &a_els.at(k - k_batch, 0, 0),
+			   m.get_cell_volume(k));
+      }
+    }
+
+    profiler::count("cells", n_element);
+    profiler::count("quadrature_points", n_element * quadrature_type::n_point);
+    if (use_reference_tensor)
+      profiler::count("reference_tensor_cells", n_element);
+  }
+
+  /*
+   *  Same as assemble_element_range, for an integrand whose monomials
+   *  are described by geometry.
+   */
+  template<typename T>
+  void assemble_reference_range(array<double>& a_els, std::size_t k_offset,
+				std::size_t k_begin, std::size_t k_end,
+				const T& integration_proxy,
+				const reference_geometry& geometry) const {
+    typedef typename test_fes_type::fe_type test_fe_type;
+    typedef typename trial_fes_type::fe_type trial_fe_type;
+    typedef typename T::quadrature_type quadrature_type;
+    using tensor_type = reference_tensor<test_fe_type, trial_fe_type, quadrature_type>;
+
+    const auto& m(integration_proxy.m);
+    std::vector<double> g(geometry.get_entries().size());
+
+    for (std::size_t k(k_begin); k < k_end; ++k) {
+      {
+	profiler::phase geometry_phase("geometry");
+	geometry.evaluate(m.get_jmt(k), g.data());
+      }
+
+      const tensor_type* r;
+      {
+	profiler::phase tabulation_phase("tabulation");
+	r = &tensor_type::instance();
+      }
+
+      profiler::phase kernel_phase("kernel");
+      r->contract(geometry.get_entries(), g.data(), &a_els.at(k - k_offset, 0, 0));
+    }
+  }
+
+  /*
+   *  Compute the element matrices of the cells [k_begin, k_end) in the
+   *  rows k - k_offset of a_els. The integration proxy is taken by
+   *  value, since the expressions cache their values.
+   */
+  template<typename T>
+  void assemble_element_range(array<double>& a_els, std::size_t k_offset,
+			      std::size_t k_begin, std::size_t k_end,
+			      T integration_proxy) const {
+    typedef typename test_fes_type::fe_type test_fe_type;
+    typedef typename trial_fes_type::fe_type trial_fe_type;
+    typedef typename T::quadrature_type quadrature_type;
+    typedef typename T::cell_type cell_type;
+    using form_type = typename T::form_type;
+
+    const auto& m(integration_proxy.m);
     
     // prepare the quadrature weights
     const std::size_t n_q(quadrature_type::n_point);
-    array<double> omega{n_q};
+    small_tensor<double, quadrature_type::n_point> omega;
     omega.set_data(&quadrature_type::w[0]);
 
     // storage for the quadrature points
-    array<double> xq_hat{n_q, test_fe_type::cell_type::n_dimension};
-    array<double> xq{n_q, test_fe_type::cell_type::n_dimension};
+    small_tensor<double, quadrature_type::n_point, test_fe_type::cell_type::n_dimension> xq_hat, xq;
     
     // storage for the point-wise basis function evaluation
     using fe_list = type_list<test_fe_type, trial_fe_type>;
@@ -51,66 +151,88 @@ public:
     fe_value_manager<unique_fe_list> fe_values(n_q);
     
     if (T::point_set_number == 1) {
-      xq_hat = integration_proxy.get_quadrature_points(0);
-      fe_values.set_points(xq_hat);
+      xq_hat.set_data(integration_proxy.get_quadrature_points(0).get_data());
+      fe_values.template set_point_set<typename T::point_set_type>(0);
       xq.fill(0.0);
     }
 
     const std::size_t n_test_dof(test_fe_type::n_dof_per_element);
     const std::size_t n_trial_dof(trial_fe_type::n_dof_per_element);
-    array<double> a_el{n_test_dof, n_trial_dof};
 
     // loop over the elements
-    for (unsigned int k(0); k < m.get_cell_number(); ++k) {
-      a_el.fill(0.0);
-
-      // prepare the quadrature points if necessary
-      if (T::point_set_number > 1) {
-	xq_hat = integration_proxy.get_quadrature_points(k);
-	fe_values.set_points(xq_hat);
+    for (std::size_t k(k_begin); k < k_end; ++k) {
+      double* a_el(&a_els.at(k - k_offset, 0, 0));
+      std::fill(a_el, a_el + n_test_dof * n_trial_dof, 0.0);
+
+      {
+        profiler::phase geometry_phase("geometry");
+        
+        // prepare the quadrature points if necessary
+        if (T::point_set_number > 1)
+	  xq_hat.set_data(integration_proxy.get_quadrature_points(k).get_data());
+
+        if (form_type::require_space_coordinates)
+	  cell_type::map_points_to_space_coordinates(xq,
+						     m.get_vertices(),
+						     m.get_cells(),
+						     k, xq_hat);
       }
 
-      if (form_type::require_space_coordinates)
-	cell_type::map_points_to_space_coordinates(xq,
-						   m.get_vertices(),
-						   m.get_cells(),
-						   k, xq_hat);
+      {
+        profiler::phase tabulation_phase("tabulation");
+
+        if (T::point_set_number > 1)
+	  fe_values.template set_point_set<typename T::point_set_type>(integration_proxy.get_point_set_id(k));
 
-      if (form_type::differential_order == 1ul) {
-	// prepare the basis function values
-	const array<double>& jmt(m.get_jmt(k));
-	fe_values.prepare(jmt); 
+        if (form_type::differential_order == 1ul) {
+	  // prepare the basis function values
+	  const auto& jmt(m.get_jmt(k));
+	  fe_values.prepare(jmt); 
+        }
+
+	// bind the coefficient functions to the cell
+	expression_cache cache;
+	integration_proxy.f.template prepare_cell<typename T::point_set_type>(k, integration_proxy.get_point_set_id(k), cache);
       }
       
       const array<double>& psi(fe_values.template get_values<test_fe_index>());
       const array<double>& phi(fe_values.template get_values<trial_fe_index>());
 
       // evaluate the weak form
-      const double volume(m.get_cell_volume(k));
+      profiler::phase kernel_phase("kernel");
       for (unsigned int q(0); q < n_q; ++q) {
-	integration_proxy.f.prepare(k, &xq.at(q, 0ul), &xq_hat.at(q, 0ul));
+	integration_proxy.f.prepare(k, q, &xq.at(q, 0ul), &xq_hat.at(q, 0ul));
 	
 	for (unsigned int i(0); i < n_test_dof; ++i) {
 	  for (unsigned int j(0); j < n_trial_dof; ++j) {
-	    a_el.at(i, j) += omega.at(q) * integration_proxy.f(k,
-							       &xq.at(q, 0), &xq_hat.at(q, 0),
-							       &psi.at(q, i, 0),
-							       &phi.at(q, j, 0));
+	    a_el[i * n_trial_dof + j] += omega.at(q) * integration_proxy.f(k,
+									   &xq.at(q, 0), &xq_hat.at(q, 0),
+									   &psi.at(q, i, 0),
+									   &phi.at(q, j, 0));
 	  }
 	}
       }
-      
-      for (unsigned int i(0); i < n_test_dof; ++i)
-	for (unsigned int j(0); j < n_trial_dof; ++j) {
-	  accumulate(test_fes.get_dof(integration_proxy.get_global_cell_id(k), i),
-		     trial_fes.get_dof(integration_proxy.get_global_cell_id(k), j),
-		     a_el.at(i, j) * volume);
-        }
     }
   }
 
-  expression<form<0,1,0> > get_test_function() const { return form<0,1,0>(); }
-  expression<form<1,2,0> > get_trial_function() const { return form<1,2,0>(); }
+  /*
+   *  Add the element matrix a_el of the cell k (n_test_dof rows of
+   *  n_trial_dof values), scaled by c.
+   */
+  void add_element_matrix(std::size_t k, const double* a_el, double c) {
+    const std::size_t n_test_dof(test_fes_type::fe_type::n_dof_per_element);
+    const std::size_t n_trial_dof(trial_fes_type::fe_type::n_dof_per_element);
+    for (unsigned int i(0); i < n_test_dof; ++i)
+      for (unsigned int j(0); j < n_trial_dof; ++j)
+	accumulate(test_fes.get_dof(k, i), trial_fes.get_dof(k, j), a_el[i * n_trial_dof + j] * c);
+  }
+
+  expression<form<0,1,0,test_fes_type::fe_type::degree> > get_test_function() const {
+    return form<0,1,0,test_fes_type::fe_type::degree>();
+  }
+  expression<form<1,2,0,trial_fes_type::fe_type::degree> > get_trial_function() const {
+    return form<1,2,0,trial_fes_type::fe_type::degree>();
+  }
 
   template<algebraic_block block>
   class algebraic_block_handle;
@@ -122,6 +244,18 @@ public:
   typename trial_fes_type::element solve(const linear_form<test_fes_type>& form,
                                          solver::basic_solver& s,
                                          dictionary* result = nullptr) const {
+    return solve(a, form, s, result);
+  }
+
+  /*
+   *  Solve with the operator op instead of the assembled one, e.g. a
+   *  combination of an operator_cache. op has the rows of the algebraic
+   *  equations, and the identity in the rows of the dirichlet dofs.
+   */
+  typename trial_fes_type::element solve(const matrix& op,
+                                         const linear_form<test_fes_type>& form,
+                                         solver::basic_solver& s,
+                                         dictionary* result = nullptr) const {
     // Add the value of the dirichlet dof in the right hand side
     array<double> f{trial_fes.get_dof_number() + a_dof_number};
     std::copy(&form.get_coefficients().at(0),
@@ -131,18 +265,31 @@ public:
 	      form.get_constraint_values().end(),
 	      &f.at(0) + test_fes.get_dof_number());
     
-    for (const auto& i: test_fes.get_dirichlet_dof_values()) {
-      const auto x(trial_fes.get_dof_space_coordinate(i.first));
+    for (const auto& i: test_fes.get_dirichlet_dof_values())
       f.at(i.first) = i.second;
-    }
     
-    s.set_operator(a);
     array<double> x{trial_fes.get_dof_number() + a_dof_number};
     dictionary r;
-    s.solve(f, x, r);
+    {
+      profiler::scope solve_scope("bilinear_form::solve");
+      if (condensation) {
+        solve_condensed(op, f, s, x, r);
+      } else {
+        profiler::count("nonzeros", op.get_nz_element_number());
+        {
+          profiler::scope setup_scope("solver_setup");
+          s.set_operator(op);
+        }
+        profiler::scope iterations_scope("solver_iterations");
+        s.solve(f, x, r);
+      }
+    }
 
-    if (result)
+    if (result) {
       *result = r;
+      if (profiler::enabled)
+        profiler::report(*result);
+    }
     
     if (a_dof_number == 0) {
       return typename trial_fes_type::element(trial_fes, x);
@@ -156,6 +303,15 @@ public:
     }
   }
 
+  const sparse_matrix& get_operator() const { return a; }
+
+  /*
+   *  Eliminate the dofs of the cell interiors (e.g. the bubbles) before
+   *  the solve, and recover them after (see static_condensation.hpp).
+   *  The test and trial spaces must be the same.
+   */
+  void set_static_condensation(bool enabled) { condensation = enabled; }
+
   void clear() {
     a.clear();
 
@@ -179,6 +335,18 @@ private:
   sparse_matrix a;
   std::size_t a_eq_number;
   std::size_t a_dof_number;
+  bool condensation;
+
+  void solve_condensed(const matrix& op, const array<double>& f, solver::basic_solver& s,
+		       array<double>& x, dictionary& r) const {
+    const sparse_matrix* sparse_op(dynamic_cast<const sparse_matrix*>(&op));
+    if (static_cast<const void*>(&test_fes) != static_cast<const void*>(&trial_fes) or not sparse_op)
+      throw std::string("bilinear_form::solve: the static condensation needs the same test and"
+			" trial spaces, and an assembled operator");
+
+    if (not static_condensation::solve(*sparse_op, f, trial_fes.get_cell_interior_dofs(), s, x, r))
+      throw std::string("bilinear_form::solve: the solve of the condensed system failed");
+  }
 
   void accumulate(std::size_t i, std::size_t j, double value) {
     if (test_fes.get_dirichlet_dof_values().count(i) == 0)
@@ -214,31 +382,36 @@ public:
 
     // prepare the quadrature weights
     const std::size_t n_q(quadrature_type::n_point);
-    array<double> omega{n_q};
+    small_tensor<double, quadrature_type::n_point> omega;
     omega.set_data(&quadrature_type::w[0]);
 
+    // storage for the quadrature points
+    small_tensor<double, quadrature_type::n_point, test_fe_type::cell_type::n_dimension> xq;
+
     // storage for the point-wise basis function evaluation
     fe_value_manager<unique_fe_list> fe_values(n_q), fe_zvalues(n_q);
     fe_zvalues.clear();
 
     if (block == algebraic_block::trial_block) {
       const std::size_t n_trial_dof(trial_fe_type::n_dof_per_element);
-      array<double> a_el{n_trial_dof};
+      small_tensor<double, trial_fe_type::n_dof_per_element> a_el;
     
       // loop over the elements
       for (unsigned int k(0); k < m.get_cell_number(); ++k) {
         a_el.fill(0.0);
       
         // prepare the quadrature points
-        const array<double> xq_hat(integration_proxy.get_quadrature_points(k));
-        const array<double> xq(cell_type::map_points_to_space_coordinates(m.get_vertices(),
-                                                                          m.get_cells(),
-                                                                          k, xq_hat));
+        const array<double>& xq_hat(integration_proxy.get_quadrature_points(k));
+        cell_type::map_points_to_space_coordinates(xq, m.get_vertices(), m.get_cells(), k, xq_hat);
 
         // prepare the basis function values
-        const array<double> jmt(m.get_jmt(k));
-        fe_values.set_points(xq_hat);
+        const auto& jmt(m.get_jmt(k));
+        fe_values.template set_point_set<typename T::point_set_type>(integration_proxy.get_point_set_id(k));
         fe_values.prepare(jmt);
+
+        // bind the coefficient functions to the cell
+        expression_cache cache;
+        integration_proxy.f.template prepare_cell<typename T::point_set_type>(k, integration_proxy.get_point_set_id(k), cache);
       
         const array<double>& psi(fe_zvalues.template get_values<test_fe_index>());
         const array<double>& phi(fe_values.template get_values<trial_fe_index>());
@@ -246,7 +419,7 @@ public:
         // evaluate the weak form
         const double volume(m.get_cell_volume(k));
         for (unsigned int q(0); q < n_q; ++q) {
-          integration_proxy.f.prepare(k, &xq.at(q, 0), &xq_hat.at(q, 0));
+          integration_proxy.f.prepare(k, q, &xq.at(q, 0), &xq_hat.at(q, 0));
 	
           for (unsigned int j(0); j < n_trial_dof; ++j) {
             a_el.at(j) += omega.at(q) * integration_proxy.f(k,
@@ -263,21 +436,23 @@ public:
 
     } else if (block == algebraic_block::test_block) {
       const std::size_t n_test_dof(test_fe_type::n_dof_per_element);
-      array<double> a_el{n_test_dof};
+      small_tensor<double, test_fe_type::n_dof_per_element> a_el;
 
       // loop over the elements
       for (unsigned int k(0); k < m.get_cell_number(); ++k) {
         a_el.fill(0.0);
       
         // prepare the quadrature points
-        const array<double> xq_hat(integration_proxy.get_quadrature_points(k));
-        const array<double> xq(cell_type::map_points_to_space_coordinates(m.get_vertices(),
-                                                                          m.get_cells(),
-                                                                          k, xq_hat));
+        const array<double>& xq_hat(integration_proxy.get_quadrature_points(k));
+        cell_type::map_points_to_space_coordinates(xq, m.get_vertices(), m.get_cells(), k, xq_hat);
         // prepare the basis function values
-        const array<double> jmt(m.get_jmt(k));
-        fe_values.set_points(xq_hat);
+        const auto& jmt(m.get_jmt(k));
+        fe_values.template set_point_set<typename T::point_set_type>(integration_proxy.get_point_set_id(k));
         fe_values.prepare(jmt);
+
+        // bind the coefficient functions to the cell
+        expression_cache cache;
+        integration_proxy.f.template prepare_cell<typename T::point_set_type>(k, integration_proxy.get_point_set_id(k), cache);
       
         const array<double>& psi(fe_values.template get_values<test_fe_index>());
         const array<double>& phi(fe_zvalues.template get_values<trial_fe_index>());
@@ -285,7 +460,7 @@ public:
         // evaluate the weak form
         const double volume(m.get_cell_volume(k));
         for (unsigned int q(0); q < n_q; ++q) {
-          integration_proxy.f.prepare(k, &xq.at(q, 0), &xq_hat.at(q, 0));
+          integration_proxy.f.prepare(k, q, &xq.at(q, 0), &xq_hat.at(q, 0));
           for (unsigned int i(0); i < n_test_dof; ++i) {
             a_el.at(i) += omega.at(q) * integration_proxy.f(k,
                                                             &xq.at(q, 0), &xq_hat.at(q, 0),
@@ -8,6 +8,7 @@
 #include <spikes/array.hpp>
 
 #include "linear_algebra.hpp"
+#include "small_tensor.hpp"
 #include "vector_operation.hpp"
 #include "subdomain.hpp"
 
@@ -73,10 +74,11 @@ namespace cell {
     }
 
 
-    static void map_points_to_space_coordinates(array<double>& hat_xs,
+    template<typename points_type, typename reference_points_type>
+    static void map_points_to_space_coordinates(points_type& hat_xs,
 						const array<double>& vertices,
 						const array<unsigned int>& cells,
-						std::size_t subdomain_id, const array<double>& xs) {
+						std::size_t subdomain_id, const reference_points_type& xs) {
       for (std::size_t i(0); i < xs.get_size(0); ++i) {
 	for (std::size_t n(0); n < xs.get_size(1); ++n)
 	  hat_xs.at(i, n) = vertices.at(cells.at(subdomain_id, 0), n);
@@ -109,6 +111,12 @@ namespace cell {
     static const bool is_simplicial = true;
 
     typedef point boundary_cell_type;
+
+    // the geometry of a cell, stored in place
+    typedef small_tensor<double, n_dimension> vector_type;
+    typedef small_tensor<double, n_dimension, n_dimension> jacobian_type;
+    typedef small_tensor<double, n_vertex_per_cell> barycentric_type;
+    typedef small_tensor<double, n_vertex_per_cell, n_vertex_per_cell> barycentric_map_type;
     
     static std::size_t n_subdomain(unsigned int i) {
       static const std::size_t n_sub[] = {2, 1};
@@ -188,10 +196,10 @@ namespace cell {
 		      - vertices.at(cells.at(k, 1), 0));
     }
 
-    static array<double> get_jmt(const array<double>& vertices,
+    static jacobian_type get_jmt(const array<double>& vertices,
 				 const array<unsigned int>& cells,
 				 unsigned int k) {
-      array<double> jmt{1,1};
+      jacobian_type jmt;
       jmt.at(0,0) = 1.0 / (vertices.at(cells.at(k, 1), 0)
 			   - vertices.at(cells.at(k, 0), 0));
       return jmt;
@@ -226,10 +234,11 @@ namespace cell {
       return hat_xs;
     }
 
-    static void map_points_to_space_coordinates(array<double>& hat_xs,
+    template<typename points_type, typename reference_points_type>
+    static void map_points_to_space_coordinates(points_type& hat_xs,
 						const array<double>& vertices,
 						const array<unsigned int>& cells,
-						std::size_t subdomain_id, const array<double>& xs) {
+						std::size_t subdomain_id, const reference_points_type& xs) {
       for (std::size_t i(0); i < xs.get_size(0); ++i) {
 	for (std::size_t n(0); n < xs.get_size(1); ++n)
 	  hat_xs.at(i, n) = vertices.at(cells.at(subdomain_id, 0), n) +
@@ -245,23 +254,23 @@ namespace cell {
 		      - vertices.at(cells.at(k, 1), 0));
     }
 
-    static array<double> normal(const array<double>& vertices,
-				const array<unsigned int>& cells,
-				std::size_t k) {
+    static small_tensor<double, 2> normal(const array<double>& vertices,
+					  const array<unsigned int>& cells,
+					  std::size_t k) {
       if (vertices.get_size(1) != 2 or cells.get_size(1) != 2)
 	throw std::string("cell::edge: normal is only defined for edges embedded in 2d space");
 
-      array<double> n{2};
+      small_tensor<double, 2> n;
       n.at(0) =  - (vertices.at(cells.at(k, 1), 1) - vertices.at(cells.at(k, 0), 1));
       n.at(1) =    (vertices.at(cells.at(k, 1), 0) - vertices.at(cells.at(k, 0), 0));
 
       return n;
     }
 
-    static array<double> get_barycentric_coordinate_map(const array<double>& vertices,
-							const array<unsigned int>& cells,
-							std::size_t k) {
-      array<double> map{n_vertex_per_cell, n_vertex_per_cell};
+    static barycentric_map_type get_barycentric_coordinate_map(const array<double>& vertices,
+							       const array<unsigned int>& cells,
+							       std::size_t k) {
+      barycentric_map_type map;
 
       for (std::size_t j(0); j < n_vertex_per_cell; ++j)
 	map.at(0, j) = 1.0;
@@ -270,19 +279,17 @@ namespace cell {
 	for (std::size_t i(0); i < n_dimension; ++i)
 	  map.at(i + 1, j) = vertices.at(cells.at(k, j), i);
 
-      matrix_inverse(&map.at(0, 0), n_vertex_per_cell);
+      invert(map);
       
       return map;
     }
 
-    static array<double> get_barycentric_coordinates(const array<double>& vertices,
-						     const array<unsigned int>& cells,
-						     std::size_t k,
-						     const double* x) {
-      const array<double> bc_map(get_barycentric_coordinate_map(vertices, cells, k));
-      array<double>
-	x_coord{n_vertex_per_cell},
-	bc_coord{n_vertex_per_cell};
+    static barycentric_type get_barycentric_coordinates(const array<double>& vertices,
+							const array<unsigned int>& cells,
+							std::size_t k,
+							const double* x) {
+      const barycentric_map_type bc_map(get_barycentric_coordinate_map(vertices, cells, k));
+      barycentric_type x_coord, bc_coord;
 
       x_coord.at(0) = 1.0;
       for (std::size_t i(0); i < n_dimension; ++i)
@@ -311,9 +318,9 @@ namespace cell {
       return bc;
     }
 
-    static array<double> barycenter() {
+    static vector_type barycenter() {
       static const double bc[1] = {0.5};
-      array<double> result{1};
+      vector_type result;
       result.set_data(bc);
       return result;
     }
@@ -336,6 +343,12 @@ namespace cell {
 
     typedef edge boundary_cell_type;
 
+    // the geometry of a cell, stored in place
+    typedef small_tensor<double, n_dimension> vector_type;
+    typedef small_tensor<double, n_dimension, n_dimension> jacobian_type;
+    typedef small_tensor<double, n_vertex_per_cell> barycentric_type;
+    typedef small_tensor<double, n_vertex_per_cell, n_vertex_per_cell> barycentric_map_type;
+
     static std::size_t n_subdomain(unsigned int i) {
       static const std::size_t n_sub[] = {3, 3, 1};
       return n_sub[i];
@@ -453,10 +466,11 @@ namespace cell {
       return hat_xs;
     }
 
-    static void map_points_to_space_coordinates(array<double>& hat_xs,
+    template<typename points_type, typename reference_points_type>
+    static void map_points_to_space_coordinates(points_type& hat_xs,
 						const array<double>& vertices,
 						const array<unsigned int>& cells,
-						std::size_t subdomain_id, const array<double>& xs) {
+						std::size_t subdomain_id, const reference_points_type& xs) {
       for (std::size_t i(0); i < xs.get_size(0); ++i) {
 	for (std::size_t n(0); n < xs.get_size(1); ++n)
 	  hat_xs.at(i, n) = vertices.at(cells.at(subdomain_id, 0), n) 
@@ -486,16 +500,16 @@ namespace cell {
     /*
      * Return the inverse transpose of the jacobian of the T_k(x) mapping
      */
-    static array<double> get_jmt(const array<double>& vertices,
+    static jacobian_type get_jmt(const array<double>& vertices,
 				 const array<unsigned int>& cells,
 				 unsigned int k) {
-      array<double> jmt{2,2};
+      jacobian_type jmt;
       jmt.at(0,0) = vertices.at(cells.at(k, 1), 0) - vertices.at(cells.at(k, 0), 0);
       jmt.at(0,1) = vertices.at(cells.at(k, 2), 0) - vertices.at(cells.at(k, 0), 0);
       jmt.at(1,0) = vertices.at(cells.at(k, 1), 1) - vertices.at(cells.at(k, 0), 1);
       jmt.at(1,1) = vertices.at(cells.at(k, 2), 1) - vertices.at(cells.at(k, 0), 1);
 
-      matrix_inverse(&jmt.at(0,0), 2);
+      invert(jmt);
       std::swap(jmt.at(0, 1), jmt.at(1, 0));
       
       return jmt;
@@ -518,10 +532,10 @@ namespace cell {
       return longest_side;
     }
 
-    static array<double> get_barycentric_coordinate_map(const array<double>& vertices,
-							const array<unsigned int>& cells,
-							std::size_t k) {
-      array<double> map{n_vertex_per_cell, n_vertex_per_cell};
+    static barycentric_map_type get_barycentric_coordinate_map(const array<double>& vertices,
+							       const array<unsigned int>& cells,
+							       std::size_t k) {
+      barycentric_map_type map;
 
       for (std::size_t j(0); j < n_vertex_per_cell; ++j)
 	map.at(0, j) = 1.0;
@@ -530,19 +544,17 @@ namespace cell {
 	for (std::size_t i(0); i < n_dimension; ++i)
 	  map.at(i + 1, j) = vertices.at(cells.at(k, j), i);
 
-      matrix_inverse(&map.at(0, 0), n_vertex_per_cell);
+      invert(map);
       
       return map;
     }
 
-    static array<double> get_barycentric_coordinates(const array<double>& vertices,
-						     const array<unsigned int>& cells,
-						     std::size_t k,
-						     const double* x) {
-      const array<double> bc_map(get_barycentric_coordinate_map(vertices, cells, k));
-      array<double>
-	x_coord{n_vertex_per_cell},
-	bc_coord{n_vertex_per_cell};
+    static barycentric_type get_barycentric_coordinates(const array<double>& vertices,
+							const array<unsigned int>& cells,
+							std::size_t k,
+							const double* x) {
+      const barycentric_map_type bc_map(get_barycentric_coordinate_map(vertices, cells, k));
+      barycentric_type x_coord, bc_coord;
 
       x_coord.at(0) = 1.0;
       for (std::size_t i(0); i < n_dimension; ++i)
@@ -570,26 +582,26 @@ namespace cell {
       return bc;
     }
 
-    static array<double> barycenter() {
+    static vector_type barycenter() {
       static const double bc[] = {1.0 / 3.0, 1.0 / 3.0};
-      array<double> result{2};
+      vector_type result;
       result.set_data(bc);
       return result;
     }
     
-    static array<double> subdomain_normal(const array<double>& vertices,
-					  const array<unsigned int>& cells,
-					  std::size_t k,
-					  std::size_t subdomain_id) {
+    static vector_type subdomain_normal(const array<double>& vertices,
+					const array<unsigned int>& cells,
+					std::size_t k,
+					std::size_t subdomain_id) {
       auto edge(get_edge(cells, k, subdomain_id));
-      std::vector<unsigned int> vertices_id(edge.begin(), edge.end());
+      const unsigned int* vertices_id(edge.begin());
       std::size_t last_vertex(2 - subdomain_id);
 
-      array<double> n{2};
+      vector_type n;
       n.at(0) =  - (vertices.at(vertices_id[1], 1) - vertices.at(vertices_id[0], 1));
       n.at(1) =    (vertices.at(vertices_id[1], 0) - vertices.at(vertices_id[0], 0));
 
-      array<double> m{2};
+      vector_type m;
       m.at(0) =    (vertices.at(cells.at(k, last_vertex), 0) - vertices.at(vertices_id[0], 0));
       m.at(1) =    (vertices.at(cells.at(k, last_vertex), 1) - vertices.at(vertices_id[0], 1));
 
@@ -618,6 +630,12 @@ namespace cell {
 
     typedef triangle boundary_cell_type;
 
+    // the geometry of a cell, stored in place
+    typedef small_tensor<double, n_dimension> vector_type;
+    typedef small_tensor<double, n_dimension, n_dimension> jacobian_type;
+    typedef small_tensor<double, n_vertex_per_cell> barycentric_type;
+    typedef small_tensor<double, n_vertex_per_cell, n_vertex_per_cell> barycentric_map_type;
+
     static std::size_t n_subdomain(unsigned int i) {
       static const std::size_t n_sub[] = {4, 6, 4, 1};
       return n_sub[i];
@@ -781,11 +799,12 @@ namespace cell {
       return hat_xs;
     }
 
-    static void map_points_to_space_coordinates(array<double>& hat_xs,
+    template<typename points_type, typename reference_points_type>
+    static void map_points_to_space_coordinates(points_type& hat_xs,
 						const array<double>& vertices,
 						const array<unsigned int>& cells,
 						std::size_t k,
-						const array<double>& xs) {
+						const reference_points_type& xs) {
       for (std::size_t i(0); i < xs.get_size(0); ++i) {
 	for (std::size_t n(0); n < xs.get_size(1); ++n) {
 	  hat_xs.at(i, n) = vertices.at(cells.at(k, 0), n);
@@ -799,7 +818,7 @@ namespace cell {
     static double get_cell_volume(const array<double>& vertices,
 				  const array<unsigned int>& cells,
 				  unsigned int k) {
-      array<double> a{3}, b{3}, c{3};
+      vector_type a, b, c;
       a.at(0) = vertices.at(cells.at(k, 1), 0) - vertices.at(cells.at(k, 0), 0);
       a.at(1) = vertices.at(cells.at(k, 1), 1) - vertices.at(cells.at(k, 0), 1);
       a.at(2) = vertices.at(cells.at(k, 1), 2) - vertices.at(cells.at(k, 0), 2);
@@ -815,19 +834,19 @@ namespace cell {
       return std::abs(1.0 / 6.0 * dotp(crossp(a, b), c));
     }
 
-    static array<double> get_jmt(const array<double>& vertices,
+    static jacobian_type get_jmt(const array<double>& vertices,
 				 const array<unsigned int>& cells,
 				 unsigned int k) {
       assert(vertices.get_size(1) == n_dimension);
       
-      array<double> jmt{n_dimension, n_dimension};
+      jacobian_type jmt;
 
       for (std::size_t i(0); i < n_dimension; ++i)
 	for (std::size_t j(0); j < n_dimension; ++j) {
 	  jmt.at(j, i) = vertices.at(cells.at(k, 1 + i), j) - vertices.at(cells.at(k, 0), j);
 	}
 
-      matrix_inverse(&jmt.at(0,0), n_dimension);
+      invert(jmt);
 
       for (std::size_t i(0); i < n_dimension - 1; ++i)
 	for (std::size_t j(i + 1); j < n_dimension; ++j)
@@ -854,10 +873,10 @@ namespace cell {
       return longest_side;
     }
 
-    static array<double> get_barycentric_coordinate_map(const array<double>& vertices,
-							const array<unsigned int>& cells,
-							std::size_t k) {
-      array<double> map{n_vertex_per_cell, n_vertex_per_cell};
+    static barycentric_map_type get_barycentric_coordinate_map(const array<double>& vertices,
+							       const array<unsigned int>& cells,
+							       std::size_t k) {
+      barycentric_map_type map;
 
       for (std::size_t j(0); j < n_vertex_per_cell; ++j)
 	map.at(0, j) = 1.0;
@@ -866,19 +885,17 @@ namespace cell {
 	for (std::size_t i(0); i < n_dimension; ++i)
 	  map.at(i + 1, j) = vertices.at(cells.at(k, j), i);
 
-      matrix_inverse(&map.at(0, 0), n_vertex_per_cell);
+      invert(map);
       
       return map;
     }
 
-    static array<double> get_barycentric_coordinates(const array<double>& vertices,
-						     const array<unsigned int>& cells,
-						     std::size_t k,
-						     const double* x) {
-      const array<double> bc_map(get_barycentric_coordinate_map(vertices, cells, k));
-      array<double>
-	x_coord{n_vertex_per_cell},
-	bc_coord{n_vertex_per_cell};
+    static barycentric_type get_barycentric_coordinates(const array<double>& vertices,
+							const array<unsigned int>& cells,
+							std::size_t k,
+							const double* x) {
+      const barycentric_map_type bc_map(get_barycentric_coordinate_map(vertices, cells, k));
+      barycentric_type x_coord, bc_coord;
 
       x_coord.at(0) = 1.0;
       for (std::size_t i(0); i < n_dimension; ++i)
@@ -906,34 +923,34 @@ namespace cell {
       return bc;
     }
 
-    static array<double> barycenter() {
+    static vector_type barycenter() {
       static const double bc[] = {1.0 / 4.0, 1.0 / 4.0, 1.0 / 4.0};
-      array<double> result{3};
+      vector_type result;
       result.set_data(bc);
       return result;
     }
 
-    static array<double> subdomain_normal(const array<double>& vertices,
-					  const array<unsigned int>& cells,
-					  std::size_t k,
-					  std::size_t subdomain_id) {
+    static vector_type subdomain_normal(const array<double>& vertices,
+					const array<unsigned int>& cells,
+					std::size_t k,
+					std::size_t subdomain_id) {
       auto triangle(get_triangle(cells, k, subdomain_id));
-      std::vector<unsigned int> vertices_id(triangle.begin(), triangle.end());
+      const unsigned int* vertices_id(triangle.begin());
       std::size_t last_vertex(3 - subdomain_id);
 
-      array<double> v1{3};
+      vector_type v1;
       v1.at(0) = (vertices.at(vertices_id[1], 0) - vertices.at(vertices_id[0], 0));
       v1.at(1) = (vertices.at(vertices_id[1], 1) - vertices.at(vertices_id[0], 1));
       v1.at(2) = (vertices.at(vertices_id[1], 2) - vertices.at(vertices_id[0], 2));
 
-      array<double> v2{3};
+      vector_type v2;
       v2.at(0) = (vertices.at(vertices_id[2], 0) - vertices.at(vertices_id[0], 0));
       v2.at(1) = (vertices.at(vertices_id[2], 1) - vertices.at(vertices_id[0], 1));
       v2.at(2) = (vertices.at(vertices_id[2], 2) - vertices.at(vertices_id[0], 2));
 
-      array<double> n(crossp(v1, v2));
+      vector_type n(crossp(v1, v2));
 
-      array<double> m{3};
+      vector_type m;
       m.at(0) = (vertices.at(cells.at(k, last_vertex), 0) - vertices.at(vertices_id[0], 0));
       m.at(1) = (vertices.at(cells.at(k, last_vertex), 1) - vertices.at(vertices_id[0], 1));
       m.at(2) = (vertices.at(cells.at(k, last_vertex), 2) - vertices.at(vertices_id[0], 2));
@@ -4,6 +4,8 @@
 #include <spikes/timer.hpp>
 #include <iostream>
 
+#include "profiler.hpp"
+
 template<typename te_cfe_type, typename tr_cfe_type>
 class bilinear_form<composite_finite_element_space<te_cfe_type>,
 		    composite_finite_element_space<tr_cfe_type> > {
@@ -37,7 +39,8 @@ public:
       a(te_cfes.get_total_dof_number(),
 	tr_cfes.get_total_dof_number()),
       a_eq_number(algebraic_equation_number),
-      a_dof_number(algebraic_dof_number) {
+      a_dof_number(algebraic_dof_number),
+      condensation(false) {
     std::size_t test_global_dof_number[n_test_component];
     fill_array_with_return_values<std::size_t,
 				  get_dof_number_impl<test_cfes_type>,
@@ -90,36 +93,87 @@ public:
       const std::size_t n_test_dof(test_fe_type::n_dof_per_element);
       const std::size_t n_trial_dof(trial_fe_type::n_dof_per_element);
 
-      // evaluate the weak form
-      const double volume(integration_proxy.m.get_cell_volume(k));
+      // evaluate the weak form in the element block
+      double a_el[n_test_dof][n_trial_dof] = {};
       for (unsigned int q(0); q < n_q; ++q) {
-        integration_proxy.f.prepare(k, &xq.at(q, 0), &xq_hat.at(q, 0));
-            
-      for (unsigned int i(0); i < n_test_dof; ++i) {
-	for (unsigned int j(0); j < n_trial_dof; ++j) {
-	  double a_el(0.0);
-	    select_function_valuation<test_fe_list, m, unique_fe_list>(psi_phi, q, i,
-								       fe_values, fe_zvalues);
+        integration_proxy.f.prepare(k, q, &xq.at(q, 0), &xq_hat.at(q, 0));
+
+        for (unsigned int i(0); i < n_test_dof; ++i) {
+	  select_function_valuation<test_fe_list, m, unique_fe_list>(psi_phi, q, i,
+								     fe_values, fe_zvalues);
+	  for (unsigned int j(0); j < n_trial_dof; ++j) {
 	    select_function_valuation<trial_fe_list, n, unique_fe_list>(psi_phi + n_test_component, q, j,
 									fe_values, fe_zvalues);
 
-	    a_el += volume * omega.at(q)
+	    a_el[i][j] += omega.at(q)
 	      * (expression_call_wrapper<0, n_test_component + n_trial_component>
 		 ::call(integration_proxy.f, psi_phi,
                         k, &xq.at(q, 0), &xq_hat.at(q, 0)));
-	  bilinear_form.accumulate_in_block<m, n>(bilinear_form.test_cfes.
-						  template get_dof<m>(integration_proxy.
-								      get_global_cell_id(k), i),
-						  bilinear_form.trial_cfes.
-						  template get_dof<n>(integration_proxy.
-								      get_global_cell_id(k), j), a_el);
-        }
+          }
 	}
       }
+
+      // scatter it once in the global matrix
+      bilinear_form.accumulate_block<m, n>(integration_proxy.get_global_cell_id(k),
+					   integration_proxy.m.get_cell_volume(k),
+					   a_el);
+    }
+  };
+
+
+  /*
+   *  Same as evaluate_block, with the reference tensors of the monomials
+   *  of the integrand; geometries[m * n_trial_component + n] describes
+   *  the monomials of the block (m, n).
+   */
+  template<typename B_INFO>
+  struct evaluate_reference_block {
+    using T = get_element_at_t<0, B_INFO>;
+    typedef typename T::quadrature_type quadrature_type;
+
+    static const std::size_t m = get_element_at_t<1, B_INFO>::value;
+    static const std::size_t n = get_element_at_t<2, B_INFO>::value;
+
+    using test_fe_type = get_element_at_t<m, typename test_cfe_type::fe_list>;
+    using trial_fe_type = get_element_at_t<n, typename trial_cfe_type::fe_list>;
+
+    static void call(bilinear_form_type& bilinear_form,
+		     const get_element_at_t<0, B_INFO>& integration_proxy,
+		     const std::size_t k,
+		     const std::vector<reference_geometry>& geometries) {
+      const reference_geometry& geometry(geometries[m * n_trial_component + n]);
+      if (geometry.empty())
+	return;
+
+      const std::size_t n_test_dof(test_fe_type::n_dof_per_element);
+      const std::size_t n_trial_dof(trial_fe_type::n_dof_per_element);
+
+      double g[(fe_cell_type::n_dimension + 1) * (fe_cell_type::n_dimension + 1)];
+      geometry.evaluate(integration_proxy.m.get_jmt(k), g);
+
+      double a_el[n_test_dof][n_trial_dof];
+      reference_tensor<test_fe_type, trial_fe_type, quadrature_type>::instance()
+	.contract(geometry.get_entries(), g, &a_el[0][0]);
+
+      bilinear_form.accumulate_block<m, n>(integration_proxy.get_global_cell_id(k),
+					   integration_proxy.m.get_cell_volume(k),
+					   a_el);
     }
   };
 
 
+  /*
+   *  Only the blocks (m, n) for which the form has a term coupling the
+   *  test function m and the trial function n are assembled.
+   */
+  struct is_nonzero_block {
+    template<typename B_INFO>
+    struct apply: expression_couples<typename get_element_at_t<0, B_INFO>::form_type,
+				     get_element_at_t<1, B_INFO>::value,
+				     n_test_component + get_element_at_t<2, B_INFO>::value> {};
+  };
+
+
   template<typename T>
   void operator+=(const T& integration_proxy) {
     static_assert(T::form_type::rank == 2, "bilinear_form expects rank-2 expression.");
@@ -131,6 +185,8 @@ public:
     // m is the mesh over which we integrate
     const auto& m(integration_proxy.m);
 
+    profiler::scope assembly_scope("composite_bilinear_form::assembly");
+
     // prepare the quadrature weights
     const std::size_t n_q(quadrature_type::n_point);
     array<double> omega{n_q};
@@ -146,51 +202,90 @@ public:
 
     if (T::point_set_number == 1) {
       xq_hat = integration_proxy.get_quadrature_points(0);
-      fe_values.set_points(xq_hat);
+      fe_values.template set_point_set<typename T::point_set_type>(0);
     }
-    
+
+    using test_blocks_il = make_integral_list_t<std::size_t, n_test_component>;
+    using trial_blocks_il = make_integral_list_t<std::size_t, n_trial_component>;
+    using block_list = tensor_product_of_lists_t<test_blocks_il, trial_blocks_il>;
+    using block_info = filter_t<is_nonzero_block, append_to_each_element_t<T, block_list> >;
+
+    // integrands with constant coefficients over the cells are
+    // assembled with the precomputed reference tensors
+    std::vector<reference_monomial> terms;
+    if (T::point_set_number == 1 and expand_reference_monomials(integration_proxy.f, terms)) {
+      std::vector<reference_geometry> geometries;
+      for (std::size_t i(0); i < n_test_component; ++i)
+	for (std::size_t j(0); j < n_trial_component; ++j)
+	  geometries.push_back(reference_geometry(terms, i, n_test_component + j,
+						  fe_cell_type::n_dimension));
+
+      for (unsigned int k(0); k < m.get_cell_number(); ++k) {
+	profiler::phase kernel_phase("kernel");
+	call_for_each<evaluate_reference_block, block_info>::call(*this, integration_proxy, k, geometries);
+      }
+
+      profiler::count("cells", m.get_cell_number());
+      profiler::count("quadrature_points", m.get_cell_number() * n_q);
+      profiler::count("reference_tensor_cells", m.get_cell_number());
+      return;
+    }
+
     for (unsigned int k(0); k < m.get_cell_number(); ++k) {
-      // prepare the quadrature points
-      if (T::point_set_number > 1) {
-	xq_hat = integration_proxy.get_quadrature_points(k);
-	fe_values.set_points(xq_hat);
+      {
+	profiler::phase geometry_phase("geometry");
+
+	// prepare the quadrature points
+	if (T::point_set_number > 1)
+	  xq_hat = integration_proxy.get_quadrature_points(k);
+
+	if (form_type::require_space_coordinates)
+	  cell_type::map_points_to_space_coordinates(xq, m.get_vertices(),
+						     m.get_cells(),
+						     k, xq_hat);
       }
 
-      if (form_type::require_space_coordinates)
-	cell_type::map_points_to_space_coordinates(xq, m.get_vertices(),
-						   m.get_cells(),
-						   k, xq_hat);
+      {
+	profiler::phase tabulation_phase("tabulation");
 
-      // prepare the basis function values
-      if (form_type::differential_order > 0) {
-	const array<double>& jmt(m.get_jmt(k));
-	fe_values.prepare(jmt);
+	if (T::point_set_number > 1)
+	  fe_values.template set_point_set<typename T::point_set_type>(integration_proxy.get_point_set_id(k));
+
+	// prepare the basis function values
+	if (form_type::differential_order > 0) {
+	  const auto& jmt(m.get_jmt(k));
+	  fe_values.prepare(jmt);
+	}
+
+	// bind the coefficient functions to the cell
+	expression_cache cache;
+	integration_proxy.f.template prepare_cell<typename T::point_set_type>(k, integration_proxy.get_point_set_id(k), cache);
       }
 
       /*
        *  Compile time loop over all the blocks
        */
-      using test_blocks_il = make_integral_list_t<std::size_t, n_test_component>;
-      using trial_blocks_il = make_integral_list_t<std::size_t, n_trial_component>;
-      using block_list = tensor_product_of_lists_t<test_blocks_il, trial_blocks_il>;
-      using block_info = append_to_each_element_t<T, block_list>;
-
+      profiler::phase kernel_phase("kernel");
       call_for_each<evaluate_block, block_info>::call(*this, integration_proxy,
 						      k,
 						      omega,
 						      xq, xq_hat,
 						      fe_values, fe_zvalues);
     }
+
+    profiler::count("cells", m.get_cell_number());
+    profiler::count("quadrature_points", m.get_cell_number() * n_q);
   }
 
   template<std::size_t n>
-  expression<form<n, 1, 0> > get_test_function() const {
-    return form<n, 1, 0>();
+  expression<form<n, 1, 0, get_element_at_t<n, test_fe_list>::degree> > get_test_function() const {
+    return form<n, 1, 0, get_element_at_t<n, test_fe_list>::degree>();
   }
 
   template<std::size_t n>
-  expression<form<n + n_test_component, 2, 0> > get_trial_function() const {
-    return form<n + n_test_component, 2, 0>();
+  expression<form<n + n_test_component, 2, 0, get_element_at_t<n, trial_fe_list>::degree> >
+  get_trial_function() const {
+    return form<n + n_test_component, 2, 0, get_element_at_t<n, trial_fe_list>::degree>();
   }
 
 
@@ -198,10 +293,8 @@ public:
   struct handle_dirichlet_dof_values {
     static const std::size_t m = IC::value;
     static void call(const bilinear_form_type& bilinear_form, array<double>& f) {
-      for (const auto& i: bilinear_form.trial_cfes.template get_dirichlet_dof_values<m>()) {
-	const auto x(bilinear_form.trial_cfes.template get_dof_space_coordinate<m>(i.first));
+      for (const auto& i: bilinear_form.trial_cfes.template get_dirichlet_dof_values<m>())
 	f.at(bilinear_form.trial_global_dof_offset[m] + i.first) = i.second;
-      }
     }
   };
 
@@ -220,13 +313,32 @@ public:
 	      form.get_constraint_values().end(),
 	      &f.at(0) + test_cfes.get_total_dof_number());
 
-    s.set_operator(a);
     array<double> x{trial_cfes.get_total_dof_number() + a_dof_number};
     dictionary r;
-    s.solve(f, x, r);
+    {
+      profiler::scope solve_scope("composite_bilinear_form::solve");
+      if (condensation) {
+        if (static_cast<const void*>(&test_cfes) != static_cast<const void*>(&trial_cfes))
+          throw std::string("composite_bilinear_form::solve: the static condensation needs"
+                            " the same test and trial spaces");
+        if (not static_condensation::solve(a, f, trial_cfes.get_cell_interior_dofs(), s, x, r))
+          throw std::string("composite_bilinear_form::solve: the solve of the condensed system failed");
+      } else {
+        profiler::count("nonzeros", a.get_nz_element_number());
+        {
+          profiler::scope setup_scope("solver_setup");
+          s.set_operator(a);
+        }
+        profiler::scope iterations_scope("solver_iterations");
+        s.solve(f, x, r);
+      }
+    }
 
-    if (result)
+    if (result) {
       *result = r;
+      if (profiler::enabled)
+        profiler::report(*result);
+    }
     
     /*
     // Convert to CRS format
@@ -279,6 +391,15 @@ public:
   }
 
 
+  const sparse_matrix& get_operator() const { return a; }
+
+  /*
+   *  Eliminate the dofs of the cell interiors of all the components
+   *  before the solve (see static_condensation.hpp).
+   */
+  void set_static_condensation(bool enabled) { condensation = enabled; }
+
+
   template<typename IC>
   struct handle_dirichlet_dof_equations {
     static const std::size_t m = IC::value;
@@ -324,13 +445,23 @@ private:
 
   std::size_t a_eq_number;
   std::size_t a_dof_number;
-
-  template<std::size_t m, std::size_t n>
-  void accumulate_in_block(std::size_t i, std::size_t j, double value) {
-    if (test_cfes.template get_dirichlet_dof_values<m>().count(i) == 0)
-      a.add(i + test_global_dof_offset[m],
-            j + trial_global_dof_offset[n],
-            value);
+  bool condensation;
+
+  template<std::size_t m, std::size_t n, std::size_t n_test_dof, std::size_t n_trial_dof>
+  void accumulate_block(std::size_t k, double volume,
+			const double (&a_el)[n_test_dof][n_trial_dof]) {
+    std::size_t trial_dof[n_trial_dof];
+    for (std::size_t j(0); j < n_trial_dof; ++j)
+      trial_dof[j] = trial_cfes.template get_dof<n>(k, j) + trial_global_dof_offset[n];
+
+    for (std::size_t i(0); i < n_test_dof; ++i) {
+      const std::size_t test_dof(test_cfes.template get_dof<m>(k, i));
+      if (test_cfes.template get_dirichlet_dof_values<m>().count(test_dof) != 0)
+	continue;
+
+      for (std::size_t j(0); j < n_trial_dof; ++j)
+	a.add(test_dof + test_global_dof_offset[m], trial_dof[j], a_el[i][j] * volume);
+    }
   }
 
   void accumulate(std::size_t i, std::size_t j, double value) {
@@ -387,7 +518,7 @@ public:
 
       const double volume(integration_proxy.m.get_cell_volume(k));
       for (unsigned int q(0); q < n_q; ++q) {
-        integration_proxy.f.prepare(k, &xq.at(q, 0), &xq_hat.at(q, 0));
+        integration_proxy.f.prepare(k, q, &xq.at(q, 0), &xq_hat.at(q, 0));
         for (unsigned int i(0); i < n_trial_dof; ++i) {
           double rhs_el(0.0);
           select_function_valuation<test_fe_list, m, unique_fe_list>(psi_phi, q, 0,
@@ -436,7 +567,7 @@ public:
 
       const double volume(integration_proxy.m.get_cell_volume(k));
       for (unsigned int q(0); q < n_q; ++q) {
-        integration_proxy.f.prepare(k, &xq.at(q, 0), &xq_hat.at(q, 0));
+        integration_proxy.f.prepare(k, q, &xq.at(q, 0), &xq_hat.at(q, 0));
         for (unsigned int i(0); i < n_test_dof; ++i) {
           double rhs_el(0.0);
           //select_function_valuation<test_fe_list, m, unique_fe_list>(psi, q, i, fe_values, fe_zvalues);
@@ -479,23 +610,27 @@ public:
 
     if(T::point_set_number == 1) {
       xq_hat = integration_proxy.get_quadrature_points(0);
-      fe_values.set_points(xq_hat);
+      fe_values.template set_point_set<typename T::point_set_type>(0);
     }
 
     for (unsigned int k(0); k < m.get_cell_number(); ++k) {
       if (T::point_set_number > 1) {
         xq_hat = integration_proxy.get_quadrature_points(k);
-        fe_values.set_points(xq_hat);
+        fe_values.template set_point_set<typename T::point_set_type>(integration_proxy.get_point_set_id(k));
       }
 
       if (form_type::require_space_coordinates)
         cell_type::map_points_to_space_coordinates(xq, m.get_vertices(), m.get_cells(), k, xq_hat);
 
       if (form_type::differential_order > 0) {
-        const array<double>& jmt(m.get_jmt(k));
+        const auto& jmt(m.get_jmt(k));
         fe_values.prepare(jmt);
       }
 
+      // bind the coefficient functions to the cell
+      expression_cache cache;
+      integration_proxy.f.template prepare_cell<typename T::point_set_type>(k, integration_proxy.get_point_set_id(k), cache);
+
       if (block == algebraic_block::trial_block) {
         using trial_blocks_il = wrap_t<type_list, make_integral_list_t<std::size_t, n_trial_component> >;
         using block_info = append_to_each_element_t<T, trial_blocks_il>;
@@ -73,6 +73,26 @@ public:
                               const std::function<double(const double*)>& f_bc) {
     std::get<n>(fe_instances).add_dirichlet_boundary(dm, f_bc);
   }
+
+  template<std::size_t n, typename c_cell_type>
+  void add_dirichlet_boundary(const submesh<cell_type, c_cell_type>& dm,
+                              const std::function<double(const double*)>& f_bc,
+                              parallel::thread_safe_t thread_safe) {
+    std::get<n>(fe_instances).add_dirichlet_boundary(dm, f_bc, thread_safe);
+  }
+
+  template<std::size_t n, typename c_cell_type>
+  void update_dirichlet_boundary(const submesh<cell_type, c_cell_type>& dm,
+                                 const std::function<double(const double*)>& f_bc) {
+    std::get<n>(fe_instances).update_dirichlet_boundary(dm, f_bc);
+  }
+
+  template<std::size_t n, typename c_cell_type>
+  void update_dirichlet_boundary(const submesh<cell_type, c_cell_type>& dm,
+                                 const std::function<double(const double*)>& f_bc,
+                                 parallel::thread_safe_t thread_safe) {
+    std::get<n>(fe_instances).update_dirichlet_boundary(dm, f_bc, thread_safe);
+  }
   
   std::size_t get_total_dof_number() const {
     return dof_number_sum_impl<cfe_type, 0, cfe_type::n_component>::call(*this);
@@ -112,13 +132,57 @@ public:
     return std::get<n>(fe_instances).get_dof_space_coordinate(i);
   }
 
+  template<std::size_t n>
+  const array<double>& get_dof_space_coordinates() const {
+    return std::get<n>(fe_instances).get_dof_space_coordinates();
+  }
+
   template<std::size_t n>
   const finite_element_space<get_element_at_t<n, fe_list> >& get_finite_element_space() const {
     return std::get<n>(fe_instances);
   }
 
+  /*
+   *  The dofs of the cell interiors of all the components, numbered as
+   *  the coefficients of the elements.
+   */
+  array<unsigned int> get_cell_interior_dofs() const {
+    std::vector<array<unsigned int> > interior_dofs;
+    std::vector<std::size_t> offsets;
+    collect_cell_interior_dofs<0>(interior_dofs, offsets, 0);
+
+    std::size_t n_interior(0);
+    for (const auto& d: interior_dofs)
+      n_interior += d.get_size(1);
+
+    const std::size_t n_cell(get_mesh().get_cell_number());
+    array<unsigned int> all_interior_dofs{n_cell, n_interior};
+    for (std::size_t k(0); k < n_cell; ++k) {
+      std::size_t i(0);
+      for (std::size_t c(0); c < interior_dofs.size(); ++c)
+	for (std::size_t n(0); n < interior_dofs[c].get_size(1); ++n)
+	  all_interior_dofs.at(k, i++) = offsets[c] + interior_dofs[c].at(k, n);
+    }
+
+    return all_interior_dofs;
+  }
+
 private:
   std::tuple<finite_element_space<fe_pack>...> fe_instances;
+
+  template<std::size_t n>
+  typename std::enable_if<(n < sizeof...(fe_pack))>::type
+  collect_cell_interior_dofs(std::vector<array<unsigned int> >& interior_dofs,
+			     std::vector<std::size_t>& offsets, std::size_t offset) const {
+    interior_dofs.push_back(std::get<n>(fe_instances).get_cell_interior_dofs());
+    offsets.push_back(offset);
+    collect_cell_interior_dofs<n + 1>(interior_dofs, offsets, offset + get_dof_number<n>());
+  }
+
+  template<std::size_t n>
+  typename std::enable_if<n == sizeof...(fe_pack)>::type
+  collect_cell_interior_dofs(std::vector<array<unsigned int> >&,
+			     std::vector<std::size_t>&, std::size_t) const {}
 };
 
 
@@ -1,6 +1,9 @@
 #ifndef _COMPOSITE_LINEAR_FORM_H_
 #define _COMPOSITE_LINEAR_FORM_H_
 
+#include "profiler.hpp"
+#include "scheduler.hpp"
+
 template<typename te_cfe_type>
 class linear_form<composite_finite_element_space<te_cfe_type> > {
 public:
@@ -19,7 +22,7 @@ public:
     : test_cfes(te_cfes),
       f{te_cfes.get_total_dof_number()},
       constraint_values(algebraic_dof_number, 0.0) {
-    f.fill(0.0);
+    parallel::first_touch_fill(f, 0.0);
 
     std::size_t test_global_dof_number[n_test_component];
     fill_array_with_return_values<std::size_t,
@@ -59,26 +62,40 @@ public:
       const std::size_t n_q(quadrature_type::n_point);
       const std::size_t n_test_dof(test_fe_type::n_dof_per_element);
 
-      // evaluate the weak form
-      const double volume(integration_proxy.m.get_cell_volume(k));
+      // evaluate the weak form in the element block
+      double rhs_el[n_test_dof] = {};
       for (unsigned int q(0); q < n_q; ++q) {
-        integration_proxy.f.prepare(k, &xq.at(q, 0), &xq_hat.at(q, 0));
+        integration_proxy.f.prepare(k, q, &xq.at(q, 0), &xq_hat.at(q, 0));
         for (unsigned int i(0); i < n_test_dof; ++i) {
-          double rhs_el(0.0);
 	  select_function_valuation<test_fe_list, m, unique_fe_list>(psi, q, i,
 								     fe_values, fe_zvalues);
 
-	  rhs_el += volume * omega.at(q)
+	  rhs_el[i] += omega.at(q)
 	    * expression_call_wrapper<0, n_test_component>::call(integration_proxy.f, psi,
 								 k, &xq.at(q, 0), &xq_hat.at(q, 0));
-          linear_form.f.at(linear_form.test_cfes.template get_dof<m>(integration_proxy.get_global_cell_id(k), i)
-                           + linear_form.test_global_dof_offset[m]) += rhs_el;
         }
       }
+
+      // scatter it once in the global vector
+      const double volume(integration_proxy.m.get_cell_volume(k));
+      const std::size_t global_k(integration_proxy.get_global_cell_id(k));
+      for (unsigned int i(0); i < n_test_dof; ++i)
+        linear_form.f.at(linear_form.test_cfes.template get_dof<m>(global_k, i)
+                         + linear_form.test_global_dof_offset[m]) += rhs_el[i] * volume;
     }
   };
 
 
+  /*
+   *  Only the blocks m on which the form depends are assembled.
+   */
+  struct is_nonzero_block {
+    template<typename B_INFO>
+    struct apply: expression_depends_on<typename get_element_at_t<0, B_INFO>::form_type,
+					get_element_at_t<1, B_INFO>::value> {};
+  };
+
+
   template<typename T>
   void operator+=(const T& integration_proxy) {
     static_assert(T::form_type::rank == 1, "linear_form expects rank-2 expression.");
@@ -90,6 +107,8 @@ public:
     // m is the mesh over which we integrate
     const auto& m(integration_proxy.m);
 
+    profiler::scope assembly_scope("composite_linear_form::assembly");
+
     // prepare the quadrature weights
     const std::size_t n_q(quadrature_type::n_point);
     array<double> omega{n_q};
@@ -105,48 +124,64 @@ public:
 
     if (T::point_set_number == 1) {
       xq_hat = integration_proxy.get_quadrature_points(0);
-      fe_values.set_points(xq_hat);
+      fe_values.template set_point_set<typename T::point_set_type>(0);
     }
 
     for (unsigned int k(0); k < m.get_cell_number(); ++k) {
 
-      // prepare the quadrature points
-      if (T::point_set_number > 1) {
-	xq_hat = integration_proxy.get_quadrature_points(k);
-	fe_values.set_points(xq_hat);
-      }
+      {
+	profiler::phase geometry_phase("geometry");
 
-      if (form_type::require_space_coordinates)
-	cell_type::map_points_to_space_coordinates(xq, m.get_vertices(),
-						   m.get_cells(),
-						   k, xq_hat);
+	// prepare the quadrature points
+	if (T::point_set_number > 1)
+	  xq_hat = integration_proxy.get_quadrature_points(k);
 
-      // prepare the basis function values
-      if (form_type::differential_order > 0) {
-	const array<double>& jmt(m.get_jmt(k));
-	fe_values.prepare(jmt);
+	if (form_type::require_space_coordinates)
+	  cell_type::map_points_to_space_coordinates(xq, m.get_vertices(),
+						     m.get_cells(),
+						     k, xq_hat);
       }
 
+      {
+	profiler::phase tabulation_phase("tabulation");
+
+	if (T::point_set_number > 1)
+	  fe_values.template set_point_set<typename T::point_set_type>(integration_proxy.get_point_set_id(k));
+
+	// prepare the basis function values
+	if (form_type::differential_order > 0) {
+	  const auto& jmt(m.get_jmt(k));
+	  fe_values.prepare(jmt);
+	}
+
+	// bind the coefficient functions to the cell
+	expression_cache cache;
+	integration_proxy.f.template prepare_cell<typename T::point_set_type>(k, integration_proxy.get_point_set_id(k), cache);
+      }
 
       /*
        *  Compile time loop over all the blocks
        */
       using test_blocks_il = wrap_t<type_list, make_integral_list_t<std::size_t, n_test_component> >;
-      using block_info = append_to_each_element_t<T, test_blocks_il>;
+      using block_info = filter_t<is_nonzero_block, append_to_each_element_t<T, test_blocks_il> >;
 
+      profiler::phase kernel_phase("kernel");
       call_for_each<evaluate_block, block_info>::call(*this, integration_proxy,
 						      k,
 						      omega,
 						      xq, xq_hat,
 						      fe_values, fe_zvalues);
     }
+
+    profiler::count("cells", m.get_cell_number());
+    profiler::count("quadrature_points", m.get_cell_number() * n_q);
   }
 
   double& algebraic_equation_value(std::size_t a_dof) { return constraint_values[a_dof]; }
   
   template<std::size_t n>
-  expression<form<n, 1, 0> > get_test_function() const {
-    return form<n, 1, 0>();
+  expression<form<n, 1, 0, get_element_at_t<n, test_fe_list>::degree> > get_test_function() const {
+    return form<n, 1, 0, get_element_at_t<n, test_fe_list>::degree>();
   }
 
   const std::vector<double>& get_constraint_values() const { return constraint_values; }
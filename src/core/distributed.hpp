@@ -0,0 +1,578 @@
+#ifndef DISTRIBUTED_H
+#define DISTRIBUTED_H
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <mpi.h>
+
+#include <spikes/array.hpp>
+
+#include "mesh.hpp"
+#include "fes.hpp"
+#include "form.hpp"
+#include "solver.hpp"
+#include "dictionary.hpp"
+#include "profiler.hpp"
+
+
+/*
+ * Distributed-memory domain decomposition.
+ *
+ * A distributed::partitioned_mesh keeps, on each rank of a
+ * communicator, the cells owned by the rank, followed by a layer of
+ * ghost cells which share a vertex with an owned cell. The global mesh
+ * and the partition (the owning rank of each cell) must be known by
+ * every rank at construction; only the local cells are kept afterwards.
+ *
+ * A distributed::distributed_fes numbers the dofs of the owned cells
+ * globally. A dof is owned by the rank which owns the cell with the
+ * smallest global id among the cells containing it; since the ghost
+ * layer contains every cell around the dofs of the owned cells, all
+ * the ranks agree on it without communication. Each rank numbers its
+ * owned dofs contiguously, and asks the owners for the numbers of the
+ * other dofs of its owned cells.
+ *
+ * The forms are assembled rank-locally with the usual bilinear_form
+ * and linear_form on the local finite element space, by integrating
+ * over get_owned_mesh(), whose cells are the first cells of the local
+ * mesh. distributed::solve then adds them in a PETSc MATMPIAIJ matrix
+ * and a VECMPI vector (PETSc communicates the contributions to the rows
+ * owned by other ranks), solves the system, and scatters the owned
+ * values of the solution to the ghost dofs of the other ranks.
+ */
+namespace distributed {
+
+  namespace detail {
+    /*
+     *  Send send[r] to the rank r, and return the vectors received from
+     *  each rank.
+     */
+    template<typename T>
+    std::vector<std::vector<T> > exchange(MPI_Comm comm,
+					  const std::vector<std::vector<T> >& send,
+					  MPI_Datatype type) {
+      const std::size_t n_rank(send.size());
+
+      std::vector<int> send_count(n_rank), recv_count(n_rank);
+      for (std::size_t r(0); r < n_rank; ++r)
+	send_count[r] = send[r].size();
+      MPI_Alltoall(&send_count[0], 1, MPI_INT, &recv_count[0], 1, MPI_INT, comm);
+
+      std::vector<int> send_offset(n_rank, 0), recv_offset(n_rank, 0);
+      for (std::size_t r(1); r < n_rank; ++r) {
+	send_offset[r] = send_offset[r - 1] + send_count[r - 1];
+	recv_offset[r] = recv_offset[r - 1] + recv_count[r - 1];
+      }
+
+      std::vector<T> send_buffer(send_offset.back() + send_count.back() + 1);
+      std::vector<T> recv_buffer(recv_offset.back() + recv_count.back() + 1);
+      for (std::size_t r(0); r < n_rank; ++r)
+	std::copy(send[r].begin(), send[r].end(), send_buffer.begin() + send_offset[r]);
+
+      MPI_Alltoallv(&send_buffer[0], &send_count[0], &send_offset[0], type,
+		    &recv_buffer[0], &recv_count[0], &recv_offset[0], type, comm);
+
+      std::vector<std::vector<T> > recv(n_rank);
+      for (std::size_t r(0); r < n_rank; ++r)
+	recv[r].assign(recv_buffer.begin() + recv_offset[r],
+		       recv_buffer.begin() + recv_offset[r] + recv_count[r]);
+      return recv;
+    }
+  }
+
+
+  template<typename cell_t>
+  class partitioned_mesh {
+  public:
+    typedef cell_t cell_type;
+
+    /*
+     *  Partition the cells of global_mesh in contiguous blocks of cell ids.
+     */
+    partitioned_mesh(const fe_mesh<cell_type>& global_mesh, MPI_Comm comm = MPI_COMM_WORLD)
+      : partitioned_mesh(global_mesh, block_partition(global_mesh.get_cell_number(), comm), comm) {}
+
+    /*
+     *  The cell k of global_mesh is owned by the rank cell_part[k], for
+     *  instance computed by partition::get_cell_partition.
+     */
+    partitioned_mesh(const fe_mesh<cell_type>& global_mesh,
+		     const std::vector<unsigned int>& cell_part,
+		     MPI_Comm comm = MPI_COMM_WORLD)
+      : comm(comm), global_cell_number(global_mesh.get_cell_number()) {
+      MPI_Comm_rank(comm, &rank);
+      MPI_Comm_size(comm, &size);
+
+      if (cell_part.size() != global_cell_number)
+	throw std::string("distributed::partitioned_mesh: the partition size differs from the cell number");
+
+      const array<unsigned int>& cells(global_mesh.get_cells());
+      const std::size_t n_vertex_per_cell(cell_type::n_vertex_per_cell);
+      const std::size_t n_dimension(global_mesh.get_embedding_space_dimension());
+
+      // the owned cells, followed by the ghost cells
+      std::vector<bool> owned_vertex(global_mesh.get_vertex_number(), false);
+      for (std::size_t k(0); k < global_cell_number; ++k)
+	if (cell_part[k] == static_cast<unsigned int>(rank)) {
+	  global_cell_id.push_back(k);
+	  for (std::size_t n(0); n < n_vertex_per_cell; ++n)
+	    owned_vertex[cells.at(k, n)] = true;
+	}
+      owned_cell_number = global_cell_id.size();
+
+      for (std::size_t k(0); k < global_cell_number; ++k)
+	if (cell_part[k] != static_cast<unsigned int>(rank))
+	  for (std::size_t n(0); n < n_vertex_per_cell; ++n)
+	    if (owned_vertex[cells.at(k, n)]) {
+	      global_cell_id.push_back(k);
+	      break;
+	    }
+
+      cell_owner.resize(global_cell_id.size());
+      for (std::size_t k(0); k < global_cell_id.size(); ++k)
+	cell_owner[k] = cell_part[global_cell_id[k]];
+
+      // the local vertices, in the order of their global ids, so that
+      // the vertices of the cells stay sorted
+      const unsigned int no_vertex(std::numeric_limits<unsigned int>::max());
+      std::vector<unsigned int> local_vertex_id(global_mesh.get_vertex_number(), no_vertex);
+      for (const auto k: global_cell_id)
+	for (std::size_t n(0); n < n_vertex_per_cell; ++n)
+	  local_vertex_id[cells.at(k, n)] = 0;
+      for (std::size_t i(0); i < local_vertex_id.size(); ++i)
+	if (local_vertex_id[i] != no_vertex) {
+	  local_vertex_id[i] = global_vertex_id.size();
+	  global_vertex_id.push_back(i);
+	}
+
+      array<double> vertices{global_vertex_id.size(), n_dimension};
+      for (std::size_t i(0); i < global_vertex_id.size(); ++i)
+	for (std::size_t n(0); n < n_dimension; ++n)
+	  vertices.at(i, n) = global_mesh.get_vertices().at(global_vertex_id[i], n);
+
+      array<unsigned int> local_cells{global_cell_id.size(), n_vertex_per_cell};
+      array<unsigned int> local_references{global_cell_id.size()};
+      array<unsigned int> owned_cells{owned_cell_number, n_vertex_per_cell};
+      array<unsigned int> owned_references{owned_cell_number};
+      for (std::size_t k(0); k < global_cell_id.size(); ++k) {
+	for (std::size_t n(0); n < n_vertex_per_cell; ++n)
+	  local_cells.at(k, n) = local_vertex_id[cells.at(global_cell_id[k], n)];
+	local_references.at(k) = global_mesh.get_references().at(global_cell_id[k]);
+
+	if (k < owned_cell_number) {
+	  for (std::size_t n(0); n < n_vertex_per_cell; ++n)
+	    owned_cells.at(k, n) = local_cells.at(k, n);
+	  owned_references.at(k) = local_references.at(k);
+	}
+      }
+
+      array<double> owned_vertices(vertices);
+      local.reset(new fe_mesh<cell_type>(std::move(vertices), std::move(local_cells),
+					 std::move(local_references)));
+      owned.reset(new fe_mesh<cell_type>(std::move(owned_vertices), std::move(owned_cells),
+					 std::move(owned_references)));
+
+      // the faces of the global boundary whose vertices are all local
+      const submesh<cell_type> global_boundary(global_mesh.get_boundary_submesh());
+      for (std::size_t k(0); k < global_boundary.get_cell_number(); ++k) {
+	std::vector<unsigned int> face;
+	for (std::size_t n(0); n < global_boundary.get_cells().get_size(1); ++n)
+	  face.push_back(local_vertex_id[global_boundary.get_cells().at(k, n)]);
+
+	if (std::find(face.begin(), face.end(), no_vertex) == face.end()) {
+	  std::sort(face.begin(), face.end());
+	  boundary_faces.insert(face);
+	}
+      }
+    }
+
+    partitioned_mesh(const partitioned_mesh&) = delete;
+    partitioned_mesh& operator=(const partitioned_mesh&) = delete;
+
+    MPI_Comm get_communicator() const { return comm; }
+    int get_rank() const { return rank; }
+    int get_size() const { return size; }
+
+    const fe_mesh<cell_type>& get_local_mesh() const { return *local; }
+    const fe_mesh<cell_type>& get_owned_mesh() const { return *owned; }
+
+    std::size_t get_global_cell_number() const { return global_cell_number; }
+    std::size_t get_owned_cell_number() const { return owned_cell_number; }
+    std::size_t get_ghost_cell_number() const { return global_cell_id.size() - owned_cell_number; }
+
+    std::size_t get_global_cell_id(std::size_t k) const { return global_cell_id[k]; }
+    std::size_t get_global_vertex_id(std::size_t i) const { return global_vertex_id[i]; }
+    unsigned int get_cell_owner(std::size_t k) const { return cell_owner[k]; }
+    bool is_owned_cell(std::size_t k) const { return k < owned_cell_number; }
+
+    /*
+     *  The faces of the local mesh which lie on the boundary of the
+     *  global mesh, excluding the artificial boundary of the ghost layer.
+     */
+    submesh<cell_type> get_boundary_submesh() const {
+      const submesh<cell_type> local_boundary(local->get_boundary_submesh());
+
+      std::vector<std::size_t> selected;
+      for (std::size_t k(0); k < local_boundary.get_cell_number(); ++k) {
+	std::vector<unsigned int> face(&local_boundary.get_cells().at(k, 0),
+				       &local_boundary.get_cells().at(k, 0)
+				       + local_boundary.get_cells().get_size(1));
+	std::sort(face.begin(), face.end());
+	if (boundary_faces.count(face))
+	  selected.push_back(k);
+      }
+
+      array<unsigned int> el{selected.size(), local_boundary.get_cells().get_size(1)};
+      array<unsigned int> el_id{selected.size()};
+      array<unsigned int> sd_id{selected.size()};
+      for (std::size_t n(0); n < selected.size(); ++n) {
+	for (std::size_t i(0); i < el.get_size(1); ++i)
+	  el.at(n, i) = local_boundary.get_cells().at(selected[n], i);
+	el_id.at(n) = local_boundary.get_parent_cell_id(selected[n]);
+	sd_id.at(n) = local_boundary.get_subdomain_id(selected[n]);
+      }
+
+      return submesh<cell_type>(*local, el, el_id, sd_id);
+    }
+
+    static std::vector<unsigned int> block_partition(std::size_t n_cell, MPI_Comm comm) {
+      int n_rank(1);
+      MPI_Comm_size(comm, &n_rank);
+
+      std::vector<unsigned int> cell_part(n_cell);
+      for (std::size_t k(0); k < n_cell; ++k)
+	cell_part[k] = k * n_rank / n_cell;
+      return cell_part;
+    }
+
+  private:
+    MPI_Comm comm;
+    int rank, size;
+
+    std::size_t global_cell_number, owned_cell_number;
+    std::vector<std::size_t> global_cell_id, global_vertex_id;
+    std::vector<unsigned int> cell_owner;
+
+    std::unique_ptr<fe_mesh<cell_type> > local, owned;
+    std::set<std::vector<unsigned int> > boundary_faces;
+  };
+
+
+  template<typename fe>
+  class distributed_fes {
+  public:
+    typedef fe fe_type;
+    typedef typename fe_type::cell_type cell_type;
+    typedef finite_element_space<fe_type> fes_type;
+
+    distributed_fes(const partitioned_mesh<cell_type>& pm)
+      : pm(pm), fes(new fes_type(pm.get_local_mesh())) {
+      number_dofs();
+    }
+
+    /*
+     *  With Dirichlet boundary conditions on the boundary of the global mesh.
+     */
+    distributed_fes(const partitioned_mesh<cell_type>& pm,
+		    const std::function<double(const double*)>& f_bc)
+      : pm(pm), fes(new fes_type(pm.get_local_mesh())) {
+      fes->add_dirichlet_boundary(pm.get_boundary_submesh(), f_bc);
+      number_dofs();
+    }
+
+    distributed_fes(const distributed_fes&) = delete;
+    distributed_fes& operator=(const distributed_fes&) = delete;
+
+    const partitioned_mesh<cell_type>& get_partitioned_mesh() const { return pm; }
+    const fes_type& get_local_fes() const { return *fes; }
+    MPI_Comm get_communicator() const { return pm.get_communicator(); }
+
+    std::size_t get_owned_dof_number() const { return owned_dof_number; }
+    std::size_t get_global_dof_number() const { return global_dof_number; }
+    std::size_t get_dof_offset() const { return dof_offset; }
+
+    /*
+     *  The local dof i is relevant when it belongs to an owned cell;
+     *  only the relevant dofs have a global number.
+     */
+    bool is_relevant(std::size_t i) const { return relevant[i]; }
+    bool is_owned(std::size_t i) const { return relevant[i] and dof_owner[i] == static_cast<unsigned int>(pm.get_rank()); }
+    std::size_t get_global_dof(std::size_t i) const { return global_dof[i]; }
+
+    /*
+     *  Copy the values of the owned dofs to the corresponding ghost dofs
+     *  of the other ranks. This is a collective operation.
+     */
+    void update_ghosts(array<double>& values) const {
+      std::vector<std::vector<double> > send(pm.get_size());
+      for (std::size_t r(0); r < send.size(); ++r)
+	for (const auto i: shared_dofs[r])
+	  send[r].push_back(values.at(i));
+
+      const std::vector<std::vector<double> >
+	recv(detail::exchange(get_communicator(), send, MPI_DOUBLE));
+      for (std::size_t r(0); r < recv.size(); ++r)
+	for (std::size_t n(0); n < recv[r].size(); ++n)
+	  values.at(ghost_dofs[r][n]) = recv[r][n];
+    }
+
+  private:
+    const partitioned_mesh<cell_type>& pm;
+    std::unique_ptr<fes_type> fes;
+
+    std::size_t owned_dof_number, global_dof_number, dof_offset;
+    std::vector<bool> relevant;
+    std::vector<unsigned int> dof_owner;
+    std::vector<std::size_t> global_dof;
+
+    // ghost_dofs[r]: local relevant dofs owned by r, shared_dofs[r]:
+    // local owned dofs which are ghosts of r, in the same order on both sides
+    std::vector<std::vector<std::size_t> > ghost_dofs, shared_dofs;
+
+    void number_dofs() {
+      const std::size_t n_dof(fes->get_dof_number());
+      const std::size_t n_dof_per_element(fe_type::n_dof_per_element);
+      const std::uint64_t no_key(std::numeric_limits<std::uint64_t>::max());
+      const unsigned int rank(pm.get_rank());
+
+      /*
+       *  The key of a dof is the smallest (global cell id, local dof id)
+       *  pair among the cells containing it.
+       */
+      std::vector<std::uint64_t> key(n_dof, no_key);
+      relevant.assign(n_dof, false);
+      dof_owner.assign(n_dof, 0);
+      for (std::size_t k(0); k < pm.get_local_mesh().get_cell_number(); ++k)
+	for (std::size_t j(0); j < n_dof_per_element; ++j) {
+	  const std::size_t i(fes->get_dof(k, j));
+	  const std::uint64_t k_key(static_cast<std::uint64_t>(pm.get_global_cell_id(k)) * n_dof_per_element + j);
+	  if (k_key < key[i]) {
+	    key[i] = k_key;
+	    dof_owner[i] = pm.get_cell_owner(k);
+	  }
+	  if (pm.is_owned_cell(k))
+	    relevant[i] = true;
+	}
+
+      // number the owned dofs contiguously
+      std::uint64_t n_owned(0), offset(0), n_global(0);
+      for (std::size_t i(0); i < n_dof; ++i)
+	if (is_owned(i))
+	  ++n_owned;
+      MPI_Exscan(&n_owned, &offset, 1, MPI_UINT64_T, MPI_SUM, get_communicator());
+      MPI_Allreduce(&n_owned, &n_global, 1, MPI_UINT64_T, MPI_SUM, get_communicator());
+      if (rank == 0)
+	offset = 0;
+
+      owned_dof_number = n_owned;
+      global_dof_number = n_global;
+      dof_offset = offset;
+
+      global_dof.assign(n_dof, std::numeric_limits<std::size_t>::max());
+      std::unordered_map<std::uint64_t, std::size_t> owned_keys;
+      for (std::size_t i(0), n(0); i < n_dof; ++i)
+	if (is_owned(i)) {
+	  global_dof[i] = dof_offset + n++;
+	  owned_keys[key[i]] = i;
+	}
+
+      // ask the owners for the numbers of the other relevant dofs
+      const std::size_t n_rank(pm.get_size());
+      ghost_dofs.assign(n_rank, std::vector<std::size_t>());
+      std::vector<std::vector<std::uint64_t> > requests(n_rank);
+      for (std::size_t i(0); i < n_dof; ++i)
+	if (relevant[i] and dof_owner[i] != rank) {
+	  ghost_dofs[dof_owner[i]].push_back(i);
+	  requests[dof_owner[i]].push_back(key[i]);
+	}
+
+      const std::vector<std::vector<std::uint64_t> >
+	received(detail::exchange(get_communicator(), requests, MPI_UINT64_T));
+
+      shared_dofs.assign(n_rank, std::vector<std::size_t>());
+      std::vector<std::vector<std::uint64_t> > replies(n_rank);
+      for (std::size_t r(0); r < n_rank; ++r)
+	for (const auto k: received[r]) {
+	  const auto dof(owned_keys.find(k));
+	  if (dof == owned_keys.end())
+	    throw std::string("distributed::distributed_fes: requested dof is not owned");
+	  shared_dofs[r].push_back(dof->second);
+	  replies[r].push_back(global_dof[dof->second]);
+	}
+
+      const std::vector<std::vector<std::uint64_t> >
+	numbers(detail::exchange(get_communicator(), replies, MPI_UINT64_T));
+      for (std::size_t r(0); r < n_rank; ++r)
+	for (std::size_t n(0); n < numbers[r].size(); ++n)
+	  global_dof[ghost_dofs[r][n]] = numbers[r][n];
+    }
+  };
+
+
+  /*
+   *  Solve the system assembled rank-locally in a and f with a parallel
+   *  GMRES preconditioned by block Jacobi (ILU(0) on each rank). The
+   *  parameters are "maxits", "restart", "rtol", "atol" and "dtol". The
+   *  returned element holds the values of the relevant local dofs.
+   */
+  template<typename fe_type>
+  typename finite_element_space<fe_type>::element
+  solve(const distributed_fes<fe_type>& fes,
+	const bilinear_form<finite_element_space<fe_type>, finite_element_space<fe_type> >& a,
+	const linear_form<finite_element_space<fe_type> >& f,
+	const dictionary& params,
+	dictionary* result = nullptr) {
+    std::vector<std::string> expected_keys {
+      "maxits", "restart", "rtol", "atol", "dtol"
+    };
+    if (not params.keys_exist(expected_keys.begin(), expected_keys.end()))
+      throw std::string("distributed::solve: missing key(s) in parameter dictionary.");
+
+    const finite_element_space<fe_type>& local_fes(fes.get_local_fes());
+    const sparse_matrix& a_local(a.get_operator());
+    if (a_local.get_row_number() != local_fes.get_dof_number()
+	or a_local.get_column_number() != local_fes.get_dof_number())
+      throw std::string("distributed::solve: algebraic constraints are not supported");
+
+    const auto& petsc_init(solver::petsc::initialize::instance());
+    ignore_unused(petsc_init);
+
+    MPI_Comm comm(fes.get_communicator());
+    const std::size_t n_dof(local_fes.get_dof_number());
+    const PetscInt n_owned(fes.get_owned_dof_number());
+    const PetscInt n_global(fes.get_global_dof_number());
+    const std::size_t offset(fes.get_dof_offset());
+    const auto& dirichlet(local_fes.get_dirichlet_dof_values());
+
+    // the Dirichlet rows are inserted by their owner only, the other
+    // rows by every rank which has a contribution to them
+    auto inserted_row = [&](std::size_t i) -> bool {
+      return dirichlet.count(i) ? fes.is_owned(i) : fes.is_relevant(i);
+    };
+
+    PetscErrorCode ierr;
+    Mat m;
+    Vec b, x;
+    KSP ksp;
+
+    array<double> coefficients{n_dof};
+    coefficients.fill(0.0);
+    dictionary r;
+    {
+      profiler::scope solve_scope("distributed::solve");
+      {
+	profiler::scope setup_scope("solver_setup");
+
+	// preallocation from the local rows; the rows shared with other
+	// ranks receive more entries, which PETSc allocates on the fly
+	std::vector<PetscInt> d_nnz(n_owned, 0), o_nnz(n_owned, 0);
+	for (const auto& v: a_local.get_values())
+	  if (fes.is_owned(v.first.first)) {
+	    const std::size_t i(fes.get_global_dof(v.first.first) - offset);
+	    const std::size_t j(fes.get_global_dof(v.first.second));
+	    if (offset <= j and j < offset + n_owned)
+	      d_nnz[i] = std::min<PetscInt>(d_nnz[i] + 1, n_owned);
+	    else
+	      o_nnz[i] = std::min<PetscInt>(o_nnz[i] + 1, n_global - n_owned);
+	  }
+
+	ierr = MatCreate(comm, &m);CHKERRCONTINUE(ierr);
+	ierr = MatSetSizes(m, n_owned, n_owned, n_global, n_global);CHKERRCONTINUE(ierr);
+	ierr = MatSetType(m, MATMPIAIJ);CHKERRCONTINUE(ierr);
+	ierr = MatMPIAIJSetPreallocation(m, 0, n_owned ? &d_nnz[0] : nullptr,
+					 0, n_owned ? &o_nnz[0] : nullptr);CHKERRCONTINUE(ierr);
+	ierr = MatSetOption(m, MAT_NEW_NONZERO_ALLOCATION_ERR, PETSC_FALSE);CHKERRCONTINUE(ierr);
+
+	for (const auto& v: a_local.get_values())
+	  if (inserted_row(v.first.first)) {
+	    const PetscInt i(fes.get_global_dof(v.first.first));
+	    const PetscInt j(fes.get_global_dof(v.first.second));
+	    const PetscScalar value(v.second);
+	    ierr = MatSetValues(m, 1, &i, 1, &j, &value, ADD_VALUES);CHKERRCONTINUE(ierr);
+	  }
+
+	ierr = VecCreate(comm, &b);CHKERRCONTINUE(ierr);
+	ierr = VecSetSizes(b, n_owned, n_global);CHKERRCONTINUE(ierr);
+	ierr = VecSetType(b, VECMPI);CHKERRCONTINUE(ierr);
+	ierr = VecSet(b, 0.0);CHKERRCONTINUE(ierr);
+
+	const array<double>& rhs(f.get_coefficients());
+	for (std::size_t i(0); i < n_dof; ++i)
+	  if (inserted_row(i)) {
+	    const auto bc(dirichlet.find(i));
+	    const PetscScalar value(bc != dirichlet.end() ? bc->second : rhs.at(i));
+	    ierr = VecSetValue(b, fes.get_global_dof(i), value, ADD_VALUES);CHKERRCONTINUE(ierr);
+	  }
+
+	ierr = MatAssemblyBegin(m, MAT_FINAL_ASSEMBLY);CHKERRCONTINUE(ierr);
+	ierr = VecAssemblyBegin(b);CHKERRCONTINUE(ierr);
+	ierr = MatAssemblyEnd(m, MAT_FINAL_ASSEMBLY);CHKERRCONTINUE(ierr);
+	ierr = VecAssemblyEnd(b);CHKERRCONTINUE(ierr);
+
+	ierr = KSPCreate(comm, &ksp);CHKERRCONTINUE(ierr);
+	ierr = KSPSetOperators(ksp, m, m);CHKERRCONTINUE(ierr);
+	ierr = KSPSetType(ksp, KSPGMRES);CHKERRCONTINUE(ierr);
+	ierr = KSPSetTolerances(ksp,
+				params.get<double>("rtol"),
+				params.get<double>("atol"),
+				params.get<double>("dtol"),
+				params.get<unsigned int>("maxits"));CHKERRCONTINUE(ierr);
+	ierr = KSPGMRESSetRestart(ksp, params.get<unsigned int>("restart"));CHKERRCONTINUE(ierr);
+
+	PC pc;
+	ierr = KSPGetPC(ksp, &pc);CHKERRCONTINUE(ierr);
+	ierr = PCSetType(pc, PCBJACOBI);CHKERRCONTINUE(ierr);
+      }
+
+      {
+	profiler::scope iterations_scope("solver_iterations");
+
+	ierr = VecDuplicate(b, &x);CHKERRCONTINUE(ierr);
+	ierr = VecSet(x, 0.0);CHKERRCONTINUE(ierr);
+	ierr = KSPSolve(ksp, b, x);CHKERRCONTINUE(ierr);
+
+	PetscInt iterations(0);
+	ierr = KSPGetIterationNumber(ksp, &iterations);CHKERRCONTINUE(ierr);
+	r.set("iterations", static_cast<std::size_t>(iterations));
+	profiler::count("krylov_iterations", iterations);
+      }
+
+      // gather the owned values, and scatter them to the ghost dofs
+      std::vector<PetscInt> ix(n_owned);
+      std::vector<PetscScalar> values(n_owned);
+      for (PetscInt n(0); n < n_owned; ++n)
+	ix[n] = offset + n;
+      if (n_owned) {
+	ierr = VecGetValues(x, n_owned, &ix[0], &values[0]);CHKERRCONTINUE(ierr);
+      }
+
+      for (std::size_t i(0); i < n_dof; ++i)
+	if (fes.is_owned(i))
+	  coefficients.at(i) = values[fes.get_global_dof(i) - offset];
+      fes.update_ghosts(coefficients);
+
+      ierr = KSPDestroy(&ksp);CHKERRCONTINUE(ierr);
+      ierr = VecDestroy(&x);CHKERRCONTINUE(ierr);
+      ierr = VecDestroy(&b);CHKERRCONTINUE(ierr);
+      ierr = MatDestroy(&m);CHKERRCONTINUE(ierr);
+    }
+
+    if (result) {
+      *result = r;
+      if (profiler::enabled)
+	profiler::report(*result);
+    }
+
+    return typename finite_element_space<fe_type>::element(local_fes, coefficients);
+  }
+}
+
+#endif /* DISTRIBUTED_H */
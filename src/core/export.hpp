@@ -5,10 +5,20 @@
 #include <iomanip>
 #include <fstream>
 #include <type_traits>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstring>
+
+#ifdef ENABLE_ZLIB
+#include <zlib.h>
+#endif
 
 #include "quadrature.hpp"
 #include "meta.hpp"
 #include "mesh_data.hpp"
+#include "profiler.hpp"
 
 
 namespace exporter {
@@ -244,6 +254,8 @@ namespace exporter {
   template<typename ... As>
   void ensight6(const std::string& filename, 
 		As&& ... as) {
+    profiler::scope export_scope("exporter::ensight6");
+
     const std::string
       case_filename(filename + ".case"),
       geometry_filename(filename + ".geom");
@@ -273,6 +285,8 @@ namespace exporter {
   template<typename mesh_type>
   void ensight6_geometry(const std::string& filename,
 			 const mesh_type& m) {
+    profiler::scope export_scope("exporter::ensight6");
+
     const std::string
       case_filename(filename + ".case"),
       geometry_filename(filename + ".geom");
@@ -371,6 +385,450 @@ namespace exporter {
 	       << t << '\n';
     }
   };
+
+
+  /*
+   * VTK XML unstructured grid (.vtu), partitioned (.pvtu) and time
+   * collection (.pvd) output. Heavy data is stored in a single
+   * appended raw section, optionally split in zlib compressed blocks
+   * (requires ENABLE_ZLIB).
+   */
+  enum class vtk_compression {none, zlib};
+
+  namespace vtk_detail {
+
+    template<typename cell_type>
+    struct vtk_cell_type {
+    private:
+      using cell_list = type_list<cell::point, cell::edge, cell::triangle, cell::tetrahedron>;
+      static constexpr std::uint8_t values[] = {1, 3, 5, 10};
+    public:
+      static constexpr std::uint8_t value = values[get_index_of_element<cell_type, cell_list>::value];
+    };
+
+    template<typename T> struct vtk_type_name;
+    template<> struct vtk_type_name<double> { static constexpr const char* value = "Float64"; };
+    template<> struct vtk_type_name<std::int64_t> { static constexpr const char* value = "Int64"; };
+    template<> struct vtk_type_name<std::uint8_t> { static constexpr const char* value = "UInt8"; };
+
+    inline
+    const char* byte_order() {
+      const std::uint16_t probe(1);
+      return *reinterpret_cast<const unsigned char*>(&probe) ? "LittleEndian" : "BigEndian";
+    }
+
+    inline
+    std::string basename(const std::string& filename) {
+      const std::size_t slash(filename.find_last_of('/'));
+      return slash == std::string::npos ? filename : filename.substr(slash + 1);
+    }
+
+    inline
+    std::string piece_filename(const std::string& filename, std::size_t piece) {
+      std::ostringstream result;
+      result << filename << "_" << std::setfill('0') << std::setw(4) << std::right << piece << ".vtu";
+      return result.str();
+    }
+
+    inline
+    void write_file_header(std::ostream& stream, const char* type, vtk_compression c) {
+      stream << "<?xml version=\"1.0\"?>\n"
+	     << "<VTKFile type=\"" << type << "\" version=\"1.0\" byte_order=\"" << byte_order()
+	     << "\" header_type=\"UInt64\"";
+      if (c == vtk_compression::zlib)
+	stream << " compressor=\"vtkZLibDataCompressor\"";
+      stream << ">\n";
+    }
+
+    /*
+     * Accumulate the binary blocks of the appended section. Each
+     * block is prefixed by its UInt64 byte count, or by the
+     * [n_block, block_size, last_block_size, compressed sizes...]
+     * header when compressed.
+     */
+    class appended_data {
+    public:
+      appended_data(vtk_compression c): compression(c) {
+#ifndef ENABLE_ZLIB
+	if (compression == vtk_compression::zlib)
+	  throw std::string("exporter::vtk_detail::appended_data: zlib compression requested, but tfel was built without ENABLE_ZLIB");
+#endif
+      }
+
+      template<typename T>
+      std::size_t add_block(const T* values, std::size_t n) {
+	const std::size_t offset(buffer.size());
+	const char* bytes(reinterpret_cast<const char*>(values));
+	const std::uint64_t n_byte(n * sizeof(T));
+
+	switch (compression) {
+	case vtk_compression::none:
+	  append(&n_byte, 1);
+	  buffer.append(bytes, n_byte);
+	  break;
+
+	case vtk_compression::zlib:
+	  append_compressed(bytes, n_byte);
+	  break;
+	}
+
+	return offset;
+      }
+
+      void write(std::ostream& stream) const {
+	stream << "  <AppendedData encoding=\"raw\">\n_";
+	stream.write(buffer.data(), buffer.size());
+	stream << "\n  </AppendedData>\n";
+      }
+
+    private:
+      vtk_compression compression;
+      std::string buffer;
+
+    private:
+      template<typename T>
+      void append(const T* values, std::size_t n) {
+	buffer.append(reinterpret_cast<const char*>(values), n * sizeof(T));
+      }
+
+#ifdef ENABLE_ZLIB
+      void append_compressed(const char* bytes, std::uint64_t n_byte) {
+	const std::uint64_t block_size(1ul << 15);
+	const std::uint64_t n_block((n_byte + block_size - 1) / block_size);
+	std::vector<std::uint64_t> header(3 + n_block);
+	header[0] = n_block;
+	header[1] = block_size;
+	header[2] = n_byte % block_size;
+
+	std::string blocks;
+	std::vector<Bytef> compressed(compressBound(block_size));
+	for (std::uint64_t b(0); b < n_block; ++b) {
+	  const std::uint64_t size(std::min(block_size, n_byte - b * block_size));
+	  uLongf compressed_size(compressed.size());
+	  if (compress2(&compressed[0], &compressed_size,
+			reinterpret_cast<const Bytef*>(bytes + b * block_size), size,
+			Z_DEFAULT_COMPRESSION) != Z_OK)
+	    throw std::string("exporter::vtk_detail::appended_data: zlib compression failed");
+	  header[3 + b] = compressed_size;
+	  blocks.append(reinterpret_cast<const char*>(&compressed[0]), compressed_size);
+	}
+
+	append(&header[0], header.size());
+	buffer.append(blocks);
+      }
+#else
+      void append_compressed(const char*, std::uint64_t) {}
+#endif
+    };
+
+    struct variable {
+      std::string name;
+      mesh_data_kind kind;
+      std::size_t n_component;
+      const array<double>* values;
+    };
+
+    inline
+    void collect_variables(std::vector<variable>&) {}
+
+    template<typename mesh_type, typename ... As>
+    void collect_variables(std::vector<variable>& variables,
+			   const mesh_data<double, mesh_type>& data,
+			   const std::string& name,
+			   As&& ... as) {
+      variables.push_back(variable{name, data.get_kind(), data.get_component_number(), &data.get_values()});
+      collect_variables(variables, std::forward<As>(as)...);
+    }
+
+    template<typename mesh_type, typename ... As>
+    const mesh_type& get_mesh(const mesh_data<double, mesh_type>& data, As&& ...) {
+      return data.get_mesh();
+    }
+
+    /*
+     * Two component fields are padded to three components, so that
+     * they are recognized as vectors by the post-processing tools.
+     */
+    inline
+    std::size_t written_component_number(std::size_t n_component) {
+      return n_component == 2 ? 3 : n_component;
+    }
+
+    inline
+    void write_data_array_header(std::ostream& stream, const char* type, const std::string& name,
+				 std::size_t n_component, std::size_t offset) {
+      stream << "        <DataArray type=\"" << type << "\"";
+      if (not name.empty())
+	stream << " Name=\"" << name << "\"";
+      stream << " NumberOfComponents=\"" << n_component << "\" format=\"appended\" offset=\""
+	     << offset << "\"/>\n";
+    }
+
+    inline
+    void write_variables(std::ostream& stream, appended_data& appended,
+			 const std::vector<variable>& variables, mesh_data_kind kind) {
+      for (const auto& v: variables) {
+	if (v.kind != kind)
+	  continue;
+
+	const std::size_t
+	  n_value(v.values->get_size(0)),
+	  n_component(written_component_number(v.n_component));
+
+	std::vector<double> values(n_value * n_component, 0.0);
+	for (std::size_t k(0); k < n_value; ++k)
+	  for (std::size_t n(0); n < v.n_component; ++n)
+	    values[k * n_component + n] = v.values->at(k, n);
+
+	write_data_array_header(stream, vtk_type_name<double>::value, v.name, n_component,
+				appended.add_block(values.data(), values.size()));
+      }
+    }
+
+    template<typename mesh_type>
+    void write_unstructured_grid(std::ostream& stream, const mesh_type& m,
+				 const std::vector<variable>& variables,
+				 vtk_compression c) {
+      using cell_type = typename mesh_type::cell_type;
+
+      const array<double>& vertices(m.get_vertices());
+      const array<unsigned int>& cells(m.get_cells());
+      const std::size_t
+	n_vertex(vertices.get_size(0)),
+	n_dimension(vertices.get_size(1)),
+	n_cell(cells.get_size(0)),
+	n_vertex_per_cell(cell_type::n_vertex_per_cell);
+
+      std::vector<double> points(3 * n_vertex, 0.0);
+      for (std::size_t k(0); k < n_vertex; ++k)
+	for (std::size_t n(0); n < n_dimension; ++n)
+	  points[3 * k + n] = vertices.at(k, n);
+
+      std::vector<std::int64_t> connectivity(n_cell * n_vertex_per_cell), offsets(n_cell);
+      for (std::size_t k(0); k < n_cell; ++k) {
+	for (std::size_t n(0); n < n_vertex_per_cell; ++n)
+	  connectivity[k * n_vertex_per_cell + n] = cells.at(k, n);
+	offsets[k] = (k + 1) * n_vertex_per_cell;
+      }
+
+      const std::uint8_t type(vtk_cell_type<cell_type>::value);
+      const std::vector<std::uint8_t> types(n_cell, type);
+
+      appended_data appended(c);
+
+      write_file_header(stream, "UnstructuredGrid", c);
+      stream << "  <UnstructuredGrid>\n"
+	     << "    <Piece NumberOfPoints=\"" << n_vertex << "\" NumberOfCells=\"" << n_cell << "\">\n";
+
+      stream << "      <PointData>\n";
+      write_variables(stream, appended, variables, mesh_data_kind::vertex);
+      stream << "      </PointData>\n";
+
+      stream << "      <CellData>\n";
+      write_variables(stream, appended, variables, mesh_data_kind::cell);
+      stream << "      </CellData>\n";
+
+      stream << "      <Points>\n";
+      write_data_array_header(stream, vtk_type_name<double>::value, "", 3,
+			      appended.add_block(points.data(), points.size()));
+      stream << "      </Points>\n";
+
+      stream << "      <Cells>\n";
+      write_data_array_header(stream, vtk_type_name<std::int64_t>::value, "connectivity", 1,
+			      appended.add_block(connectivity.data(), connectivity.size()));
+      write_data_array_header(stream, vtk_type_name<std::int64_t>::value, "offsets", 1,
+			      appended.add_block(offsets.data(), offsets.size()));
+      write_data_array_header(stream, vtk_type_name<std::uint8_t>::value, "types", 1,
+			      appended.add_block(types.data(), types.size()));
+      stream << "      </Cells>\n";
+
+      stream << "    </Piece>\n"
+	     << "  </UnstructuredGrid>\n";
+      appended.write(stream);
+      stream << "</VTKFile>\n";
+    }
+
+    inline
+    void write_parallel_unstructured_grid(std::ostream& stream, const std::string& filename,
+					  std::size_t n_piece, const std::vector<variable>& variables) {
+      write_file_header(stream, "PUnstructuredGrid", vtk_compression::none);
+      stream << "  <PUnstructuredGrid GhostLevel=\"0\">\n";
+
+      const std::pair<mesh_data_kind, const char*> sections[] = {
+	{mesh_data_kind::vertex, "PPointData"},
+	{mesh_data_kind::cell, "PCellData"}
+      };
+      for (const auto& section: sections) {
+	stream << "    <" << section.second << ">\n";
+	for (const auto& v: variables)
+	  if (v.kind == section.first)
+	    stream << "      <PDataArray type=\"" << vtk_type_name<double>::value
+		   << "\" Name=\"" << v.name << "\" NumberOfComponents=\""
+		   << written_component_number(v.n_component) << "\"/>\n";
+	stream << "    </" << section.second << ">\n";
+      }
+
+      stream << "    <PPoints>\n"
+	     << "      <PDataArray type=\"" << vtk_type_name<double>::value << "\" NumberOfComponents=\"3\"/>\n"
+	     << "    </PPoints>\n";
+
+      for (std::size_t p(0); p < n_piece; ++p)
+	stream << "    <Piece Source=\"" << basename(piece_filename(filename, p)) << "\"/>\n";
+
+      stream << "  </PUnstructuredGrid>\n"
+	     << "</VTKFile>\n";
+    }
+
+    template<typename mesh_type>
+    void write_vtu_file(const std::string& filename, const mesh_type& m,
+			const std::vector<variable>& variables, vtk_compression c) {
+      profiler::scope export_scope("exporter::vtu");
+
+      std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary);
+      if (not file)
+	throw std::string("exporter::vtu: failed to open ") + filename + " for output";
+      write_unstructured_grid(file, m, variables, c);
+    }
+
+    template<typename mesh_type>
+    void write_pvtu_files(const std::string& filename, std::size_t piece, std::size_t n_piece,
+			  const mesh_type& m, const std::vector<variable>& variables, vtk_compression c) {
+      if (piece >= n_piece)
+	throw std::string("exporter::pvtu: piece number out of range");
+
+      write_vtu_file(piece_filename(filename, piece), m, variables, c);
+
+      if (piece == 0) {
+	const std::string pvtu_filename(filename + ".pvtu");
+	std::ofstream file(pvtu_filename.c_str(), std::ios::out);
+	if (not file)
+	  throw std::string("exporter::pvtu: failed to open ") + pvtu_filename + " for output";
+	write_parallel_unstructured_grid(file, filename, n_piece, variables);
+      }
+    }
+  }
+
+
+  /*
+   * Write filename.vtu, with the geometry of the mesh of the first
+   * variable. The arguments are pairs (mesh_data, name).
+   */
+  template<typename ... As>
+  void vtu(const std::string& filename, vtk_compression c, As&& ... as) {
+    std::vector<vtk_detail::variable> variables;
+    vtk_detail::collect_variables(variables, std::forward<As>(as)...);
+    vtk_detail::write_vtu_file(filename + ".vtu", vtk_detail::get_mesh(std::forward<As>(as)...), variables, c);
+  }
+
+  template<typename ... As>
+  void vtu(const std::string& filename, As&& ... as) {
+    vtu(filename, vtk_compression::none, std::forward<As>(as)...);
+  }
+
+  template<typename mesh_type>
+  void vtu_geometry(const std::string& filename, const mesh_type& m,
+		    vtk_compression c = vtk_compression::none) {
+    vtk_detail::write_vtu_file(filename + ".vtu", m, std::vector<vtk_detail::variable>(), c);
+  }
+
+  /*
+   * Write the piece number 'piece' out of 'n_piece' as
+   * filename_<piece>.vtu. Each piece (typically one per process) is
+   * written independently, and the piece 0 also writes the
+   * filename.pvtu index.
+   */
+  template<typename ... As>
+  void pvtu(const std::string& filename, std::size_t piece, std::size_t n_piece,
+	    vtk_compression c, As&& ... as) {
+    std::vector<vtk_detail::variable> variables;
+    vtk_detail::collect_variables(variables, std::forward<As>(as)...);
+    vtk_detail::write_pvtu_files(filename, piece, n_piece,
+				 vtk_detail::get_mesh(std::forward<As>(as)...), variables, c);
+  }
+
+  template<typename ... As>
+  void pvtu(const std::string& filename, std::size_t piece, std::size_t n_piece,
+	    As&& ... as) {
+    pvtu(filename, piece, n_piece, vtk_compression::none, std::forward<As>(as)...);
+  }
+
+  /*
+   * Time series as a .pvd collection. Each time step is written
+   * either as a single .vtu file by export_time_step, or as a
+   * partitioned .pvtu by export_time_step_piece, and the collection
+   * file is rewritten after each step.
+   */
+  class pvd_transient {
+  public:
+    pvd_transient(const std::string& filename,
+		  vtk_compression c = vtk_compression::none)
+      : filename(filename), compression(c) {}
+
+    template<typename ... As>
+    void export_time_step(double time, As&& ... as) {
+      const std::string step_filename(next_step_filename());
+
+      std::vector<vtk_detail::variable> variables;
+      vtk_detail::collect_variables(variables, std::forward<As>(as)...);
+      vtk_detail::write_vtu_file(step_filename + ".vtu",
+				 vtk_detail::get_mesh(std::forward<As>(as)...), variables, compression);
+
+      add_time_step(time, step_filename + ".vtu");
+      write_collection_file();
+    }
+
+    /*
+     * Write the piece number 'piece' out of 'n_piece' of the time
+     * step, as pvtu does. Each piece has its own pvd_transient, and
+     * the piece 0 writes the collection file.
+     */
+    template<typename ... As>
+    void export_time_step_piece(double time, std::size_t piece, std::size_t n_piece, As&& ... as) {
+      const std::string step_filename(next_step_filename());
+
+      std::vector<vtk_detail::variable> variables;
+      vtk_detail::collect_variables(variables, std::forward<As>(as)...);
+      vtk_detail::write_pvtu_files(step_filename, piece, n_piece,
+				   vtk_detail::get_mesh(std::forward<As>(as)...), variables, compression);
+
+      add_time_step(time, step_filename + ".pvtu");
+      if (piece == 0)
+	write_collection_file();
+    }
+
+  private:
+    std::string filename;
+    vtk_compression compression;
+    std::vector<std::pair<double, std::string> > steps;
+
+  private:
+    std::string next_step_filename() const {
+      std::ostringstream step_filename;
+      step_filename << filename << "_" << std::setfill('0') << std::setw(6) << std::right << steps.size();
+      return step_filename.str();
+    }
+
+    void add_time_step(double time, const std::string& step_filename) {
+      steps.push_back(std::make_pair(time, vtk_detail::basename(step_filename)));
+    }
+
+    void write_collection_file() const {
+      const std::string collection_filename(filename + ".pvd");
+      std::ofstream stream(collection_filename.c_str(), std::ios::out);
+      if (not stream)
+	throw std::string("exporter::pvd_transient: failed to open ") + collection_filename + " for output";
+
+      stream << "<?xml version=\"1.0\"?>\n"
+	     << "<VTKFile type=\"Collection\" version=\"1.0\" byte_order=\"" << vtk_detail::byte_order() << "\">\n"
+	     << "  <Collection>\n";
+      stream.precision(12);
+      for (const auto& step: steps)
+	stream << "    <DataSet timestep=\"" << step.first << "\" group=\"\" part=\"0\" file=\""
+	       << step.second << "\"/>\n";
+      stream << "  </Collection>\n"
+	     << "</VTKFile>\n";
+    }
+  };
 }
 
 
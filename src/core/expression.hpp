@@ -1,17 +1,98 @@
 #ifndef _INTEGRAND_EXPRESSION_H_
 #define _INTEGRAND_EXPRESSION_H_
 
+#include <cmath>
 #include <cstddef>
 #include <algorithm>
+#include <array>
 #include <functional>
+#include <limits>
+#include <string>
 
 #include "meta.hpp"
 #include "fes.hpp"
 #include "operator.hpp"
 #include "fe_value_manager.hpp"
+#include "tabulation.hpp"
 
 
-template<std::size_t arg, std::size_t rnk, std::size_t derivative>
+/*
+ *  Values shared, on one cell, by the leaves of an expression with the
+ *  same source: the nodes of a finite element function and of its
+ *  derivatives share the gathered coefficients, and the nodes of the
+ *  same derivative share their value. The first node registered for a
+ *  key computes, the others read it.
+ */
+class expression_cache {
+public:
+  expression_cache(): n_entry(0) {}
+
+  /*
+   *  Return the slot registered for (source, tag), or register slot. Past
+   *  the capacity, nothing is shared.
+   */
+  const double* share(const void* source, std::size_t tag, const double* slot) {
+    for (std::size_t n(0); n < n_entry; ++n)
+      if (entries[n].source == source and entries[n].tag == tag)
+	return entries[n].slot;
+
+    if (n_entry < capacity)
+      entries[n_entry++] = entry{source, tag, slot};
+    return slot;
+  }
+
+private:
+  static const std::size_t capacity = 32;
+
+  struct entry {
+    const void* source;
+    std::size_t tag;
+    const double* slot;
+  };
+
+  std::array<entry, capacity> entries;
+  std::size_t n_entry;
+};
+
+
+/*
+ *  Compile-time polynomial degree of the expressions on a cell, from
+ *  which integrate chooses the quadrature rule. The cells are affine, so
+ *  that a derivative lowers the degree by one. The functions of the space
+ *  coordinates have no degree, and make the degree of the expressions
+ *  using them unknown.
+ */
+constexpr std::size_t non_polynomial_degree = std::numeric_limits<std::size_t>::max();
+
+constexpr std::size_t derivative_degree(std::size_t p) {
+  return (p == 0 or p == non_polynomial_degree) ? p : p - 1;
+}
+
+constexpr std::size_t product_degree(std::size_t p, std::size_t q) {
+  return (p == non_polynomial_degree or q == non_polynomial_degree) ? non_polynomial_degree : p + q;
+}
+
+template<typename op, std::size_t p, std::size_t q>
+struct operation_degree: integral_constant<std::size_t, non_polynomial_degree> {};
+
+template<std::size_t p, std::size_t q>
+struct operation_degree<add<double>, p, q>: integral_constant<std::size_t, (p < q ? q : p)> {};
+
+template<std::size_t p, std::size_t q>
+struct operation_degree<substract<double>, p, q>: integral_constant<std::size_t, (p < q ? q : p)> {};
+
+template<std::size_t p, std::size_t q>
+struct operation_degree<multiply<double>, p, q>: integral_constant<std::size_t, product_degree(p, q)> {};
+
+template<std::size_t p>
+struct operation_degree<divide<double>, p, 0>: integral_constant<std::size_t, p> {};
+
+
+/*
+ *  The argument arg of a form of rank rnk, of degree the degree of its
+ *  finite element.
+ */
+template<std::size_t arg, std::size_t rnk, std::size_t derivative, std::size_t degree = non_polynomial_degree>
 struct form {
   template<typename ... Ts>
   double operator()(unsigned int k,
@@ -21,10 +102,14 @@ struct form {
     return argument<arg>(ts...)[derivative];
   }
 
-  void prepare(unsigned int k, const double* x, const double* x_hat) const  {}
+  template<typename point_set_type>
+  void prepare_cell(unsigned int k, std::size_t s, expression_cache& cache) const {}
+
+  void prepare(unsigned int k, std::size_t q, const double* x, const double* x_hat) const {}
 
   static constexpr std::size_t rank = rnk;
   static constexpr std::size_t differential_order = derivative == 0 ? 0 : 1;
+  static constexpr std::size_t polynomial_degree = derivative == 0 ? degree : derivative_degree(degree);
   static constexpr bool require_space_coordinates = false;
 };
 
@@ -43,12 +128,16 @@ struct free_function {
     return cached_value;
   }
 
-  void prepare(unsigned int k, const double* x, const double* x_hat) const {
+  template<typename point_set_type>
+  void prepare_cell(unsigned int k, std::size_t s, expression_cache& cache) const {}
+
+  void prepare(unsigned int k, std::size_t q, const double* x, const double* x_hat) const {
     cached_value = f(x);
   }
 
   static constexpr std::size_t rank = 0;
   static constexpr std::size_t differential_order = 0;
+  static constexpr std::size_t polynomial_degree = non_polynomial_degree;
   static constexpr bool require_space_coordinates = true;
   
 private:
@@ -73,12 +162,16 @@ struct std_function {
     return cached_value;
   }
 
-  void prepare(unsigned int k, const double* x, const double* x_hat) const {
+  template<typename point_set_type>
+  void prepare_cell(unsigned int k, std::size_t s, expression_cache& cache) const {}
+
+  void prepare(unsigned int k, std::size_t q, const double* x, const double* x_hat) const {
     cached_value = f(x);
   }
 
   static constexpr std::size_t rank = 0;
   static constexpr std::size_t differential_order = 0;
+  static constexpr std::size_t polynomial_degree = non_polynomial_degree;
   static constexpr bool require_space_coordinates = true;
 
 private:
@@ -86,6 +179,13 @@ private:
   mutable double cached_value = 0.0;
 };
 
+/*
+ *  Inside an assembly, prepare_cell gathers the coefficients of the cell
+ *  and binds the table of the basis functions on its points, so that the
+ *  value on the point q is a short dot product. The nodes of the same
+ *  function share this work through the expression_cache. Out of an
+ *  assembly, the basis functions are evaluated on the point.
+ */
 template<typename fe, std::size_t d = 0>
 struct finite_element_function {
   template<typename fe_p, std::size_t d_p>
@@ -95,6 +195,10 @@ public:
   finite_element_function(const typename finite_element_space<fe>::element& v)
     : v(v), fe_values(1), xq_hat{1, fe::cell_type::n_dimension} {}
 
+  // the bindings to a cell are not copied
+  finite_element_function(const finite_element_function& f)
+    : v(f.v), fe_values(1), xq_hat{1, fe::cell_type::n_dimension} {}
+
   template<std::size_t dd>
   finite_element_function(const finite_element_function<fe, dd>& f)
     : v(f.v), fe_values(1), xq_hat{1, fe::cell_type::n_dimension} {}
@@ -111,13 +215,95 @@ public:
     return cached_value;
   }
 
-  void prepare(unsigned int k, const double* x, const double* x_hat) const {
+  template<typename point_set_type>
+  void prepare_cell(unsigned int k, std::size_t s, expression_cache& cache) const {
+    coefficients_k = cache.share(&v, 0, u_k.data());
+    if (coefficients_k == u_k.data()) {
+      const finite_element_space<fe>& fes(v.get_finite_element_space());
+      const array<double>& coefficients(v.get_coefficients());
+      for (std::size_t i(0); i < n_dof; ++i)
+	u_k[i] = coefficients.at(fes.get_dof(k, i));
+    }
+
+    value = cache.share(&v, 1 + d, &cached_value);
+    if (d > 0 and value == &cached_value) {
+      const auto& jmt(v.get_finite_element_space().get_mesh().get_jmt(k));
+      for (std::size_t t(0); t < n_dim; ++t)
+	j[t] = jmt.at(d - 1, t);
+    }
+
+    table = tabulation::table<fe, point_set_type>::get(s);
+    cell = k;
+  }
+
+  void prepare(unsigned int k, std::size_t q, const double* x, const double* x_hat) const {
+    if (table == nullptr or k != cell) {
+      evaluate(k, x_hat);
+      value = &cached_value;
+      return;
+    }
+
+    // computed by a previous node of the same function and derivative,
+    // since the nodes are prepared in the order of their registration
+    if (value != &cached_value) {
+      cached_value = *value;
+      return;
+    }
+
+    const double* t(table + q * n_dof * (n_dim + 1));
+    const double* u(coefficients_k);
+    double r(0.0);
+    if (d == 0) {
+      for (std::size_t i(0); i < n_dof; ++i)
+	r += u[i] * t[i * (n_dim + 1)];
+    } else {
+      // the derivative d is the row d - 1 of jmt applied to the
+      // reference gradient
+      for (std::size_t s(0); s < n_dim; ++s) {
+	double g(0.0);
+	for (std::size_t i(0); i < n_dof; ++i)
+	  g += u[i] * t[i * (n_dim + 1) + 1 + s];
+	r += j[s] * g;
+      }
+    }
+    cached_value = r;
+  }
+
+  const typename finite_element_space<fe>::element& get_element() const { return v; }
+
+  static constexpr std::size_t rank = 0;
+  static constexpr std::size_t differential_order = d == 0 ? 0 : 1;
+  static constexpr std::size_t polynomial_degree = d == 0 ? fe::degree : derivative_degree(fe::degree);
+  static constexpr bool require_space_coordinates = false;
+			     
+private:
+  static const std::size_t n_dof = fe::n_dof_per_element;
+  static const std::size_t n_dim = fe::cell_type::n_dimension;
+
+  const typename finite_element_space<fe>::element& v;
+  mutable fe_value_manager<type_list<fe> > fe_values;
+  mutable array<double> xq_hat;
+  mutable double cached_value = 0.0;
+
+  // the value computed by this node or by a node of the same function
+  // and derivative
+  mutable const double* value = &cached_value;
+
+  // the coefficients of the cell, gathered by this node or by a node of
+  // the same function, the row d - 1 of its jmt, and the table of its
+  // points
+  mutable std::array<double, n_dof> u_k;
+  mutable const double* coefficients_k = nullptr;
+  mutable std::array<double, n_dim> j;
+  mutable const double* table = nullptr;
+  mutable std::size_t cell = 0;
+
+  void evaluate(unsigned int k, const double* x_hat) const {
     std::copy(x_hat, x_hat + xq_hat.get_size(1), xq_hat.get_data());
     fe_values.set_points(xq_hat);
     if (d > 0)
       fe_values.prepare(v.get_finite_element_space().get_mesh().get_jmt(k));
 
-    const std::size_t n_dof(fe::n_dof_per_element);
     const array<double>& phi(fe_values.template get_values<0>());
     const finite_element_space<fe>& fes(v.get_finite_element_space());
     const array<double>& coefficients(v.get_coefficients());
@@ -126,16 +312,22 @@ public:
     for (unsigned int i(0); i < n_dof; ++i)
       cached_value += coefficients.at(fes.get_dof(k, i)) * phi.at(0, i, d);
   }
+};
 
-  static constexpr std::size_t rank = 0;
-  static constexpr std::size_t differential_order = d;
-  static constexpr bool require_space_coordinates = false;
-			     
-private:
-  const typename finite_element_space<fe>::element& v;
-  mutable fe_value_manager<type_list<fe> > fe_values;
-  mutable array<double> xq_hat;
-  mutable double cached_value = 0.0;
+/*
+ *  A finite element function which is the unknown of a nonlinear
+ *  problem: linearize derives the residuals with respect to it, and
+ *  makes it the trial function arg of the jacobian. It is evaluated as
+ *  the other finite element functions.
+ */
+template<typename fe, std::size_t arg, std::size_t d = 0>
+struct unknown_function: finite_element_function<fe, d> {
+  unknown_function(const typename finite_element_space<fe>::element& v)
+    : finite_element_function<fe, d>(v) {}
+
+  template<std::size_t dd>
+  unknown_function(const unknown_function<fe, arg, dd>& f)
+    : finite_element_function<fe, d>(f.get_element()) {}
 };
 
 struct constant {
@@ -154,10 +346,16 @@ struct constant {
     return value;
   }
 
-  void prepare(unsigned int k, const double* x, const double* x_hat) const {}
+  template<typename point_set_type>
+  void prepare_cell(unsigned int k, std::size_t s, expression_cache& cache) const {}
+
+  void prepare(unsigned int k, std::size_t q, const double* x, const double* x_hat) const {}
+
+  double get_value() const { return value; }
 
   static constexpr std::size_t rank = 0;
   static constexpr std::size_t differential_order = 0;
+  static constexpr std::size_t polynomial_degree = 0;
   static constexpr bool require_space_coordinates = false;
   
 private:
@@ -183,10 +381,14 @@ struct mesh_data_component {
     return data.evaluate(k, x_hat, c);
   }
 
-  void prepare(unsigned int k, const double* x, const double* x_hat) const {}
+  template<typename point_set_type>
+  void prepare_cell(unsigned int k, std::size_t s, expression_cache& cache) const {}
+
+  void prepare(unsigned int k, std::size_t q, const double* x, const double* x_hat) const {}
 
   static constexpr std::size_t rank = 0;
   static constexpr std::size_t differential_order = 0;
+  static constexpr std::size_t polynomial_degree = 0;
   static constexpr bool require_space_coordinates = false;
 
 private:
@@ -210,12 +412,18 @@ struct expression {
     return expr(k, x, x_hat);
   }
 
-  void prepare(unsigned int k, const double* x, const double* x_hat) const {
-    expr.prepare(k, x, x_hat);
+  template<typename point_set_type>
+  void prepare_cell(unsigned int k, std::size_t s, expression_cache& cache) const {
+    expr.template prepare_cell<point_set_type>(k, s, cache);
+  }
+
+  void prepare(unsigned int k, std::size_t q, const double* x, const double* x_hat) const {
+    expr.prepare(k, q, x, x_hat);
   }
 
   static constexpr std::size_t rank = expr_t::rank;
   static constexpr std::size_t differential_order = expr_t::differential_order;
+  static constexpr std::size_t polynomial_degree = expr_t::polynomial_degree;
   static constexpr bool require_space_coordinates = expr_t::require_space_coordinates;
 };
 
@@ -235,13 +443,20 @@ struct binary_expression {
 		     r(k, x, x_hat));
   }
 
-  void prepare(unsigned int k, const double* x, const double* x_hat) const {
-    l.prepare(k, x, x_hat);
-    r.prepare(k, x, x_hat);
+  template<typename point_set_type>
+  void prepare_cell(unsigned int k, std::size_t s, expression_cache& cache) const {
+    l.template prepare_cell<point_set_type>(k, s, cache);
+    r.template prepare_cell<point_set_type>(k, s, cache);
+  }
+
+  void prepare(unsigned int k, std::size_t q, const double* x, const double* x_hat) const {
+    l.prepare(k, q, x, x_hat);
+    r.prepare(k, q, x, x_hat);
   }
   
   static constexpr std::size_t rank = left::rank < right::rank ? right::rank : left::rank;
   static constexpr std::size_t differential_order = left::differential_order < right::differential_order ? right::differential_order : left::differential_order;
+  static constexpr std::size_t polynomial_degree = operation_degree<op, left::polynomial_degree, right::polynomial_degree>::value;
 
   static constexpr bool require_space_coordinates = left::require_space_coordinates or right::require_space_coordinates;
   
@@ -249,9 +464,48 @@ struct binary_expression {
   expression<right> r;
 };
 
+/*
+ *  The derivatives of the functions of cmath known by compose.
+ */
+struct known_derivative {
+  typedef double (*function_type)(double);
+
+  static double minus_sin(double x) { return -std::sin(x); }
+  static double minus_cos(double x) { return -std::cos(x); }
+  static double inverse(double x) { return 1.0 / x; }
+  static double half_inverse_sqrt(double x) { return 0.5 / std::sqrt(x); }
+
+  // nullptr when f is not known
+  static function_type get(function_type f) {
+    if (f == static_cast<function_type>(std::exp))
+      return static_cast<function_type>(std::exp);
+    if (f == static_cast<function_type>(std::log))
+      return inverse;
+    if (f == static_cast<function_type>(std::sqrt))
+      return half_inverse_sqrt;
+    if (f == static_cast<function_type>(std::sin))
+      return static_cast<function_type>(std::cos);
+    if (f == static_cast<function_type>(std::cos))
+      return minus_sin;
+    if (f == minus_sin)
+      return minus_cos;
+    if (f == minus_cos)
+      return static_cast<function_type>(std::sin);
+    return nullptr;
+  }
+};
+
+/*
+ *  f(e), where df is the derivative of f used by the derivatives of the
+ *  expression, or nullptr.
+ */
 template<typename inner_expr>
 struct composition {
-  composition(double (*f)(double), const expression<inner_expr>& e): f(f), e(e) {}
+  composition(double (*f)(double), const expression<inner_expr>& e)
+    : f(f), df(known_derivative::get(f)), e(e) {}
+
+  composition(double (*f)(double), double (*df)(double), const expression<inner_expr>& e)
+    : f(f), df(df), e(e) {}
 
   template<typename ... Ts>
   double operator()(unsigned int k, const double* x, const double* x_hat,
@@ -263,15 +517,22 @@ struct composition {
     return f(e(k, x, x_hat));
   }
 
-  void prepare(unsigned int k, const double* x, const double* x_hat) const {
-    e.prepare(k, x, x_hat);
+  template<typename point_set_type>
+  void prepare_cell(unsigned int k, std::size_t s, expression_cache& cache) const {
+    e.template prepare_cell<point_set_type>(k, s, cache);
+  }
+
+  void prepare(unsigned int k, std::size_t q, const double* x, const double* x_hat) const {
+    e.prepare(k, q, x, x_hat);
   }
 
   static constexpr std::size_t rank = inner_expr::rank;
   static constexpr std::size_t differential_order = inner_expr::differential_order;
+  static constexpr std::size_t polynomial_degree = inner_expr::polynomial_degree == 0 ? 0 : non_polynomial_degree;
   static constexpr bool require_space_coordinates = inner_expr::require_space_coordinates;
   
   double (*f)(double);
+  double (*df)(double);
   expression<inner_expr> e;
 };
 
@@ -291,6 +552,17 @@ make_expr(const typename finite_element_space<fe>::element& u) {
   return fe_function_t<fe>(finite_element_function<fe>(u) );
 }
 
+/*
+ *  The unknown u of a nonlinear problem, which is the trial function arg
+ *  of the jacobian: 1 for the bilinear forms of a finite element space,
+ *  and n_test_component + n for the component n of a composite one.
+ */
+template<typename fe, std::size_t arg = 1>
+expression<unknown_function<fe, arg> >
+make_unknown(const typename finite_element_space<fe>::element& u) {
+  return unknown_function<fe, arg>(u);
+}
+
 free_function_t
 make_expr(double(*f)(const double*)) {
   return free_function_t(free_function(f));
@@ -312,60 +584,332 @@ make_expr(const mesh_data<value_t, mesh_t>& data, std::size_t c) {
   return mesh_data_component_t<value_t, mesh_t> (mesh_data_component<value_t, mesh_t>(data, c));
 }
 
-template<std::size_t d, typename expression>
-struct differentiate;
+/*
+ *  The derivatives of the expressions with respect to a variable: a
+ *  direction of the space for differentiate, or the unknown of a
+ *  nonlinear problem for linearize. Both share the rules of the sums,
+ *  the products, the quotients and the compositions, and differ by the
+ *  derivatives of the leaves, given by leaf_derivative<variable, leaf>.
+ *
+ *  is_zero is true when the derivative vanishes, so that the terms
+ *  which do not depend on the variable are dropped at compile time.
+ *  Otherwise, type is the type of the derivative, and initialize builds
+ *  it from the expression.
+ */
+template<typename variable, typename leaf>
+struct leaf_derivative;
+
+template<typename variable, typename expr>
+struct derivative: leaf_derivative<variable, expr> {};
+
+template<typename variable, typename expr, bool expr_is_zero = derivative<variable, expr>::is_zero>
+struct expression_derivative {
+  static const bool is_zero = true;
+};
+
+template<typename variable, typename expr>
+struct expression_derivative<variable, expr, false> {
+  static const bool is_zero = false;
+  typedef typename derivative<variable, expr>::type type;
 
-template<std::size_t d, std::size_t arg, std::size_t rnk>
-struct differentiate<d, form<arg, rnk, 0> > {
-  typedef form<arg, rnk, d> type;
-  
   static
-  type initialize(const expression<form<arg, rnk, 0> >&) { return type(); }
+  type initialize(const expression<expr>& e) { return derivative<variable, expr>::initialize(e.expr); }
 };
 
-template<std::size_t d, typename fe>
-struct differentiate<d, finite_element_function<fe, 0> > {
-  typedef finite_element_function<fe, d> type;
+template<typename variable, typename expr>
+struct derivative<variable, expression<expr> >: expression_derivative<variable, expr> {};
+
+
+template<typename variable, typename left, typename right, typename op,
+	 bool left_is_zero = derivative<variable, left>::is_zero,
+	 bool right_is_zero = derivative<variable, right>::is_zero>
+struct binary_derivative {
+  static_assert(left_is_zero and right_is_zero, "derivative: the operation has no derivative");
+  static const bool is_zero = true;
+};
+
+template<typename variable, typename left, typename right, typename op>
+struct derivative<variable, binary_expression<left, right, op> >: binary_derivative<variable, left, right, op> {};
+
+// (l + r)' = l' + r'
+template<typename variable, typename left, typename right>
+struct binary_derivative<variable, left, right, add<double>, false, true> {
+  static const bool is_zero = false;
+  typedef typename derivative<variable, left>::type type;
 
   static
-  type initialize(const finite_element_function<fe, 0> & e) {
-    return type(e);
+  type initialize(const binary_expression<left, right, add<double> >& e) {
+    return derivative<variable, expression<left> >::initialize(e.l);
   }
 };
 
-template<std::size_t d, typename left, typename right>
-struct differentiate<d, binary_expression<left, right, multiply<double>> > {
-  typedef binary_expression<typename differentiate<d, left>::type, right, multiply<double>> first_type;
-  typedef binary_expression<left, typename differentiate<d, right>::type, multiply<double>> second_type;
-  typedef binary_expression<first_type, second_type, add<double>> type;
+template<typename variable, typename left, typename right>
+struct binary_derivative<variable, left, right, add<double>, true, false> {
+  static const bool is_zero = false;
+  typedef typename derivative<variable, right>::type type;
 
   static
-    type initialize(const binary_expression<left, right, multiply<double>>& expr) {
-    const first_type t1(differentiate<d, left>::initialize(expr.l), expr.r);
-    const second_type t2(expr.l, differentiate<d, right>::initialize(expr.r));
-    return type(t1, t2);
+  type initialize(const binary_expression<left, right, add<double> >& e) {
+    return derivative<variable, expression<right> >::initialize(e.r);
   }
 };
 
-template<std::size_t d, typename left, typename right, typename op>
-struct differentiate<d, binary_expression<left, right, op> > {
-  typedef binary_expression<typename differentiate<d, left>::type,
-			    typename differentiate<d, right>::type, op>
-  type;
-  
+template<typename variable, typename left, typename right>
+struct binary_derivative<variable, left, right, add<double>, false, false> {
+  static const bool is_zero = false;
+  typedef binary_expression<typename derivative<variable, left>::type,
+			    typename derivative<variable, right>::type, add<double> > type;
+
   static
-  type initialize(const binary_expression<left, right, op>& expr) {
-    return type(differentiate<d, left>::initialize(expr.l),
-		differentiate<d, right>::initialize(expr.r));
+  type initialize(const binary_expression<left, right, add<double> >& e) {
+    return type(derivative<variable, expression<left> >::initialize(e.l),
+		derivative<variable, expression<right> >::initialize(e.r));
   }
 };
 
+// (l - r)' = l' - r'
+template<typename variable, typename left, typename right>
+struct binary_derivative<variable, left, right, substract<double>, false, true> {
+  static const bool is_zero = false;
+  typedef typename derivative<variable, left>::type type;
+
+  static
+  type initialize(const binary_expression<left, right, substract<double> >& e) {
+    return derivative<variable, expression<left> >::initialize(e.l);
+  }
+};
+
+template<typename variable, typename left, typename right>
+struct binary_derivative<variable, left, right, substract<double>, true, false> {
+  static const bool is_zero = false;
+  typedef binary_expression<constant, typename derivative<variable, right>::type, multiply<double> > type;
+
+  static
+  type initialize(const binary_expression<left, right, substract<double> >& e) {
+    return type(constant(-1.0), derivative<variable, expression<right> >::initialize(e.r));
+  }
+};
+
+template<typename variable, typename left, typename right>
+struct binary_derivative<variable, left, right, substract<double>, false, false> {
+  static const bool is_zero = false;
+  typedef binary_expression<typename derivative<variable, left>::type,
+			    typename derivative<variable, right>::type, substract<double> > type;
+
+  static
+  type initialize(const binary_expression<left, right, substract<double> >& e) {
+    return type(derivative<variable, expression<left> >::initialize(e.l),
+		derivative<variable, expression<right> >::initialize(e.r));
+  }
+};
+
+// (l r)' = l' r + l r'
+template<typename variable, typename left, typename right>
+struct binary_derivative<variable, left, right, multiply<double>, false, true> {
+  static const bool is_zero = false;
+  typedef binary_expression<typename derivative<variable, left>::type, right, multiply<double> > type;
+
+  static
+  type initialize(const binary_expression<left, right, multiply<double> >& e) {
+    return type(derivative<variable, expression<left> >::initialize(e.l), e.r);
+  }
+};
+
+template<typename variable, typename left, typename right>
+struct binary_derivative<variable, left, right, multiply<double>, true, false> {
+  static const bool is_zero = false;
+  typedef binary_expression<left, typename derivative<variable, right>::type, multiply<double> > type;
+
+  static
+  type initialize(const binary_expression<left, right, multiply<double> >& e) {
+    return type(e.l, derivative<variable, expression<right> >::initialize(e.r));
+  }
+};
+
+template<typename variable, typename left, typename right>
+struct binary_derivative<variable, left, right, multiply<double>, false, false> {
+  static const bool is_zero = false;
+  typedef binary_expression<typename derivative<variable, left>::type, right, multiply<double> > first_type;
+  typedef binary_expression<left, typename derivative<variable, right>::type, multiply<double> > second_type;
+  typedef binary_expression<first_type, second_type, add<double> > type;
+
+  static
+  type initialize(const binary_expression<left, right, multiply<double> >& e) {
+    return type(first_type(derivative<variable, expression<left> >::initialize(e.l), e.r),
+		second_type(e.l, derivative<variable, expression<right> >::initialize(e.r)));
+  }
+};
+
+// (l / r)' = l' / r - l r' / r^2
+template<typename variable, typename left, typename right>
+struct binary_derivative<variable, left, right, divide<double>, false, true> {
+  static const bool is_zero = false;
+  typedef binary_expression<typename derivative<variable, left>::type, right, divide<double> > type;
+
+  static
+  type initialize(const binary_expression<left, right, divide<double> >& e) {
+    return type(derivative<variable, expression<left> >::initialize(e.l), e.r);
+  }
+};
+
+template<typename variable, typename left, typename right>
+struct binary_derivative<variable, left, right, divide<double>, true, false> {
+  static const bool is_zero = false;
+  typedef binary_expression<left, typename derivative<variable, right>::type, multiply<double> > numerator_type;
+  typedef binary_expression<constant, numerator_type, multiply<double> > negated_type;
+  typedef binary_expression<right, right, multiply<double> > denominator_type;
+  typedef binary_expression<negated_type, denominator_type, divide<double> > type;
+
+  static
+  type initialize(const binary_expression<left, right, divide<double> >& e) {
+    return type(negated_type(constant(-1.0),
+			     numerator_type(e.l, derivative<variable, expression<right> >::initialize(e.r))),
+		denominator_type(e.r, e.r));
+  }
+};
+
+template<typename variable, typename left, typename right>
+struct binary_derivative<variable, left, right, divide<double>, false, false> {
+  static const bool is_zero = false;
+  typedef binary_expression<typename derivative<variable, left>::type, right, multiply<double> > first_type;
+  typedef binary_expression<left, typename derivative<variable, right>::type, multiply<double> > second_type;
+  typedef binary_expression<first_type, second_type, substract<double> > numerator_type;
+  typedef binary_expression<right, right, multiply<double> > denominator_type;
+  typedef binary_expression<numerator_type, denominator_type, divide<double> > type;
+
+  static
+  type initialize(const binary_expression<left, right, divide<double> >& e) {
+    return type(numerator_type(first_type(derivative<variable, expression<left> >::initialize(e.l), e.r),
+			       second_type(e.l, derivative<variable, expression<right> >::initialize(e.r))),
+		denominator_type(e.r, e.r));
+  }
+};
+
+// f(e)' = f'(e) e'
+template<typename variable, typename inner_expr, bool inner_is_zero = derivative<variable, inner_expr>::is_zero>
+struct composition_derivative {
+  static const bool is_zero = true;
+};
+
+template<typename variable, typename inner_expr>
+struct composition_derivative<variable, inner_expr, false> {
+  static const bool is_zero = false;
+  typedef binary_expression<composition<inner_expr>,
+			    typename derivative<variable, inner_expr>::type, multiply<double> > type;
+
+  static
+  type initialize(const composition<inner_expr>& e) {
+    if (e.df == nullptr)
+      throw std::string("derivative: the derivative of a composed function is unknown");
+    return type(composition<inner_expr>(e.df, e.e), derivative<variable, expression<inner_expr> >::initialize(e.e));
+  }
+};
+
+template<typename variable, typename inner_expr>
+struct derivative<variable, composition<inner_expr> >: composition_derivative<variable, inner_expr> {};
+
+
+/*
+ *  The derivative in the direction d of the space. The functions of the
+ *  space coordinates, and the derivatives, have no derivative.
+ */
+template<std::size_t d>
+struct space_direction {};
+
+template<std::size_t d, typename leaf>
+struct leaf_derivative<space_direction<d>, leaf> {
+  static_assert(sizeof(leaf) == 0, "differentiate: the expression has no derivative");
+  static const bool is_zero = false;
+};
+
+template<std::size_t d>
+struct leaf_derivative<space_direction<d>, constant> {
+  static const bool is_zero = true;
+};
+
+template<std::size_t d, std::size_t arg, std::size_t rnk, std::size_t degree>
+struct leaf_derivative<space_direction<d>, form<arg, rnk, 0, degree> > {
+  static const bool is_zero = false;
+  typedef form<arg, rnk, d, degree> type;
+
+  static
+  type initialize(const form<arg, rnk, 0, degree>&) { return type(); }
+};
+
+template<std::size_t d, typename fe>
+struct leaf_derivative<space_direction<d>, finite_element_function<fe, 0> > {
+  static const bool is_zero = false;
+  typedef finite_element_function<fe, d> type;
+
+  static
+  type initialize(const finite_element_function<fe, 0>& e) { return type(e); }
+};
+
+template<std::size_t d, typename fe, std::size_t arg>
+struct leaf_derivative<space_direction<d>, unknown_function<fe, arg, 0> > {
+  static const bool is_zero = false;
+  typedef unknown_function<fe, arg, d> type;
+
+  static
+  type initialize(const unknown_function<fe, arg, 0>& e) { return type(e); }
+};
+
+template<std::size_t d, typename expr>
+struct differentiate: derivative<space_direction<d>, expr> {};
+
+
+/*
+ *  The Gateaux derivative of a residual R(u; v) in the direction of
+ *  the trial functions: the unknown functions and their derivatives
+ *  become the trial functions and their derivatives, and the other
+ *  leaves are constant.
+ */
+struct trial_direction {};
+
+template<typename leaf>
+struct leaf_derivative<trial_direction, leaf> {
+  static const bool is_zero = true;
+};
+
+template<typename fe, std::size_t arg, std::size_t d>
+struct leaf_derivative<trial_direction, unknown_function<fe, arg, d> > {
+  static const bool is_zero = false;
+  typedef form<arg, 2, d, fe::degree> type;
+
+  static
+  type initialize(const unknown_function<fe, arg, d>&) { return type(); }
+};
+
+template<typename expr>
+struct linearization {
+  static_assert(not derivative<trial_direction, expr>::is_zero, "linearize: the residual does not depend on an unknown");
+  typedef typename derivative<trial_direction, expr>::type type;
+};
+
+/*
+ *  The jacobian of a rank-1 residual, as a rank-2 expression. The
+ *  residual is written with the unknown functions (see make_unknown).
+ */
+template<typename expr>
+expression<typename linearization<expr>::type>
+linearize(const expression<expr>& e) {
+  static_assert(expr::rank == 1, "linearize expects a rank-1 expression");
+  return derivative<trial_direction, expr>::initialize(e.expr);
+}
+
 
 template<typename inner_expr>
 expression<composition<inner_expr> > compose(double (*f)(double), const expression<inner_expr>& e) {
   return composition<inner_expr>(f, e.expr);
 }
 
+// df is the derivative of f
+template<typename inner_expr>
+expression<composition<inner_expr> > compose(double (*f)(double), double (*df)(double),
+					     const expression<inner_expr>& e) {
+  return composition<inner_expr>(f, df, e.expr);
+}
+
 template<std::size_t direction, typename expr>
 expression<typename differentiate<direction, expr>::type>
 d(const expression<expr>& e) {
@@ -412,6 +956,67 @@ operator-(const expression<left>& l, const expression<right>& r) {
   return ret(binary_expression<left, right, substract<double>>(l, r));
 }
 
+template<typename left, typename right>
+expression<binary_expression<left, right, divide<double>> >
+operator/(const expression<left>& l, const expression<right>& r) {
+  static_assert(right::rank == 0, "operator/ expects a rank-0 divisor");
+  typedef expression<binary_expression<left, right, divide<double>> > ret;
+  return ret(binary_expression<left, right, divide<double>>(l, r));
+}
+
+
+/*
+ * Compile-time dependency of an expression on the arguments of a
+ * form. expression_depends_on<expr, a> is true if the expression uses
+ * the argument a, and expression_couples<expr, a, b> is true if the
+ * expression, expanded as a sum of products, has a term which uses both
+ * a and b. Unknown expression types are conservatively assumed to
+ * depend on all the arguments, unless their rank is zero.
+ */
+template<typename expr, std::size_t a>
+struct expression_depends_on: bool_constant<(expr::rank > 0)> {};
+
+template<typename expr, std::size_t a, std::size_t b>
+struct expression_couples: bool_constant<(expr::rank > 1)> {};
+
+template<typename expr, std::size_t a>
+struct expression_depends_on<expression<expr>, a>: expression_depends_on<expr, a> {};
+
+template<typename expr, std::size_t a, std::size_t b>
+struct expression_couples<expression<expr>, a, b>: expression_couples<expr, a, b> {};
+
+template<std::size_t arg, std::size_t rnk, std::size_t derivative, std::size_t degree, std::size_t a>
+struct expression_depends_on<form<arg, rnk, derivative, degree>, a>: bool_constant<arg == a> {};
+
+template<std::size_t arg, std::size_t rnk, std::size_t derivative, std::size_t degree,
+	 std::size_t a, std::size_t b>
+struct expression_couples<form<arg, rnk, derivative, degree>, a, b>: false_type {};
+
+template<typename left, typename right, typename op, std::size_t a>
+struct expression_depends_on<binary_expression<left, right, op>, a>
+  : bool_constant<expression_depends_on<left, a>::value or expression_depends_on<right, a>::value> {};
+
+template<typename left, typename right, typename op, std::size_t a, std::size_t b>
+struct expression_couples<binary_expression<left, right, op>, a, b>
+  : bool_constant<expression_couples<left, a, b>::value or expression_couples<right, a, b>::value
+		  or (expression_depends_on<left, a>::value and expression_depends_on<right, b>::value)
+		  or (expression_depends_on<left, b>::value and expression_depends_on<right, a>::value)> {};
+
+template<typename left, typename right, std::size_t a, std::size_t b>
+struct expression_couples<binary_expression<left, right, add<double> >, a, b>
+  : bool_constant<expression_couples<left, a, b>::value or expression_couples<right, a, b>::value> {};
+
+template<typename left, typename right, std::size_t a, std::size_t b>
+struct expression_couples<binary_expression<left, right, substract<double> >, a, b>
+  : bool_constant<expression_couples<left, a, b>::value or expression_couples<right, a, b>::value> {};
+
+template<typename inner_expr, std::size_t a>
+struct expression_depends_on<composition<inner_expr>, a>: expression_depends_on<inner_expr, a> {};
+
+template<typename inner_expr, std::size_t a, std::size_t b>
+struct expression_couples<composition<inner_expr>, a, b>
+  : bool_constant<expression_depends_on<inner_expr, a>::value and expression_depends_on<inner_expr, b>::value> {};
+
 
 template<std::size_t n, std::size_t n_max>
 struct expression_call_wrapper {
@@ -19,6 +19,7 @@ namespace cell {
     typedef cell::edge cell_type;
 
     static const std::size_t n_dof_per_element = 1;
+    static const std::size_t degree = 0;
     static constexpr std::size_t n_dof[2] = {0, 1};
     static constexpr std::size_t n_dof_per_subdomain(unsigned int i) {
       return n_dof[i];
@@ -55,6 +56,7 @@ namespace cell {
     typedef cell::edge cell_type;
 
     static const std::size_t n_dof_per_element = 2;
+    static const std::size_t degree = 1;
     static constexpr std::size_t n_dof[2] = {1, 0};
     static constexpr std::size_t n_dof_per_subdomain(unsigned int i) {
       return n_dof[i];
@@ -105,6 +107,7 @@ namespace cell {
     using edge::fe::lagrange_p1::cell_type;
 
     static const std::size_t n_dof_per_element = 3;
+    static const std::size_t degree = 2;
     static constexpr std::size_t n_dof[] = {1, 1};
     static constexpr std::size_t n_dof_per_subdomain(unsigned int i) {
       return n_dof[i];
@@ -173,6 +176,7 @@ namespace cell {
     typedef cell::edge cell_type;
 
     static const std::size_t n_dof_per_element = 3;
+    static const std::size_t degree = 2;
     static constexpr std::size_t n_dof[2] = {1, 1};
     static constexpr std::size_t n_dof_per_subdomain(unsigned int i) {
       return n_dof[i];
@@ -225,6 +229,7 @@ namespace cell {
     typedef cell::triangle cell_type;
 
     static const std::size_t n_dof_per_element = 1;
+    static const std::size_t degree = 0;
     static constexpr std::size_t n_dof[3] = {0, 0, 1};
     static constexpr std::size_t n_dof_per_subdomain(unsigned int i) {
       return n_dof[i];
@@ -261,6 +266,7 @@ namespace cell {
     typedef cell::triangle cell_type;
 
     static const std::size_t n_dof_per_element = 3;
+    static const std::size_t degree = 1;
     static constexpr std::size_t n_dof[] = {1, 0, 0};
     static constexpr std::size_t n_dof_per_subdomain(unsigned int i) {
       return n_dof[i];
@@ -331,6 +337,7 @@ namespace cell {
     using triangle::fe::lagrange_p1::cell_type;
 
     static const std::size_t n_dof_per_element = 4;
+    static const std::size_t degree = 3;
     static constexpr std::size_t n_dof[] = {1, 0, 1};
     static constexpr std::size_t n_dof_per_subdomain(unsigned int i) {
       return n_dof[i];
@@ -390,6 +397,7 @@ namespace cell {
     typedef cell::triangle cell_type;
 
     static const std::size_t n_dof_per_element = 6;
+    static const std::size_t degree = 2;
     static constexpr std::size_t n_dof[] = {1, 1, 0};
     static constexpr std::size_t n_dof_per_subdomain(unsigned int i) {
       return n_dof[i];
@@ -460,6 +468,7 @@ namespace cell {
     typedef cell::tetrahedron cell_type;
 
     static const std::size_t n_dof_per_element = 1;
+    static const std::size_t degree = 0;
     static constexpr std::size_t n_dof[] = {0, 0, 0, 1};
     static constexpr std::size_t n_dof_per_subdomain(unsigned int i) {
       return n_dof[i];
@@ -495,6 +504,7 @@ namespace cell {
     typedef cell::tetrahedron cell_type;
 
     static const std::size_t n_dof_per_element = 4;
+    static const std::size_t degree = 1;
     static constexpr std::size_t n_dof[] = {1, 0, 0, 0};
     static constexpr std::size_t n_dof_per_subdomain(unsigned int i) {
       return n_dof[i];
@@ -585,6 +595,7 @@ namespace cell {
     using tetrahedron::fe::lagrange_p1::cell_type;
 
     static const std::size_t n_dof_per_element = 5;
+    static const std::size_t degree = 4;
     static constexpr std::size_t n_dof[] = {1, 0, 0, 1};
     static constexpr std::size_t n_dof_per_subdomain(unsigned int i) {
       return n_dof[i];
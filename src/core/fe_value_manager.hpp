@@ -1,11 +1,14 @@
 #ifndef FE_VALUE_MANAGER_H
 #define FE_VALUE_MANAGER_H
 
+#include <algorithm>
+#include <string>
 #include <tuple>
 
 #include <spikes/array.hpp>
 
 #include "meta.hpp"
+#include "tabulation.hpp"
 
 
 template<template<typename> class F, typename TL>
@@ -67,9 +70,26 @@ struct fe_value_manager<type_list<fe_pack...> > {
     using index_sequence = make_integral_list_t<std::size_t, sizeof...(fe_pack)>;
     call_for_each<prepare_hat_impl, index_sequence>::call(values, values_hat, xq_hat);
   }
+
+  /*
+   *  Set the points of the set s of a tabulation point set: the basis
+   *  functions are copied from their tables.
+   */
+  template<typename point_set_type>
+  void set_point_set(std::size_t s) {
+    if (point_set_type::n_point != xq_hat.get_size(0))
+      throw std::string("fe_value_manager::set_point_set: wrong number of points");
+
+    const array<double>& x(point_set_type::get_points(s));
+    std::copy(x.get_data(), x.get_data() + x.get_element_number(), xq_hat.get_data());
+
+    using index_sequence = make_integral_list_t<std::size_t, sizeof...(fe_pack)>;
+    call_for_each<copy_table<point_set_type>::template impl, index_sequence>::call(values, values_hat, s);
+  }
     
   
-  void prepare(const array<double>& jmt) {
+  template<typename jacobian_type>
+  void prepare(const jacobian_type& jmt) {
     using index_sequence = make_integral_list_t<std::size_t, sizeof...(fe_pack)>;
     call_for_each<prepare_impl, index_sequence
 		  >::call(values, values_hat, jmt, xq_hat);
@@ -101,27 +121,32 @@ private:
   
   template<std::size_t n>
   struct prepare_impl<integral_constant<std::size_t, n> > {
+    template<typename jacobian_type>
     static void call(values_type& values,
 		     const values_type& values_hat,
-		     const array<double>& jmt,
+		     const jacobian_type& jmt,
 		     const array<double>& xq_hat) {
       
-      array<double>& phi(std::get<n>(values));
-      const array<double>& phi_hat(std::get<n>(values_hat));
-    
       const std::size_t n_q(xq_hat.get_size(0));
       const std::size_t n_dim(cell_type::n_dimension);
       const std::size_t n_dof(fe_type<n>::n_dof_per_element);
-    
+
+      // the loops over the dimensions have compile-time bounds
+      double j[n_dim][n_dim];
+      for (std::size_t s(0); s < n_dim; ++s)
+	for (std::size_t t(0); t < n_dim; ++t)
+	  j[s][t] = jmt.at(s, t);
+
       // prepare the basis function derivatives on the quadrature points
-      for (unsigned int q(0); q < n_q; ++q) {
-	for (std::size_t i(0); i < n_dof; ++i) {
-	  phi.at(q, i, 0) = phi_hat.at(q, i, 0);
-	  for (std::size_t s(0); s < n_dim; ++s) {
-	    phi.at(q, i, 1 + s) = 0.0;
-	    for (std::size_t t(0); t < n_dim; ++t)
-	      phi.at(q, i, 1 + s) += jmt.at(s, t) * phi_hat.at(q, i, 1 + t);
-	  }
+      double* phi(std::get<n>(values).get_data());
+      const double* phi_hat(std::get<n>(values_hat).get_data());
+      for (std::size_t p(0); p < n_q * n_dof; ++p, phi += n_dim + 1, phi_hat += n_dim + 1) {
+	phi[0] = phi_hat[0];
+	for (std::size_t s(0); s < n_dim; ++s) {
+	  double d(0.0);
+	  for (std::size_t t(0); t < n_dim; ++t)
+	    d += j[s][t] * phi_hat[1 + t];
+	  phi[1 + s] = d;
 	}
       }
     }
@@ -158,6 +183,26 @@ private:
   };
 
 
+  template<typename point_set_type>
+  struct copy_table {
+    template<typename integral_value>
+    struct impl;
+
+    template<std::size_t n>
+    struct impl<integral_constant<std::size_t, n> > {
+      static void call(values_type& values,
+		       values_type& values_hat,
+		       std::size_t s) {
+	using table_type = tabulation::table<fe_type<n>, point_set_type>;
+
+	const double* t(table_type::get(s));
+	std::copy(t, t + table_type::set_size, std::get<n>(values_hat).get_data());
+	std::copy(t, t + table_type::set_size, std::get<n>(values).get_data());
+      }
+    };
+  };
+
+
   template<typename integral_value>
   struct clear_impl;
 
@@ -19,7 +19,8 @@ public:
     : m(m),
       dof_map{m.get_cell_number(),
       fe_type::n_dof_per_element},
-      global_dof_to_local_dof{0} {
+      global_dof_to_local_dof{0},
+      dof_space_coordinates{0, cell_type::n_dimension} {
     const array<unsigned int>& elements(m.get_cells());
     
     using cell::subdomain_type;
@@ -72,6 +73,7 @@ public:
     }
 
     dof_number = global_dof_offset;
+    dof_map = parallel::first_touch_copy(dof_map);
 
     global_dof_to_local_dof = array<unsigned int>{dof_number, 2};
     for (std::size_t k(0); k < dof_map.get_size(0); ++k)
@@ -79,6 +81,8 @@ public:
 	global_dof_to_local_dof.at(dof_map.at(k, n), 0) = k;
 	global_dof_to_local_dof.at(dof_map.at(k, n), 1) = n;
       }
+
+    compute_dof_space_coordinates();
   }
 
   template<typename c_cell_type>
@@ -100,52 +104,42 @@ public:
   template<typename c_cell_type>
   void add_dirichlet_boundary(const submesh<cell_type, c_cell_type>& dm,
                               double value = 0.0) {
-    using cell::subdomain_type;
-
-    std::size_t global_dof_offset(0);
-    for (std::size_t sd(0); sd < submesh<cell_type>::cell_type::n_subdomain_type; ++sd) {
-      const std::size_t hat_m(fe_type::n_dof_per_subdomain(sd));
-      if (fe_type::n_dof_per_subdomain(sd)) {
-	const array<unsigned int>& elements(dm.get_cells());
-	std::set<subdomain_type> subdomains(submesh<cell_type>::cell_type::get_subdomain_list(elements, sd));
-	for (const auto& subdomain: subdomains) {
-	  const std::size_t j(std::distance(subdomain_list[sd].begin(),
-					    subdomain_list[sd].find(subdomain)));
-	  for (unsigned int hat_i(0); hat_i < hat_m; ++hat_i) {
-            const std::size_t dof_id((j * hat_m + hat_i) + global_dof_offset);
-	    dirichlet_dof_values.insert(std::make_pair(dof_id, value));
-          }
-	}
-	global_dof_offset += hat_m * subdomain_list[sd].size();
-      }
-    }
+    for (const auto dof_id: get_boundary_dofs(dm))
+      dirichlet_dof_values.insert(std::make_pair(dof_id, value));
   }
-  
+
+  /*
+   *  f_bc is evaluated on the dofs of dm in order, or concurrently when
+   *  parallel::thread_safe is passed.
+   */
   template<typename c_cell_type>
   void add_dirichlet_boundary(const submesh<cell_type, c_cell_type>& dm,
                               const std::function<double(const double*)>& f_bc) {
-    using cell::subdomain_type;
+    set_dirichlet_values(dm, f_bc, false, false);
+  }
 
-    std::size_t global_dof_offset(0);
-    for (std::size_t sd(0); sd < submesh<cell_type>::cell_type::n_subdomain_type; ++sd) {
-      const std::size_t hat_m(fe_type::n_dof_per_subdomain(sd));
-      if (fe_type::n_dof_per_subdomain(sd)) {
-	const array<unsigned int>& elements(dm.get_cells());
-	std::set<subdomain_type> subdomains(submesh<cell_type>::cell_type::get_subdomain_list(elements, sd));
-	for (const auto& subdomain: subdomains) {
-	  const std::size_t j(std::distance(subdomain_list[sd].begin(),
-					    subdomain_list[sd].find(subdomain)));
-	  for (unsigned int hat_i(0); hat_i < hat_m; ++hat_i) {
-            const std::size_t dof_id((j * hat_m + hat_i) + global_dof_offset);
-            const array<double> x(get_dof_space_coordinate(dof_id));
-            const double dof_value(f_bc(&x.at(0, 0)));
-            
-	    dirichlet_dof_values.insert(std::make_pair(dof_id, dof_value));
-          }
-	}
-	global_dof_offset += hat_m * subdomain_list[sd].size();
-      }
-    }
+  template<typename c_cell_type>
+  void add_dirichlet_boundary(const submesh<cell_type, c_cell_type>& dm,
+                              const std::function<double(const double*)>& f_bc,
+                              parallel::thread_safe_t) {
+    set_dirichlet_values(dm, f_bc, true, false);
+  }
+
+  /*
+   *  Replace the values of the dirichlet dofs of dm by f_bc, for the
+   *  boundary data which depend on time.
+   */
+  template<typename c_cell_type>
+  void update_dirichlet_boundary(const submesh<cell_type, c_cell_type>& dm,
+                                 const std::function<double(const double*)>& f_bc) {
+    set_dirichlet_values(dm, f_bc, false, true);
+  }
+
+  template<typename c_cell_type>
+  void update_dirichlet_boundary(const submesh<cell_type, c_cell_type>& dm,
+                                 const std::function<double(const double*)>& f_bc,
+                                 parallel::thread_safe_t) {
+    set_dirichlet_values(dm, f_bc, true, true);
   }
   
   std::size_t get_dof_number() const {
@@ -160,6 +154,21 @@ public:
     return dirichlet_dof_values;
   }
 
+  /*
+   *  The dofs of the cell interiors, which are the last local dofs of
+   *  each cell: interior_dofs.at(k, n) is the n-th one of the cell k.
+   */
+  array<unsigned int> get_cell_interior_dofs() const {
+    const std::size_t n_interior(fe_type::n_dof_per_subdomain(cell_type::n_dimension));
+    const std::size_t n_first(fe_type::n_dof_per_element - n_interior);
+
+    array<unsigned int> interior_dofs{dof_map.get_size(0), n_interior};
+    for (std::size_t k(0); k < dof_map.get_size(0); ++k)
+      for (std::size_t n(0); n < n_interior; ++n)
+	interior_dofs.at(k, n) = dof_map.at(k, n_first + n);
+    return interior_dofs;
+  }
+
   const std::vector<std::set<cell::subdomain_type> > get_subdomain_list() const {
     return subdomain_list;
   }
@@ -188,17 +197,19 @@ public:
   const fe_mesh<cell_type>& get_mesh() const { return m; }
 
   array<double> get_dof_space_coordinate(unsigned int i) const {
-    const std::size_t local_node_id(global_dof_to_local_dof.at(i, 1));
-    
     array<double> x{1, cell_type::n_dimension};
-    std::copy(&fe_type::x[local_node_id][0],
-	      &fe_type::x[local_node_id][0] + cell_type::n_dimension,
+    std::copy(&dof_space_coordinates.at(i, 0),
+	      &dof_space_coordinates.at(i, 0) + cell_type::n_dimension,
 	      &x.at(0, 0));
+    return x;
+  }
 
-    return cell_type::map_points_to_space_coordinates(m.get_vertices(),
-						      m.get_cells(),
-						      global_dof_to_local_dof.at(i,0),
-						      x);
+  /*
+   *  The space coordinates of all the dofs: the row i is the one of the
+   *  dof i.
+   */
+  const array<double>& get_dof_space_coordinates() const {
+    return dof_space_coordinates;
   }
 
   std::size_t get_dof_element(std::size_t i) const { return global_dof_to_local_dof.at(i, 0); }
@@ -209,10 +220,76 @@ private:
   array<unsigned int> dof_map;
   array<unsigned int> global_dof_to_local_dof;
   std::size_t dof_number;
+  array<double> dof_space_coordinates;
   
   std::map<unsigned int, double> dirichlet_dof_values;
 
   std::vector<std::set<cell::subdomain_type> > subdomain_list;
+
+  /*
+   *  Each dof is mapped from the reference coordinates of its node in the
+   *  last cell which holds it, by the owners of the dofs.
+   */
+  void compute_dof_space_coordinates() {
+    dof_space_coordinates = array<double>{dof_number, cell_type::n_dimension};
+    parallel::for_each_partition(0, dof_number, [this](std::size_t i_begin, std::size_t i_end) {
+	small_tensor<double, 1, cell_type::n_dimension> x_hat, x;
+	for (std::size_t i(i_begin); i < i_end; ++i) {
+	  x_hat.set_data(&fe_type::x[global_dof_to_local_dof.at(i, 1)][0]);
+	  cell_type::map_points_to_space_coordinates(x, m.get_vertices(), m.get_cells(),
+						     global_dof_to_local_dof.at(i, 0), x_hat);
+	  std::copy(x.get_data(), x.get_data() + cell_type::n_dimension, &dof_space_coordinates.at(i, 0));
+	}
+      });
+  }
+
+  /*
+   *  The dofs on the subdomains of the cells of dm.
+   */
+  template<typename c_cell_type>
+  std::vector<unsigned int> get_boundary_dofs(const submesh<cell_type, c_cell_type>& dm) const {
+    using cell::subdomain_type;
+
+    std::vector<unsigned int> dofs;
+    std::size_t global_dof_offset(0);
+    for (std::size_t sd(0); sd < submesh<cell_type>::cell_type::n_subdomain_type; ++sd) {
+      const std::size_t hat_m(fe_type::n_dof_per_subdomain(sd));
+      if (fe_type::n_dof_per_subdomain(sd)) {
+	const array<unsigned int>& elements(dm.get_cells());
+	std::set<subdomain_type> subdomains(submesh<cell_type>::cell_type::get_subdomain_list(elements, sd));
+	for (const auto& subdomain: subdomains) {
+	  const std::size_t j(std::distance(subdomain_list[sd].begin(),
+					    subdomain_list[sd].find(subdomain)));
+	  for (unsigned int hat_i(0); hat_i < hat_m; ++hat_i)
+	    dofs.push_back((j * hat_m + hat_i) + global_dof_offset);
+	}
+	global_dof_offset += hat_m * subdomain_list[sd].size();
+      }
+    }
+    return dofs;
+  }
+
+  /*
+   *  The values of the dofs of dm already set are kept, unless replace
+   *  is set.
+   */
+  template<typename c_cell_type>
+  void set_dirichlet_values(const submesh<cell_type, c_cell_type>& dm,
+			    const std::function<double(const double*)>& f_bc,
+			    bool concurrent, bool replace) {
+    const std::vector<unsigned int> dofs(get_boundary_dofs(dm));
+    std::vector<double> values(dofs.size());
+    parallel::parallel_for_if(concurrent, 0, dofs.size(), [&](std::size_t n_begin, std::size_t n_end) {
+	for (std::size_t n(n_begin); n < n_end; ++n)
+	  values[n] = f_bc(&dof_space_coordinates.at(dofs[n], 0));
+      });
+
+    for (std::size_t n(0); n < dofs.size(); ++n)
+      if (replace)
+	dirichlet_dof_values[dofs[n]] = values[n];
+      else
+	dirichlet_dof_values.insert(std::make_pair(dofs[n], values[n]));
+  }
 };
 
 
@@ -271,7 +348,7 @@ public:
   double evaluate(const double* x) const {
     std::size_t k(get_mesh().get_cell_at(x));
     
-    const array<double>
+    const typename cell_type::barycentric_type
       bc_coord(cell_type::get_barycentric_coordinates(
         get_mesh().get_vertices(),
 	get_mesh().get_cells(),
@@ -472,7 +549,7 @@ to_mesh_cell_data(const typename finite_element_space<fe_type>::element& v) {
   
   array<double> values{m.get_cell_number(), 1};
 
-  const array<double> bc_hat(cell_type::barycenter());
+  const typename cell_type::vector_type bc_hat(cell_type::barycenter());
   for (std::size_t k(0); k < m.get_cell_number(); ++k) {
     values.at(k, 0) = v.evaluate(k, &bc_hat.at(0));
   }
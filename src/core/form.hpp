@@ -4,14 +4,22 @@
 #include <cstddef>
 #include <ostream>
 #include <algorithm>
+#include <cmath>
 
 #include <spikes/array.hpp>
 
 #include "mesh.hpp"
+#include "profiler.hpp"
+#include "scheduler.hpp"
+#include "quadrature.hpp"
 #include "expression.hpp"
 #include "solver.hpp"
 #include "meta.hpp"
 #include "fe_value_manager.hpp"
+#include "tabulation.hpp"
+#include "reference_tensor.hpp"
+#include "operator_cache.hpp"
+#include "static_condensation.hpp"
 
 template<typename cell_t, typename quadrature_t, typename form_t>
 struct mesh_integration_proxy {
@@ -23,6 +31,7 @@ struct mesh_integration_proxy {
   typedef quadrature_t quadrature_type;
   typedef typename std::decay<form_t>::type form_type;
   typedef cell_t cell_type;
+  typedef tabulation::cell_point_set<quadrature_t> point_set_type;
 
   const static std::size_t point_set_number = 1;
   
@@ -34,6 +43,10 @@ struct mesh_integration_proxy {
     return k;
   }
 
+  std::size_t get_point_set_id(std::size_t /*k*/) const {
+    return 0;
+  }
+
   const array<double>& get_quadrature_points(std::size_t /*k*/) const {
     return xq;
   }
@@ -50,6 +63,7 @@ struct submesh_integration_proxy {
   typedef typename std::decay<form_t>::type form_type;
   typedef typename submesh<cell_t>::cell_type cell_type;
   typedef typename submesh<cell_t>::parent_cell_type parent_cell_type;
+  typedef tabulation::subdomain_point_set<parent_cell_type, quadrature_t> point_set_type;
 
   const static std::size_t point_set_number = parent_cell_type::n_subdomain_of_type[parent_cell_type::n_subdomain_type - 2];
   
@@ -61,9 +75,12 @@ struct submesh_integration_proxy {
     return m.get_parent_cell_id(k);
   }
   
-  array<double> get_quadrature_points(std::size_t k) const {
-    array<double> hat_xq(cell_t::map_points_to_subdomain(m.get_subdomain_id(k), xq));
-    return hat_xq;
+  std::size_t get_point_set_id(std::size_t k) const {
+    return m.get_subdomain_id(k);
+  }
+
+  const array<double>& get_quadrature_points(std::size_t k) const {
+    return point_set_type::get_points(m.get_subdomain_id(k));
   }
 };
 
@@ -84,10 +101,44 @@ integrate(const expression<form_type>& f, const submesh<cell_type>& m) {
   return submesh_integration_proxy<cell_type, quadrature_type, expression<form_type> >(f, m);
 }
 
-template<typename T>
-double integrate_with_proxy(const T& integration_proxy) {
-  static_assert(T::form_type::rank == 0, "integrate_with_proxy expects rank-0 expression.");
+/*
+ *  Sum with a running compensation of the rounding errors (Neumaier):
+ *  the error of a sum of n terms does not grow with n.
+ */
+class compensated_sum {
+public:
+  compensated_sum() : sum(0.0), compensation(0.0) {}
+
+  void add(double x) {
+    const double t(sum + x);
+    if (std::abs(sum) >= std::abs(x))
+      compensation += (sum - t) + x;
+    else
+      compensation += (x - t) + sum;
+    sum = t;
+  }
 
+  void add(const compensated_sum& s) {
+    add(s.sum);
+    compensation += s.compensation;
+  }
+
+  double get_value() const {
+    return sum + compensation;
+  }
+
+private:
+  double sum;
+  double compensation;
+};
+
+/*
+ *  The sum of the integrals of the rank-0 expression on the cells
+ *  [k_begin, k_end). The integration proxy is taken by value, since the
+ *  expressions cache their values.
+ */
+template<typename T>
+compensated_sum integrate_cell_range(std::size_t k_begin, std::size_t k_end, T integration_proxy) {
   typedef typename T::quadrature_type quadrature_type;
   typedef typename T::cell_type cell_type;
 
@@ -98,32 +149,58 @@ double integrate_with_proxy(const T& integration_proxy) {
   array<double> omega{n_q};
   omega.set_data(&quadrature_type::w[0]);
 
-  //timer t;
-
   array<double> xq{n_q, cell_type::n_dimension};
-  double result(0.0);
-  for (unsigned int k(0); k < m.get_cell_number(); ++k) {
+  compensated_sum result;
+  for (std::size_t k(k_begin); k < k_end; ++k) {
     const array<double>& xq_hat(integration_proxy.get_quadrature_points(k));
     cell_type::map_points_to_space_coordinates(xq,
 					       m.get_vertices(),
 					       m.get_cells(),
 					       k, xq_hat);
+    expression_cache cache;
+    integration_proxy.f.template prepare_cell<typename T::point_set_type>(k, integration_proxy.get_point_set_id(k), cache);
+
     // evaluate the expression
-    const double volume(m.get_cell_volume(k));
-    double rhs_el(0.0);
+    double value(0.0);
     for (unsigned int q(0); q < n_q; ++q) {
-      integration_proxy.f.prepare(k, &xq.at(q, 0), &xq_hat.at(q, 0));
-      
-      rhs_el += omega.at(q)
+      integration_proxy.f.prepare(k, q, &xq.at(q, 0), &xq_hat.at(q, 0));
+
+      value += omega.at(q)
 	* integration_proxy.f(k, &xq.at(q, 0), &xq_hat.at(q, 0));
     }
-    result += rhs_el * volume;
+    result.add(value * m.get_cell_volume(k));
   }
-
-  //std::cerr << "integrate_with_proxy: loop : "  << t.tic() << std::endl;
   return result;
 }
 
+/*
+ *  The cells are split in chunks of a fixed size, whose sums are
+ *  reduced in the chunk order: the result does not depend on the thread
+ *  number.
+ */
+template<typename T>
+double integrate_with_proxy(const T& integration_proxy) {
+  static_assert(T::form_type::rank == 0, "integrate_with_proxy expects rank-0 expression.");
+
+  const std::size_t n_element(integration_proxy.m.get_cell_number());
+  const std::size_t grain(256);
+
+  profiler::scope integration_scope("integrate");
+
+  const compensated_sum result(parallel::parallel_reduce(0, n_element, compensated_sum(),
+							  [&integration_proxy](std::size_t k_begin, std::size_t k_end) {
+							    return integrate_cell_range(k_begin, k_end, integration_proxy);
+							  },
+							  [](compensated_sum a, const compensated_sum& b) {
+							    a.add(b);
+							    return a;
+							  }, grain));
+
+  profiler::count("cells", n_element);
+  profiler::count("quadrature_points", n_element * T::quadrature_type::n_point);
+  return result.get_value();
+}
+
 template<typename quadrature_type, typename cell_type, typename form_type>
 typename std::enable_if<form_type::rank == 0, double>::type
 integrate(const expression<form_type>& f, const fe_mesh<cell_type>& m) {
@@ -138,6 +215,37 @@ integrate(const expression<form_type>& f, const submesh<cell_type>& m) {
   return integrate_with_proxy(proxy);
 }
 
+/*
+ *  integrate<n>(f, m) uses the rule with the fewest points exact for the
+ *  degree n, and integrate(f, m) the one exact for the degree of the
+ *  expression. The degree of an expression using a function of the space
+ *  coordinates is unknown: give the degree or the rule.
+ */
+template<std::size_t degree, typename cell_type, typename form_type>
+auto integrate(const expression<form_type>& f, const fe_mesh<cell_type>& m)
+  -> decltype(integrate<typename minimal_quadrature<cell_type, degree>::type>(f, m)) {
+  return integrate<typename minimal_quadrature<cell_type, degree>::type>(f, m);
+}
+
+template<std::size_t degree, typename cell_type, typename form_type>
+auto integrate(const expression<form_type>& f, const submesh<cell_type>& m)
+  -> decltype(integrate<typename minimal_quadrature<typename submesh<cell_type>::cell_type, degree>::type>(f, m)) {
+  return integrate<typename minimal_quadrature<typename submesh<cell_type>::cell_type, degree>::type>(f, m);
+}
+
+// the unknown degree is reported by integrate
+template<typename form_type>
+struct expression_quadrature_degree
+  : integral_constant<std::size_t, form_type::polynomial_degree == non_polynomial_degree ? 0 : form_type::polynomial_degree> {};
+
+template<typename mesh_type, typename form_type>
+auto integrate(const expression<form_type>& f, const mesh_type& m)
+  -> decltype(integrate<expression_quadrature_degree<form_type>::value>(f, m)) {
+  static_assert(form_type::polynomial_degree != non_polynomial_degree,
+		"integrate: the degree of the expression is unknown, give the degree or the quadrature rule");
+  return integrate<expression_quadrature_degree<form_type>::value>(f, m);
+}
+
 
 #include "linear_form.hpp"
 #include "bilinear_form.hpp"
@@ -0,0 +1,406 @@
+#ifndef FUSED_ASSEMBLY_H
+#define FUSED_ASSEMBLY_H
+
+#include <cstddef>
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <string>
+#include <tuple>
+
+#include <spikes/array.hpp>
+
+#include "meta.hpp"
+#include "expression.hpp"
+#include "fe_value_manager.hpp"
+#include "form.hpp"
+#include "profiler.hpp"
+#include "scheduler.hpp"
+#include "small_tensor.hpp"
+
+
+/*
+ * Assembly of several forms in a single pass over the cells.
+ *
+ * A nonlinear iteration assembles a bilinear form, a linear form and
+ * some functionals (norms, estimators) of the same coefficients on the
+ * same mesh. With
+ *   fused_assembly::assemble(fused_assembly::make_term(a, integrate<q>(..., m)),
+ *                            fused_assembly::make_term(f, integrate<q>(..., m)),
+ *                            fused_assembly::make_term<q>(norm, ..., m));
+ * the quadrature points, the basis functions and the coefficients of a
+ * cell are computed once for all the terms: the coefficient functions
+ * of the terms share one expression_cache. Each term is then added to
+ * its target, a bilinear_form, a linear_form, or a double for a rank-0
+ * expression, with the same result as its own assembly. The terms are
+ * integrated on the same mesh with the same quadrature.
+ *
+ * The bilinear forms are integrated on the quadrature points, also when
+ * their coefficients are constant on the cells: their own assembly by
+ * reference tensors is cheaper then.
+ */
+namespace fused_assembly {
+
+  template<typename target_type, typename proxy_t>
+  class term;
+
+  /*
+   *  A rank-2 expression added to a bilinear form. The element matrices
+   *  are scaled by the cell volumes when they are scattered.
+   */
+  template<typename test_fes_type, typename trial_fes_type, typename proxy_t>
+  class term<bilinear_form<test_fes_type, trial_fes_type>, proxy_t> {
+  public:
+    typedef proxy_t proxy_type;
+    typedef typename test_fes_type::fe_type test_fe_type;
+    typedef typename trial_fes_type::fe_type trial_fe_type;
+    typedef type_list<test_fe_type, trial_fe_type> fe_list;
+
+    static_assert(proxy_type::form_type::rank == 2, "fused_assembly::term: a bilinear form expects a rank-2 expression");
+
+    term(bilinear_form<test_fes_type, trial_fes_type>& target, const proxy_type& proxy)
+      : proxy(proxy), target(target) {}
+
+    void resize(std::size_t n_row) {
+      els.reset(new array<double>{n_row, n_test_dof, n_trial_dof});
+    }
+
+    void clear(std::size_t row) {
+      std::fill(&els->at(row, 0, 0), &els->at(row, 0, 0) + n_test_dof * n_trial_dof, 0.0);
+    }
+
+    template<typename values_type>
+    void add_point(std::size_t row, unsigned int k, std::size_t q, double omega, double volume,
+		   const double* x, const double* x_hat, const values_type& fe_values) {
+      const array<double>& psi(fe_values.template get_values<get_index_of_element<test_fe_type, typename values_type::fe_list>::value>());
+      const array<double>& phi(fe_values.template get_values<get_index_of_element<trial_fe_type, typename values_type::fe_list>::value>());
+
+      double* a_el(&els->at(row, 0, 0));
+      for (unsigned int i(0); i < n_test_dof; ++i)
+	for (unsigned int j(0); j < n_trial_dof; ++j)
+	  a_el[i * n_trial_dof + j] += omega * proxy.f(k, x, x_hat, &psi.at(q, i, 0), &phi.at(q, j, 0));
+    }
+
+    void scatter(std::size_t row, std::size_t k, double volume) {
+      target.add_element_matrix(proxy.get_global_cell_id(k), &els->at(row, 0, 0), volume);
+    }
+
+    proxy_type proxy;
+
+  private:
+    static const std::size_t n_test_dof = test_fe_type::n_dof_per_element;
+    static const std::size_t n_trial_dof = trial_fe_type::n_dof_per_element;
+
+    bilinear_form<test_fes_type, trial_fes_type>& target;
+
+    // shared by the copies of the term made for the threads, which
+    // write distinct rows
+    std::shared_ptr<array<double> > els;
+  };
+
+  /*
+   *  A rank-1 expression added to a linear form.
+   */
+  template<typename test_fes_type, typename proxy_t>
+  class term<linear_form<test_fes_type>, proxy_t> {
+  public:
+    typedef proxy_t proxy_type;
+    typedef typename test_fes_type::fe_type test_fe_type;
+    typedef type_list<test_fe_type> fe_list;
+
+    static_assert(proxy_type::form_type::rank == 1, "fused_assembly::term: a linear form expects a rank-1 expression");
+
+    term(linear_form<test_fes_type>& target, const proxy_type& proxy)
+      : proxy(proxy), target(target) {}
+
+    void resize(std::size_t n_row) {
+      els.reset(new array<double>{n_row, n_test_dof});
+    }
+
+    void clear(std::size_t row) {
+      std::fill(&els->at(row, 0), &els->at(row, 0) + n_test_dof, 0.0);
+    }
+
+    template<typename values_type>
+    void add_point(std::size_t row, unsigned int k, std::size_t q, double omega, double volume,
+		   const double* x, const double* x_hat, const values_type& fe_values) {
+      const array<double>& psi(fe_values.template get_values<get_index_of_element<test_fe_type, typename values_type::fe_list>::value>());
+
+      double* f_el(&els->at(row, 0));
+      for (std::size_t j(0); j < n_test_dof; ++j)
+	f_el[j] += omega * volume * proxy.f(k, x, x_hat, &psi.at(q, j, 0));
+    }
+
+    void scatter(std::size_t row, std::size_t k, double volume) {
+      target.add_element_vector(proxy.get_global_cell_id(k), &els->at(row, 0));
+    }
+
+    proxy_type proxy;
+
+  private:
+    static const std::size_t n_test_dof = test_fe_type::n_dof_per_element;
+
+    linear_form<test_fes_type>& target;
+    std::shared_ptr<array<double> > els;
+  };
+
+  /*
+   *  A rank-0 expression whose integral is added to a double. The
+   *  integrals on the cells are summed with compensation, in the cell
+   *  order.
+   */
+  template<typename proxy_t>
+  class term<double, proxy_t> {
+  public:
+    typedef proxy_t proxy_type;
+    typedef type_list<> fe_list;
+
+    static_assert(proxy_type::form_type::rank == 0, "fused_assembly::term: a functional expects a rank-0 expression");
+
+    term(double& target, const proxy_type& proxy)
+      : proxy(proxy), target(target), sum(new compensated_sum()) {
+      sum->add(target);
+    }
+
+    void resize(std::size_t n_row) {
+      els.reset(new array<double>{n_row});
+    }
+
+    void clear(std::size_t row) {
+      els->at(row) = 0.0;
+    }
+
+    template<typename values_type>
+    void add_point(std::size_t row, unsigned int k, std::size_t q, double omega, double volume,
+		   const double* x, const double* x_hat, const values_type& fe_values) {
+      els->at(row) += omega * proxy.f(k, x, x_hat);
+    }
+
+    void scatter(std::size_t row, std::size_t k, double volume) {
+      sum->add(els->at(row) * volume);
+      target = sum->get_value();
+    }
+
+    proxy_type proxy;
+
+  private:
+    double& target;
+    std::shared_ptr<array<double> > els;
+    std::shared_ptr<compensated_sum> sum;
+  };
+
+
+  template<typename target_type, typename proxy_type>
+  term<target_type, proxy_type> make_term(target_type& target, const proxy_type& proxy) {
+    return term<target_type, proxy_type>(target, proxy);
+  }
+
+  /*
+   *  integrate returns the value of a rank-0 expression, so the term of
+   *  a functional is made from the expression.
+   */
+  template<typename quadrature_type, typename cell_type, typename form_type>
+  term<double, mesh_integration_proxy<cell_type, quadrature_type, expression<form_type> > >
+  make_term(double& target, const expression<form_type>& f, const fe_mesh<cell_type>& m) {
+    typedef mesh_integration_proxy<cell_type, quadrature_type, expression<form_type> > proxy_type;
+    return term<double, proxy_type>(target, proxy_type(f, m));
+  }
+
+  template<typename quadrature_type, typename cell_type, typename form_type>
+  term<double, submesh_integration_proxy<cell_type, quadrature_type, expression<form_type> > >
+  make_term(double& target, const expression<form_type>& f, const submesh<cell_type>& m) {
+    typedef submesh_integration_proxy<cell_type, quadrature_type, expression<form_type> > proxy_type;
+    return term<double, proxy_type>(target, proxy_type(f, m));
+  }
+
+
+  namespace detail {
+    template<typename index>
+    struct check_mesh {
+      template<typename terms_type>
+      static void call(const terms_type& terms, const void* m) {
+	if (static_cast<const void*>(&std::get<index::value>(terms).proxy.m) != m)
+	  throw std::string("fused_assembly::assemble: the terms are not integrated on the same mesh");
+      }
+    };
+
+    template<typename index>
+    struct resize {
+      template<typename terms_type>
+      static void call(terms_type& terms, std::size_t n_row) {
+	std::get<index::value>(terms).resize(n_row);
+      }
+    };
+
+    template<typename index>
+    struct bind_cell {
+      template<typename terms_type>
+      static void call(terms_type& terms, std::size_t row, unsigned int k, expression_cache& cache) {
+	auto& t(std::get<index::value>(terms));
+	typedef typename std::decay<decltype(t)>::type::proxy_type proxy_type;
+
+	t.clear(row);
+	t.proxy.f.template prepare_cell<typename proxy_type::point_set_type>(k, t.proxy.get_point_set_id(k), cache);
+      }
+    };
+
+    // the terms are prepared on the point in the order of their binding,
+    // for the coefficients they share
+    template<typename index>
+    struct add_point {
+      template<typename terms_type, typename values_type>
+      static void call(terms_type& terms, std::size_t row, unsigned int k, std::size_t q,
+		       double omega, double volume, const double* x, const double* x_hat,
+		       const values_type& fe_values) {
+	auto& t(std::get<index::value>(terms));
+	t.proxy.f.prepare(k, q, x, x_hat);
+	t.add_point(row, k, q, omega, volume, x, x_hat, fe_values);
+      }
+    };
+
+    template<typename index>
+    struct scatter {
+      template<typename terms_type>
+      static void call(terms_type& terms, std::size_t row, std::size_t k, double volume) {
+	std::get<index::value>(terms).scatter(row, k, volume);
+      }
+    };
+
+    template<bool ... bs>
+    struct any_of: false_type {};
+
+    template<bool b, bool ... bs>
+    struct any_of<b, bs...>: bool_constant<b or any_of<bs...>::value> {};
+
+    // the values of a basis on the points of the cells are needed even
+    // without finite element, for the fe_value_manager
+    template<typename fe_list, typename cell_type>
+    struct value_fe_list: is_type<fe_list> {};
+
+    template<typename cell_type>
+    struct value_fe_list<type_list<>, cell_type>: is_type<type_list<typename cell_type::fe::lagrange_p0> > {};
+  }
+
+
+  template<typename ... term_types>
+  void assemble(term_types ... terms) {
+    static_assert(sizeof...(term_types) > 0, "fused_assembly::assemble: no term");
+
+    using first_proxy_type = get_element_at_t<0, type_list<typename term_types::proxy_type...> >;
+    using quadrature_type = typename first_proxy_type::quadrature_type;
+    using point_set_type = typename first_proxy_type::point_set_type;
+    using cell_type = typename first_proxy_type::cell_type;
+    using index_list = make_integral_list_t<std::size_t, sizeof...(term_types)>;
+    using fe_list = typename detail::value_fe_list<unique_t<flatten_list_t<type_list<typename term_types::fe_list...> > >,
+						   typename point_set_type::cell_type>::type;
+
+    static_assert(list_size<unique_t<type_list<typename term_types::proxy_type::point_set_type...> > >::value == 1,
+		  "fused_assembly::assemble: the terms are not integrated with the same quadrature");
+
+    const bool require_space_coordinates(detail::any_of<term_types::proxy_type::form_type::require_space_coordinates...>::value);
+    const bool require_jmt(detail::any_of<(term_types::proxy_type::form_type::differential_order > 0)...>::value);
+
+    std::tuple<term_types...> ts(terms...);
+    const auto& m(std::get<0>(ts).proxy.m);
+    call_for_each<detail::check_mesh, index_list>::call(ts, static_cast<const void*>(&m));
+
+    profiler::scope assembly_scope("fused_assembly::assembly");
+
+    // the element contributions of a batch of cells are computed in
+    // parallel, and scattered in the cell order
+    const std::size_t n_element(m.get_cell_number());
+    const std::size_t batch_size(std::max<std::size_t>(1, std::min<std::size_t>(n_element,
+									   1024 * parallel::get_thread_number())));
+    call_for_each<detail::resize, index_list>::call(ts, batch_size);
+
+    const std::size_t n_q(quadrature_type::n_point);
+    small_tensor<double, quadrature_type::n_point> omega;
+    omega.set_data(&quadrature_type::w[0]);
+
+    for (std::size_t k_batch(0); k_batch < n_element; k_batch += batch_size) {
+      const std::size_t k_batch_end(std::min(k_batch + batch_size, n_element));
+
+      parallel::parallel_for(k_batch, k_batch_end, [&](std::size_t k_begin, std::size_t k_end) {
+	  // the expressions cache their values: each thread has its copy
+	  std::tuple<term_types...> local(ts);
+
+	  small_tensor<double, quadrature_type::n_point, point_set_type::cell_type::n_dimension> xq_hat, xq;
+	  xq.fill(0.0);
+	  fe_value_manager<fe_list> fe_values(n_q);
+
+	  if (first_proxy_type::point_set_number == 1) {
+	    xq_hat.set_data(std::get<0>(local).proxy.get_quadrature_points(0).get_data());
+	    fe_values.template set_point_set<point_set_type>(0);
+	  }
+
+	  for (std::size_t k(k_begin); k < k_end; ++k) {
+	    const std::size_t row(k - k_batch);
+	    const auto& proxy(std::get<0>(local).proxy);
+
+	    {
+	      profiler::phase geometry_phase("geometry");
+
+	      if (first_proxy_type::point_set_number > 1)
+		xq_hat.set_data(proxy.get_quadrature_points(k).get_data());
+
+	      if (require_space_coordinates)
+		cell_type::map_points_to_space_coordinates(xq, m.get_vertices(), m.get_cells(), k, xq_hat);
+	    }
+
+	    {
+	      profiler::phase tabulation_phase("tabulation");
+
+	      if (first_proxy_type::point_set_number > 1)
+		fe_values.template set_point_set<point_set_type>(proxy.get_point_set_id(k));
+
+	      if (require_jmt)
+		fe_values.prepare(m.get_jmt(k));
+
+	      // bind the coefficient functions of all the terms to the cell
+	      expression_cache cache;
+	      call_for_each<detail::bind_cell, index_list>::call(local, row, k, cache);
+	    }
+
+	    profiler::phase kernel_phase("kernel");
+	    const double volume(m.get_cell_volume(k));
+	    for (std::size_t q(0); q < n_q; ++q)
+	      call_for_each<detail::add_point, index_list>::call(local, row, k, q, omega.at(q), volume,
+								  &xq.at(q, 0), &xq_hat.at(q, 0), fe_values);
+	  }
+	});
+
+      profiler::phase scatter_phase("scatter");
+      for (std::size_t k(k_batch); k < k_batch_end; ++k)
+	call_for_each<detail::scatter, index_list>::call(ts, k - k_batch, k, m.get_cell_volume(k));
+    }
+
+    profiler::count("cells", n_element);
+    profiler::count("quadrature_points", n_element * n_q);
+  }
+
+
+  namespace detail {
+    template<typename quadrature_type, typename mesh_type, typename ... indices, typename ... form_types>
+    std::array<double, sizeof...(form_types)>
+    integrate_functionals(type_list<indices...>, const mesh_type& m, const expression<form_types>& ... f) {
+      std::array<double, sizeof...(form_types)> values;
+      values.fill(0.0);
+      assemble(make_term<quadrature_type>(values[indices::value], f, m)...);
+      return values;
+    }
+  }
+
+  /*
+   *  The integrals of several rank-0 expressions, in one pass over the
+   *  cells of the mesh or submesh m:
+   *    auto norms(fused_assembly::integrate_functionals<q>(m, u * u, v * v));
+   */
+  template<typename quadrature_type, typename mesh_type, typename ... form_types>
+  std::array<double, sizeof...(form_types)>
+  integrate_functionals(const mesh_type& m, const expression<form_types>& ... f) {
+    static_assert(sizeof...(form_types) > 0, "fused_assembly::integrate_functionals: no expression");
+    return detail::integrate_functionals<quadrature_type>(make_integral_list_t<std::size_t, sizeof...(form_types)>(), m, f...);
+  }
+}
+
+#endif /* FUSED_ASSEMBLY_H */
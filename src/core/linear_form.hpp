@@ -1,19 +1,19 @@
 #ifndef _LINEAR_FORM_H_
 #define _LINEAR_FORM_H_
 
-#include <spikes/thread_pool.hpp>
+#include "profiler.hpp"
+#include "scheduler.hpp"
+#include "small_tensor.hpp"
 
 template<typename test_fes_type>
 class linear_form {
 public:
   linear_form(const test_fes_type& te_fes,
-              std::size_t algebraic_dof_number = 0,
-	      std::size_t n_thread = std::thread::hardware_concurrency())
-    : tp(n_thread),
-      test_fes(te_fes),
+              std::size_t algebraic_dof_number = 0)
+    : test_fes(te_fes),
       f{te_fes.get_dof_number()},
       constraint_values(algebraic_dof_number, 0.0) {
-    f.fill(0.0);
+    parallel::first_touch_fill(f, 0.0);
   }
 
   template<typename T>
@@ -22,53 +22,36 @@ public:
     const std::size_t n_test_dof(test_fe_type::n_dof_per_element);
 
     std::size_t n_element(integration_proxy.m.get_cell_number());
-    std::size_t n_thread(tp.size());
 
-    std::vector<array<double> > rhs_els(n_thread, array<double>{});
-    for (std::size_t n(0); n < n_thread; ++n) {
-      std::size_t
-	k_begin(n_element * n / n_thread ),
-	k_end(std::min(n_element * (n + 1) / n_thread, n_element));
+    profiler::scope assembly_scope("linear_form::assembly");
 
-      rhs_els[n] = array<double>{k_end - k_begin, n_test_dof};
-    }
-
-    std::vector<std::future<void> > futures;
-    for (std::size_t n(0); n < n_thread; ++n) {
-      std::size_t
-	k_begin(n_element * n / n_thread ),
-	k_end(std::min(n_element * (n + 1) / n_thread, n_element));
-      futures.push_back(
-        tp.enqueue(
-	  [this, &rhs_els, integration_proxy, k_begin, k_end, n]
-	  () {
-	    this->assemble_element_range<T>(rhs_els[n],	k_begin, k_end, integration_proxy);
-	  }
-        )
-      );
-
-      //assemble_element_range<T>(rhs_els[n], k_begin, k_end, integration_proxy);
-    }
+    // the element vectors are computed in parallel, and scattered in
+    // the cell order
+    array<double> rhs_el{n_element, n_test_dof};
+    rhs_el.fill(0.0);
 
-    for (auto& f: futures) f.wait();
+    parallel::parallel_for(0, n_element,
+			   [this, &rhs_el, &integration_proxy](std::size_t k_begin, std::size_t k_end) {
+			     this->assemble_element_range<T>(rhs_el, k_begin, k_end, integration_proxy);
+			   });
 
-    for (std::size_t n(0); n < n_thread; ++n) {
-      std::size_t
-	k_begin(n_element * n / n_thread ),
-	k_end(std::min(n_element * (n + 1) / n_thread, n_element));
+    profiler::phase scatter_phase("scatter");
+    for (std::size_t k(0); k < n_element; ++k)
+      add_element_vector(integration_proxy.get_global_cell_id(k), &rhs_el.at(k, 0));
 
-      for (std::size_t k(k_begin); k < k_end; ++k)
-	for (std::size_t j(0); j < n_test_dof; ++j)
-	  f.at(test_fes.get_dof(integration_proxy.get_global_cell_id(k), j)) += rhs_els[n].at(k - k_begin, j);
-    }
+    profiler::count("cells", n_element);
+    profiler::count("quadrature_points", n_element * T::quadrature_type::n_point);
   }
 
+  /*
+   *  Add the element vectors of the cells [k_begin, k_end) in the
+   *  rows k of rhs_el. The integration proxy is taken by value, since
+   *  the expressions cache their values.
+   */
   template<typename T>
   void assemble_element_range(array<double>& rhs_el,
 			      std::size_t k_begin, std::size_t k_end,
 			      T integration_proxy) {
-    rhs_el.fill(0.0);
-
     static_assert(T::form_type::rank == 1, "linear_form expects rank-1 expression.");
 
     typedef typename test_fes_type::fe_type test_fe_type;
@@ -79,15 +62,15 @@ public:
 
     const auto& m(integration_proxy.m);
 
+    profiler::scope range_scope("linear_form::element_range");
 
     // prepare the quadrature weights
     const std::size_t n_q(quadrature_type::n_point);
-    array<double> omega{n_q};
+    small_tensor<double, quadrature_type::n_point> omega;
     omega.set_data(&quadrature_type::w[0]);
 
     // storage for the quadrature points
-    array<double> xq_hat{n_q, test_fe_type::cell_type::n_dimension};
-    array<double> xq{n_q, test_fe_type::cell_type::n_dimension};
+    small_tensor<double, quadrature_type::n_point, test_fe_type::cell_type::n_dimension> xq_hat, xq;
 
     // storage for the point-wise basis function evaluation
     using fe_list = type_list<test_fe_type>;
@@ -97,8 +80,9 @@ public:
     fe_value_manager<unique_fe_list> fe_values(n_q);
 
     if (T::point_set_number == 1) {
-      xq_hat = integration_proxy.get_quadrature_points(0);
-      fe_values.set_points(xq_hat);
+      xq_hat.set_data(integration_proxy.get_quadrature_points(0).get_data());
+      fe_values.template set_point_set<typename T::point_set_type>(0);
+      xq.fill(0.0);
     }
 
     const std::size_t n_test_dof(test_fe_type::n_dof_per_element);
@@ -106,32 +90,46 @@ public:
     // loop over the elements
     for (std::size_t k(k_begin); k < k_end; ++k) {
 
-      // prepare the quadrature points if necessary
-      if (T::point_set_number > 1) {
-	xq_hat = integration_proxy.get_quadrature_points(k);
-	fe_values.set_points(xq_hat);
+      {
+	profiler::phase geometry_phase("geometry");
+
+	// prepare the quadrature points if necessary
+	if (T::point_set_number > 1)
+	  xq_hat.set_data(integration_proxy.get_quadrature_points(k).get_data());
+
+	if (form_type::require_space_coordinates)
+	  cell_type::map_points_to_space_coordinates(xq, m.get_vertices(),
+						     m.get_cells(),
+						     k, xq_hat);
       }
 
-      if (form_type::require_space_coordinates)
-	cell_type::map_points_to_space_coordinates(xq, m.get_vertices(),
-						   m.get_cells(),
-						   k, xq_hat);
+      {
+	profiler::phase tabulation_phase("tabulation");
+
+	if (T::point_set_number > 1)
+	  fe_values.template set_point_set<typename T::point_set_type>(integration_proxy.get_point_set_id(k));
 
-      // prepare the basis function values if necessary
-      if (form_type::differential_order == 1ul) {
-	const array<double>& jmt(m.get_jmt(k));
-	fe_values.prepare(jmt);
+	// prepare the basis function values if necessary
+	if (form_type::differential_order == 1ul) {
+	  const auto& jmt(m.get_jmt(k));
+	  fe_values.prepare(jmt);
+	}
+
+	// bind the coefficient functions to the cell
+	expression_cache cache;
+	integration_proxy.f.template prepare_cell<typename T::point_set_type>(k, integration_proxy.get_point_set_id(k), cache);
       }
 
       const array<double>& psi(fe_values.template get_values<test_fe_index>());
 
       // evaluate the weak form
+      profiler::phase kernel_phase("kernel");
       const double volume(m.get_cell_volume(k));
       for (std::size_t q(0); q < n_q; ++q) {
-	integration_proxy.f.prepare(k, &xq.at(q, 0ul), &xq_hat.at(q, 0ul));
+	integration_proxy.f.prepare(k, q, &xq.at(q, 0ul), &xq_hat.at(q, 0ul));
 
 	for (std::size_t j(0); j < n_test_dof; ++j) {
-	  rhs_el.at(k - k_begin, j) += omega.at(q) * volume *
+	  rhs_el.at(k, j) += omega.at(q) * volume *
 	    integration_proxy.f(k, &xq.at(q, 0ul),
 				&xq_hat.at(q, 0ul),
 				&psi.at(q, j, 0ul));
@@ -141,13 +139,35 @@ public:
     }
   }
 
+  /*
+   *  Add the element vector f_el of the cell k.
+   */
+  void add_element_vector(std::size_t k, const double* f_el) {
+    for (std::size_t j(0); j < test_fes_type::fe_type::n_dof_per_element; ++j)
+      f.at(test_fes.get_dof(k, j)) += f_el[j];
+  }
+
   double& algebraic_equation_value(std::size_t a_dof) { return constraint_values[a_dof]; }
 
-  expression<form<0,1,0> > get_test_function() const { return form<0,1,0>(); }
+  expression<form<0,1,0,test_fes_type::fe_type::degree> > get_test_function() const {
+    return form<0,1,0,test_fes_type::fe_type::degree>();
+  }
 
   const array<double>& get_coefficients() const { return f; }
   const std::vector<double>& get_constraint_values() const { return constraint_values; }
 
+  /*
+   *  f += alpha * x, e.g. with x the product of a cached matrix and of
+   *  the coefficients of a function, instead of assembling the form.
+   */
+  void axpy(double alpha, const array<double>& x) {
+    if (x.get_size(0) != f.get_size(0))
+      throw std::string("linear_form::axpy: incompatible vector size");
+
+    for (std::size_t j(0); j < f.get_size(0); ++j)
+      f.at(j) += alpha * x.at(j);
+  }
+
   void clear() {
     std::fill(f.get_data(),
 	      f.get_data() + f.get_size(0),
@@ -173,8 +193,6 @@ public:
   }
 
 private:
-  thread_pool tp;
-
   const test_fes_type& test_fes;
 
   array<double> f;
@@ -3,6 +3,7 @@
 
 #include <algorithm>
 #include <map>
+#include <memory>
 #include <vector>
 #include <ostream>
 #include <cassert>
@@ -12,6 +13,7 @@
 
 #include "cell.hpp"
 #include "vector_operation.hpp"
+#include "scheduler.hpp"
 
 
 template<typename value_t, typename mesh_t>
@@ -46,7 +48,7 @@ public:
   double get_cell_volume(std::size_t k) const { return cell_type::get_cell_volume(m.get_vertices(), cells, k); }
   std::size_t get_cell_number() const { return cells.get_size(0); }
   std::size_t get_vertex_number() const { return m.get_vertices().get_size(0); }
-  const array<double>& get_jmt(std::size_t k) const { return m.get_jmt(parent_cell_id.at(k)); }
+  const typename parent_cell_type::jacobian_type& get_jmt(std::size_t k) const { return m.get_jmt(parent_cell_id.at(k)); }
   std::size_t get_subdomain_id(std::size_t k) const { return parent_subdomain_id.at(k); }
   std::size_t get_parent_cell_id(std::size_t k) const { return parent_cell_id.at(k); }
   const fe_mesh<parent_cell_type>& get_mesh() const {return m;}
@@ -73,7 +75,9 @@ public:
       for (std::size_t n(0); n < get_vertices().get_size(1); ++n) {
 	const auto normal(cell_type::normal(m.get_vertices(), cells, k));
 	const auto b_val(b(&m.get_vertices().at(cells.at(k, n), 0)));
-	const double dot_product(dotp(normal, b_val));
+	double dot_product(0.0);
+	for (std::size_t i(0); i < normal.get_size(0); ++i)
+	  dot_product += normal.at(i) * b_val.at(i);
 	const bool is_inflow_cell(dot_product < 0.0);
 
 	selected_cells.at(k) = selected_cells.at(k) || is_inflow_cell;
@@ -165,6 +169,18 @@ public:
     (this->references).set_data(references);
   }
 
+  mesh(array<double>&& vertices,
+       array<unsigned int>&& cells,
+       array<unsigned int>&& references)
+    : vertices(std::move(vertices)),
+      cells(std::move(cells)),
+      references(std::move(references)),
+      cell_neighbours{this->cells.get_size(0), cell_type::n_vertex_per_cell} {
+        if(not check_cells_admissibility())
+          sort_cells();
+        compute_cell_neighbours();
+      }
+
   template<typename parent_cell_type>
   mesh(const submesh<parent_cell_type, cell_type>& m)
     : vertices{0},
@@ -217,6 +233,7 @@ public:
   
   const array<double>& get_vertices() const { return vertices; }
   const array<unsigned int>& get_cells() const { return cells; }
+  const array<unsigned int>& get_references() const { return references; }
 
 
   struct subdomain_info {
@@ -244,7 +261,7 @@ public:
 #warning "FIXME: implement a better than O(N) algorithm."
   std::size_t get_cell_at(const double* x) const {
     for (std::size_t k(0); k < get_cell_number(); ++k) {
-      const array<double>
+      const typename cell_type::barycentric_type
 	bc_coord(cell_type::get_barycentric_coordinates(vertices, cells, k, x));
 
       const double* min(std::min_element(&bc_coord.at(0),
@@ -295,38 +312,29 @@ private:
   void sort_cells() {
     for (unsigned int k(0); k < cells.get_size(0); ++k)
       std::sort(&cells.at(k, 0),
-		&cells.at(k, cell_type::n_vertex_per_cell - 1));
+		&cells.at(k, 0) + cell_type::n_vertex_per_cell);
   }
 
   void compute_cell_neighbours() {
     cell_neighbours.fill(-1);
 
-    
     const std::size_t subdomain_id(cell_type::n_subdomain_type - 2);
+    const std::size_t n(cell_type::n_subdomain(subdomain_id));
 
-    const std::set<typename ::cell::subdomain_type>
-      subdomain_set(cell_type::get_subdomain_list(cells, subdomain_id));
-
-    const std::vector<typename ::cell::subdomain_type>
-      subdomain_list(subdomain_set.begin(), subdomain_set.end());
-
-    std::vector<std::pair<int, int> >
-      tmp(subdomain_set.size(), std::pair<int, int>(-1, -1));
-
-    
-    for (std::size_t k(0); k < get_cell_number(); ++k) {
-      const std::size_t n(cell_type::n_subdomain(subdomain_id));
-      for (unsigned int j(0); j < n; ++j) {
-        typename ::cell::subdomain_type subdomain(cell_type::get_subdomain(cells, k, subdomain_id, j));
-        const std::size_t face_id(std::distance(subdomain_list.begin(),
-                                                std::lower_bound(subdomain_list.begin(),
-                                                                 subdomain_list.end(), subdomain)));
-        if (tmp[face_id].first == -1) {
-          tmp[face_id] = std::make_pair<int, int>(k, j);
-        } else {
-          cell_neighbours.at(k, j) = tmp[face_id].first;
-          cell_neighbours.at(tmp[face_id].first, tmp[face_id].second) = k;
-        }
+    // Sort the faces of all the cells, so that the two cells sharing
+    // a face are adjacent in the list.
+    std::vector<std::pair<typename ::cell::subdomain_type, std::size_t> > faces;
+    faces.reserve(get_cell_number() * n);
+    for (std::size_t k(0); k < get_cell_number(); ++k)
+      for (unsigned int j(0); j < n; ++j)
+        faces.push_back(std::make_pair(cell_type::get_subdomain(cells, k, subdomain_id, j), k * n + j));
+    std::sort(faces.begin(), faces.end());
+
+    for (std::size_t i(1); i < faces.size(); ++i) {
+      if (faces[i - 1].first == faces[i].first) {
+        const std::size_t a(faces[i - 1].second), b(faces[i].second);
+        cell_neighbours.at(a / n, a % n) = b / n;
+        cell_neighbours.at(b / n, b % n) = a / n;
       }
     }
   }
@@ -346,6 +354,7 @@ public:
     : mesh<cell>(m),
       cell_volume{m.get_cell_number()},
       h{m.get_cell_number()} {
+      place_data();
       compute_cell_diameter();
       compute_cell_volume();
       compute_jmt();
@@ -358,6 +367,7 @@ public:
     : mesh<cell>(vertices, n_vertices, n_components, cells, n_cells),
       cell_volume{n_cells},
       h{n_cells} {
+      place_data();
       compute_cell_diameter();
       compute_cell_volume();
       compute_jmt();
@@ -369,6 +379,18 @@ public:
           const unsigned int* references)
     : mesh<cell>(vertices, n_vertices, n_components, cells, n_cells, references),
       cell_volume{n_cells}, h{n_cells}, h_max(0.0) {
+    place_data();
+    compute_cell_diameter();
+    compute_cell_volume();
+    compute_jmt();
+  }
+
+  fe_mesh(array<double>&& vertices,
+          array<unsigned int>&& cells,
+          array<unsigned int>&& references)
+    : mesh<cell>(std::move(vertices), std::move(cells), std::move(references)),
+      cell_volume{this->get_cell_number()}, h{this->get_cell_number()}, h_max(0.0) {
+    place_data();
     compute_cell_diameter();
     compute_cell_volume();
     compute_jmt();
@@ -419,6 +441,7 @@ public:
         }
       }
 
+      place_data();
       compute_cell_diameter();
       compute_cell_volume();
       compute_jmt();
@@ -439,7 +462,7 @@ public:
     return cell_volume.at(k);
   }
 
-  const array<double>& get_jmt(std::size_t k) const {
+  const typename cell_type::jacobian_type& get_jmt(std::size_t k) const {
     return jmt[k];
   }
 
@@ -533,7 +556,7 @@ public:
 #warning "FIXME: implement a better than O(N) algorithm."
     std::size_t get_cell_at(const double* x) const {
       for (std::size_t k(0); k < this->get_cell_number(); ++k) {
-        const array<double>
+        const typename cell_type::barycentric_type
           bc_coord(cell_type::get_barycentric_coordinates(mesh<cell>::vertices,
                                                           mesh<cell>::cells, k, x));
 
@@ -558,12 +581,27 @@ private:
   array<double> cell_volume;
   array<double> h;
   double h_max;
-  std::vector<array<double> > jmt;
+  std::unique_ptr<typename cell_type::jacobian_type[]> jmt;
   
+  /*
+   *  With the first-touch placement, the vertex, cell and reference
+   *  arrays are copied by the participants which own their rows, and
+   *  the geometric quantities are computed by the owners of the cells.
+   */
+  void place_data() {
+    if (parallel::first_touch_enabled()) {
+      vertices = parallel::first_touch_copy(vertices);
+      mesh<cell>::cells = parallel::first_touch_copy(mesh<cell>::cells);
+      references = parallel::first_touch_copy(references);
+    }
+  }
+
   void compute_cell_diameter() {
-    for (std::size_t k(0); k < this->get_cell_number(); ++k)
-      h.at(k) = cell_type::cell_diameter(mesh<cell>::vertices,
-                                         mesh<cell>::cells, k);
+    parallel::for_each_partition(0, this->get_cell_number(), [this](std::size_t k_begin, std::size_t k_end) {
+	for (std::size_t k(k_begin); k < k_end; ++k)
+	  h.at(k) = cell_type::cell_diameter(mesh<cell>::vertices,
+					     mesh<cell>::cells, k);
+      });
 
     if (this->get_cell_number())
       h_max = *std::max_element(&h.at(0),
@@ -573,16 +611,24 @@ private:
   }
 
   void compute_cell_volume() {
-    for (std::size_t k(0); k < this->get_cell_number(); ++k)
-      cell_volume.at(k) = cell_type::get_cell_volume(mesh<cell>::vertices,
-                                                     mesh<cell>::cells, k);
+    parallel::for_each_partition(0, this->get_cell_number(), [this](std::size_t k_begin, std::size_t k_end) {
+	for (std::size_t k(k_begin); k < k_end; ++k)
+	  cell_volume.at(k) = cell_type::get_cell_volume(mesh<cell>::vertices,
+							 mesh<cell>::cells, k);
+      });
   }
 
+  /*
+   *  The jacobians are left uninitialized by the allocation, so that
+   *  their pages are first touched by the owners of the cells.
+   */
   void compute_jmt() {
-    jmt.reserve(this->get_cell_number());
-    for (std::size_t k(0); k < this->get_cell_number(); ++k)
-      jmt.push_back(cell_type::get_jmt(mesh<cell>::vertices,
-                                       mesh<cell>::cells, k));
+    jmt.reset(new typename cell_type::jacobian_type[this->get_cell_number()]);
+    parallel::for_each_partition(0, this->get_cell_number(), [this](std::size_t k_begin, std::size_t k_end) {
+	for (std::size_t k(k_begin); k < k_end; ++k)
+	  jmt[k] = cell_type::get_jmt(mesh<cell>::vertices,
+				      mesh<cell>::cells, k);
+      });
   }
 
   submesh<cell_type, cell_type> submesh_from_selection(
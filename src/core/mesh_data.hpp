@@ -6,6 +6,7 @@
 #include "operator.hpp"
 #include "meta.hpp"
 #include "mesh.hpp"
+#include "scheduler.hpp"
 
 template<typename value_t, typename mesh_t>
 class mesh_data;
@@ -349,6 +350,10 @@ compute_boundary_normals(const submesh<cell_type>& dm) {
 }
 
 
+/*
+ *  The functions fs are called concurrently on ranges of cells (or
+ *  vertices), and must therefore be thread safe.
+ */
 template<typename mesh_type, typename ... Fs>
 mesh_data<double, mesh_type>
 evaluate_on_cells(const mesh_type& m, Fs... fs) {
@@ -357,13 +362,15 @@ evaluate_on_cells(const mesh_type& m, Fs... fs) {
   mesh_data<double, mesh_type> result(m, mesh_data_kind::cell,
 				      sizeof...(Fs));
 
-  for (std::size_t k(0); k < m.get_cell_number(); ++k) {
-    const auto x(cell_type::barycenter(m.get_vertices(), m.get_cells(), k));
-    double values[sizeof...(Fs)];
-    array_from<double, return_2nd_t<Fs, double>...>::parameters(values, fs(&x.at(0))...);
-    for (std::size_t n(0); n < sizeof...(Fs); ++n)
-      result.value(k, n) = values[n];
-  }
+  parallel::parallel_for(0, m.get_cell_number(), [&](std::size_t k_begin, std::size_t k_end) {
+      for (std::size_t k(k_begin); k < k_end; ++k) {
+	const auto x(cell_type::barycenter(m.get_vertices(), m.get_cells(), k));
+	double values[sizeof...(Fs)];
+	array_from<double, return_2nd_t<Fs, double>...>::parameters(values, fs(&x.at(0))...);
+	for (std::size_t n(0); n < sizeof...(Fs); ++n)
+	  result.value(k, n) = values[n];
+      }
+    });
 
   return result;
 }
@@ -374,12 +381,14 @@ evaluate_on_vertices(const mesh_type& m, Fs... fs) {
   mesh_data<double, mesh_type> result(m, mesh_data_kind::vertex,
 				      sizeof...(Fs));
 
-  for (std::size_t k(0); k < m.get_vertex_number(); ++k) {
-    double values[sizeof...(Fs)];
-    array_from<double, return_2nd_t<Fs, double>...>::parameters(values, fs(&m.get_vertices().at(k, 0))...);
-    for (std::size_t n(0); n < sizeof...(Fs); ++n)
-      result.value(k, n) = values[n];
-  }
+  parallel::parallel_for(0, m.get_vertex_number(), [&](std::size_t k_begin, std::size_t k_end) {
+      for (std::size_t k(k_begin); k < k_end; ++k) {
+	double values[sizeof...(Fs)];
+	array_from<double, return_2nd_t<Fs, double>...>::parameters(values, fs(&m.get_vertices().at(k, 0))...);
+	for (std::size_t n(0); n < sizeof...(Fs); ++n)
+	  result.value(k, n) = values[n];
+      }
+    });
 
   return result;
 }
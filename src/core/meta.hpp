@@ -250,6 +250,22 @@ template<typename F, typename TL>
 using transform = typename foldr<transform_impl<F>, type_list<>, TL>::type;
 
 
+/*
+ * Type list utility filter: return the list of the elements A of TL
+ * for which P::apply<A>::value is true
+ */
+template<typename P>
+struct filter_impl {
+  template<typename A, typename TL>
+  struct apply: std::conditional<P::template apply<A>::value,
+				 is_type<append_t<A, TL> >,
+				 is_type<TL> >::type {};
+};
+
+template<typename P, typename TL>
+using filter_t = typename foldr<filter_impl<P>, type_list<>, TL>::type;
+
+
 /*
  * Metafunction: the identity metafunction
  */
@@ -0,0 +1,383 @@
+#ifndef NEWTON_H
+#define NEWTON_H
+
+#include <cmath>
+#include <cstddef>
+#include <algorithm>
+#include <numeric>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <spikes/array.hpp>
+
+#include "composite_form.hpp"
+#include "dictionary.hpp"
+#include "expression.hpp"
+#include "form.hpp"
+#include "profiler.hpp"
+#include "solver.hpp"
+
+
+/*
+ *  The iterate of newton_solver, whose components are the unknowns of
+ *  the residual. The iterate of a composite space keeps its components
+ *  as separate elements, updated with its coefficients.
+ */
+template<typename fes_type>
+class newton_iterate {
+public:
+  typedef typename fes_type::fe_type fe_type;
+
+  newton_iterate(const fes_type& fes): fes(fes), u(fes) {}
+
+  std::size_t get_dof_number() const { return fes.get_dof_number(); }
+
+  template<std::size_t n>
+  expression<unknown_function<fe_type, 1> > get_unknown() const {
+    static_assert(n == 0, "newton_iterate::get_unknown: a finite element space has a single component");
+    return unknown_function<fe_type, 1>(u);
+  }
+
+  template<std::size_t n>
+  expression<form<0,1,0,fe_type::degree> > get_test_function() const {
+    static_assert(n == 0, "newton_iterate::get_test_function: a finite element space has a single component");
+    return form<0,1,0,fe_type::degree>();
+  }
+
+  const array<double>& get_coefficients() const { return u.get_coefficients(); }
+
+  void set_coefficients(const array<double>& c) {
+    u = typename fes_type::element(fes, c);
+  }
+
+  // the residual of the dirichlet dof i is u_i - g_i
+  void set_dirichlet_residual(array<double>& f) const {
+    for (const auto& i: fes.get_dirichlet_dof_values())
+      f.at(i.first) = u.get_coefficients().at(i.first) - i.second;
+  }
+
+private:
+  const fes_type& fes;
+  typename fes_type::element u;
+};
+
+template<typename ... fe_pack>
+class newton_iterate<composite_finite_element_space<composite_finite_element<fe_pack...> > > {
+public:
+  typedef composite_finite_element_space<composite_finite_element<fe_pack...> > fes_type;
+  typedef type_list<fe_pack...> fe_list;
+
+  static const std::size_t n_component = sizeof...(fe_pack);
+
+  newton_iterate(const fes_type& fes)
+    : fes(fes),
+      components(make_components(fes, make_integral_list_t<std::size_t, n_component>())),
+      coefficients{fes.get_total_dof_number()},
+      offsets(n_component, 0) {
+    std::size_t dof_number[n_component];
+    fill_array_with_return_values<std::size_t,
+				  get_dof_number_impl<fes_type>,
+				  0,
+				  n_component>::template fill<const fes_type&>(&dof_number[0], fes);
+    std::partial_sum(dof_number, dof_number + n_component - 1, offsets.begin() + 1);
+  }
+
+  std::size_t get_dof_number() const { return fes.get_total_dof_number(); }
+
+  template<std::size_t n>
+  expression<unknown_function<get_element_at_t<n, fe_list>, n_component + n> > get_unknown() const {
+    return unknown_function<get_element_at_t<n, fe_list>, n_component + n>(std::get<n>(components));
+  }
+
+  template<std::size_t n>
+  expression<form<n, 1, 0, get_element_at_t<n, fe_list>::degree> > get_test_function() const {
+    return form<n, 1, 0, get_element_at_t<n, fe_list>::degree>();
+  }
+
+  const array<double>& get_coefficients() const { return coefficients; }
+
+  void set_coefficients(const array<double>& c) {
+    coefficients = c;
+    call_for_each<set_component, make_integral_list_t<std::size_t, n_component> >::call(*this);
+  }
+
+  void set_dirichlet_residual(array<double>& f) const {
+    call_for_each<set_component_dirichlet_residual, make_integral_list_t<std::size_t, n_component> >::call(*this, f);
+  }
+
+private:
+  typedef std::tuple<typename finite_element_space<fe_pack>::element...> components_type;
+
+  const fes_type& fes;
+  components_type components;
+  array<double> coefficients;
+  std::vector<std::size_t> offsets;
+
+  template<typename ... ICs>
+  static components_type make_components(const fes_type& fes, type_list<ICs...>) {
+    return components_type(fes.template get_finite_element_space<ICs::value>()...);
+  }
+
+  template<typename IC>
+  struct set_component {
+    static const std::size_t n = IC::value;
+    static void call(newton_iterate& iterate) {
+      const auto& component_fes(iterate.fes.template get_finite_element_space<n>());
+      array<double> c{component_fes.get_dof_number()};
+      std::copy(&iterate.coefficients.at(iterate.offsets[n]),
+		&iterate.coefficients.at(iterate.offsets[n]) + c.get_size(0),
+		&c.at(0));
+      std::get<n>(iterate.components) = typename std::tuple_element<n, components_type>::type(component_fes, c);
+    }
+  };
+
+  template<typename IC>
+  struct set_component_dirichlet_residual {
+    static const std::size_t n = IC::value;
+    static void call(const newton_iterate& iterate, array<double>& f) {
+      for (const auto& i: iterate.fes.template get_dirichlet_dof_values<n>())
+	f.at(iterate.offsets[n] + i.first) = iterate.coefficients.at(iterate.offsets[n] + i.first) - i.second;
+    }
+  };
+};
+
+
+/*
+ * Newton's method for the problems R(u; v) = 0 for all the test
+ * functions v of a finite element space, with u in the space.
+ *
+ * The residual is a rank-1 expression of the unknown of the solver,
+ * whose iterate is the element passed to solve, updated in place:
+ *   newton_solver<fes_type> newton(fes);
+ *   const auto w(newton.get_unknown());
+ *   const auto v(newton.get_test_function());
+ *   newton.solve<quad_type>(u, (1.0 + w * w) * d<1>(w) * d<1>(v) - g * v, s);
+ * On a composite space, the components n of the unknown and of the test
+ * function are get_unknown<n>() and get_test_function<n>(). The other
+ * finite element functions of the residual are constant. The jacobian
+ * is the Gateaux derivative of the residual (see linearize). The rows
+ * of the dirichlet dofs are u_i - g_i = 0, so that the first step also
+ * sets the boundary values.
+ *
+ * The iteration stops when the euclidean norm of the residual vector
+ * is below max(atol, rtol |F(u_0)|). The options are:
+ *  - the inexact steps of Eisenstat and Walker: the relative tolerance
+ *    of the linear solve follows the decrease of the residual, so that
+ *    the first steps do not over-solve (iterative solvers only). The
+ *    tolerance of the solver is restored by solve. Without them, the
+ *    linear solves keep the tolerance of the solver,
+ *  - a backtracking line search on the residual norm,
+ *  - the lagging of the jacobian, assembled (and factorized) once for
+ *    several steps. A lagged step which does not decrease the residual
+ *    is rejected, and taken again with a new jacobian.
+ */
+template<typename fes_type>
+class newton_solver {
+public:
+  typedef typename fes_type::element element_type;
+
+  newton_solver(const fes_type& fes)
+    : fes(fes), iterate(fes),
+      rtol(1.e-10), atol(1.e-12), max_iteration(50),
+      inexact(false), max_forcing(0.9),
+      line_search(false), jacobian_lag(0) {}
+
+  void set_tolerances(double rtol, double atol) {
+    this->rtol = rtol;
+    this->atol = atol;
+  }
+
+  void set_max_iteration_number(std::size_t n) { max_iteration = n; }
+
+  void set_inexact_steps(bool enabled, double max_forcing = 0.9) {
+    inexact = enabled;
+    this->max_forcing = max_forcing;
+  }
+
+  void set_line_search(bool enabled) { line_search = enabled; }
+
+  // the jacobian is assembled every n + 1 steps
+  void set_jacobian_lag(std::size_t n) { jacobian_lag = n; }
+
+  template<std::size_t n = 0>
+  auto get_unknown() const -> decltype(std::declval<const newton_iterate<fes_type>&>().template get_unknown<n>()) {
+    return iterate.template get_unknown<n>();
+  }
+
+  template<std::size_t n = 0>
+  auto get_test_function() const -> decltype(std::declval<const newton_iterate<fes_type>&>().template get_test_function<n>()) {
+    return iterate.template get_test_function<n>();
+  }
+
+  /*
+   *  Solve in place from the initial iterate u. The report has the
+   *  number of steps ("iterations"), of jacobian assemblies
+   *  ("jacobian_assemblies"), the final residual norm
+   *  ("residual_norm"), and the relative tolerance of the last linear
+   *  solve ("forcing").
+   */
+  template<typename quadrature_type, typename residual_type>
+  bool solve(element_type& u, const expression<residual_type>& r, solver::basic_solver& s,
+	     dictionary* report = nullptr) {
+    static_assert(residual_type::rank == 1, "newton_solver::solve expects a rank-1 residual.");
+
+    if (&u.get_finite_element_space() != &fes)
+      throw std::string("newton_solver::solve: the iterate is not in the finite element space");
+
+    profiler::scope newton_scope("newton_solver::solve");
+
+    const auto jacobian(linearize(r));
+    bilinear_form<fes_type, fes_type> a(fes, fes);
+
+    const std::size_t n_dof(iterate.get_dof_number());
+    iterate.set_coefficients(u.get_coefficients());
+    array<double> f{n_dof};
+    double norm(residual<quadrature_type>(r, f));
+    const double target(std::max(atol, rtol * norm));
+
+    const tolerance_guard guard(s, inexact);
+    double forcing(inexact ? max_forcing : s.get_relative_tolerance());
+    std::size_t n_step(0), n_assembly(0), age(0);
+    bool fresh(false);
+
+    while (norm > target and n_step < max_iteration) {
+      ++n_step;
+
+      if (not fresh and (n_assembly == 0 or age >= jacobian_lag)) {
+	profiler::scope jacobian_scope("jacobian");
+	a.clear();
+	a += integrate<quadrature_type>(jacobian, fes.get_mesh());
+	s.set_operator(a.get_operator());
+	++n_assembly;
+	age = 0;
+	fresh = true;
+      }
+
+      // J delta = -F
+      array<double> delta{n_dof};
+      {
+	profiler::scope linear_solve_scope("linear_solve");
+	for (std::size_t i(0); i < f.get_size(0); ++i)
+	  f.at(i) = -f.at(i);
+	delta.fill(0.0);
+	if (inexact)
+	  s.set_relative_tolerance(forcing);
+	dictionary linear_report;
+	if (not s.solve(f, delta, linear_report))
+	  throw std::string("newton_solver::solve: the linear solve failed");
+      }
+
+      const array<double> u_0(iterate.get_coefficients());
+      array<double> u_1{n_dof};
+      double lambda(1.0), next_norm(0.0);
+      for (;;) {
+	for (std::size_t i(0); i < u_1.get_size(0); ++i)
+	  u_1.at(i) = u_0.at(i) + lambda * delta.at(i);
+	iterate.set_coefficients(u_1);
+	next_norm = residual<quadrature_type>(r, f);
+
+	if (not line_search or next_norm <= (1.0 - 1.e-4 * lambda) * norm or lambda < min_step)
+	  break;
+	lambda *= 0.5;
+      }
+
+      // a lagged jacobian gives a poor step: take it again with a new one
+      if (not fresh and next_norm >= norm) {
+	iterate.set_coefficients(u_0);
+	norm = residual<quadrature_type>(r, f);
+	age = jacobian_lag;
+	continue;
+      }
+
+      if (inexact)
+	forcing = next_forcing(forcing, norm, next_norm, target);
+      norm = next_norm;
+      ++age;
+      fresh = false;
+    }
+
+    u = element_type(fes, iterate.get_coefficients());
+
+    if (report) {
+      report->set("iterations", n_step);
+      report->set("jacobian_assemblies", n_assembly);
+      report->set("residual_norm", norm);
+      report->set("forcing", forcing);
+    }
+
+    return norm <= target;
+  }
+
+private:
+  const fes_type& fes;
+  newton_iterate<fes_type> iterate;
+
+  double rtol, atol;
+  std::size_t max_iteration;
+  bool inexact;
+  double max_forcing;
+  bool line_search;
+  std::size_t jacobian_lag;
+
+  static constexpr double min_step = 1.0 / 1024.0;
+
+  /*
+   *  Restores the relative tolerance of the linear solver, which the
+   *  inexact steps change.
+   */
+  class tolerance_guard {
+  public:
+    tolerance_guard(solver::basic_solver& s, bool enabled)
+      : s(s), enabled(enabled), rtol(s.get_relative_tolerance()) {}
+
+    ~tolerance_guard() {
+      if (enabled)
+	s.set_relative_tolerance(rtol);
+    }
+
+  private:
+    solver::basic_solver& s;
+    const bool enabled;
+    const double rtol;
+  };
+
+  /*
+   *  Assemble the residual vector F of the iterate in f, and return its
+   *  norm.
+   */
+  template<typename quadrature_type, typename residual_type>
+  double residual(const expression<residual_type>& r, array<double>& f) const {
+    profiler::scope residual_scope("residual");
+
+    linear_form<fes_type> l(fes);
+    l += integrate<quadrature_type>(r, fes.get_mesh());
+    f = l.get_coefficients();
+    iterate.set_dirichlet_residual(f);
+
+    double norm(0.0);
+    for (std::size_t i(0); i < f.get_size(0); ++i)
+      norm += f.at(i) * f.at(i);
+    return std::sqrt(norm);
+  }
+
+  /*
+   *  Eisenstat and Walker's choice 2, eta = gamma (|F_k+1| / |F_k|)^alpha,
+   *  kept from decreasing faster than the previous one, and from
+   *  over-solving the last step.
+   */
+  double next_forcing(double forcing, double norm, double next_norm, double target) const {
+    const double gamma(0.9), alpha(2.0);
+    double eta(gamma * std::pow(next_norm / norm, alpha));
+
+    const double previous(gamma * std::pow(forcing, alpha));
+    if (previous > 0.1)
+      eta = std::max(eta, previous);
+
+    eta = std::max(eta, 0.5 * target / next_norm);
+    return std::min(eta, max_forcing);
+  }
+};
+
+#endif /* NEWTON_H */
@@ -0,0 +1,118 @@
+#ifndef OPERATOR_CACHE_H
+#define OPERATOR_CACHE_H
+
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "solver.hpp"
+#include "profiler.hpp"
+
+
+/*
+ * Named matrices on a shared sparsity pattern.
+ *
+ * The bilinear forms whose coefficients do not change between two
+ * solves (mass, diffusion, ...) are assembled once, and stored in the
+ * cache. The operator of each solve is then a weighted sum of the stored
+ * matrices, computed on the value arrays of the compressed row storage,
+ *   A = sum_n w_n A_n.
+ * The terms which depend on the state are reassembled and stored again
+ * under the same name: their values are updated in place when their
+ * entries are in the pattern, which is otherwise extended.
+ *
+ * Every bilinear_form stores the identity in the rows of the dirichlet
+ * dofs; these rows are set to the identity in the combinations too.
+ */
+class operator_cache {
+public:
+  using term_list = std::vector<std::pair<std::string, double> >;
+
+  operator_cache(std::size_t n_row, std::size_t n_column)
+    : p(crs_matrix::make_pattern(n_row, n_column, {})) {}
+
+  void set_identity_rows(const std::map<unsigned int, double>& dirichlet_dof_values) {
+    identity_rows.clear();
+    for (const auto& i: dirichlet_dof_values)
+      identity_rows.push_back(i.first);
+  }
+
+  void store(const std::string& name, const sparse_matrix& a) {
+    profiler::scope store_scope("operator_cache::store");
+
+    if (not p->contains(a))
+      extend_pattern(a);
+
+    auto item(matrices.find(name));
+    if (item == matrices.end())
+      matrices.insert(std::make_pair(name, crs_matrix(p, a)));
+    else
+      item->second.assign(a);
+  }
+
+  bool contains(const std::string& name) const { return matrices.count(name) != 0; }
+
+  const crs_matrix& get(const std::string& name) const {
+    auto item(matrices.find(name));
+    if (item == matrices.end())
+      throw std::string("operator_cache::get: no matrix named ") + name;
+    return item->second;
+  }
+
+  const std::shared_ptr<const crs_matrix::pattern>& get_pattern() const { return p; }
+
+  /*
+   *  result = sum_n w_n A_n. The storage of result is reused if it is
+   *  on the pattern of the cache.
+   */
+  void combine(const term_list& terms, crs_matrix& result) const {
+    profiler::scope combine_scope("operator_cache::combine");
+
+    if (result.get_pattern() != p)
+      result = crs_matrix(p);
+    else
+      result.clear();
+
+    for (const auto& t: terms)
+      result.axpy(t.second, get(t.first));
+
+    result.set_identity_rows(identity_rows);
+  }
+
+  crs_matrix combine(const term_list& terms) const {
+    crs_matrix result(p);
+    combine(terms, result);
+    return result;
+  }
+
+private:
+  std::shared_ptr<const crs_matrix::pattern> p;
+  std::map<std::string, crs_matrix> matrices;
+  std::vector<std::size_t> identity_rows;
+
+  /*
+   *  Move the stored matrices to the union of the pattern and of the
+   *  entries of a.
+   */
+  void extend_pattern(const sparse_matrix& a) {
+    sparse_matrix entries(p->n_row, p->n_column);
+    for (std::size_t i(0); i < p->n_row; ++i)
+      for (std::size_t n(p->row[i]); n < p->row[i + 1]; ++n)
+	entries.set(i, p->column[n], 0.0);
+
+    const auto extended(crs_matrix::make_pattern(p->n_row, p->n_column, {&entries, &a}));
+    for (auto& m: matrices) {
+      crs_matrix moved(extended);
+      for (std::size_t i(0); i < p->n_row; ++i)
+	for (std::size_t n(p->row[i]); n < p->row[i + 1]; ++n)
+	  moved.set(i, p->column[n], m.second.get_values()[n]);
+      m.second = std::move(moved);
+    }
+
+    p = extended;
+  }
+};
+
+#endif /* OPERATOR_CACHE_H */
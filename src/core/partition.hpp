@@ -0,0 +1,330 @@
+#ifndef PARTITION_H
+#define PARTITION_H
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include <spikes/array.hpp>
+
+#include "mesh.hpp"
+#include "mesh_data.hpp"
+
+
+/*
+ * Cell partitioning of a fe_mesh.
+ *
+ * partition::recursive_coordinate_bisection and
+ * partition::recursive_inertial_bisection split the barycenters of the
+ * cells in two sets of sizes proportional to the part numbers of each
+ * side, orthogonally to the coordinate axis of largest extent, or to the
+ * principal axis of inertia of the barycenters, and recurse on both
+ * sides. Any number of parts is supported.
+ *
+ * partition::refine then improves a partition on the dual graph of the
+ * mesh (two cells are adjacent when they share a face): the cells of the
+ * part boundaries are moved greedily to the neighbouring part which
+ * reduces the edge cut, as long as the part sizes stay within the
+ * imbalance tolerance.
+ *
+ * The part ids are stored in a cell mesh_data, which can be exported as
+ * is; partition::get_cell_partition converts them for
+ * distributed::partitioned_mesh.
+ */
+namespace partition {
+
+  /*
+   *  Edge cut: number of faces shared by two cells of different parts.
+   *  Imbalance: size of the largest part divided by the mean part size.
+   */
+  struct statistics {
+    std::size_t part_number;
+    std::size_t edge_cut;
+    double imbalance;
+    std::vector<std::size_t> part_size;
+  };
+
+
+  namespace detail {
+    template<typename cell_type>
+    array<double> compute_barycenters(const fe_mesh<cell_type>& m) {
+      const std::size_t n_dim(m.get_embedding_space_dimension());
+      array<double> x{m.get_cell_number(), n_dim};
+
+      for (std::size_t k(0); k < m.get_cell_number(); ++k) {
+	const array<double> bc(cell_type::barycenter(m.get_vertices(), m.get_cells(), k));
+	for (std::size_t i(0); i < n_dim; ++i)
+	  x.at(k, i) = bc.at(i);
+      }
+
+      return x;
+    }
+
+    /*
+     *  Split direction of the cells [begin, end) of ids: the coordinate
+     *  axis of largest extent.
+     */
+    inline std::vector<double> coordinate_direction(const array<double>& x,
+						    std::vector<std::size_t>::const_iterator begin,
+						    std::vector<std::size_t>::const_iterator end) {
+      const std::size_t n_dim(x.get_size(1));
+      std::size_t axis(0);
+      double extent(-1.0);
+
+      for (std::size_t i(0); i < n_dim; ++i) {
+	double x_min(x.at(*begin, i)), x_max(x.at(*begin, i));
+	for (auto k(begin); k != end; ++k) {
+	  x_min = std::min(x_min, x.at(*k, i));
+	  x_max = std::max(x_max, x.at(*k, i));
+	}
+	if (x_max - x_min > extent) {
+	  extent = x_max - x_min;
+	  axis = i;
+	}
+      }
+
+      std::vector<double> direction(n_dim, 0.0);
+      direction[axis] = 1.0;
+      return direction;
+    }
+
+    /*
+     *  Split direction of the cells [begin, end) of ids: the principal
+     *  axis of inertia of the barycenters, computed by power iteration
+     *  on their covariance matrix.
+     */
+    inline std::vector<double> inertial_direction(const array<double>& x,
+						  std::vector<std::size_t>::const_iterator begin,
+						  std::vector<std::size_t>::const_iterator end) {
+      const std::size_t n_dim(x.get_size(1));
+      const double n(end - begin);
+
+      std::vector<double> mean(n_dim, 0.0);
+      for (auto k(begin); k != end; ++k)
+	for (std::size_t i(0); i < n_dim; ++i)
+	  mean[i] += x.at(*k, i) / n;
+
+      std::vector<double> covariance(n_dim * n_dim, 0.0);
+      for (auto k(begin); k != end; ++k)
+	for (std::size_t i(0); i < n_dim; ++i)
+	  for (std::size_t j(0); j < n_dim; ++j)
+	    covariance[i * n_dim + j] += (x.at(*k, i) - mean[i]) * (x.at(*k, j) - mean[j]);
+
+      // start close to the coordinate axis of largest variance, so that
+      // the iteration is never orthogonal to the principal axis
+      std::vector<double> direction(n_dim, 0.1);
+      std::size_t axis(0);
+      for (std::size_t i(1); i < n_dim; ++i)
+	if (covariance[i * n_dim + i] > covariance[axis * n_dim + axis])
+	  axis = i;
+      direction[axis] = 1.0;
+
+      for (unsigned int it(0); it < 100; ++it) {
+	std::vector<double> next(n_dim, 0.0);
+	double norm(0.0);
+	for (std::size_t i(0); i < n_dim; ++i) {
+	  for (std::size_t j(0); j < n_dim; ++j)
+	    next[i] += covariance[i * n_dim + j] * direction[j];
+	  norm += next[i] * next[i];
+	}
+
+	norm = std::sqrt(norm);
+	if (norm == 0.0)
+	  break;
+	for (std::size_t i(0); i < n_dim; ++i)
+	  direction[i] = next[i] / norm;
+      }
+
+      return direction;
+    }
+
+    /*
+     *  Assign the parts [first_part, first_part + n_part) to the cells
+     *  [begin, end) of ids.
+     */
+    template<typename D>
+    void bisect(const array<double>& x,
+		std::vector<std::size_t>::iterator begin,
+		std::vector<std::size_t>::iterator end,
+		std::size_t first_part, std::size_t n_part,
+		array<double>& part, const D& direction) {
+      if (n_part == 1 or end - begin <= 1) {
+	for (auto k(begin); k != end; ++k)
+	  part.at(*k, 0) = first_part;
+	return;
+      }
+
+      const std::vector<double> d(direction(x, begin, end));
+      const std::size_t n_dim(x.get_size(1));
+      auto projection = [&](std::size_t k) {
+	double p(0.0);
+	for (std::size_t i(0); i < n_dim; ++i)
+	  p += x.at(k, i) * d[i];
+	return p;
+      };
+
+      const std::size_t n_left_part(n_part / 2);
+      const auto middle(begin + (end - begin) * n_left_part / n_part);
+      std::nth_element(begin, middle, end, [&](std::size_t a, std::size_t b) {
+	  const double p_a(projection(a)), p_b(projection(b));
+	  return p_a < p_b or (p_a == p_b and a < b);
+	});
+
+      bisect(x, begin, middle, first_part, n_left_part, part, direction);
+      bisect(x, middle, end, first_part + n_left_part, n_part - n_left_part, part, direction);
+    }
+
+    template<typename cell_type, typename D>
+    mesh_data<double, fe_mesh<cell_type> >
+    recursive_bisection(const fe_mesh<cell_type>& m, std::size_t n_part, const D& direction) {
+      if (n_part == 0)
+	throw std::string("partition::recursive_bisection: the part number must be positive");
+
+      if (m.get_cell_number() == 0)
+	return mesh_data<double, fe_mesh<cell_type> >(m, mesh_data_kind::cell);
+
+      const array<double> x(compute_barycenters(m));
+      std::vector<std::size_t> ids(m.get_cell_number());
+      for (std::size_t k(0); k < ids.size(); ++k)
+	ids[k] = k;
+
+      array<double> values{m.get_cell_number(), 1};
+      bisect(x, ids.begin(), ids.end(), 0, n_part, values, direction);
+      return mesh_data<double, fe_mesh<cell_type> >(m, mesh_data_kind::cell, std::move(values));
+    }
+
+    inline std::size_t part_number(const array<double>& part) {
+      std::size_t n_part(0);
+      for (std::size_t k(0); k < part.get_size(0); ++k)
+	n_part = std::max(n_part, static_cast<std::size_t>(part.at(k, 0)) + 1);
+      return n_part;
+    }
+  }
+
+
+  template<typename cell_type>
+  mesh_data<double, fe_mesh<cell_type> >
+  recursive_coordinate_bisection(const fe_mesh<cell_type>& m, std::size_t n_part) {
+    return detail::recursive_bisection(m, n_part, detail::coordinate_direction);
+  }
+
+  template<typename cell_type>
+  mesh_data<double, fe_mesh<cell_type> >
+  recursive_inertial_bisection(const fe_mesh<cell_type>& m, std::size_t n_part) {
+    return detail::recursive_bisection(m, n_part, detail::inertial_direction);
+  }
+
+
+  /*
+   *  Move boundary cells to a neighbouring part while it strictly
+   *  decreases the edge cut, or keeps it and reduces the size of the
+   *  largest of both parts. A part never exceeds (1 + tolerance) times
+   *  the mean part size (or its current size, if larger), and never
+   *  becomes empty. Return the number of moved cells.
+   */
+  template<typename cell_type>
+  std::size_t refine(mesh_data<double, fe_mesh<cell_type> >& part,
+		     double tolerance = 0.05, unsigned int max_pass = 10) {
+    const fe_mesh<cell_type>& m(part.get_mesh());
+    const std::size_t n_cell(m.get_cell_number());
+    const std::size_t n_face(cell_type::n_vertex_per_cell);
+    if (n_cell == 0)
+      return 0;
+
+    const std::size_t n_part(detail::part_number(part.get_values()));
+    std::vector<std::size_t> size(n_part, 0);
+    for (std::size_t k(0); k < n_cell; ++k)
+      ++size[part.value(k, 0)];
+
+    const std::size_t max_size(std::max({static_cast<std::size_t>((1.0 + tolerance) * n_cell / n_part),
+					 (n_cell + n_part - 1) / n_part,
+					 *std::max_element(size.begin(), size.end())}));
+
+    std::size_t n_moved(0);
+    std::vector<unsigned int> connection(n_part, 0);
+    for (unsigned int pass(0); pass < max_pass; ++pass) {
+      std::size_t n_pass_moved(0);
+
+      for (std::size_t k(0); k < n_cell; ++k) {
+	const std::size_t p(part.value(k, 0));
+
+	std::vector<std::size_t> candidates;
+	for (std::size_t f(0); f < n_face; ++f) {
+	  const std::size_t l(m.get_cell_neighbour(k, f));
+	  if (l < n_cell) {
+	    const std::size_t q(part.value(l, 0));
+	    if (connection[q]++ == 0)
+	      candidates.push_back(q);
+	  }
+	}
+
+	std::size_t best(p);
+	int best_gain(0);
+	for (const auto q: candidates) {
+	  if (q == p or size[q] + 1 > max_size or size[p] == 1)
+	    continue;
+
+	  const int gain(static_cast<int>(connection[q]) - static_cast<int>(connection[p]));
+	  const bool balances(size[q] + 1 < size[p]);
+	  if ((gain > 0 or balances) and
+	      (gain > best_gain or (gain == best_gain and (best == p or size[q] < size[best])))) {
+	    best = q;
+	    best_gain = gain;
+	  }
+	}
+
+	for (const auto q: candidates)
+	  connection[q] = 0;
+
+	if (best != p) {
+	  part.value(k, 0) = best;
+	  --size[p];
+	  ++size[best];
+	  ++n_pass_moved;
+	}
+      }
+
+      n_moved += n_pass_moved;
+      if (n_pass_moved == 0)
+	break;
+    }
+
+    return n_moved;
+  }
+
+
+  template<typename cell_type>
+  statistics compute_statistics(const mesh_data<double, fe_mesh<cell_type> >& part) {
+    const fe_mesh<cell_type>& m(part.get_mesh());
+    const std::size_t n_cell(m.get_cell_number());
+
+    statistics s;
+    s.part_number = detail::part_number(part.get_values());
+    s.part_size.assign(s.part_number, 0);
+    s.edge_cut = 0;
+
+    for (std::size_t k(0); k < n_cell; ++k) {
+      ++s.part_size[part.value(k, 0)];
+      for (std::size_t f(0); f < cell_type::n_vertex_per_cell; ++f) {
+	const std::size_t l(m.get_cell_neighbour(k, f));
+	if (k < l and l < n_cell and part.value(k, 0) != part.value(l, 0))
+	  ++s.edge_cut;
+      }
+    }
+
+    s.imbalance = n_cell == 0 ? 1.0 :
+      *std::max_element(s.part_size.begin(), s.part_size.end()) * s.part_number / static_cast<double>(n_cell);
+    return s;
+  }
+
+  template<typename cell_type>
+  std::vector<unsigned int> get_cell_partition(const mesh_data<double, fe_mesh<cell_type> >& part) {
+    std::vector<unsigned int> cell_part(part.get_mesh().get_cell_number());
+    for (std::size_t k(0); k < cell_part.size(); ++k)
+      cell_part[k] = part.value(k, 0);
+    return cell_part;
+  }
+}
+
+#endif /* PARTITION_H */
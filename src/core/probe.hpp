@@ -0,0 +1,172 @@
+#ifndef _PROBE_H_
+#define _PROBE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <spikes/array.hpp>
+
+#include "fes.hpp"
+#include "profiler.hpp"
+#include "scheduler.hpp"
+
+
+/*
+ * Monitoring points of the functions of a finite element space.
+ *
+ * The cell of each point, the dofs of the cell and the values of the
+ * basis functions at the point are found once, when the set is built, so
+ * that sampling a function is a gather and a dot product per point:
+ *   probe_set<fes_type> probes(fes, points);
+ *   probe_series<fes_type> series(probes, "probes.bin");
+ *   for (...) {
+ *     ...
+ *     series.record(t, u);
+ *   }
+ * A point on the interface of several cells is in the first of them.
+ */
+template<typename fes_type>
+class probe_set {
+public:
+  typedef typename fes_type::fe_type fe_type;
+  typedef typename fe_type::cell_type cell_type;
+  typedef typename fes_type::element element_type;
+
+  /*
+   *  The points are the rows of a n_probe x n_dimension array.
+   */
+  probe_set(const fes_type& fes, const array<double>& points)
+    : fes(fes), points(points),
+      cells(points.get_size(0)),
+      dofs{points.get_size(0), fe_type::n_dof_per_element},
+      weights{points.get_size(0), fe_type::n_dof_per_element} {
+    if (points.get_rank() != 2 or points.get_size(1) != cell_type::n_dimension)
+      throw std::string("probe_set::probe_set: the points are not a n_probe x n_dimension array");
+
+    profiler::scope probe_scope("probe_set::probe_set");
+
+    const fe_mesh<cell_type>& m(fes.get_mesh());
+    parallel::parallel_for(std::size_t(0), get_probe_number(), [&](std::size_t begin, std::size_t end) {
+	for (std::size_t p(begin); p < end; ++p) {
+	  std::size_t k;
+	  try {
+	    k = m.get_cell_at(&this->points.at(p, 0));
+	  } catch (const std::string&) {
+	    throw std::string("probe_set::probe_set: the point ") + std::to_string(p) + " is out of the mesh";
+	  }
+
+	  const typename cell_type::barycentric_type
+	    bc(cell_type::get_barycentric_coordinates(m.get_vertices(), m.get_cells(), k, &this->points.at(p, 0)));
+
+	  cells[p] = k;
+	  for (std::size_t n(0); n < fe_type::n_dof_per_element; ++n) {
+	    dofs.at(p, n) = fes.get_dof(k, n);
+	    weights.at(p, n) = fe_type::phi(n, &bc.at(1));
+	  }
+	}
+      });
+  }
+
+  const fes_type& get_finite_element_space() const { return fes; }
+
+  std::size_t get_probe_number() const { return points.get_size(0); }
+
+  const array<double>& get_points() const { return points; }
+
+  std::size_t get_cell(std::size_t p) const { return cells[p]; }
+
+  double sample(const element_type& u, std::size_t p) const {
+    const array<double>& c(u.get_coefficients());
+    double value(0.0);
+    for (std::size_t n(0); n < fe_type::n_dof_per_element; ++n)
+      value += weights.at(p, n) * c.at(dofs.at(p, n));
+    return value;
+  }
+
+  /*
+   *  Sample u at all the points, in values[0] ... values[n_probe - 1].
+   */
+  void sample(const element_type& u, double* values) const {
+    if (&u.get_finite_element_space() != &fes)
+      throw std::string("probe_set::sample: the function is not in the finite element space");
+
+    for (std::size_t p(0); p < get_probe_number(); ++p)
+      values[p] = sample(u, p);
+  }
+
+  array<double> sample(const element_type& u) const {
+    array<double> values{get_probe_number()};
+    sample(u, values.get_data());
+    return values;
+  }
+
+private:
+  const fes_type& fes;
+  const array<double> points;
+  std::vector<std::size_t> cells;
+  array<unsigned int> dofs;
+  array<double> weights;
+};
+
+
+/*
+ * The samples of a probe set, streamed to a binary file in the native
+ * byte order:
+ *   uint64 n_probe, uint64 n_dimension,
+ *   double points[n_probe][n_dimension],
+ * then a record per call to record:
+ *   double t, double values[n_probe].
+ * The number of records follows from the size of the file.
+ */
+template<typename fes_type>
+class probe_series {
+public:
+  typedef typename fes_type::element element_type;
+
+  probe_series(const probe_set<fes_type>& probes, const std::string& filename)
+    : probes(probes),
+      file(filename.c_str(), std::ios::out | std::ios::binary),
+      buffer(probes.get_probe_number() + 1),
+      n_record(0) {
+    if (not file)
+      throw std::string("probe_series::probe_series: failed to open ") + filename + " for output";
+
+    const std::uint64_t sizes[] = {probes.get_probe_number(), probes.get_points().get_size(1)};
+    file.write(reinterpret_cast<const char*>(sizes), sizeof(sizes));
+    file.write(reinterpret_cast<const char*>(probes.get_points().get_data()),
+	       probes.get_points().get_element_number() * sizeof(double));
+    check("probe_series::probe_series");
+  }
+
+  void record(double t, const element_type& u) {
+    buffer[0] = t;
+    probes.sample(u, &buffer[1]);
+    file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size() * sizeof(double));
+    check("probe_series::record");
+    ++n_record;
+  }
+
+  // the records are buffered: flush to read them while the computation runs
+  void flush() {
+    file.flush();
+    check("probe_series::flush");
+  }
+
+  std::size_t get_record_number() const { return n_record; }
+
+private:
+  const probe_set<fes_type>& probes;
+  std::ofstream file;
+  std::vector<double> buffer;
+  std::size_t n_record;
+
+  void check(const char* where) const {
+    if (not file)
+      throw std::string(where) + ": failed to write the samples";
+  }
+};
+
+#endif /* _PROBE_H_ */
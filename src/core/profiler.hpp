@@ -0,0 +1,321 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "dictionary.hpp"
+
+
+/*
+ * Hierarchical phase timers and counters.
+ *
+ * A profiler::scope measures the time spent between its construction
+ * and its destruction, nested in the scopes which are alive in the same
+ * thread. A profiler::phase does the same, but is never recorded in the
+ * trace: it is meant for fine grained phases which are entered once per
+ * cell. profiler::count increments a named counter.
+ *
+ * The measurements are recorded per thread without synchronization,
+ * and aggregated by profiler::report (or written as a Chrome trace by
+ * profiler::export_chrome_trace), which must be called while no
+ * instrumented code runs. Scopes, phases and counters compile to
+ * nothing unless ENABLE_PROFILING is defined (WITH_PROFILING = on).
+ */
+namespace profiler {
+
+#ifdef ENABLE_PROFILING
+  constexpr bool enabled = true;
+#else
+  constexpr bool enabled = false;
+#endif
+
+  namespace detail {
+    using clock = std::chrono::steady_clock;
+
+    struct node {
+      node(const char* name, node* parent)
+        : name(name), parent(parent), calls(0), time(0.0) {}
+
+      node* get_child(const char* child_name) {
+        for (const auto& c: children)
+          if (c->name == child_name or std::strcmp(c->name, child_name) == 0)
+            return c.get();
+
+        children.emplace_back(new node(child_name, this));
+        return children.back().get();
+      }
+
+      const char* name;
+      node* parent;
+      std::size_t calls;
+      double time;
+      std::vector<std::unique_ptr<node> > children;
+    };
+
+    struct trace_event {
+      const char* name;
+      clock::time_point begin;
+      double duration;
+    };
+
+    struct thread_record {
+      thread_record(std::size_t id)
+        : id(id), root(new node("", nullptr)), current(root.get()) {}
+
+      void add(const char* name, std::uint64_t n) {
+        for (auto& c: counters)
+          if (c.first == name or std::strcmp(c.first, name) == 0) {
+            c.second += n;
+            return;
+          }
+        counters.push_back(std::make_pair(name, n));
+      }
+
+      void clear() {
+        root.reset(new node("", nullptr));
+        current = root.get();
+        counters.clear();
+        events.clear();
+      }
+
+      std::size_t id;
+      std::unique_ptr<node> root;
+      node* current;
+      std::vector<std::pair<const char*, std::uint64_t> > counters;
+      std::vector<trace_event> events;
+    };
+
+    class registry {
+    public:
+      static registry& instance() {
+        static registry r;
+        return r;
+      }
+
+      thread_record& local() {
+        thread_local thread_record* record(nullptr);
+        if (not record) {
+          std::lock_guard<std::mutex> lock(mutex);
+          records.emplace_back(new thread_record(records.size()));
+          record = records.back().get();
+        }
+        return *record;
+      }
+
+      const std::vector<std::unique_ptr<thread_record> >& get_records() const { return records; }
+      clock::time_point get_epoch() const { return epoch; }
+
+      void clear() {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& r: records)
+          r->clear();
+        epoch = clock::now();
+      }
+
+    private:
+      registry(): epoch(clock::now()) {}
+
+      std::mutex mutex;
+      std::vector<std::unique_ptr<thread_record> > records;
+      clock::time_point epoch;
+    };
+
+    inline void collect(const node& n, const std::string& path,
+                        std::map<std::string, std::pair<std::size_t, double> >& phases) {
+      for (const auto& c: n.children) {
+        const std::string child_path(path.empty() ? std::string(c->name) : path + "/" + c->name);
+        auto& p(phases[child_path]);
+        p.first += c->calls;
+        p.second += c->time;
+        collect(*c, child_path, phases);
+      }
+    }
+
+    inline void write_json_string(std::ostream& stream, const std::string& str) {
+      stream << "\"";
+      for (char c: str) {
+        if (c == '"' or c == '\\')
+          stream << '\\';
+        stream << c;
+      }
+      stream << "\"";
+    }
+
+    template<bool traced>
+    class basic_scope {
+    public:
+#ifdef ENABLE_PROFILING
+      explicit basic_scope(const char* name)
+        : record(registry::instance().local()) {
+        record.current = record.current->get_child(name);
+        begin = clock::now();
+      }
+
+      ~basic_scope() {
+        const clock::time_point end(clock::now());
+        const double duration(std::chrono::duration<double>(end - begin).count());
+
+        node* n(record.current);
+        n->time += duration;
+        ++n->calls;
+        if (traced)
+          record.events.push_back(trace_event{n->name, begin, duration});
+        record.current = n->parent;
+      }
+#else
+      explicit basic_scope(const char*) {}
+#endif
+
+      basic_scope(const basic_scope&) = delete;
+      basic_scope& operator=(const basic_scope&) = delete;
+
+#ifdef ENABLE_PROFILING
+    private:
+      thread_record& record;
+      clock::time_point begin;
+#endif
+    };
+  }
+
+  using scope = detail::basic_scope<true>;
+  using phase = detail::basic_scope<false>;
+
+  /*
+   * The path of the scopes alive in the calling thread, which another
+   * thread can adopt with profiler::adopt_context, so that the phases of
+   * the tasks it executes are nested in the scope which spawned them.
+   */
+  class context {
+  public:
+#ifdef ENABLE_PROFILING
+    context() {
+      for (const detail::node* n(detail::registry::instance().local().current);
+           n->parent; n = n->parent)
+        path.push_back(n->name);
+    }
+#endif
+
+  private:
+    friend class adopt_context;
+
+#ifdef ENABLE_PROFILING
+    std::vector<const char*> path;
+#endif
+  };
+
+  class adopt_context {
+  public:
+#ifdef ENABLE_PROFILING
+    explicit adopt_context(const context& c)
+      : record(detail::registry::instance().local()), previous(record.current) {
+      record.current = record.root.get();
+      for (auto name(c.path.rbegin()); name != c.path.rend(); ++name)
+        record.current = record.current->get_child(*name);
+    }
+
+    ~adopt_context() {
+      record.current = previous;
+    }
+#else
+    explicit adopt_context(const context&) {}
+#endif
+
+    adopt_context(const adopt_context&) = delete;
+    adopt_context& operator=(const adopt_context&) = delete;
+
+#ifdef ENABLE_PROFILING
+  private:
+    detail::thread_record& record;
+    detail::node* previous;
+#endif
+  };
+
+  inline void count(const char* name, std::uint64_t n = 1) {
+#ifdef ENABLE_PROFILING
+    detail::registry::instance().local().add(name, n);
+#endif
+  }
+
+  /*
+   * Aggregate the measurements of all the threads in the dictionary d,
+   * under the keys "profile/time/<path>" (seconds, summed over the
+   * threads), "profile/calls/<path>" and "profile/count/<name>". The
+   * path of a phase is the list of the names of the enclosing scopes,
+   * separated by '/'.
+   */
+  inline void report(dictionary& d) {
+    std::map<std::string, std::pair<std::size_t, double> > phases;
+    std::map<std::string, std::uint64_t> counters;
+
+    const auto& records(detail::registry::instance().get_records());
+    for (const auto& r: records) {
+      detail::collect(*r->root, "", phases);
+      for (const auto& c: r->counters)
+        counters[c.first] += c.second;
+    }
+
+    for (const auto& p: phases) {
+      d.set("profile/calls/" + p.first, p.second.first);
+      d.set("profile/time/" + p.first, p.second.second);
+    }
+    for (const auto& c: counters)
+      d.set("profile/count/" + c.first, static_cast<std::size_t>(c.second));
+    d.set("profile/thread_number", records.size());
+  }
+
+  /*
+   * Write the scopes as complete events of the Chrome trace event
+   * format, readable by chrome://tracing or Perfetto. The counters are
+   * stored in the "otherData" object.
+   */
+  inline void export_chrome_trace(const std::string& filename) {
+    std::ofstream file(filename.c_str(), std::ios::out);
+    if (not file)
+      throw std::string("profiler::export_chrome_trace: failed to open ") + filename + " for output";
+
+    const auto& records(detail::registry::instance().get_records());
+    const auto epoch(detail::registry::instance().get_epoch());
+    std::map<std::string, std::uint64_t> counters;
+
+    file.precision(15);
+    file << "{\"traceEvents\": [";
+    bool first_event(true);
+    for (const auto& r: records) {
+      for (const auto& e: r->events) {
+        file << (first_event ? "\n" : ",\n") << "{\"name\": ";
+        detail::write_json_string(file, e.name);
+        file << ", \"ph\": \"X\", \"pid\": 0, \"tid\": " << r->id
+             << ", \"ts\": " << std::chrono::duration<double, std::micro>(e.begin - epoch).count()
+             << ", \"dur\": " << e.duration * 1.0e6 << "}";
+        first_event = false;
+      }
+      for (const auto& c: r->counters)
+        counters[c.first] += c.second;
+    }
+    file << "\n],\n\"displayTimeUnit\": \"ms\",\n\"otherData\": {";
+
+    bool first_counter(true);
+    for (const auto& c: counters) {
+      file << (first_counter ? "\n" : ",\n");
+      detail::write_json_string(file, c.first);
+      file << ": " << c.second;
+      first_counter = false;
+    }
+    file << "\n}\n}\n";
+  }
+
+  inline void clear() {
+    detail::registry::instance().clear();
+  }
+}
+
+#endif /* PROFILER_H */
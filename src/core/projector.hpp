@@ -1,7 +1,9 @@
 #ifndef _PROJECTOR_H_
 #define _PROJECTOR_H_
 
+#include <array>
 #include <functional>
+#include <memory>
 
 #include "fe.hpp"
 #include "quadrature.hpp"
@@ -9,34 +11,147 @@
 
 namespace projector {
 
-  template<typename fe_type, typename quadrature_type, typename expr_t>
-  typename finite_element_space<fe_type>::element
-  l2(const expression<expr_t>& expr, const finite_element_space<fe_type>& fes) {
-    static_assert(expr_t::rank == 0, "");
+  /*
+   *  The L2 projection on a finite element space, for many functions.
+   *
+   *  When every dof of the space is in the interior of a cell (P0, or
+   *  any discontinuous space), the mass matrix is block diagonal, and the
+   *  block of the cell K is |K| times the reference mass matrix: the
+   *  projection is computed cell by cell with the inverse of the
+   *  reference mass matrix. Otherwise, the mass matrix is assembled and
+   *  given to the solver once, and each projection only solves with a
+   *  new right hand side. The dirichlet dofs of the space take their
+   *  values at the time of the projection.
+   */
+  template<typename fe_type, typename quadrature_type>
+  class l2_projector {
+  public:
+    using fes_type = finite_element_space<fe_type>;
+    using element_type = typename fes_type::element;
+
+    static const bool cell_local =
+      fe_type::n_dof_per_subdomain(fe_type::cell_type::n_dimension) == fe_type::n_dof_per_element;
+
+    explicit l2_projector(const fes_type& fes)
+      : l2_projector(fes, nullptr) {}
+
+    /*
+     *  s solves the mass matrix systems of the global projections; the
+     *  default is the gmres_ilu solver.
+     */
+    l2_projector(const fes_type& fes, std::unique_ptr<solver::basic_solver> s)
+      : fes(fes), local(cell_local and fes.get_dirichlet_dof_values().empty()),
+	s(std::move(s)) {
+      if (local)
+	invert_reference_mass();
+      else
+	set_mass_operator();
+    }
+
+    template<typename expr_t>
+    element_type operator()(const expression<expr_t>& expr) const {
+      static_assert(expr_t::rank == 0, "");
+
+      linear_form<fes_type> f(fes); {
+	auto v(f.get_test_function());
+	f += integrate<quadrature_type>(expr * v, fes.get_mesh());
+      }
+
+      return local ? solve_local(f) : solve(f);
+    }
+
+    element_type operator()(const std::function<double(const double*)>& fun) const {
+      return (*this)(make_expr(fun));
+    }
+
+  private:
+    static const std::size_t n_dof = fe_type::n_dof_per_element;
+
+    const fes_type& fes;
+    const bool local;
 
-    typedef finite_element_space<fe_type> fes_type;
-    bilinear_form<fes_type, fes_type> a(fes, fes); {
-      auto u(a.get_trial_function());
-      auto v(a.get_test_function());
+    std::array<double, n_dof * n_dof> inverse_mass;
+    std::unique_ptr<solver::basic_solver> s;
 
-      a += integrate<quadrature_type>(u * v, fes.get_mesh());
+    void invert_reference_mass() {
+      const double one(1.0);
+      reference_tensor<fe_type, fe_type, quadrature_type>::instance().contract({0}, &one, inverse_mass.data());
+
+      std::array<lapack_int, n_dof> pivots;
+      lapack_int info(LAPACKE_dgetrf(LAPACK_ROW_MAJOR, n_dof, n_dof,
+				     inverse_mass.data(), n_dof, pivots.data()));
+      if (info == 0)
+	info = LAPACKE_dgetri(LAPACK_ROW_MAJOR, n_dof, inverse_mass.data(), n_dof, pivots.data());
+
+      if (info != 0)
+	throw std::string("projector::l2_projector: singular reference mass matrix");
+    }
+
+    void set_mass_operator() {
+      if (not s) {
+	dictionary p(dictionary()
+		     .set("maxits",  2000u)
+		     .set("restart", 1000u)
+		     .set("rtol",    1.e-8)
+		     .set("atol",    1.e-50)
+		     .set("dtol",    1.e20)
+		     .set("ilufill", 2u));
+	s.reset(new solver::petsc::gmres_ilu(p));
+      }
+
+      bilinear_form<fes_type, fes_type> a(fes, fes); {
+	auto u(a.get_trial_function());
+	auto v(a.get_test_function());
+
+	a += integrate<quadrature_type>(u * v, fes.get_mesh());
+      }
+
+      profiler::scope setup_scope("solver_setup");
+      s->set_operator(a.get_operator());
     }
 
-    linear_form<fes_type> f(fes); {
-      auto v(f.get_test_function());
-      f += integrate<quadrature_type>(expr * v, fes.get_mesh());
+    element_type solve_local(const linear_form<fes_type>& f) const {
+      const auto& m(fes.get_mesh());
+      const auto& b(f.get_coefficients());
+
+      array<double> coefficients{fes.get_dof_number()};
+      parallel::parallel_for(0, m.get_cell_number(), [&](std::size_t k_begin, std::size_t k_end) {
+	  for (std::size_t k(k_begin); k < k_end; ++k) {
+	    const double volume(m.get_cell_volume(k));
+	    for (std::size_t i(0); i < n_dof; ++i) {
+	      double c(0.0);
+	      for (std::size_t j(0); j < n_dof; ++j)
+		c += inverse_mass[i * n_dof + j] * b.at(fes.get_dof(k, j));
+	      coefficients.at(fes.get_dof(k, i)) = c / volume;
+	    }
+	  }
+	});
+
+      return element_type(fes, coefficients);
     }
-    
-    dictionary p(dictionary()
-                 .set("maxits",  2000u)
-                 .set("restart", 1000u)
-                 .set("rtol",    1.e-8)
-                 .set("atol",    1.e-50)
-                 .set("dtol",    1.e20)
-                 .set("ilufill", 2u));
-    solver::petsc::gmres_ilu s(p);
-
-    return a.solve(f, s);
+
+    element_type solve(const linear_form<fes_type>& f) const {
+      array<double> rhs(f.get_coefficients());
+      for (const auto& i: fes.get_dirichlet_dof_values())
+	rhs.at(i.first) = i.second;
+
+      array<double> x{fes.get_dof_number()};
+      x.fill(0.0);
+      dictionary r;
+      {
+	profiler::scope iterations_scope("solver_iterations");
+	s->solve(rhs, x, r);
+      }
+
+      return element_type(fes, x);
+    }
+  };
+
+
+  template<typename fe_type, typename quadrature_type, typename expr_t>
+  typename finite_element_space<fe_type>::element
+  l2(const expression<expr_t>& expr, const finite_element_space<fe_type>& fes) {
+    return l2_projector<fe_type, quadrature_type>(fes)(expr);
   }
 
   template<typename fe_type, typename quadrature_type>
@@ -45,55 +160,80 @@ namespace projector {
     return l2<fe_type, quadrature_type>(make_expr(fun), fes);
   }
 
-  template<typename fe_type>
-  typename finite_element_space<fe_type>::element
-  lagrange(const std::function<double(const double*)>& fun, const finite_element_space<fe_type>& fes) {
-    static_assert(fe_type::is_lagrangian,
-		  "lagrange projector is only defined for lagrangian finite element space.");
+  namespace detail {
+
+    template<typename fe_type>
+    typename finite_element_space<fe_type>::element
+    lagrange(const std::function<double(const double*)>& fun, const finite_element_space<fe_type>& fes,
+	     bool concurrent) {
+      static_assert(fe_type::is_lagrangian,
+		    "lagrange projector is only defined for lagrangian finite element space.");
 
-    array<double> coefficients{fes.get_dof_number()};
+      const array<double>& x(fes.get_dof_space_coordinates());
+      array<double> coefficients{fes.get_dof_number()};
+      parallel::parallel_for_if(concurrent, 0, fes.get_dof_number(), [&](std::size_t n_begin, std::size_t n_end) {
+	  for (std::size_t n(n_begin); n < n_end; ++n)
+	    coefficients.at(n) = fun(&x.at(n, 0));
+	});
 
-    for (std::size_t n(0); n < fes.get_dof_number(); ++n) {
-      const auto x(fes.get_dof_space_coordinate(n));
-      coefficients.at(n) = fun(&x.at(0, 0));
+      return typename finite_element_space<fe_type>::element(fes, coefficients);
+    }
+
+    template<typename fe_type, typename expr_t>
+    typename finite_element_space<fe_type>::element
+    lagrange(const expression<expr_t>& expr, const finite_element_space<fe_type>& fes, bool concurrent) {
+      static_assert(expr_t::rank == 0, "");
+      static_assert(fe_type::is_lagrangian,
+		    "lagrange projector is only defined for lagrangian finite element space.");
+
+      const array<double>& x(fes.get_dof_space_coordinates());
+      array<double> coefficients{fes.get_dof_number()};
+      parallel::parallel_for_if(concurrent, 0, fes.get_dof_number(), [&](std::size_t i_begin, std::size_t i_end) {
+	  // the expressions cache their values: each thread has its copy
+	  expression<expr_t> e(expr);
+	  for (std::size_t i(i_begin); i < i_end; ++i) {
+	    const std::size_t k(fes.get_dof_element(i));
+	    const double* x_hat(&fe_type::x[fes.get_dof_local_id(i)][0]);
+
+	    e.prepare(k, 0, &x.at(i, 0), x_hat);
+	    coefficients.at(i) = e(k, &x.at(i, 0), x_hat);
+	  }
+	});
+
+      return typename finite_element_space<fe_type>::element(fes, coefficients);
     }
 
-    return typename finite_element_space<fe_type>::element(fes, coefficients);
   }
 
-  template<typename fe_type, typename expr_t>
+  /*
+   *  The interpolation at the nodes of a lagrangian space. The function
+   *  or the expression is evaluated on the dofs in order, or concurrently
+   *  when parallel::thread_safe is passed.
+   */
+  template<typename fe_type>
   typename finite_element_space<fe_type>::element
-  lagrange(const expression<expr_t>& expr, const finite_element_space<fe_type>& fes) {
-    using cell_type = typename fe_type::cell_type;
-
-    static_assert(expr_t::rank == 0, "");
-    static_assert(fe_type::is_lagrangian,
-		  "lagrange projector is only defined for lagrangian finite element space.");
-
-    const fe_mesh<cell_type>& m(fes.get_mesh());
-
-    array<double> coefficients{fes.get_dof_number()};
-    for (std::size_t i(0); i < fes.get_dof_number(); ++i) {
-      const std::size_t i_hat(fes.get_dof_local_id(i));
-      const std::size_t k(fes.get_dof_element(i));
-
-      array<double> x_hat{1, cell_type::n_dimension};
-      std::copy(
-	&fe_type::x[i_hat][0],
-	&fe_type::x[i_hat][0] + cell_type::n_dimension,
-	&x_hat.at(0, 0));
+  lagrange(const std::function<double(const double*)>& fun, const finite_element_space<fe_type>& fes) {
+    return detail::lagrange<fe_type>(fun, fes, false);
+  }
 
-      array<double> x(cell_type::map_points_to_space_coordinates(
-        m.get_vertices(),
-	m.get_cells(),
-	k,
-	x_hat));
+  template<typename fe_type>
+  typename finite_element_space<fe_type>::element
+  lagrange(const std::function<double(const double*)>& fun, const finite_element_space<fe_type>& fes,
+	   parallel::thread_safe_t) {
+    return detail::lagrange<fe_type>(fun, fes, true);
+  }
 
-      expr.prepare(k, &x.at(0,0), &x_hat.at(0,0));
-      coefficients.at(i) = expr(k, &x.at(0,0), &x_hat.at(0,0));
-    }
+  template<typename fe_type, typename expr_t>
+  typename finite_element_space<fe_type>::element
+  lagrange(const expression<expr_t>& expr, const finite_element_space<fe_type>& fes) {
+    return detail::lagrange<fe_type>(expr, fes, false);
+  }
 
-    return typename finite_element_space<fe_type>::element(fes, coefficients);
+  template<typename fe_type, typename expr_t>
+  typename finite_element_space<fe_type>::element
+  lagrange(const expression<expr_t>& expr, const finite_element_space<fe_type>& fes,
+	   parallel::thread_safe_t) {
+    return detail::lagrange<fe_type>(expr, fes, true);
   }
 
 }
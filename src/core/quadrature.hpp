@@ -2,8 +2,11 @@
 #define _QUADRATURE_H_
 
 #include <cstddef>
+#include <limits>
+#include <type_traits>
 
 #include "cell.hpp"
+#include "meta.hpp"
 
 
 /*
@@ -13,6 +16,9 @@
  *     The Gaussian Quadrature Points For A Line, K. Sham Sunder and 
  *     R. A. Cookson, Computers and Structures Vol. 21, No. 5, pp. 881-885,
  *     1985.
+ *
+ *  The degree of a rule is the highest degree of the polynomials it
+ *  integrates exactly. The evaluation on a point is exact for all of them.
  */
 
 namespace quad {
@@ -22,6 +28,7 @@ namespace quad {
       
       static const std::size_t n_point_space_dimension = 1;
       static const std::size_t n_point = 1;
+      static const std::size_t degree = std::numeric_limits<std::size_t>::max();
       static const double x[1][1];
       static const double w[1];
     };
@@ -34,6 +41,7 @@ namespace quad {
       
       static const std::size_t n_point_space_dimension = 1;
       static const std::size_t n_point = 1;
+      static const std::size_t degree = 1;
       static const double x[1][1];
       static const double w[1];
     };
@@ -43,6 +51,7 @@ namespace quad {
       
       static const std::size_t n_point_space_dimension = 1;
       static const std::size_t n_point = 2;
+      static const std::size_t degree = 3;
       static const double x[2][1];
       static const double w[2];
     };
@@ -52,6 +61,7 @@ namespace quad {
       
       static const std::size_t n_point_space_dimension = 1;
       static const std::size_t n_point = 3;
+      static const std::size_t degree = 5;
       static const double x[3][1];
       static const double w[3];
     };
@@ -61,6 +71,7 @@ namespace quad {
       
       static const std::size_t n_point_space_dimension = 1;
       static const std::size_t n_point = 4;
+      static const std::size_t degree = 7;
       static const double x[4][1];
       static const double w[4];
     };
@@ -70,6 +81,7 @@ namespace quad {
       
       static const std::size_t n_point_space_dimension = 1;
       static const std::size_t n_point = 5;
+      static const std::size_t degree = 9;
       static const double x[5][1];
       static const double w[5];
     };
@@ -82,6 +94,7 @@ namespace quad {
       
       static const std::size_t n_point_space_dimension = 2;
       static const std::size_t n_point = 1;
+      static const std::size_t degree = 1;
       static const double x[1][2];
       static const double w[1];
     };
@@ -91,6 +104,7 @@ namespace quad {
       
       static const std::size_t n_point_space_dimension = 2;
       static const std::size_t n_point = 3;
+      static const std::size_t degree = 2;
       static const double x[3][2];
       static const double w[3];
     };
@@ -100,6 +114,7 @@ namespace quad {
       
       static const std::size_t n_point_space_dimension = 2;
       static const std::size_t n_point = 7;
+      static const std::size_t degree = 5;
       static const double x[7][2];
       static const double w[7];
     };
@@ -109,6 +124,7 @@ namespace quad {
       
       static const std::size_t n_point_space_dimension = 2;
       static const std::size_t n_point = 3;
+      static const std::size_t degree = 1;
       static const double x[3][2];
       static const double w[3];
     };
@@ -136,6 +152,7 @@ namespace quad {
 
       static const std::size_t n_point_space_dimension = 3;
       static const std::size_t n_point = 1;
+      static const std::size_t degree = 1;
       static const double x[n_point][3];
       static const double w[n_point];
     };
@@ -145,6 +162,7 @@ namespace quad {
 
       static const std::size_t n_point_space_dimension = 3;
       static const std::size_t n_point = 4;
+      static const std::size_t degree = 2;
       static const double x[n_point][3];
       static const double w[n_point];
     };
@@ -154,6 +172,7 @@ namespace quad {
 
       static const std::size_t n_point_space_dimension = 3;
       static const std::size_t n_point = 10;
+      static const std::size_t degree = 3;
       static const double x[n_point][3];
       static const double w[n_point];
     };
@@ -163,6 +182,7 @@ namespace quad {
 
       static const std::size_t n_point_space_dimension = 3;
       static const std::size_t n_point = 20;
+      static const std::size_t degree = 5;
       static const double x[n_point][3];
       static const double w[n_point];
     };
@@ -172,6 +192,7 @@ namespace quad {
 
       static const std::size_t n_point_space_dimension = 3;
       static const std::size_t n_point = 35;
+      static const std::size_t degree = 6;
       static const double x[n_point][3];
       static const double w[n_point];
     };
@@ -181,6 +202,7 @@ namespace quad {
 
       static const std::size_t n_point_space_dimension = 3;
       static const std::size_t n_point = 56;
+      static const std::size_t degree = 8;
       static const double x[n_point][3];
       static const double w[n_point];
     };
@@ -190,6 +212,7 @@ namespace quad {
       
       static const std::size_t n_point_space_dimension = 3;
       static const std::size_t n_point = 1;
+      static const std::size_t degree = 1;
       static const double x[1][3];
       static const double w[1];
     };
@@ -199,6 +222,7 @@ namespace quad {
       
       static const std::size_t n_point_space_dimension = 3;
       static const std::size_t n_point = 4;
+      static const std::size_t degree = 2;
       static const double x[4][3];
       static const double w[4];
     };
@@ -213,6 +237,7 @@ namespace quad {
       
       static const std::size_t n_point_space_dimension = 3;
       static const std::size_t n_point = 5;
+      static const std::size_t degree = 2;
       static const double x[5][3];
       static const double w[5];
     };
@@ -225,6 +250,44 @@ struct default_quadrature;
 template<> struct default_quadrature<cell::point> { typedef quad::point::eval type; };
 template<> struct default_quadrature<cell::edge> { typedef quad::edge::gauss3 type; };
 template<> struct default_quadrature<cell::triangle> { typedef quad::triangle::qf2pT type; };
+template<> struct default_quadrature<cell::tetrahedron> { typedef quad::tetrahedron::qfSym4pTet type; };
+
+/*
+ *  minimal_quadrature<cell_type, n>::type is the rule with the fewest
+ *  points of the cell which integrates exactly the polynomials of degree
+ *  n. The candidates are listed by increasing number of points.
+ */
+template<std::size_t n, typename ... quadrature_types>
+struct first_exact_quadrature {
+  static_assert(n != n, "minimal_quadrature: no rule of the cell is exact for this degree");
+};
+
+template<std::size_t n, typename quadrature_type, typename ... quadrature_types>
+struct first_exact_quadrature<n, quadrature_type, quadrature_types...>
+  : std::conditional<(quadrature_type::degree >= n),
+		     is_type<quadrature_type>,
+		     first_exact_quadrature<n, quadrature_types...> >::type {};
+
+template<typename cell_type, std::size_t n>
+struct minimal_quadrature;
+
+template<std::size_t n>
+struct minimal_quadrature<cell::point, n>: first_exact_quadrature<n, quad::point::eval> {};
+
+template<std::size_t n>
+struct minimal_quadrature<cell::edge, n>
+  : first_exact_quadrature<n, quad::edge::gauss1, quad::edge::gauss2, quad::edge::gauss3,
+			   quad::edge::gauss4, quad::edge::gauss5> {};
+
+template<std::size_t n>
+struct minimal_quadrature<cell::triangle, n>
+  : first_exact_quadrature<n, quad::triangle::qf1pT, quad::triangle::qf2pT, quad::triangle::qf5pT> {};
+
+template<std::size_t n>
+struct minimal_quadrature<cell::tetrahedron, n>
+  : first_exact_quadrature<n, quad::tetrahedron::qfSym1pTet, quad::tetrahedron::qfSym4pTet,
+			   quad::tetrahedron::qfSym10pTet, quad::tetrahedron::qfSym20pTet,
+			   quad::tetrahedron::qfSym35pTet, quad::tetrahedron::qfSym56pTet> {};
 
 template<typename Q, typename F>
 double integrate(const F& f, double a, double b, double n) {
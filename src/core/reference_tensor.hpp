@@ -0,0 +1,283 @@
+#ifndef REFERENCE_TENSOR_H
+#define REFERENCE_TENSOR_H
+
+#include <cstddef>
+#include <vector>
+
+#include <spikes/array.hpp>
+
+#include "meta.hpp"
+#include "operator.hpp"
+#include "expression.hpp"
+#include "tabulation.hpp"
+
+
+/*
+ * Precomputed reference element tensors.
+ *
+ * The cells are simplices, whose map from the reference cell is
+ * affine. When the integrand of a bilinear form is a sum of monomials
+ *   c * d<s>(v) * d<t>(u)
+ * with constant coefficients c (d<0> being the identity), the element
+ * matrix of the cell K is
+ *   A_ij = |K| sum_{a, b} G_ab R_abij,
+ * where the reference tensor
+ *   R_abij = sum_q w_q dphi_hat_i^a(x_q) dphi_hat_j^b(x_q)
+ * only depends on the finite elements and on the quadrature, and the
+ * geometry tensor G_ab gathers the coefficients c and the rows s and t
+ * of the jacobian jmt of K. R is computed once per (test fe, trial fe,
+ * quadrature), so that the element matrix costs a contraction over the
+ * nonzero entries of G instead of an evaluation of the integrand at
+ * every quadrature point. The result is the same as with the quadrature,
+ * up to the rounding errors.
+ *
+ * reference_tensor_form<expr>::value tells at compile time whether an
+ * expression only contains constants, form arguments, sums, differences
+ * and products; its monomials are then expanded at run time by
+ * expand_reference_monomials.
+ */
+
+struct reference_monomial {
+  struct factor {
+    std::size_t argument, rank, derivative;
+  };
+
+  double coefficient;
+  std::vector<factor> factors;
+};
+
+
+template<typename expr>
+struct reference_tensor_form: false_type {};
+
+template<typename expr>
+struct reference_tensor_form<expression<expr> >: reference_tensor_form<expr> {
+  static void expand(const expression<expr>& e, std::vector<reference_monomial>& terms) {
+    reference_tensor_form<expr>::expand(e.expr, terms);
+  }
+};
+
+template<std::size_t arg, std::size_t rnk, std::size_t derivative, std::size_t degree>
+struct reference_tensor_form<form<arg, rnk, derivative, degree> >: true_type {
+  static void expand(const form<arg, rnk, derivative, degree>&, std::vector<reference_monomial>& terms) {
+    terms.push_back(reference_monomial{1.0, {reference_monomial::factor{arg, rnk, derivative}}});
+  }
+};
+
+template<>
+struct reference_tensor_form<constant>: true_type {
+  static void expand(const constant& c, std::vector<reference_monomial>& terms) {
+    terms.push_back(reference_monomial{c.get_value(), {}});
+  }
+};
+
+template<typename left, typename right>
+struct reference_tensor_form<binary_expression<left, right, add<double> > >
+  : bool_constant<reference_tensor_form<left>::value and reference_tensor_form<right>::value> {
+  static void expand(const binary_expression<left, right, add<double> >& e,
+		     std::vector<reference_monomial>& terms) {
+    reference_tensor_form<left>::expand(e.l.expr, terms);
+    reference_tensor_form<right>::expand(e.r.expr, terms);
+  }
+};
+
+template<typename left, typename right>
+struct reference_tensor_form<binary_expression<left, right, substract<double> > >
+  : bool_constant<reference_tensor_form<left>::value and reference_tensor_form<right>::value> {
+  static void expand(const binary_expression<left, right, substract<double> >& e,
+		     std::vector<reference_monomial>& terms) {
+    reference_tensor_form<left>::expand(e.l.expr, terms);
+
+    const std::size_t n_left(terms.size());
+    reference_tensor_form<right>::expand(e.r.expr, terms);
+    for (std::size_t n(n_left); n < terms.size(); ++n)
+      terms[n].coefficient = -terms[n].coefficient;
+  }
+};
+
+template<typename left, typename right>
+struct reference_tensor_form<binary_expression<left, right, multiply<double> > >
+  : bool_constant<reference_tensor_form<left>::value and reference_tensor_form<right>::value> {
+  static void expand(const binary_expression<left, right, multiply<double> >& e,
+		     std::vector<reference_monomial>& terms) {
+    std::vector<reference_monomial> l_terms, r_terms;
+    reference_tensor_form<left>::expand(e.l.expr, l_terms);
+    reference_tensor_form<right>::expand(e.r.expr, r_terms);
+
+    for (const auto& l: l_terms)
+      for (const auto& r: r_terms) {
+	reference_monomial t(l);
+	t.coefficient *= r.coefficient;
+	t.factors.insert(t.factors.end(), r.factors.begin(), r.factors.end());
+	terms.push_back(t);
+      }
+  }
+};
+
+
+namespace detail {
+  template<typename expr>
+  bool expand_reference_monomials(const expr& e, std::vector<reference_monomial>& terms, true_type) {
+    reference_tensor_form<expr>::expand(e, terms);
+
+    // every monomial must be bilinear
+    for (const auto& t: terms) {
+      if (t.factors.size() != 2 or t.factors[0].rank == t.factors[1].rank)
+	return false;
+    }
+    return true;
+  }
+
+  template<typename expr>
+  bool expand_reference_monomials(const expr&, std::vector<reference_monomial>&, false_type) {
+    return false;
+  }
+}
+
+/*
+ *  Expand the integrand of a bilinear form in monomials, and return
+ *  true if the element matrices can be computed with the reference
+ *  tensors.
+ */
+template<typename expr>
+bool expand_reference_monomials(const expr& e, std::vector<reference_monomial>& terms) {
+  terms.clear();
+  return detail::expand_reference_monomials(e, terms, bool_constant<reference_tensor_form<expr>::value>());
+}
+
+
+/*
+ *  The geometry tensor of the monomials coupling the test argument
+ *  test_arg and the trial argument trial_arg. Only the entries G_ab
+ *  which are structurally nonzero are evaluated.
+ */
+class reference_geometry {
+public:
+  reference_geometry(): n_dim(0) {}
+
+  reference_geometry(const std::vector<reference_monomial>& terms,
+		     std::size_t test_arg, std::size_t trial_arg, std::size_t n_dim)
+    : n_dim(n_dim) {
+    std::vector<bool> nonzero((n_dim + 1) * (n_dim + 1), false);
+
+    for (const auto& t: terms) {
+      const auto& test(t.factors[0].rank == 1 ? t.factors[0] : t.factors[1]);
+      const auto& trial(t.factors[0].rank == 1 ? t.factors[1] : t.factors[0]);
+      if (test.argument != test_arg or trial.argument != trial_arg or t.coefficient == 0.0)
+	continue;
+
+      monomials.push_back(monomial{t.coefficient, test.derivative, trial.derivative});
+      for (std::size_t a(0); a <= n_dim; ++a)
+	for (std::size_t b(0); b <= n_dim; ++b)
+	  if ((test.derivative == 0) == (a == 0) and (trial.derivative == 0) == (b == 0))
+	    nonzero[a * (n_dim + 1) + b] = true;
+    }
+
+    for (std::size_t ab(0); ab < nonzero.size(); ++ab)
+      if (nonzero[ab])
+	entries.push_back(ab);
+  }
+
+  bool empty() const { return monomials.empty(); }
+
+  const std::vector<std::size_t>& get_entries() const { return entries; }
+
+  /*
+   *  g[n] = G_ab, where (a, b) is the n-th nonzero entry.
+   */
+  template<typename jacobian_type>
+  void evaluate(const jacobian_type& jmt, double* g) const {
+    for (std::size_t n(0); n < entries.size(); ++n) {
+      const std::size_t a(entries[n] / (n_dim + 1)), b(entries[n] % (n_dim + 1));
+
+      g[n] = 0.0;
+      for (const auto& m: monomials)
+	g[n] += m.coefficient * jacobian(jmt, m.test_derivative, a) * jacobian(jmt, m.trial_derivative, b);
+    }
+  }
+
+private:
+  struct monomial {
+    double coefficient;
+    std::size_t test_derivative, trial_derivative;
+  };
+
+  std::size_t n_dim;
+  std::vector<monomial> monomials;
+  std::vector<std::size_t> entries;
+
+  // derivative s of a basis function, as a combination of the value (a
+  // = 0) and of the reference derivatives a = 1, ..., n_dim
+  template<typename jacobian_type>
+  static double jacobian(const jacobian_type& jmt, std::size_t s, std::size_t a) {
+    if (s == 0 or a == 0)
+      return s == a ? 1.0 : 0.0;
+    return jmt.at(s - 1, a - 1);
+  }
+};
+
+
+template<typename test_fe_type, typename trial_fe_type, typename quadrature_type>
+class reference_tensor {
+public:
+  static const std::size_t n_dim = test_fe_type::cell_type::n_dimension;
+  static const std::size_t n_test_dof = test_fe_type::n_dof_per_element;
+  static const std::size_t n_trial_dof = trial_fe_type::n_dof_per_element;
+
+  static const reference_tensor& instance() {
+    static const reference_tensor r;
+    return r;
+  }
+
+  /*
+   *  a_el[i * n_trial_dof + j] = sum_n g[n] R_(entries[n])ij, without the
+   *  cell volume.
+   */
+  void contract(const std::vector<std::size_t>& entries, const double* g, double* a_el) const {
+    const std::size_t n_el(n_test_dof * n_trial_dof);
+    std::fill(a_el, a_el + n_el, 0.0);
+
+    for (std::size_t n(0); n < entries.size(); ++n) {
+      const double* r(&values[entries[n] * n_el]);
+      for (std::size_t ij(0); ij < n_el; ++ij)
+	a_el[ij] += g[n] * r[ij];
+    }
+  }
+
+private:
+  std::vector<double> values;
+
+  reference_tensor()
+    : values((n_dim + 1) * (n_dim + 1) * n_test_dof * n_trial_dof, 0.0) {
+    static_assert(static_cast<std::size_t>(trial_fe_type::cell_type::n_dimension) == n_dim,
+		  "the cells types must be homogeneous");
+
+    const std::size_t n_q(quadrature_type::n_point);
+    std::vector<double> psi((n_dim + 1) * n_test_dof), phi((n_dim + 1) * n_trial_dof);
+
+    for (std::size_t q(0); q < n_q; ++q) {
+      tabulate<test_fe_type>(q, &psi[0]);
+      tabulate<trial_fe_type>(q, &phi[0]);
+
+      for (std::size_t a(0); a <= n_dim; ++a)
+	for (std::size_t b(0); b <= n_dim; ++b) {
+	  double* r(&values[(a * (n_dim + 1) + b) * n_test_dof * n_trial_dof]);
+	  for (std::size_t i(0); i < n_test_dof; ++i)
+	    for (std::size_t j(0); j < n_trial_dof; ++j)
+	      r[i * n_trial_dof + j] += quadrature_type::w[q] * psi[a * n_test_dof + i] * phi[b * n_trial_dof + j];
+	}
+    }
+  }
+
+  template<typename fe_type>
+  static void tabulate(std::size_t q, double* phi) {
+    using table_type = tabulation::table<fe_type, tabulation::cell_point_set<quadrature_type> >;
+    const std::size_t n_dof(fe_type::n_dof_per_element);
+    const double* t(table_type::get(0) + q * n_dof * (n_dim + 1));
+    for (std::size_t i(0); i < n_dof; ++i)
+      for (std::size_t a(0); a <= n_dim; ++a)
+	phi[a * n_dof + i] = t[i * (n_dim + 1) + a];
+  }
+};
+
+#endif /* REFERENCE_TENSOR_H */
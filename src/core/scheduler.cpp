@@ -0,0 +1,299 @@
+#include "scheduler.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+
+namespace {
+  thread_local bool in_chunk(false);
+
+  std::size_t environment_thread_number() {
+    const char* value(std::getenv("TFEL_NUM_THREADS"));
+    if (value) {
+      const long n(std::strtol(value, nullptr, 10));
+      if (n > 0)
+	return n;
+    }
+
+    const std::size_t n(std::thread::hardware_concurrency());
+    return n > 0 ? n : 1;
+  }
+
+  bool environment_pin_threads() {
+    const char* value(std::getenv("TFEL_PIN_THREADS"));
+    return value and std::string(value) == "1";
+  }
+
+#ifdef __linux__
+  void pin_thread(pthread_t t, std::size_t core) {
+    const std::size_t n_core(std::thread::hardware_concurrency());
+    if (n_core == 0)
+      return;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core % n_core, &set);
+    pthread_setaffinity_np(t, sizeof(cpu_set_t), &set);
+  }
+
+  // the affinity of a thread pinned as the participant 0, before it was
+  thread_local bool caller_pinned(false);
+  thread_local cpu_set_t caller_affinity;
+#endif
+
+  /*
+   *  The scheduler is read without lock once it exists. The mutex only
+   *  guards its creation and its replacement, and instance_owner
+   *  destroys the last one at exit.
+   */
+  std::mutex instance_mutex;
+  std::unique_ptr<parallel::scheduler> instance_owner;
+}
+
+
+std::atomic<parallel::scheduler*> parallel::scheduler::inst(nullptr);
+
+
+parallel::scheduler& parallel::scheduler::instance() {
+  scheduler* s(inst.load(std::memory_order_acquire));
+  if (s)
+    return *s;
+
+  std::lock_guard<std::mutex> lock(instance_mutex);
+  if (not instance_owner) {
+    instance_owner.reset(new scheduler(environment_thread_number(),
+				       environment_pin_threads()));
+    inst.store(instance_owner.get(), std::memory_order_release);
+  }
+  return *instance_owner;
+}
+
+void parallel::scheduler::configure(std::size_t n_thread, bool pin_threads) {
+  if (in_chunk)
+    throw std::string("parallel::scheduler::configure: called from a parallel region");
+
+  std::lock_guard<std::mutex> lock(instance_mutex);
+  inst.store(nullptr, std::memory_order_release);
+  instance_owner.reset();
+  instance_owner.reset(new scheduler(n_thread > 0 ? n_thread : 1, pin_threads));
+  inst.store(instance_owner.get(), std::memory_order_release);
+}
+
+bool parallel::scheduler::in_parallel_region() {
+  return in_chunk;
+}
+
+
+parallel::scheduler::scheduler(std::size_t n_thread, bool pin_threads)
+  : n_thread(n_thread), pin_threads(pin_threads), stealable(0), stop(false) {
+  for (std::size_t n(0); n < n_thread; ++n)
+    queues.emplace_back(new queue());
+
+  for (std::size_t n(1); n < n_thread; ++n)
+    workers.push_back(std::thread(&scheduler::worker_loop, this, n));
+
+  /*
+   *  The thread which creates the scheduler is the participant 0. When
+   *  it was pinned by a previous scheduler, it first recovers its
+   *  affinity, which the unpinned workers then get, whatever the
+   *  threads created before them had. With pinning, it is pinned to the
+   *  core 0 like the worker n to the core n.
+   */
+#ifdef __linux__
+  if (caller_pinned) {
+    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &caller_affinity);
+    caller_pinned = false;
+  }
+
+  cpu_set_t caller_set;
+  const bool has_caller_set(pthread_getaffinity_np(pthread_self(), sizeof(cpu_set_t), &caller_set) == 0);
+  for (std::size_t n(1); n < n_thread; ++n)
+    if (pin_threads)
+      pin_thread(workers[n - 1].native_handle(), n);
+    else if (has_caller_set)
+      pthread_setaffinity_np(workers[n - 1].native_handle(), sizeof(cpu_set_t), &caller_set);
+
+  if (pin_threads and has_caller_set) {
+    caller_affinity = caller_set;
+    caller_pinned = true;
+    pin_thread(pthread_self(), 0);
+  }
+#endif
+}
+
+parallel::scheduler::~scheduler() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stop = true;
+  }
+  work_available.notify_all();
+
+  for (auto& w: workers)
+    w.join();
+}
+
+
+void parallel::scheduler::run(std::size_t begin, std::size_t end, std::size_t grain,
+			      const range_function& f) {
+  if (end <= begin)
+    return;
+
+  grain = get_grain(end - begin, grain);
+  const std::size_t n_chunk((end - begin + grain - 1) / grain);
+
+  /*
+   *  Serial execution, with the same chunks
+   */
+  if (n_thread == 1 or n_chunk == 1 or in_chunk) {
+    const bool nested(in_chunk);
+    in_chunk = true;
+    try {
+      for (std::size_t b(begin); b < end; b += grain)
+	f(b, std::min(b + grain, end));
+    } catch (...) {
+      in_chunk = nested;
+      throw;
+    }
+    in_chunk = nested;
+    return;
+  }
+
+  std::lock_guard<std::mutex> submit_lock(submit_mutex);
+  job j(f, n_chunk, true);
+
+  /*
+   *  Distribute contiguous sets of chunks to the queues
+   */
+  for (std::size_t n(0); n < n_thread; ++n) {
+    std::lock_guard<std::mutex> lock(queues[n]->mutex);
+    for (std::size_t c(n_chunk * n / n_thread); c < n_chunk * (n + 1) / n_thread; ++c) {
+      const std::size_t b(begin + c * grain);
+      queues[n]->chunks.push_back(chunk{&j, b, std::min(b + grain, end)});
+    }
+    queues[n]->size = queues[n]->chunks.size();
+  }
+
+  submit(j, n_chunk);
+}
+
+void parallel::scheduler::run_partitioned(std::size_t begin, std::size_t end,
+					  const range_function& f) {
+  if (end <= begin)
+    return;
+
+  if (n_thread == 1 or in_chunk) {
+    run(begin, end, end - begin, f);
+    return;
+  }
+
+  std::lock_guard<std::mutex> submit_lock(submit_mutex);
+  job j(f, n_thread, false);
+
+  for (std::size_t n(0); n < n_thread; ++n) {
+    std::lock_guard<std::mutex> lock(queues[n]->mutex);
+    queues[n]->chunks.push_back(chunk{&j,
+				      get_partition_bound(begin, end, n),
+				      get_partition_bound(begin, end, n + 1)});
+    queues[n]->size = queues[n]->chunks.size();
+  }
+
+  submit(j, n_thread);
+}
+
+void parallel::scheduler::submit(job& j, std::size_t n_chunk) {
+  /*
+   *  The counters change under the mutex, so that a worker cannot miss
+   *  the notification between the test of its predicate and its wait
+   */
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (j.stealable)
+      stealable += n_chunk;
+  }
+  work_available.notify_all();
+
+  /*
+   *  The calling thread participates as the participant 0
+   */
+  chunk c;
+  while (pop(0, c) or steal(0, c))
+    execute(c);
+
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    job_done.wait(lock, [&j]() { return j.remaining == 0; });
+  }
+
+  if (j.error)
+    std::rethrow_exception(j.error);
+}
+
+
+void parallel::scheduler::worker_loop(std::size_t id) {
+  chunk c;
+  while (true) {
+    if (pop(id, c) or steal(id, c)) {
+      execute(c);
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    work_available.wait(lock, [this, id]() { return stop or queues[id]->size > 0 or stealable > 0; });
+    if (stop)
+      return;
+  }
+}
+
+bool parallel::scheduler::pop(std::size_t id, chunk& c) {
+  queue& q(*queues[id]);
+  std::lock_guard<std::mutex> lock(q.mutex);
+  if (q.chunks.empty())
+    return false;
+
+  c = q.chunks.front();
+  q.chunks.pop_front();
+  --q.size;
+  if (c.j->stealable)
+    --stealable;
+  return true;
+}
+
+bool parallel::scheduler::steal(std::size_t id, chunk& c) {
+  for (std::size_t n(1); n < n_thread; ++n) {
+    queue& q(*queues[(id + n) % n_thread]);
+    std::lock_guard<std::mutex> lock(q.mutex);
+    if (not q.chunks.empty() and q.chunks.back().j->stealable) {
+      c = q.chunks.back();
+      q.chunks.pop_back();
+      --q.size;
+      --stealable;
+      return true;
+    }
+  }
+  return false;
+}
+
+void parallel::scheduler::execute(const chunk& c) {
+  in_chunk = true;
+  try {
+    profiler::adopt_context profile_context(c.j->profile_context);
+    c.j->f(c.begin, c.end);
+  } catch (...) {
+    std::lock_guard<std::mutex> lock(c.j->error_mutex);
+    if (not c.j->error)
+      c.j->error = std::current_exception();
+  }
+  in_chunk = false;
+
+  if (--c.j->remaining == 0) {
+    std::lock_guard<std::mutex> lock(mutex);
+    job_done.notify_all();
+  }
+}
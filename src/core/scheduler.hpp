@@ -0,0 +1,266 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <string>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <spikes/array.hpp>
+
+#include "profiler.hpp"
+
+/*
+ * Process-wide work-stealing scheduler.
+ *
+ * The scheduler owns n_thread - 1 worker threads; the thread which
+ * calls parallel_for is the n_thread-th participant. A range [begin,
+ * end) is split in chunks of 'grain' indices, which are distributed
+ * evenly over the participants' queues. A participant takes chunks
+ * from the front of its own queue and, once it is empty, steals from
+ * the back of the other queues. Calls nested in a running chunk, or
+ * with a single thread, run serially in the calling thread.
+ *
+ * The thread number is read from the TFEL_NUM_THREADS environment
+ * variable (default: std::thread::hardware_concurrency()), and the
+ * participant n is pinned to the core n when TFEL_PIN_THREADS is set
+ * to 1. The pinned participant 0 is the thread which creates the
+ * scheduler: it recovers its affinity when it replaces the scheduler,
+ * and the loops called from other threads run their partition 0 on an
+ * unpinned thread. Both can be changed with parallel::set_thread_number
+ * while no parallel loop runs.
+ *
+ * Pinned threads also enable the first-touch placement: the large
+ * arrays of the meshes, finite element spaces and forms are
+ * initialized by the participant which owns the corresponding
+ * partition of [0, n), so that on NUMA nodes the memory pages are
+ * placed close to the core which processes them. The partition n of a
+ * range is the same for parallel::for_each_partition and for the queue
+ * of the participant n in parallel::parallel_for, up to the chunk
+ * granularity.
+ */
+namespace parallel {
+
+  class scheduler {
+  public:
+    using range_function = std::function<void(std::size_t, std::size_t)>;
+
+    static scheduler& instance();
+    static void configure(std::size_t n_thread, bool pin_threads);
+
+    ~scheduler();
+
+    scheduler(const scheduler&) = delete;
+    scheduler& operator=(const scheduler&) = delete;
+
+    std::size_t get_thread_number() const { return n_thread; }
+    bool get_pin_threads() const { return pin_threads; }
+    bool get_first_touch() const { return pin_threads and n_thread > 1; }
+
+    std::size_t get_partition_bound(std::size_t begin, std::size_t end, std::size_t n) const {
+      return begin + (end - begin) * n / n_thread;
+    }
+
+    /*
+     * Call f(chunk_begin, chunk_end) on every chunk of [begin, end),
+     * where chunk_begin = begin + n * grain. A grain of 0 selects about
+     * eight chunks per thread.
+     */
+    void run(std::size_t begin, std::size_t end, std::size_t grain,
+	     const range_function& f);
+
+    /*
+     * Call f(part_begin, part_end) on the partition n of [begin, end) in
+     * the participant n. The partitions are never stolen.
+     */
+    void run_partitioned(std::size_t begin, std::size_t end, const range_function& f);
+
+    std::size_t get_grain(std::size_t n, std::size_t grain) const {
+      if (grain > 0)
+	return grain;
+      const std::size_t g(n / (8 * n_thread));
+      return g > 0 ? g : 1;
+    }
+
+    static bool in_parallel_region();
+
+  private:
+    struct job {
+      job(const range_function& f, std::size_t n_chunk, bool stealable)
+	: f(f), stealable(stealable), remaining(n_chunk) {}
+
+      const range_function& f;
+      const bool stealable;
+      profiler::context profile_context;
+      std::atomic<std::size_t> remaining;
+      std::mutex error_mutex;
+      std::exception_ptr error;
+    };
+
+    struct chunk {
+      job* j;
+      std::size_t begin, end;
+    };
+
+    // size is chunks.size(), readable without the mutex
+    struct queue {
+      queue(): size(0) {}
+
+      std::mutex mutex;
+      std::deque<chunk> chunks;
+      std::atomic<std::size_t> size;
+    };
+
+    scheduler(std::size_t n_thread, bool pin_threads);
+
+    void submit(job& j, std::size_t n_chunk);
+    void worker_loop(std::size_t id);
+    bool pop(std::size_t id, chunk& c);
+    bool steal(std::size_t id, chunk& c);
+    void execute(const chunk& c);
+
+    std::size_t n_thread;
+    bool pin_threads;
+
+    std::vector<std::unique_ptr<queue> > queues;
+    std::vector<std::thread> workers;
+
+    /*
+     *  stealable is the number of queued chunks which may be stolen. An
+     *  idle worker waits until its own queue or stealable is not empty.
+     */
+    std::mutex mutex;
+    std::condition_variable work_available, job_done;
+    std::atomic<std::size_t> stealable;
+    bool stop;
+
+    std::mutex submit_mutex;
+
+    static std::atomic<scheduler*> inst;
+  };
+
+
+  inline std::size_t get_thread_number() {
+    return scheduler::instance().get_thread_number();
+  }
+
+  inline void set_thread_number(std::size_t n_thread, bool pin_threads = false) {
+    scheduler::configure(n_thread, pin_threads);
+  }
+
+  inline bool first_touch_enabled() {
+    return scheduler::instance().get_first_touch();
+  }
+
+  template<typename F>
+  void parallel_for(std::size_t begin, std::size_t end, F f, std::size_t grain = 0) {
+    scheduler::instance().run(begin, end, grain, scheduler::range_function(f));
+  }
+
+  /*
+   * Passed to the functions which call a user function on many points,
+   * to state that it is thread safe and may be called concurrently.
+   * Without it, the user functions are called in order from the calling
+   * thread.
+   */
+  struct thread_safe_t {};
+  constexpr thread_safe_t thread_safe = thread_safe_t();
+
+  /*
+   * parallel_for when concurrent, and f(begin, end) in the calling
+   * thread otherwise.
+   */
+  template<typename F>
+  void parallel_for_if(bool concurrent, std::size_t begin, std::size_t end, F f) {
+    if (concurrent)
+      parallel_for(begin, end, f);
+    else if (begin < end)
+      f(begin, end);
+  }
+
+  template<typename F>
+  void for_each_partition(std::size_t begin, std::size_t end, F f) {
+    scheduler::instance().run_partitioned(begin, end, scheduler::range_function(f));
+  }
+
+  /*
+   * Reduce map(chunk_begin, chunk_end) over the chunks of [begin, end)
+   * with reduce(T, T), starting from identity. The partial results are
+   * reduced in the chunk order, so that the result does not depend on
+   * the scheduling.
+   */
+  template<typename T, typename M, typename R>
+  T parallel_reduce(std::size_t begin, std::size_t end, const T& identity,
+		    M map, R reduce, std::size_t grain = 0) {
+    if (end <= begin)
+      return identity;
+
+    scheduler& s(scheduler::instance());
+    const std::size_t g(s.get_grain(end - begin, grain));
+    std::vector<T> partial((end - begin + g - 1) / g, identity);
+
+    s.run(begin, end, g, [&](std::size_t b, std::size_t e) {
+	partial[(b - begin) / g] = map(b, e);
+      });
+
+    T result(identity);
+    for (const auto& p: partial)
+      result = reduce(result, p);
+    return result;
+  }
+
+
+  /*
+   * Copy an array of rank 1 or 2 in a new array whose rows are first
+   * touched by the participant owning them. The array is returned
+   * unchanged when the first-touch placement is disabled.
+   */
+  template<typename T>
+  array<T> first_touch_copy(const array<T>& a) {
+    if (not first_touch_enabled())
+      return a;
+
+    if (a.get_rank() != 1 and a.get_rank() != 2)
+      throw std::string("parallel::first_touch_copy: unsupported array rank");
+
+    const std::size_t n_row(a.get_size(0));
+    const std::size_t n_column(a.get_rank() == 2 ? a.get_size(1) : 1);
+    array<T> result(a.get_rank() == 2 ? array<T>{n_row, n_column} : array<T>{n_row});
+    if (n_row * n_column == 0)
+      return result;
+
+    const T* source(a.get_data());
+    T* destination(result.get_data());
+    for_each_partition(0, n_row, [=](std::size_t k_begin, std::size_t k_end) {
+	std::copy(source + k_begin * n_column, source + k_end * n_column,
+		  destination + k_begin * n_column);
+      });
+    return result;
+  }
+
+  /*
+   * Fill the array a with the value v, each participant writing the
+   * elements of its partition.
+   */
+  template<typename T>
+  void first_touch_fill(array<T>& a, const T& v) {
+    if (not first_touch_enabled() or a.get_element_number() == 0) {
+      a.fill(v);
+      return;
+    }
+
+    T* data(a.get_data());
+    for_each_partition(0, a.get_element_number(), [=](std::size_t k_begin, std::size_t k_end) {
+	std::fill(data + k_begin, data + k_end, v);
+      });
+  }
+}
+
+#endif /* SCHEDULER_H */
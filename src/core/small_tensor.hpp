@@ -0,0 +1,162 @@
+#ifndef _SMALL_TENSOR_H_
+#define _SMALL_TENSOR_H_
+
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <algorithm>
+#include <string>
+
+#include <spikes/array.hpp>
+
+
+/*
+ * A tensor of compile-time extents, stored in place in row major order:
+ * the jacobians, barycentric coordinates, normals and element buffers of
+ * the cells, which are too small to be worth a heap allocation.
+ *
+ * The interface is the one of array, so that the code which reads the
+ * geometry is the same for both. The elements are not initialized. The
+ * storage is aligned on the fundamental alignment, which the standard
+ * containers and operator new honour.
+ */
+template<std::size_t ... extents>
+struct extent_product;
+
+template<>
+struct extent_product<> { static constexpr std::size_t value = 1; };
+
+template<std::size_t e, std::size_t ... extents>
+struct extent_product<e, extents...> {
+  static constexpr std::size_t value = e * extent_product<extents...>::value;
+};
+
+
+template<std::size_t ... extents>
+struct small_tensor_index;
+
+template<>
+struct small_tensor_index<> {
+  static std::size_t offset() { return 0; }
+};
+
+template<std::size_t e, std::size_t ... extents>
+struct small_tensor_index<e, extents...> {
+  template<typename ... Is>
+  static std::size_t offset(std::size_t i, Is... is) {
+    assert(i < e);
+    return i * extent_product<extents...>::value + small_tensor_index<extents...>::offset(is...);
+  }
+};
+
+
+template<typename T, std::size_t ... extents>
+class small_tensor {
+public:
+  static constexpr std::size_t rank = sizeof...(extents);
+  static constexpr std::size_t n_element = extent_product<extents...>::value;
+
+  template<typename ... Is>
+  T& at(Is... is) {
+    static_assert(sizeof...(Is) == rank, "small_tensor::at: wrong number of indices.");
+    return values[small_tensor_index<extents...>::offset(is...)];
+  }
+
+  template<typename ... Is>
+  const T& at(Is... is) const {
+    static_assert(sizeof...(Is) == rank, "small_tensor::at: wrong number of indices.");
+    return values[small_tensor_index<extents...>::offset(is...)];
+  }
+
+  std::size_t get_rank() const { return rank; }
+
+  std::size_t get_size(std::size_t d) const {
+    static const std::size_t sizes[] = {extents..., 0};
+    assert(d < rank);
+    return sizes[d];
+  }
+
+  std::size_t get_element_number() const { return n_element; }
+
+  T* get_data() { return values; }
+  const T* get_data() const { return values; }
+
+  void fill(const T& v) { std::fill(values, values + n_element, v); }
+
+  void set_data(const T* data) { std::copy(data, data + n_element, values); }
+
+  /*
+   *  A copy with the extents known at run time, for the code which
+   *  stores array<T>.
+   */
+  explicit operator array<T>() const {
+    array<T> result{extents...};
+    result.set_data(values);
+    return result;
+  }
+
+private:
+  alignas(alignof(std::max_align_t)) T values[n_element == 0 ? 1 : n_element];
+};
+
+
+template<typename T, std::size_t n>
+T dotp(const small_tensor<T, n>& a, const small_tensor<T, n>& b) {
+  T result = {};
+  for (std::size_t k(0); k < n; ++k)
+    result += a.at(k) * b.at(k);
+  return result;
+}
+
+template<typename T>
+small_tensor<T, 3> crossp(const small_tensor<T, 3>& a, const small_tensor<T, 3>& b) {
+  small_tensor<T, 3> result;
+  result.at(0) = a.at(1) * b.at(2) - a.at(2) * b.at(1);
+  result.at(1) = a.at(2) * b.at(0) - a.at(0) * b.at(2);
+  result.at(2) = a.at(0) * b.at(1) - a.at(1) * b.at(0);
+  return result;
+}
+
+/*
+ *  Invert in place a small square matrix, by Gauss-Jordan elimination
+ *  with partial pivoting.
+ */
+template<std::size_t n>
+void invert(small_tensor<double, n, n>& m) {
+  small_tensor<double, n, n> a(m);
+  for (std::size_t i(0); i < n; ++i)
+    for (std::size_t j(0); j < n; ++j)
+      m.at(i, j) = (i == j ? 1.0 : 0.0);
+
+  for (std::size_t c(0); c < n; ++c) {
+    std::size_t p(c);
+    for (std::size_t i(c + 1); i < n; ++i)
+      if (std::abs(a.at(i, c)) > std::abs(a.at(p, c)))
+	p = i;
+    if (a.at(p, c) == 0.0)
+      throw std::string("small_tensor::invert: singular matrix.");
+
+    for (std::size_t j(0); j < n; ++j) {
+      std::swap(a.at(c, j), a.at(p, j));
+      std::swap(m.at(c, j), m.at(p, j));
+    }
+
+    const double pivot(a.at(c, c));
+    for (std::size_t j(0); j < n; ++j) {
+      a.at(c, j) /= pivot;
+      m.at(c, j) /= pivot;
+    }
+
+    for (std::size_t i(0); i < n; ++i) {
+      if (i == c)
+	continue;
+      const double f(a.at(i, c));
+      for (std::size_t j(0); j < n; ++j) {
+	a.at(i, j) -= f * a.at(c, j);
+	m.at(i, j) -= f * m.at(c, j);
+      }
+    }
+  }
+}
+
+#endif /* _SMALL_TENSOR_H_ */
@@ -11,6 +11,8 @@ void solver::lapack::lu::set_operator(const sparse_matrix& m) {
   /*
    *  Fill the data array
    */
+  if (data.get_size(0) != m.get_row_number())
+    set_operator_size(m.get_row_number());
   data.fill(0.0);
   for (auto v: m.values)
     data.at(v.first.first, v.first.second) = v.second;
@@ -30,6 +32,22 @@ void solver::lapack::lu::set_operator(const dense_matrix& m) {
   do_lu_decomposition();
 }
 
+void solver::lapack::lu::set_operator(const crs_matrix& m) {
+  report.clear();
+
+  /*
+   *  Fill the data array
+   */
+  if (data.get_size(0) != m.get_row_number())
+    set_operator_size(m.get_row_number());
+  data.fill(0.0);
+  for (std::size_t i(0); i < m.get_row_number(); ++i)
+    for (std::size_t n(m.p->row[i]); n < m.p->row[i + 1]; ++n)
+      data.at(i, m.p->column[n]) = m.values[n];
+
+  do_lu_decomposition();
+}
+
 void solver::lapack::lu::do_lu_decomposition() {
   /*
    *  LU decomposition
@@ -55,6 +73,11 @@ solver::petsc::initialize* solver::petsc::initialize::inst = nullptr;
 
 
 void solver::petsc::gmres_ilu::set_operator(const sparse_matrix& m) {
+  set_operator(crs_matrix(m));
+}
+
+
+void solver::petsc::gmres_ilu::set_operator(const crs_matrix& m) {
   PetscErrorCode ierr;
 
   ierr = MatSetSizes(a,
@@ -66,34 +89,20 @@ void solver::petsc::gmres_ilu::set_operator(const sparse_matrix& m) {
 
   
   /*
-   *  Convert sparse matrix to CRS representation
+   *  The CRS representation stores the diagonal entries, which the ILU
+   *  factorization requires even when the assembly skipped a
+   *  structurally zero diagonal block.
    */
-  std::vector<int>
-    row(m.get_row_number() + 1),
-    col(m.get_nz_element_number());
-  std::vector<double>
-    val(m.get_nz_element_number());
-    
-  std::size_t row_id(0), val_id(0);
-  row[0] = row_id;
-  for (const auto& v: m.values) {
-    while (row_id < v.first.first) {
-      ++row_id;
-      row[row_id] = val_id;
-    }
-    col[val_id] = v.first.second;
-    val[val_id] = v.second;
-    ++val_id;
-  }
-  row.back() = val_id;
+  const crs_matrix::pattern& p(*m.p);
+  const std::vector<int> col(p.column.begin(), p.column.end());
 
   
   /*
    *  Count the number of non-zero per row
    */
-  std::vector<int> nnz(m.get_row_number());
-  for (std::size_t n(0); n < m.get_row_number(); ++n)
-    nnz[n] = row[n + 1] - row[n];
+  std::vector<int> nnz(p.n_row);
+  for (std::size_t n(0); n < p.n_row; ++n)
+    nnz[n] = p.row[n + 1] - p.row[n];
 
   
   /*
@@ -105,11 +114,11 @@ void solver::petsc::gmres_ilu::set_operator(const sparse_matrix& m) {
   /*
    * Assemble the matrix row by row
    */
-  for (int row_id(0); row_id < row.size() - 1; ++row_id) {
-    if (row[row_id + 1] > row[row_id]) {
+  for (int row_id(0); row_id < static_cast<int>(p.n_row); ++row_id) {
+    if (nnz[row_id] > 0) {
       ierr = MatSetValues(a, 1, &row_id,
-                          nnz[row_id], &col[row[row_id]],
-                          &val[row[row_id]],
+                          nnz[row_id], &col[p.row[row_id]],
+                          &m.values[p.row[row_id]],
                           INSERT_VALUES);CHKERRV(ierr);
     }
   }
@@ -168,6 +177,11 @@ bool solver::petsc::gmres_ilu::solve(const array<double>& rhs,
   ierr = VecDuplicate(b, &y);CHKERRCONTINUE(ierr);
   ierr = KSPSolve(ksp, b, y);CHKERRCONTINUE(ierr);
 
+  PetscInt iterations(0);
+  ierr = KSPGetIterationNumber(ksp, &iterations);CHKERRCONTINUE(ierr);
+  report.set("iterations", static_cast<std::size_t>(iterations));
+  profiler::count("krylov_iterations", iterations);
+
   std::vector<PetscInt> iy(rhs.get_size(0));
   std::iota(iy.begin(), iy.end(), 0);
 
@@ -176,3 +190,122 @@ bool solver::petsc::gmres_ilu::solve(const array<double>& rhs,
   return true;
 }
 
+
+
+std::size_t crs_matrix::pattern::find(std::size_t i, std::size_t j) const {
+  if (i >= n_row)
+    return column.size();
+
+  const auto begin(column.begin() + row[i]), end(column.begin() + row[i + 1]);
+  const auto c(std::lower_bound(begin, end, j));
+  return c != end and *c == j ? c - column.begin() : column.size();
+}
+
+bool crs_matrix::pattern::contains(const sparse_matrix& m) const {
+  for (const auto& v: m.get_values())
+    if (find(v.first.first, v.first.second) == column.size())
+      return false;
+  return true;
+}
+
+std::shared_ptr<const crs_matrix::pattern>
+crs_matrix::make_pattern(std::size_t n_row, std::size_t n_column,
+                         const std::vector<const sparse_matrix*>& m) {
+  std::vector<std::vector<std::size_t> > row_columns(n_row);
+  for (std::size_t i(0); i < std::min(n_row, n_column); ++i)
+    row_columns[i].push_back(i);
+
+  for (const auto a: m)
+    for (const auto& v: a->get_values()) {
+      if (v.first.first >= n_row or v.first.second >= n_column)
+        throw std::string("crs_matrix::make_pattern: entry out of the matrix bounds");
+      row_columns[v.first.first].push_back(v.first.second);
+    }
+
+  std::shared_ptr<pattern> p(new pattern());
+  p->n_row = n_row;
+  p->n_column = n_column;
+  p->row.resize(n_row + 1);
+  for (std::size_t i(0); i < n_row; ++i) {
+    auto& c(row_columns[i]);
+    std::sort(c.begin(), c.end());
+    c.erase(std::unique(c.begin(), c.end()), c.end());
+
+    p->row[i] = p->column.size();
+    p->column.insert(p->column.end(), c.begin(), c.end());
+  }
+  p->row.back() = p->column.size();
+
+  return p;
+}
+
+
+crs_matrix::crs_matrix(const sparse_matrix& m)
+  : crs_matrix(make_pattern(m.get_row_number(), m.get_column_number(), {&m}), m) {}
+
+crs_matrix::crs_matrix(const std::shared_ptr<const pattern>& p)
+  : p(p), values(p->column.size(), 0.0) {}
+
+crs_matrix::crs_matrix(const std::shared_ptr<const pattern>& p, const sparse_matrix& m)
+  : crs_matrix(p) {
+  assign(m);
+}
+
+double& crs_matrix::get(std::size_t i, std::size_t j) {
+  const std::size_t n(p->find(i, j));
+  if (n == values.size())
+    throw std::string("crs_matrix::get: entry not in the sparsity pattern");
+  return values[n];
+}
+
+void crs_matrix::assign(const sparse_matrix& m) {
+  if (m.get_row_number() != p->n_row or m.get_column_number() != p->n_column)
+    throw std::string("crs_matrix::assign: incompatible matrix sizes");
+
+  clear();
+
+  /*
+   *  The entries of the map are sorted by row and column, as the
+   *  pattern: walk both at once
+   */
+  std::size_t n(0);
+  for (const auto& v: m.get_values()) {
+    const std::size_t i(v.first.first), j(v.first.second);
+    if (n < p->row[i] or n >= p->row[i + 1] or p->column[n] > j)
+      n = p->row[i];
+    while (n < p->row[i + 1] and p->column[n] < j)
+      ++n;
+
+    if (n == p->row[i + 1] or p->column[n] != j)
+      throw std::string("crs_matrix::assign: entry not in the sparsity pattern");
+    values[n] = v.second;
+  }
+}
+
+void crs_matrix::axpy(double alpha, const crs_matrix& x) {
+  if (x.p != p)
+    throw std::string("crs_matrix::axpy: the matrices do not share their sparsity pattern");
+
+  for (std::size_t n(0); n < values.size(); ++n)
+    values[n] += alpha * x.values[n];
+}
+
+void crs_matrix::scale(double alpha) {
+  for (auto& v: values)
+    v *= alpha;
+}
+
+array<double> crs_matrix::multiply(const array<double>& x) const {
+  if (x.get_size(0) != p->n_column)
+    throw std::string("crs_matrix::multiply: incompatible vector size");
+
+  array<double> y{p->n_row};
+  for (std::size_t i(0); i < p->n_row; ++i) {
+    double y_i(0.0);
+    for (std::size_t n(p->row[i]); n < p->row[i + 1]; ++n)
+      y_i += values[n] * x.at(p->column[n]);
+    y.at(i) = y_i;
+  }
+
+  return y;
+}
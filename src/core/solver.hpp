@@ -1,6 +1,7 @@
 #ifndef SOLVER_H
 #define SOLVER_H
 
+#include <algorithm>
 #include <map>
 #include <string>
 #include <memory>
@@ -17,6 +18,7 @@
 
 #include "meta.hpp"
 #include "dictionary.hpp"
+#include "profiler.hpp"
 
 
 class matrix;
@@ -33,10 +35,19 @@ namespace solver {
     void set_operator(const matrix& m);
     virtual void set_operator(const sparse_matrix& m) = 0;
     virtual void set_operator(const dense_matrix& m) = 0;
+    virtual void set_operator(const crs_matrix& m) = 0;
     
     virtual bool solve(const array<double>& rhs,
                        array<double>& x,
                        dictionary& report) = 0;
+
+    /*
+     *  The relative tolerance of the next solves, for the iterative
+     *  solvers (e.g. the inexact Newton steps). The direct solvers
+     *  ignore it, and have a tolerance of 0.
+     */
+    virtual void set_relative_tolerance(double rtol) {}
+    virtual double get_relative_tolerance() const { return 0.0; }
   };
 
   namespace lapack {
@@ -47,6 +58,7 @@ namespace solver {
       
       void set_operator(const sparse_matrix& m);
       void set_operator(const dense_matrix& m);
+      void set_operator(const crs_matrix& m);
 
       void set_operator_size(std::size_t n) {
         data = array<double>{n, n};
@@ -70,7 +82,7 @@ namespace solver {
         lapack_int info(LAPACKE_dgetrs(LAPACK_ROW_MAJOR,
                                        'N',
                                        n, 1, data.get_data(), n, pivots.get_data(),
-                                       x.get_data(), n));
+                                       x.get_data(), 1));
 
         if (info < 0) {
           report.set("error", "dgetrs invalid parameter");
@@ -173,10 +185,27 @@ namespace solver {
       
       virtual void set_operator(const sparse_matrix& m);
       virtual void set_operator(const dense_matrix& m);
+      virtual void set_operator(const crs_matrix& m);
       
       virtual bool solve(const array<double>& rhs,
                          array<double>& x,
                          dictionary& report);
+
+      // the other tolerances are kept
+      virtual void set_relative_tolerance(double rtol) {
+        PetscErrorCode ierr;
+        PetscReal current_rtol, atol, dtol;
+        PetscInt maxits;
+        ierr = KSPGetTolerances(ksp, &current_rtol, &atol, &dtol, &maxits);CHKERRV(ierr);
+        ierr = KSPSetTolerances(ksp, rtol, atol, dtol, maxits);CHKERRV(ierr);
+      }
+
+      virtual double get_relative_tolerance() const {
+        PetscReal rtol(0.0);
+        PetscErrorCode ierr;
+        ierr = KSPGetTolerances(ksp, &rtol, nullptr, nullptr, nullptr);CHKERRCONTINUE(ierr);
+        return rtol;
+      }
       
     private:
       Mat a;
@@ -276,6 +305,10 @@ public:
     auto result(values.insert(std::make_pair(std::make_pair(i, j), 0.0)));
     return result.first->second;
   }
+
+  const std::map<std::pair<std::size_t, std::size_t>, double>& get_values() const {
+    return values;
+  }
   
 private:
   std::size_t n_row, n_column;
@@ -324,4 +357,92 @@ private:
 };
 
 
+/*
+ *  Compressed row storage on a sparsity pattern which can be shared by
+ *  several matrices, so that linear combinations of matrices assembled
+ *  once are computed on the value arrays (see operator_cache). The
+ *  diagonal entries are always stored. The entries outside of the
+ *  pattern cannot be set.
+ */
+class crs_matrix: public matrix {
+public:
+  friend class solver::lapack::lu;
+  friend class solver::petsc::gmres_ilu;
+
+  struct pattern {
+    std::size_t n_row, n_column;
+    std::vector<std::size_t> row, column;
+
+    // index of the entry (i, j) in column, or column.size()
+    std::size_t find(std::size_t i, std::size_t j) const;
+    bool contains(const sparse_matrix& m) const;
+  };
+
+  /*
+   *  Pattern of the union of the nonzero entries of the matrices.
+   */
+  static std::shared_ptr<const pattern> make_pattern(std::size_t n_row, std::size_t n_column,
+                                                     const std::vector<const sparse_matrix*>& m);
+
+  explicit crs_matrix(const sparse_matrix& m);
+  explicit crs_matrix(const std::shared_ptr<const pattern>& p);
+  crs_matrix(const std::shared_ptr<const pattern>& p, const sparse_matrix& m);
+
+  virtual void populate_solver(solver::basic_solver& s) const {
+    s.set_operator(*this);
+  }
+
+  virtual std::size_t get_row_number() const { return p->n_row; }
+  virtual std::size_t get_column_number() const { return p->n_column; }
+
+  virtual std::size_t get_nz_element_number() const {
+    return values.size();
+  }
+
+  virtual void clear() { std::fill(values.begin(), values.end(), 0.0); }
+
+  virtual void set(std::size_t i, std::size_t j, double v) { get(i, j) = v; }
+  virtual void add(std::size_t i, std::size_t j, double v) { get(i, j) += v; }
+
+  virtual double get(std::size_t i, std::size_t j) const {
+    const std::size_t n(p->find(i, j));
+    return n < values.size() ? values[n] : 0.0;
+  }
+
+  virtual double& get(std::size_t i, std::size_t j);
+
+  /*
+   *  Set the values from a sparse matrix, whose entries must be in the
+   *  pattern.
+   */
+  void assign(const sparse_matrix& m);
+
+  /*
+   *  this += alpha * x, where x has the same pattern.
+   */
+  void axpy(double alpha, const crs_matrix& x);
+  void scale(double alpha);
+
+  /*
+   *  Replace the rows by the rows of the identity.
+   */
+  template<typename T>
+  void set_identity_rows(const T& rows) {
+    for (const auto i: rows) {
+      std::fill(values.begin() + p->row[i], values.begin() + p->row[i + 1], 0.0);
+      set(i, i, 1.0);
+    }
+  }
+
+  array<double> multiply(const array<double>& x) const;
+
+  const std::shared_ptr<const pattern>& get_pattern() const { return p; }
+  const std::vector<double>& get_values() const { return values; }
+
+private:
+  std::shared_ptr<const pattern> p;
+  std::vector<double> values;
+};
+
+
 #endif /* SOLVER_H */
@@ -0,0 +1,177 @@
+#include "static_condensation.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <lapacke.h>
+
+#include "profiler.hpp"
+#include "scheduler.hpp"
+
+
+namespace {
+  const std::size_t no_cell(std::numeric_limits<std::size_t>::max());
+
+  /*
+   *  Elimination of the interior dofs of a cell, coupled to the dofs
+   *  "coupled" of the reduced system.
+   */
+  struct cell_block {
+    std::vector<unsigned int> coupled;
+
+    // A_II^-1 [A_IC f_I], n_interior rows of n_coupled + 1 columns
+    std::vector<double> elimination;
+
+    // A_CI A_II^-1 A_IC and A_CI A_II^-1 f_I
+    std::vector<double> schur, rhs;
+  };
+}
+
+
+bool static_condensation::solve(const sparse_matrix& a, const array<double>& f,
+                                const array<unsigned int>& interior_dofs,
+                                solver::basic_solver& s, array<double>& x, dictionary& report) {
+  const std::size_t n(a.get_row_number());
+  const std::size_t n_interior(interior_dofs.get_size(0) == 0 ? 0 : interior_dofs.get_size(1));
+  const std::size_t n_cell(n_interior == 0 ? 0 : interior_dofs.get_size(0));
+
+  if (a.get_column_number() != n)
+    throw std::string("static_condensation::solve: the matrix is not square");
+
+  /*
+   *  Number the dofs of the reduced system
+   */
+  std::vector<std::size_t> cell(n, no_cell), reduced(n, 0);
+  for (std::size_t k(0); k < n_cell; ++k)
+    for (std::size_t i(0); i < n_interior; ++i)
+      cell[interior_dofs.at(k, i)] = k;
+
+  std::size_t n_reduced(0);
+  for (std::size_t i(0); i < n; ++i)
+    if (cell[i] == no_cell)
+      reduced[i] = n_reduced++;
+
+  profiler::count("condensed_dofs", n - n_reduced);
+
+  sparse_matrix s_a(n_reduced, n_reduced);
+  array<double> g{n_reduced};
+  std::vector<cell_block> blocks(n_cell);
+  {
+    profiler::scope condensation_scope("static_condensation");
+
+    /*
+     *  Copy the entries of the reduced dofs, and find the dofs coupled
+     *  to the interior of each cell
+     */
+    for (const auto& v: a.get_values()) {
+      const std::size_t i(v.first.first), j(v.first.second);
+
+      if (cell[i] == no_cell and cell[j] == no_cell)
+        s_a.add(reduced[i], reduced[j], v.second);
+      else if (cell[i] == no_cell)
+        blocks[cell[j]].coupled.push_back(i);
+      else if (cell[j] == no_cell)
+        blocks[cell[i]].coupled.push_back(j);
+      else if (cell[i] != cell[j])
+        throw std::string("static_condensation::solve: interior dofs of different cells are coupled");
+    }
+
+    for (std::size_t i(0); i < n; ++i)
+      if (cell[i] == no_cell)
+        g.at(reduced[i]) = f.at(i);
+
+    /*
+     *  Eliminate the interior dofs of each cell
+     */
+    parallel::parallel_for(0, n_cell, [&](std::size_t k_begin, std::size_t k_end) {
+        for (std::size_t k(k_begin); k < k_end; ++k) {
+          cell_block& b(blocks[k]);
+          std::sort(b.coupled.begin(), b.coupled.end());
+          b.coupled.erase(std::unique(b.coupled.begin(), b.coupled.end()), b.coupled.end());
+
+          const std::size_t n_c(b.coupled.size()), n_col(n_c + 1);
+          std::vector<double> a_ii(n_interior * n_interior);
+          b.elimination.resize(n_interior * n_col);
+          for (std::size_t i(0); i < n_interior; ++i) {
+            const std::size_t d_i(interior_dofs.at(k, i));
+            for (std::size_t j(0); j < n_interior; ++j)
+              a_ii[i * n_interior + j] = a.get(d_i, interior_dofs.at(k, j));
+            for (std::size_t c(0); c < n_c; ++c)
+              b.elimination[i * n_col + c] = a.get(d_i, b.coupled[c]);
+            b.elimination[i * n_col + n_c] = f.at(d_i);
+          }
+
+          std::vector<lapack_int> pivots(n_interior);
+          const lapack_int info(LAPACKE_dgesv(LAPACK_ROW_MAJOR, n_interior, n_col,
+                                              a_ii.data(), n_interior, pivots.data(),
+                                              b.elimination.data(), n_col));
+          if (info != 0)
+            throw std::string("static_condensation::solve: singular interior block");
+
+          b.schur.assign(n_c * n_c, 0.0);
+          b.rhs.assign(n_c, 0.0);
+          for (std::size_t c(0); c < n_c; ++c)
+            for (std::size_t i(0); i < n_interior; ++i) {
+              const double a_ci(a.get(b.coupled[c], interior_dofs.at(k, i)));
+              if (a_ci == 0.0)
+                continue;
+              for (std::size_t e(0); e < n_c; ++e)
+                b.schur[c * n_c + e] += a_ci * b.elimination[i * n_col + e];
+              b.rhs[c] += a_ci * b.elimination[i * n_col + n_c];
+            }
+        }
+      });
+
+    // scatter in the cell order, as the assembly
+    for (const auto& b: blocks) {
+      const std::size_t n_c(b.coupled.size());
+      for (std::size_t c(0); c < n_c; ++c) {
+        for (std::size_t e(0); e < n_c; ++e)
+          if (b.schur[c * n_c + e] != 0.0)
+            s_a.add(reduced[b.coupled[c]], reduced[b.coupled[e]], -b.schur[c * n_c + e]);
+        g.at(reduced[b.coupled[c]]) -= b.rhs[c];
+      }
+    }
+  }
+
+  /*
+   *  Solve the reduced system
+   */
+  array<double> u{n_reduced};
+  u.fill(0.0);
+  {
+    profiler::count("nonzeros", s_a.get_nz_element_number());
+    {
+      profiler::scope setup_scope("solver_setup");
+      s.set_operator(s_a);
+    }
+    profiler::scope iterations_scope("solver_iterations");
+    if (not s.solve(g, u, report))
+      return false;
+  }
+
+  /*
+   *  Recover the interior values
+   */
+  profiler::scope recovery_scope("static_condensation_recovery");
+  for (std::size_t i(0); i < n; ++i)
+    if (cell[i] == no_cell)
+      x.at(i) = u.at(reduced[i]);
+
+  parallel::parallel_for(0, n_cell, [&](std::size_t k_begin, std::size_t k_end) {
+      for (std::size_t k(k_begin); k < k_end; ++k) {
+        const cell_block& b(blocks[k]);
+        const std::size_t n_c(b.coupled.size()), n_col(n_c + 1);
+        for (std::size_t i(0); i < n_interior; ++i) {
+          double u_i(b.elimination[i * n_col + n_c]);
+          for (std::size_t c(0); c < n_c; ++c)
+            u_i -= b.elimination[i * n_col + c] * u.at(reduced[b.coupled[c]]);
+          x.at(interior_dofs.at(k, i)) = u_i;
+        }
+      }
+    });
+
+  return true;
+}
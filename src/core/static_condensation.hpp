@@ -0,0 +1,36 @@
+#ifndef STATIC_CONDENSATION_H
+#define STATIC_CONDENSATION_H
+
+#include <spikes/array.hpp>
+
+#include "dictionary.hpp"
+#include "solver.hpp"
+
+
+/*
+ * Static condensation of the dofs of the cell interiors.
+ *
+ * A dof of the interior of a cell (a bubble) is only coupled to the dofs
+ * of its cell, so that the block A_II of the interior dofs is block
+ * diagonal, with one block per cell. With C the other dofs of the cell
+ * K, the interior dofs of K are eliminated by
+ *   S_CC -= A_CI A_II^-1 A_IC,    g_C -= A_CI A_II^-1 f_I,
+ * cell by cell, the reduced system S u = g is given to the solver, and
+ * the interior values are recovered cell by cell:
+ *   u_I = A_II^-1 (f_I - A_IC u_C).
+ * The result is the one of the full system, up to the solver tolerance,
+ * with fewer unknowns and nonzeros. The blocks A_II must be invertible
+ * (it is not the case for the P0 pressure of a mixed problem).
+ */
+namespace static_condensation {
+
+  /*
+   *  interior_dofs.at(k, n) is the n-th interior dof of the cell k.
+   *  Return the result of the solver.
+   */
+  bool solve(const sparse_matrix& a, const array<double>& f,
+	     const array<unsigned int>& interior_dofs,
+	     solver::basic_solver& s, array<double>& x, dictionary& report);
+}
+
+#endif /* STATIC_CONDENSATION_H */
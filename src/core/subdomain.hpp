@@ -31,6 +31,8 @@ namespace cell {
 	for (unsigned int i(0); i < fill; ++i)
 	  if (nodes[i] != s.nodes[i])
 	    return false;
+
+	return true;
       }
 
       bool operator<(const subdomain<n>& s) const {
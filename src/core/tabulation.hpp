@@ -0,0 +1,118 @@
+#ifndef TABULATION_H
+#define TABULATION_H
+
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+#include <spikes/array.hpp>
+
+
+/*
+ * Tables of the basis functions of a finite element on fixed sets of
+ * points of the reference cell.
+ *
+ * The quadrature rules and the finite elements have compile-time sizes,
+ * so each (finite element, point set) pair has a table of compile-time
+ * size, filled once on its first use. The assembly then copies values
+ * from the tables instead of evaluating the basis functions.
+ */
+namespace tabulation {
+
+  /*
+   *  The points of a quadrature of the cell: a single set.
+   */
+  template<typename quadrature_type>
+  struct cell_point_set {
+    typedef typename quadrature_type::cell_type cell_type;
+
+    static const std::size_t n_set = 1;
+    static const std::size_t n_point = quadrature_type::n_point;
+
+    static const array<double>& get_points(std::size_t /*s*/) {
+      static const array<double> x(make_points());
+      return x;
+    }
+
+  private:
+    static array<double> make_points() {
+      array<double> x{n_point, cell_type::n_dimension};
+      x.set_data(&quadrature_type::x[0][0]);
+      return x;
+    }
+  };
+
+  /*
+   *  The points of a quadrature of the subdomains of codimension 1 of
+   *  the cell, mapped on each of them: one set per subdomain.
+   */
+  template<typename parent_cell_type, typename quadrature_type>
+  struct subdomain_point_set {
+    typedef parent_cell_type cell_type;
+
+    static const std::size_t n_set = cell_type::n_subdomain_of_type[cell_type::n_subdomain_type - 2];
+    static const std::size_t n_point = quadrature_type::n_point;
+
+    static const array<double>& get_points(std::size_t s) {
+      static const std::vector<array<double> > x(make_points());
+      return x[s];
+    }
+
+  private:
+    static std::vector<array<double> > make_points() {
+      array<double> xq{n_point, quadrature_type::n_point_space_dimension};
+      xq.set_data(&quadrature_type::x[0][0]);
+
+      std::vector<array<double> > x;
+      for (std::size_t s(0); s < n_set; ++s)
+	x.push_back(cell_type::map_points_to_subdomain(s, xq));
+      return x;
+    }
+  };
+
+
+  /*
+   *  get(s)[(q * n_dof + i) * (n_dimension + 1) + d] is the value (d = 0)
+   *  or the reference derivative d - 1 of the basis function i on the
+   *  point q of the set s.
+   */
+  template<typename fe_type, typename point_set_type>
+  class table {
+  public:
+    static const std::size_t n_dimension = fe_type::cell_type::n_dimension;
+    static const std::size_t n_dof = fe_type::n_dof_per_element;
+    static const std::size_t n_set = point_set_type::n_set;
+    static const std::size_t n_point = point_set_type::n_point;
+    static const std::size_t set_size = n_point * n_dof * (n_dimension + 1);
+
+    static const double* get(std::size_t s) {
+      static_assert(std::is_same<typename fe_type::cell_type, typename point_set_type::cell_type>::value,
+		    "the point set is not on the cell of the finite element");
+      return &instance().values[s][0][0][0];
+    }
+
+  private:
+    struct data {
+      double values[n_set][n_point][n_dof][n_dimension + 1];
+
+      data() {
+	for (std::size_t s(0); s < n_set; ++s) {
+	  const array<double>& x(point_set_type::get_points(s));
+	  for (std::size_t q(0); q < n_point; ++q)
+	    for (std::size_t i(0); i < n_dof; ++i) {
+	      values[s][q][i][0] = fe_type::phi(i, &x.at(q, 0));
+	      for (std::size_t d(0); d < n_dimension; ++d)
+		values[s][q][i][1 + d] = fe_type::dphi(d, i, &x.at(q, 0));
+	    }
+	}
+      }
+    };
+
+    static const data& instance() {
+      static const data d;
+      return d;
+    }
+  };
+}
+
+#endif /* TABULATION_H */
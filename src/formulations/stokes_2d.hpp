@@ -20,6 +20,9 @@
  *
  *  The dirichlet boundary is taken as the entire boundary
  *  of the domain m.
+ *
+ *  The dofs of the cell interiors (the velocity bubbles) are
+ *  condensed before the solve.
  */
 
 
@@ -54,6 +57,9 @@ public:
     
     fes.template add_dirichlet_boundary<2>(pressure_point_m, 0.0);
     a.clear();
+
+    // the velocity bubbles are eliminated from the solved system
+    a.set_static_condensation(true);
     
     // The dirichlet dof must be known when assembling the system.
     // The values are relevent only when solving, though.
@@ -23,10 +23,14 @@ public:
 			       double delta_t, double diffusivity)
     : delta_t(delta_t), diffusivity(diffusivity),
       m(m), dm(dm), fes(m, dm), p0_fes(m),
-      a(fes, fes), f(fes),
+      mass(fes, fes), f(fes),
+      operators(fes.get_dof_number(), fes.get_dof_number()),
+      a(operators.get_pattern()),
       solution(fes),
       bk_norm(p0_fes), h(build_element_diameter_function<cell_type>(m, p0_fes)),
-      b_0(null_function), b_1(null_function), src(null_function) {}
+      b_0(null_function), b_1(null_function), src(null_function) {
+    assemble_mass();
+  }
 
   unsteady_advection_diffusion(const fe_mesh<cell_type>& m, double delta_t, double diffusivity)
     : unsteady_advection_diffusion(m, submesh<cell_type>(m), delta_t, diffusivity) {}
@@ -82,7 +86,7 @@ public:
     solver::petsc::gmres_ilu s(p);
     
     std::cerr << "assemble_linear_form(): " << t.tic() << std::endl;
-    solution = a.solve(f, s);
+    solution = mass.solve(a, f, s);
     std::cerr << "bilinear_form::solve(f): " << t.tic() << std::endl;
   }
 
@@ -102,9 +106,13 @@ private:
   fes_type fes;
   finite_element_space<cell::triangle::fe::lagrange_p0> p0_fes;
 
-  bilinear_form<fes_type, fes_type> a;
+  // the mass form also provides the dirichlet conditions to the solve
+  bilinear_form<fes_type, fes_type> mass;
   linear_form<fes_type> f;
 
+  operator_cache operators;
+  crs_matrix a;
+
   element_type solution;
   finite_element_space<cell::triangle::fe::lagrange_p0>::element bk_norm;
   finite_element_space<cell::triangle::fe::lagrange_p0>::element h;
@@ -122,27 +130,53 @@ private:
   static double null_function(const double* x) { return 0.0; }
   static double inv(double x) { return 1.0 / x; }
   
+  /*
+   *  The mass matrix does not depend on the velocity: it is assembled
+   *  once. Its rows of the dirichlet dofs are replaced in the operator
+   *  of the steps and in the right hand side.
+   */
+  void assemble_mass() {
+    const auto u(mass.get_trial_function());
+    const auto v(mass.get_test_function());
+
+    mass += integrate<volume_quadrature_type>(u * v, m);
+    operators.store("mass", mass.get_operator());
+  }
+
+  /*
+   *  The terms which depend on the velocity are assembled in separate
+   *  matrices, and combined with the mass in the operator of the steps.
+   */
   void assemble_bilinear_form() {
-    a.clear();
+    bilinear_form<fes_type, fes_type> b(fes, fes);
+    operator_cache::term_list terms;
     
-    const auto u(a.get_trial_function());
-    const auto v(a.get_test_function());
+    const auto u(b.get_trial_function());
+    const auto v(b.get_test_function());
 
+    operators.set_identity_rows(fes.get_dirichlet_dof_values());
 
     if (assemble_time_derivative)
-      a += integrate<volume_quadrature_type>((1.0 / delta_t) * u * v, m);
+      terms.push_back(std::make_pair("mass", 1.0 / delta_t));
     
-    if (assemble_advection_diffusion)
-      a += integrate<volume_quadrature_type>(diffusivity * (d<1>(u) * d<1>(v) + d<2>(u) * d<2>(v)) +
+    if (assemble_advection_diffusion) {
+      b.clear();
+      b += integrate<volume_quadrature_type>(diffusivity * (d<1>(u) * d<1>(v) + d<2>(u) * d<2>(v)) +
 					     make_expr(b_0) * d<1>(u) * v +
 					     make_expr(b_1) * d<2>(u) * v
 					     , m);
+      operators.store("advection_diffusion", b.get_operator());
+      terms.push_back(std::make_pair("advection_diffusion", 1.0));
+    }
     
     if (diffusion_stabilisation) {
-      a += integrate<volume_quadrature_type>(make_expr<cell::triangle::fe::lagrange_p0>(h) *
+      b.clear();
+      b += integrate<volume_quadrature_type>(make_expr<cell::triangle::fe::lagrange_p0>(h) *
 					     make_expr<cell::triangle::fe::lagrange_p0>(bk_norm) * 
 					     (d<1>(u) * d<1>(v) + d<2>(u) * d<2>(v))
 					     , m);
+      operators.store("diffusion_stabilisation", b.get_operator());
+      terms.push_back(std::make_pair("diffusion_stabilisation", 1.0));
     }
 
     if (supg_stabilisation) {
@@ -150,14 +184,19 @@ private:
 	throw std::string("unsteady advection diffusion 2d:"
 			  " supg stabilisation is not available for non piece wise linear finite elements");
       
-      a += integrate<volume_quadrature_type>(//delta_t *
+      b.clear();
+      b += integrate<volume_quadrature_type>(//delta_t *
 					     supg_delta *
 					     compose(inv, make_expr<cell::triangle::fe::lagrange_p0>(bk_norm)) *
 					     make_expr<cell::triangle::fe::lagrange_p0>(h) *
 					     ((1.0 / delta_t) * u + make_expr(b_0) * d<1>(u) + make_expr(b_1) * d<2>(u)) *
 					     (make_expr(b_0) * d<1>(v) + make_expr(b_1) * d<2>(v))
 					     , m);
+      operators.store("supg", b.get_operator());
+      terms.push_back(std::make_pair("supg", 1.0));
     }
+
+    operators.combine(terms, a);
   }
 
   void assemble_linear_form() {
@@ -167,7 +206,7 @@ private:
 
     
     if (assemble_time_derivative)
-      f += integrate<volume_quadrature_type>((1.0 / delta_t) * make_expr<fe_type>(solution) * v, m);
+      f.axpy(1.0 / delta_t, operators.get("mass").multiply(solution.get_coefficients()));
 
     if (assemble_source)
       f += integrate<volume_quadrature_type>(make_expr(src) * v, m);
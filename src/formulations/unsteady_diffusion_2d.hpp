@@ -18,7 +18,9 @@ public:
 			double delta_t, double diffusivity)
     : delta_t(delta_t), diffusivity(diffusivity),
       m(m), dm(m.get_boundary_submesh()),
-      fes(m, dm), a(fes, fes), f(fes),
+      fes(m, dm), l2(fes), mass(fes, fes), f(fes),
+      operators(fes.get_dof_number(), fes.get_dof_number()),
+      a(operators.get_pattern()),
       source(fes), solution(fes) {
     assemble_bilinear_form();
   }
@@ -28,7 +30,9 @@ public:
 			double delta_t, double diffusivity)
     : delta_t(delta_t), diffusivity(diffusivity),
       m(m), dm(dm),
-      fes(m, dm), a(fes, fes), f(fes),
+      fes(m, dm), l2(fes), mass(fes, fes), f(fes),
+      operators(fes.get_dof_number(), fes.get_dof_number()),
+      a(operators.get_pattern()),
       source(fes), solution(fes) {
     assemble_bilinear_form();
   }
@@ -38,11 +42,11 @@ public:
   }
 
   void set_initial_condition(double (*ic)(const double* )) {
-    solution = projector::l2<fe_type, volume_quadrature_type>(ic, fes);
+    solution = l2(ic);
   }
 
   void set_source(const std::function<double(const double*)>& src) {
-    source = projector::l2<fe_type, volume_quadrature_type>(src, fes);
+    source = l2(src);
   }
 
   void step() {
@@ -57,7 +61,7 @@ public:
                  .set("ilufill", 2u));
     solver::petsc::gmres_ilu s(p);
     
-    solution = a.solve(f, s);
+    solution = mass.solve(a, f, s);
   }
 
   const element_type& get_solution() const {
@@ -70,10 +74,15 @@ private:
   const fe_mesh<cell_type>& m;
   const submesh<cell_type>& dm;
   fes_type fes;
+  projector::l2_projector<fe_type, volume_quadrature_type> l2;
 
-  bilinear_form<fes_type, fes_type> a;
+  // the mass form also provides the dirichlet conditions to the solve
+  bilinear_form<fes_type, fes_type> mass;
   linear_form<fes_type> f;
 
+  operator_cache operators;
+  crs_matrix a;
+
   static const bool assemble_time_derivative = true;
   static const bool assemble_laplacian = true;
   static const bool assemble_source = true;
@@ -83,31 +92,54 @@ private:
   element_type solution;
 
 private:
+  /*
+   *  The mass and stiffness matrices are assembled once, and combined in
+   *  the operator M / dt + K.
+   */
   void assemble_bilinear_form() {
-    a.clear();
+    bilinear_form<fes_type, fes_type> stiffness(fes, fes);
+    mass.clear();
+    stiffness.clear();
     
-    const auto u(a.get_trial_function());
-    const auto v(a.get_test_function());
+    const auto u(mass.get_trial_function());
+    const auto v(mass.get_test_function());
 
-    if (assemble_time_derivative)
-      a += integrate<volume_quadrature_type>((1.0 / delta_t) * u * v, m);
+    mass += integrate<volume_quadrature_type>(u * v, m);
+
+    if (assemble_laplacian)
+      stiffness += integrate<volume_quadrature_type>(diffusivity * (d<1>(u) * d<1>(v)
+								    + d<2>(u) * d<2>(v)),
+						     m);
 
+    operators.set_identity_rows(fes.get_dirichlet_dof_values());
+    operators.store("mass", mass.get_operator());
+    operators.store("stiffness", stiffness.get_operator());
+
+    operator_cache::term_list terms;
+    if (assemble_time_derivative)
+      terms.push_back(std::make_pair("mass", 1.0 / delta_t));
     if (assemble_laplacian)
-      a += integrate<volume_quadrature_type>(diffusivity * (d<1>(u) * d<1>(v)
-							    + d<2>(u) * d<2>(v)),
-					     m);
+      terms.push_back(std::make_pair("stiffness", 1.0));
+    operators.combine(terms, a);
   }
 
+  /*
+   *  The solution and the source are in the finite element space: their
+   *  forms are M (u / dt + s), computed with the cached mass matrix.
+   */
   void assemble_linear_form() {
     f.clear();
 
-    const auto v(f.get_test_function());
-
-    if (assemble_time_derivative)
-      f += integrate<volume_quadrature_type>((1.0 / delta_t) * make_expr<fe_type>(solution) * v, m);
+    array<double> x{fes.get_dof_number()};
+    x.fill(0.0);
+    for (std::size_t j(0); j < fes.get_dof_number(); ++j) {
+      if (assemble_time_derivative)
+	x.at(j) += solution.get_coefficients().at(j) / delta_t;
+      if (assemble_source)
+	x.at(j) += source.get_coefficients().at(j);
+    }
 
-    if (assemble_source)
-      f += integrate<volume_quadrature_type>(make_expr<fe_type>(source) * v, m);
+    f.axpy(1.0, operators.get("mass").multiply(x));
   }
 };
 
@@ -27,6 +27,18 @@
 #include "core/quadrature.hpp"
 #include "core/mesh_data.hpp"
 #include "core/operator.hpp"
+#include "core/profiler.hpp"
+#include "core/scheduler.hpp"
+#include "core/distributed.hpp"
+#include "core/partition.hpp"
+#include "core/reference_tensor.hpp"
+#include "core/operator_cache.hpp"
+#include "core/static_condensation.hpp"
+#include "core/tabulation.hpp"
+#include "core/fused_assembly.hpp"
+#include "core/newton.hpp"
+#include "core/small_tensor.hpp"
+#include "core/probe.hpp"
 
 
 #endif /* _TFEL_H_ */
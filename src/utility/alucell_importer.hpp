@@ -10,56 +10,118 @@
 
 namespace importer {
   namespace alucell {
+
+    /*
+     * Import session, which keeps the database and its index open
+     * across several mesh and variable imports. Arrays are read with
+     * a single bulk get_data and moved into the fe_mesh and mesh_data.
+     */
+    class database {
+    public:
+      database(const std::string& db_filename)
+	: db(db_filename), index(&db) {}
+
+      database(const database&) = delete;
+      database& operator=(const database&) = delete;
+
+      template<typename cell_type>
+      fe_mesh<cell_type> mesh(const std::string& mesh_name) {
+	const unsigned int
+	  mesh_nodes_id(index.get_variable_id(mesh_name + "_nodes")),
+	  mesh_elems_id(index.get_variable_id(mesh_name + "_elems")),
+	  mesh_refs_id(index.get_variable_id(mesh_name + "_refs"));
+
+	if (db.get_variable_type(mesh_nodes_id) != ::alucell::data_type::real_array
+	    or db.get_variable_type(mesh_elems_id) != ::alucell::data_type::element_array
+	    or db.get_variable_type(mesh_refs_id) != ::alucell::data_type::int_array)
+	  throw std::string("importer::alucell::mesh: incompatible variable type");
+
+	::alucell::variable::array<double> n(&db, mesh_nodes_id);
+	::alucell::variable::array<int> e(&db, mesh_elems_id);
+	::alucell::variable::array<int> r(&db, mesh_refs_id);
+
+	if (n.get_components() != 3)
+	  throw std::string("importer::alucell::mesh: the nodes array is expected to have 3 components");
+
+	if (e.get_components() != cell_type::n_vertex_per_cell)
+	  throw std::string("importer::alucell::mesh: the element array is expected to have the same "
+			    "number of components as the number of vertices per element.");
+
+	if (r.get_components() != 1)
+	  throw std::string("importer::alucell::mesh: the reference array is expected to have 1 component");
+
+	if (r.get_size() != e.get_size())
+	  throw std::string("importer::alucell::mesh: the reference and element arrays have different sizes");
+
+	array<double> nodes{n.get_size(), 3};
+	if (n.get_size())
+	  n.get_data(nodes.get_data());
+
+	// The int and unsigned int representations agree on the
+	// (positive) ids stored in the database.
+	array<unsigned int> elements{e.get_size(), e.get_components()};
+	array<unsigned int> references{r.get_size()};
+	if (e.get_size()) {
+	  e.get_data(reinterpret_cast<int*>(elements.get_data()));
+	  r.get_data(reinterpret_cast<int*>(references.get_data()));
+	}
+
+	unsigned int* const first(elements.get_data());
+	unsigned int* const last(first + elements.get_size(0) * elements.get_size(1));
+	for (unsigned int* id(first); id != last; ++id)
+	  *id -= 1;
+
+	return ::fe_mesh<cell_type>(to_space_dimension(std::move(nodes), cell_type::n_dimension),
+				    std::move(elements), std::move(references));
+      }
+
+      template<typename cell_type>
+      mesh_data<double, ::fe_mesh<cell_type> > variable(const std::string& mesh_name,
+							const std::string& var_name,
+							const ::fe_mesh<cell_type>& m) {
+	const unsigned int
+	  variable_id(index.get_variable_id(mesh_name + "_" + var_name));
+
+	if (db.get_variable_type(variable_id) != ::alucell::data_type::real_array)
+	  throw std::string("importer::alucell::variable: only real variables are supported");
+
+	::alucell::variable::array<double> v(&db, variable_id);
+
+	array<double> coefficients{v.get_size(), v.get_components()};
+	if (v.get_size())
+	  v.get_data(coefficients.get_data());
+
+	using mesh_data_type = mesh_data<double, ::fe_mesh<cell_type> >;
+	if (coefficients.get_size(0) == m.get_vertex_number())
+	  return mesh_data_type(m, mesh_data_kind::vertex, std::move(coefficients));
+	else if (coefficients.get_size(0) == m.get_cell_number())
+	  return mesh_data_type(m, mesh_data_kind::cell, std::move(coefficients));
+	else
+	  throw std::string("importer::alucell::variable: incompatible array size");
+      }
+
+    private:
+      ::alucell::database_read_access db;
+      ::alucell::database_index index;
+
+    private:
+      static array<double> to_space_dimension(array<double>&& nodes, std::size_t n_dimension) {
+	if (n_dimension == nodes.get_size(1))
+	  return std::move(nodes);
+
+	array<double> vertices{nodes.get_size(0), n_dimension};
+	for (std::size_t i(0); i < vertices.get_size(0); ++i)
+	  for (std::size_t j(0); j < n_dimension; ++j)
+	    vertices.at(i, j) = nodes.at(i, j);
+	return vertices;
+      }
+    };
+
+
     template<typename cell_type>
     fe_mesh<cell_type> mesh(const std::string& db_filename,
                             const std::string& mesh_name) {
-      ::alucell::database_read_access db(db_filename);
-      ::alucell::database_index index(&db);
-
-      const unsigned int
-	mesh_nodes_id(index.get_variable_id(mesh_name + "_nodes")),
-	mesh_elems_id(index.get_variable_id(mesh_name + "_elems")),
-	mesh_refs_id(index.get_variable_id(mesh_name + "_refs"));
-      
-      if (db.get_variable_type(mesh_nodes_id) != ::alucell::data_type::real_array
-	  or db.get_variable_type(mesh_elems_id) != ::alucell::data_type::element_array
-	  or db.get_variable_type(mesh_refs_id) != ::alucell::data_type::int_array)
-	throw std::string("importer::alucell::mesh: incompatible variable type");
-
-      ::alucell::variable::array<double> n(&db, mesh_nodes_id);
-      ::alucell::variable::array<int> e(&db, mesh_elems_id);
-      ::alucell::variable::array<int> r(&db, mesh_refs_id);
-
-      if (n.get_components() != 3)
-	throw std::string("importer::alucell::mesh: the nodes array is expected to have 3 components");
-
-      if (e.get_components() != cell_type::n_vertex_per_cell)
-	throw std::string("importer::alucell::mesh: the element array is expected to have the same "
-			  "number of components as the number of vertices per element.");
-
-      if (r.get_components() != 1)
-	throw std::string();
-
-      if (r.get_size() != e.get_size())
-	throw std::string();
-	  
-      array<double> vertices{n.get_size(), cell_type::n_dimension};
-      array<unsigned int> elements{e.get_size(), e.get_components()};
-      array<unsigned int> references{e.get_size()};
-
-      for (unsigned int i(0); i < vertices.get_size(0); ++i)
-	for (unsigned int j(0); j < vertices.get_size(1); ++j)
-	  vertices.at(i, j) = n.get_value(i, j);
-      
-      for (unsigned int i(0); i < elements.get_size(0); ++i) {
-	references.at(i) = r.get_value(i, 0);
-	for (unsigned int j(0); j < elements.get_size(1); ++j) 
-	  elements.at(i, j) = e.get_value(i, j) - 1;
-      }
-      
-      return ::fe_mesh<cell_type>(&vertices.at(0,0), vertices.get_size(0), vertices.get_size(1),
-			       &elements.at(0,0), elements.get_size(0),
-			       &references.at(0));
+      return database(db_filename).mesh<cell_type>(mesh_name);
     }
 
     template<typename cell_type>
@@ -67,27 +129,7 @@ namespace importer {
                                                       const std::string& mesh_name,
                                                       const std::string& var_name,
                                                       const ::fe_mesh<cell_type>& m) {
-      ::alucell::database_read_access db(db_filename);
-      ::alucell::database_index index(&db);
-
-      const unsigned int
-	variable_id(index.get_variable_id(mesh_name + "_" + var_name));
-
-      if (db.get_variable_type(variable_id) != ::alucell::data_type::real_array)
-	throw std::string("importer::alucell::variable: only real variables are supported");
-
-      ::alucell::variable::array<double> v(&db, variable_id);
-
-      array<double> coefficients{v.get_size(), v.get_components()};
-      v.get_data(&coefficients.at(0, 0));
-
-      using mesh_data_type = mesh_data<double, ::fe_mesh<cell_type> >;
-      if (coefficients.get_size(0) == m.get_vertex_number())
-	return mesh_data<double, ::fe_mesh<cell_type> >(m, mesh_data_kind::vertex, std::move(coefficients));
-      else if (coefficients.get_size(0) == m.get_cell_number())
-	return mesh_data<double, ::fe_mesh<cell_type> >(m, mesh_data_kind::cell, std::move(coefficients));
-      else
-	throw std::string("incompatible array size");
+      return database(db_filename).variable<cell_type>(mesh_name, var_name, m);
     }
   }
 }
@@ -0,0 +1,656 @@
+#ifndef GMSH_IMPORTER_H
+#define GMSH_IMPORTER_H
+
+
+#include <cstdio>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <algorithm>
+
+#include "../core/cell.hpp"
+#include "../core/mesh.hpp"
+#include "../core/meta.hpp"
+
+namespace importer {
+  namespace gmsh {
+    namespace detail {
+
+      /*
+       * Buffered reader over a Gmsh file, which reads either ascii
+       * tokens or raw binary values without going through the
+       * iostream machinery.
+       */
+      class stream_reader {
+      public:
+	stream_reader(const std::string& filename)
+	  : file(std::fopen(filename.c_str(), "rb")),
+	    buffer(buffer_size + 1, '\0'),
+	    begin(0), end(0), binary(false) {
+	  if (not file)
+	    throw std::string("importer::gmsh: failed to open ") + filename;
+	}
+
+	stream_reader(const stream_reader&) = delete;
+	stream_reader& operator=(const stream_reader&) = delete;
+
+	~stream_reader() {
+	  std::fclose(file);
+	}
+
+	void set_binary(bool b) { binary = b; }
+
+	bool get_section(std::string& name) {
+	  skip_whitespace();
+	  if (begin == end)
+	    return false;
+	  name = get_line();
+	  return true;
+	}
+
+	std::string get_line() {
+	  std::string line;
+	  while (fill(1)) {
+	    const char* first(&buffer[begin]);
+	    const char* last(static_cast<const char*>(std::memchr(first, '\n', end - begin)));
+	    if (last) {
+	      line.append(first, last);
+	      begin += last - first + 1;
+	      break;
+	    }
+	    line.append(first, end - begin);
+	    begin = end;
+	  }
+	  if (not line.empty() and line.back() == '\r')
+	    line.pop_back();
+	  return line;
+	}
+
+	int get_int() {
+	  if (binary) {
+	    int value;
+	    get_binary(&value, 1);
+	    return value;
+	  }
+
+	  skip_whitespace();
+	  fill(max_token_size);
+	  const bool negative(buffer[begin] == '-');
+	  if (negative)
+	    ++begin;
+	  const long value(parse_unsigned());
+	  return negative ? -value : value;
+	}
+
+	std::size_t get_size() {
+	  if (binary) {
+	    std::size_t value;
+	    get_binary(&value, 1);
+	    return value;
+	  }
+
+	  skip_whitespace();
+	  fill(max_token_size);
+	  return parse_unsigned();
+	}
+
+	double get_double() {
+	  if (binary) {
+	    double value;
+	    get_binary(&value, 1);
+	    return value;
+	  }
+
+	  skip_whitespace();
+	  fill(max_token_size);
+	  char* token_end(nullptr);
+	  const double value(std::strtod(&buffer[begin], &token_end));
+	  if (token_end == &buffer[begin])
+	    throw std::string("importer::gmsh: expected a floating point value");
+	  begin = token_end - &buffer[0];
+	  return value;
+	}
+
+	void get_sizes(std::size_t* values, std::size_t n) {
+	  if (binary)
+	    get_binary(values, n);
+	  else
+	    for (std::size_t i(0); i < n; ++i)
+	      values[i] = get_size();
+	}
+
+	void get_doubles(double* values, std::size_t n) {
+	  if (binary)
+	    get_binary(values, n);
+	  else
+	    for (std::size_t i(0); i < n; ++i)
+	      values[i] = get_double();
+	}
+
+	template<typename T>
+	void get_binary(T* values, std::size_t n) {
+	  char* dst(reinterpret_cast<char*>(values));
+	  std::size_t n_byte(n * sizeof(T));
+
+	  const std::size_t buffered(std::min(n_byte, end - begin));
+	  std::memcpy(dst, &buffer[begin], buffered);
+	  begin += buffered;
+	  dst += buffered;
+	  n_byte -= buffered;
+
+	  // Large blocks bypass the buffer.
+	  if (n_byte > buffer_size) {
+	    if (std::fread(dst, 1, n_byte, file) != n_byte)
+	      throw std::string("importer::gmsh: unexpected end of file");
+	    return;
+	  }
+
+	  if (n_byte) {
+	    if (not fill(n_byte))
+	      throw std::string("importer::gmsh: unexpected end of file");
+	    std::memcpy(dst, &buffer[begin], n_byte);
+	    begin += n_byte;
+	  }
+	}
+
+	void expect_section_end(const std::string& name) {
+	  std::string line;
+	  if (not get_section(line) or line != "$End" + name)
+	    throw std::string("importer::gmsh: expected $End") + name;
+	}
+
+	void skip_section(const std::string& name) {
+	  std::string line;
+	  while (get_section(line))
+	    if (line == "$End" + name)
+	      return;
+	  throw std::string("importer::gmsh: unterminated section ") + name;
+	}
+
+      private:
+	static const std::size_t buffer_size = 1ul << 22;
+	static const std::size_t max_token_size = 64;
+
+	std::FILE* file;
+	std::vector<char> buffer;
+	std::size_t begin, end;
+	bool binary;
+
+      private:
+	bool fill(std::size_t n) {
+	  if (end - begin >= n)
+	    return true;
+
+	  std::memmove(&buffer[0], &buffer[begin], end - begin);
+	  end -= begin;
+	  begin = 0;
+	  end += std::fread(&buffer[end], 1, buffer_size - end, file);
+	  buffer[end] = '\0';
+
+	  return end - begin >= n;
+	}
+
+	void skip_whitespace() {
+	  while (fill(1)) {
+	    while (begin < end and std::isspace(static_cast<unsigned char>(buffer[begin])))
+	      ++begin;
+	    if (begin < end)
+	      return;
+	  }
+	}
+
+	std::size_t parse_unsigned() {
+	  if (buffer[begin] < '0' or buffer[begin] > '9')
+	    throw std::string("importer::gmsh: expected an integer value");
+
+	  std::size_t value(0);
+	  while (buffer[begin] >= '0' and buffer[begin] <= '9')
+	    value = 10 * value + (buffer[begin++] - '0');
+	  return value;
+	}
+      };
+
+
+      inline
+      std::size_t element_node_number(int element_type) {
+	switch (element_type) {
+	case 1: return 2;
+	case 2: return 3;
+	case 3: return 4;
+	case 4: return 4;
+	case 5: return 8;
+	case 6: return 6;
+	case 7: return 5;
+	case 8: return 3;
+	case 9: return 6;
+	case 10: return 9;
+	case 11: return 10;
+	case 15: return 1;
+	}
+	throw std::string("importer::gmsh: unsupported element type");
+      }
+
+      template<typename cell_type>
+      struct element_type {
+      private:
+	using cell_list = type_list<cell::point, cell::edge, cell::triangle, cell::tetrahedron>;
+	static constexpr int values[] = {15, 1, 2, 4};
+      public:
+	static constexpr int value = values[get_index_of_element<cell_type, cell_list>::value];
+      };
+
+
+      /*
+       * Maps the (possibly sparse) Gmsh node tags to contiguous
+       * indices.
+       */
+      class node_index {
+      public:
+	void reset(std::size_t min_tag, std::size_t max_tag, std::size_t n_node) {
+	  offset = min_tag;
+	  dense = max_tag - min_tag < 4 * n_node + 1;
+	  if (dense)
+	    dense_index.assign(max_tag - min_tag + 1, invalid());
+	  else
+	    sparse_index.reserve(n_node);
+	}
+
+	void insert(std::size_t tag, unsigned int id) {
+	  if (dense)
+	    dense_index.at(tag - offset) = id;
+	  else
+	    sparse_index[tag] = id;
+	}
+
+	unsigned int at(std::size_t tag) const {
+	  if (dense) {
+	    if (tag < offset or tag - offset >= dense_index.size() or dense_index[tag - offset] == invalid())
+	      throw std::string("importer::gmsh: reference to an undefined node");
+	    return dense_index[tag - offset];
+	  }
+
+	  const auto it(sparse_index.find(tag));
+	  if (it == sparse_index.end())
+	    throw std::string("importer::gmsh: reference to an undefined node");
+	  return it->second;
+	}
+
+      private:
+	static unsigned int invalid() { return static_cast<unsigned int>(-1); }
+
+	std::size_t offset;
+	bool dense;
+	std::vector<unsigned int> dense_index;
+	std::unordered_map<std::size_t, unsigned int> sparse_index;
+      };
+
+
+      struct msh_content {
+	std::size_t n_dimension;
+	std::vector<double> vertices;
+	std::vector<unsigned int> cells, cell_references;
+	std::vector<unsigned int> facets, facet_references;
+	std::map<std::string, unsigned int> physical_names;
+      };
+
+
+      inline
+      void read_physical_names(stream_reader& reader, msh_content& content) {
+	const std::size_t n(std::atol(reader.get_line().c_str()));
+	for (std::size_t i(0); i < n; ++i) {
+	  std::istringstream line(reader.get_line());
+	  int dim;
+	  unsigned int tag;
+	  std::string name;
+	  line >> dim >> tag >> std::ws;
+	  std::getline(line, name);
+	  if (name.size() >= 2 and name.front() == '"' and name.back() == '"')
+	    name = name.substr(1, name.size() - 2);
+	  content.physical_names[name] = tag;
+	}
+	reader.expect_section_end("PhysicalNames");
+      }
+
+      /*
+       * Returns, for each entity dimension, the map from the entity
+       * tag to its first physical tag.
+       */
+      inline
+      void read_entities(stream_reader& reader,
+			 std::vector<std::map<int, unsigned int> >& physical_tags) {
+	std::size_t n_entity[4];
+	reader.get_sizes(n_entity, 4);
+
+	for (std::size_t dim(0); dim < 4; ++dim) {
+	  for (std::size_t i(0); i < n_entity[dim]; ++i) {
+	    const int tag(reader.get_int());
+
+	    double box[6];
+	    reader.get_doubles(box, dim == 0 ? 3 : 6);
+
+	    const std::size_t n_physical(reader.get_size());
+	    for (std::size_t p(0); p < n_physical; ++p) {
+	      const int physical(reader.get_int());
+	      if (p == 0)
+		physical_tags[dim][tag] = std::abs(physical);
+	    }
+
+	    if (dim > 0) {
+	      const std::size_t n_bounding(reader.get_size());
+	      for (std::size_t b(0); b < n_bounding; ++b)
+		reader.get_int();
+	    }
+	  }
+	}
+	reader.expect_section_end("Entities");
+      }
+
+      inline
+      void read_nodes(stream_reader& reader, msh_content& content, node_index& index) {
+	std::size_t header[4];
+	reader.get_sizes(header, 4);
+	const std::size_t n_block(header[0]), n_node(header[1]);
+
+	index.reset(header[2], header[3], n_node);
+	content.vertices.resize(3 * n_node);
+
+	std::vector<std::size_t> tags;
+	std::vector<double> coordinates;
+	for (std::size_t b(0), id(0); b < n_block; ++b) {
+	  const int dim(reader.get_int());
+	  reader.get_int();
+	  const bool parametric(reader.get_int());
+	  const std::size_t n(reader.get_size());
+
+	  tags.resize(n);
+	  reader.get_sizes(&tags[0], n);
+
+	  const std::size_t n_coordinate(3 + (parametric ? dim : 0));
+	  if (n_coordinate == 3)
+	    reader.get_doubles(&content.vertices[3 * id], 3 * n);
+	  else {
+	    coordinates.resize(n_coordinate * n);
+	    reader.get_doubles(&coordinates[0], coordinates.size());
+	    for (std::size_t k(0); k < n; ++k)
+	      std::copy(&coordinates[n_coordinate * k], &coordinates[n_coordinate * k] + 3,
+			&content.vertices[3 * (id + k)]);
+	  }
+
+	  for (std::size_t k(0); k < n; ++k)
+	    index.insert(tags[k], id + k);
+	  id += n;
+	}
+	reader.expect_section_end("Nodes");
+      }
+
+      template<typename cell_type>
+      void read_elements(stream_reader& reader, msh_content& content,
+			 const node_index& index,
+			 const std::vector<std::map<int, unsigned int> >& physical_tags) {
+	using boundary_cell_type = typename cell_type::boundary_cell_type;
+
+	std::size_t header[4];
+	reader.get_sizes(header, 4);
+	const std::size_t n_block(header[0]);
+
+	std::vector<std::size_t> data;
+	for (std::size_t b(0); b < n_block; ++b) {
+	  const int dim(reader.get_int());
+	  const int tag(reader.get_int());
+	  const int type(reader.get_int());
+	  const std::size_t n(reader.get_size());
+
+	  const std::size_t n_node(element_node_number(type));
+	  data.resize((n_node + 1) * n);
+	  if (not data.empty())
+	    reader.get_sizes(&data[0], data.size());
+
+	  std::vector<unsigned int>* elements(nullptr);
+	  std::vector<unsigned int>* references(nullptr);
+	  if (dim == static_cast<int>(cell_type::n_dimension) and type == element_type<cell_type>::value) {
+	    elements = &content.cells;
+	    references = &content.cell_references;
+	  } else if (dim + 1 == static_cast<int>(cell_type::n_dimension) and type == element_type<boundary_cell_type>::value) {
+	    elements = &content.facets;
+	    references = &content.facet_references;
+	  } else
+	    continue;
+
+	  const auto physical(physical_tags[dim].find(tag));
+	  const unsigned int reference(physical == physical_tags[dim].end() ? 0 : physical->second);
+
+	  elements->reserve(elements->size() + n * n_node);
+	  for (std::size_t k(0); k < n; ++k) {
+	    for (std::size_t i(0); i < n_node; ++i)
+	      elements->push_back(index.at(data[(n_node + 1) * k + 1 + i]));
+	    std::sort(elements->end() - n_node, elements->end());
+	  }
+	  references->insert(references->end(), n, reference);
+	}
+	reader.expect_section_end("Elements");
+      }
+
+      /*
+       * Only keep the vertices referenced by the cells, and drop the
+       * coordinates beyond the cell dimension.
+       */
+      inline
+      void compact_vertices(msh_content& content) {
+	const std::size_t n_node(content.vertices.size() / 3);
+	const unsigned int unused(static_cast<unsigned int>(-1));
+
+	std::vector<unsigned int> new_id(n_node, unused);
+	for (auto v: content.cells)
+	  new_id[v] = 0;
+
+	unsigned int n_vertex(0);
+	for (std::size_t k(0); k < n_node; ++k) {
+	  if (new_id[k] != unused) {
+	    new_id[k] = n_vertex;
+	    for (std::size_t n(0); n < content.n_dimension; ++n)
+	      content.vertices[content.n_dimension * n_vertex + n] = content.vertices[3 * k + n];
+	    ++n_vertex;
+	  }
+	}
+	content.vertices.resize(content.n_dimension * n_vertex);
+
+	for (auto& v: content.cells)
+	  v = new_id[v];
+
+	for (auto& v: content.facets) {
+	  if (new_id[v] == unused)
+	    throw std::string("importer::gmsh: facet vertex which does not belong to any cell");
+	  v = new_id[v];
+	}
+      }
+
+      template<typename cell_type>
+      msh_content read_msh(const std::string& filename) {
+	stream_reader reader(filename);
+	msh_content content;
+	content.n_dimension = cell_type::n_dimension;
+
+	std::vector<std::map<int, unsigned int> > physical_tags(4);
+	node_index index;
+	bool has_nodes(false);
+
+	std::string section;
+	while (reader.get_section(section)) {
+	  if (section == "$MeshFormat") {
+	    std::istringstream format(reader.get_line());
+	    double version;
+	    int file_type, data_size;
+	    format >> version >> file_type >> data_size;
+	    if (version < 4.1)
+	      throw std::string("importer::gmsh: only the msh format 4.1 and later is supported");
+	    if (file_type == 1) {
+	      if (data_size != sizeof(std::size_t))
+		throw std::string("importer::gmsh: unsupported data size");
+	      int one;
+	      reader.get_binary(&one, 1);
+	      if (one != 1)
+		throw std::string("importer::gmsh: unsupported byte order");
+	    }
+	    reader.set_binary(file_type == 1);
+	    reader.expect_section_end("MeshFormat");
+	  } else if (section == "$PhysicalNames") {
+	    read_physical_names(reader, content);
+	  } else if (section == "$Entities") {
+	    read_entities(reader, physical_tags);
+	  } else if (section == "$Nodes") {
+	    read_nodes(reader, content, index);
+	    has_nodes = true;
+	  } else if (section == "$Elements") {
+	    if (not has_nodes)
+	      throw std::string("importer::gmsh: $Elements section found before $Nodes");
+	    read_elements<cell_type>(reader, content, index, physical_tags);
+	  } else if (section.size() > 1 and section[0] == '$') {
+	    reader.skip_section(section.substr(1));
+	  } else
+	    throw std::string("importer::gmsh: unexpected content in ") + filename;
+	}
+
+	compact_vertices(content);
+	return content;
+      }
+    }
+
+
+    /*
+     * Gmsh (msh 4.1, ascii or binary) mesh file. The cells of
+     * dimension cell_type::n_dimension form the mesh, and the
+     * physical tag of their entity becomes their reference. The
+     * facets carrying a physical tag can be retrieved as boundary
+     * submeshes.
+     */
+    template<typename cell_type>
+    class mesh_file {
+    public:
+      using boundary_cell_type = typename cell_type::boundary_cell_type;
+
+      mesh_file(const std::string& filename)
+	: mesh_file(detail::read_msh<cell_type>(filename)) {}
+
+      mesh_file(const mesh_file&) = delete;
+      mesh_file& operator=(const mesh_file&) = delete;
+
+      const fe_mesh<cell_type>& get_mesh() const { return m; }
+
+      unsigned int get_physical_tag(const std::string& name) const {
+	const auto it(physical_names.find(name));
+	if (it == physical_names.end())
+	  throw std::string("importer::gmsh::mesh_file: unknown physical name ") + name;
+	return it->second;
+      }
+
+      submesh<cell_type> get_boundary_submesh(unsigned int reference) const {
+	return boundary_submesh([reference](unsigned int r) { return r == reference; });
+      }
+
+      submesh<cell_type> get_boundary_submesh(const std::string& name) const {
+	return get_boundary_submesh(get_physical_tag(name));
+      }
+
+      submesh<cell_type> get_tagged_facets_submesh() const {
+	return boundary_submesh([](unsigned int) { return true; });
+      }
+
+    private:
+      fe_mesh<cell_type> m;
+      std::map<std::string, unsigned int> physical_names;
+      array<unsigned int> facet_cell_id, facet_subdomain_id, facet_references;
+
+    private:
+      mesh_file(detail::msh_content&& content)
+	: m(content.vertices.data(), content.vertices.size() / content.n_dimension, content.n_dimension,
+	    content.cells.data(), content.cell_references.size(),
+	    content.cell_references.data()),
+	  physical_names(std::move(content.physical_names)),
+	  facet_cell_id{content.facet_references.size()},
+	  facet_subdomain_id{content.facet_references.size()},
+	  facet_references{content.facet_references.size()} {
+	if (not content.facet_references.empty())
+	  facet_references.set_data(content.facet_references.data());
+	locate_facets(content.facets);
+      }
+
+      /*
+       * Find the parent cell and local subdomain id of each tagged
+       * facet, by looking up the sorted facet list.
+       */
+      void locate_facets(const std::vector<unsigned int>& facets) {
+	using ::cell::subdomain_type;
+
+	const std::size_t
+	  n_facet(facet_references.get_size(0)),
+	  n_facet_vertex(boundary_cell_type::n_vertex_per_cell),
+	  subdomain_id(cell_type::n_subdomain_type - 2),
+	  n_subdomain(cell_type::n_subdomain(subdomain_id));
+
+	std::vector<std::pair<subdomain_type, std::size_t> > sorted_facets(n_facet);
+	for (std::size_t f(0); f < n_facet; ++f) {
+	  for (std::size_t i(0); i < n_facet_vertex; ++i)
+	    sorted_facets[f].first.insert(facets[f * n_facet_vertex + i]);
+	  sorted_facets[f].second = f;
+	}
+	std::sort(sorted_facets.begin(), sorted_facets.end());
+
+	std::vector<bool> located(n_facet, false);
+	for (std::size_t k(0); k < m.get_cell_number() and n_facet; ++k) {
+	  for (std::size_t j(0); j < n_subdomain; ++j) {
+	    const std::pair<subdomain_type, std::size_t>
+	      key(cell_type::get_subdomain(m.get_cells(), k, subdomain_id, j), 0);
+	    for (auto it(std::lower_bound(sorted_facets.begin(), sorted_facets.end(), key));
+		 it != sorted_facets.end() and it->first == key.first; ++it) {
+	      if (not located[it->second]) {
+		facet_cell_id.at(it->second) = k;
+		facet_subdomain_id.at(it->second) = j;
+		located[it->second] = true;
+	      }
+	    }
+	  }
+	}
+
+	if (std::find(located.begin(), located.end(), false) != located.end())
+	  throw std::string("importer::gmsh::mesh_file: tagged facet which is not a cell facet");
+      }
+
+      template<typename predicate_type>
+      submesh<cell_type> boundary_submesh(predicate_type selected) const {
+	const std::size_t subdomain_id(cell_type::n_subdomain_type - 2);
+
+	std::size_t n_cell(0);
+	for (std::size_t f(0); f < facet_references.get_size(0); ++f)
+	  n_cell += selected(facet_references.at(f));
+
+	array<unsigned int> el_id{n_cell};
+	array<unsigned int> sd_id{n_cell};
+	array<unsigned int> el{n_cell, boundary_cell_type::n_vertex_per_cell};
+
+	for (std::size_t f(0), n(0); f < facet_references.get_size(0); ++f) {
+	  if (selected(facet_references.at(f))) {
+	    el_id.at(n) = facet_cell_id.at(f);
+	    sd_id.at(n) = facet_subdomain_id.at(f);
+	    const auto subdomain(cell_type::get_subdomain(m.get_cells(), el_id.at(n), subdomain_id, sd_id.at(n)));
+	    std::copy(subdomain.begin(), subdomain.end(), &el.at(n, 0));
+	    ++n;
+	  }
+	}
+
+	return submesh<cell_type>(m, el, el_id, sd_id);
+      }
+    };
+
+    template<typename cell_type>
+    fe_mesh<cell_type> mesh(const std::string& filename) {
+      return mesh_file<cell_type>(filename).get_mesh();
+    }
+  }
+}
+
+#endif /* GMSH_IMPORTER_H */
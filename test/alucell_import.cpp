@@ -44,7 +44,9 @@ void test_alucell_import() {
     using cell_type = cell::tetrahedron;
     using mesh_type = fe_mesh<cell_type>;
   
-    fe_mesh<cell_type> cuve(importer::alucell::mesh<cell_type>("/home/thomas/git/alu-data/AP32/stat/dbfile_stat", "cuveb"));
+    importer::alucell::database db("/home/thomas/git/alu-data/AP32/stat/dbfile_stat");
+
+    fe_mesh<cell_type> cuve(db.mesh<cell_type>("cuveb"));
     submesh<cell_type, cell_type> electrolyte(cuve.get_submesh_with_reference(2));
     fe_mesh<cell_type> electrolyte_m(electrolyte);
 
@@ -57,9 +59,7 @@ void test_alucell_import() {
   
     cfes_type::element
       velocity(to_composite_p1_finite_element_function<3, cell_type>(
-		 importer::alucell::variable<cell_type>(
-		   "/home/thomas/git/alu-data/AP32/stat/dbfile_stat",
-		   "cuveb", "vitesse", cuve),
+		 db.variable<cell_type>("cuveb", "vitesse", cuve),
                  velocity_fes));
 
     cfes_type::element electrolyte_velocity(velocity.restrict(electrolyte_velocity_fes, electrolyte));
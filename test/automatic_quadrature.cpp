@@ -0,0 +1,161 @@
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <type_traits>
+
+#include "../src/core/mesh.hpp"
+#include "../src/core/fe.hpp"
+#include "../src/core/fes.hpp"
+#include "../src/core/form.hpp"
+#include "../src/core/quadrature.hpp"
+#include "../src/core/projector.hpp"
+
+#include "check.hpp"
+
+
+double g(const double* x) {
+  return std::sin(x[0]) + x[1];
+}
+
+double factorial(std::size_t n) {
+  return n < 2 ? 1.0 : n * factorial(n - 1);
+}
+
+/*
+ * The rules integrate exactly the monomials of their degree on the
+ * reference cell, whose volume is the sum of the weights.
+ */
+template<typename quadrature_type>
+void check_degree(const std::string& name) {
+  const std::size_t n_dim(quadrature_type::n_point_space_dimension), p(quadrature_type::degree);
+
+  double volume(0.0);
+  for (std::size_t q(0); q < quadrature_type::n_point; ++q)
+    volume += quadrature_type::w[q];
+
+  for (std::size_t a(0); a <= p; ++a)
+    for (std::size_t b(0); b <= (n_dim > 1 ? p - a : 0); ++b) {
+      const std::size_t c(n_dim > 2 ? p - a - b : 0);
+      double result(0.0);
+      for (std::size_t q(0); q < quadrature_type::n_point; ++q) {
+	const double* x(quadrature_type::x[q]);
+	result += quadrature_type::w[q] * std::pow(x[0], a) * (n_dim > 1 ? std::pow(x[1], b) : 1.0)
+	  * (n_dim > 2 ? std::pow(x[2], c) : 1.0);
+      }
+      const double exact(factorial(a) * factorial(b) * factorial(c) / factorial(a + b + c + n_dim)
+			 * factorial(n_dim));
+      check(std::abs(result / volume - exact) < 1.e-11, name + ": not exact for the degree " + std::to_string(p));
+    }
+}
+
+void test_degrees() {
+  check_degree<quad::edge::gauss1>("gauss1");
+  check_degree<quad::edge::gauss2>("gauss2");
+  check_degree<quad::edge::gauss3>("gauss3");
+  check_degree<quad::edge::gauss4>("gauss4");
+  check_degree<quad::edge::gauss5>("gauss5");
+  check_degree<quad::triangle::qf1pT>("qf1pT");
+  check_degree<quad::triangle::qf2pT>("qf2pT");
+  check_degree<quad::triangle::qf5pT>("qf5pT");
+  check_degree<quad::tetrahedron::qfSym1pTet>("qfSym1pTet");
+  check_degree<quad::tetrahedron::qfSym4pTet>("qfSym4pTet");
+  check_degree<quad::tetrahedron::qfSym10pTet>("qfSym10pTet");
+  check_degree<quad::tetrahedron::qfSym20pTet>("qfSym20pTet");
+  check_degree<quad::tetrahedron::qfSym35pTet>("qfSym35pTet");
+  check_degree<quad::tetrahedron::qfSym56pTet>("qfSym56pTet");
+
+  static_assert(std::is_same<minimal_quadrature<cell::triangle, 3>::type, quad::triangle::qf5pT>::value, "");
+  static_assert(std::is_same<minimal_quadrature<cell::tetrahedron, 4>::type, quad::tetrahedron::qfSym20pTet>::value, "");
+  static_assert(std::is_same<minimal_quadrature<cell::edge, 4>::type, quad::edge::gauss3>::value, "");
+}
+
+/*
+ * The degree of the expressions follows the finite elements, and the
+ * automatic rule gives the operators of a rule of higher degree.
+ */
+void test_triangle_p2() {
+  using fe_type = cell::triangle::fe::lagrange_p2;
+  using fes_type = finite_element_space<fe_type>;
+  const fe_mesh<cell::triangle> m(gen_square_mesh(1.0, 1.0, 6, 6));
+  const fes_type fes(m);
+
+  bilinear_form<fes_type, fes_type> a(fes, fes), a_ref(fes, fes);
+  const auto u(a.get_trial_function());
+  const auto v(a.get_test_function());
+  static_assert(decltype(u * v)::polynomial_degree == 4, "");
+  static_assert(decltype(d<1>(u) * d<2>(v))::polynomial_degree == 2, "");
+  static_assert(decltype(u * v + d<1>(u) * v)::polynomial_degree == 4, "");
+  static_assert(decltype(make_expr(g) * v)::polynomial_degree == non_polynomial_degree, "");
+  static_assert(std::is_same<decltype(integrate(d<1>(u) * d<1>(v), m))::quadrature_type,
+			     quad::triangle::qf2pT>::value, "");
+
+  a += integrate(u * v + d<1>(u) * d<1>(v) + d<2>(u) * d<2>(v), m);
+  a_ref += integrate<quad::triangle::qf5pT>(u * v + d<1>(u) * d<1>(v) + d<2>(u) * d<2>(v), m);
+  check_same_pattern(a.get_operator(), a_ref.get_operator(), "triangle P2");
+  check_same_operator(a.get_operator(), a_ref.get_operator(), "triangle P2", 1.e-12);
+
+  // the degree of a function of the space coordinates is given
+  linear_form<fes_type> f(fes), f_ref(fes);
+  f += integrate<3>(make_expr(g) * v, m);
+  f_ref += integrate<quad::triangle::qf5pT>(make_expr(g) * v, m);
+  for (std::size_t i(0); i < fes.get_dof_number(); ++i)
+    check(f.get_coefficients().at(i) == f_ref.get_coefficients().at(i), "triangle P2: the given degree is not used");
+
+  // rank 0
+  const auto u_h(projector::lagrange<fe_type>(g, fes));
+  const auto w(make_expr<fe_type>(u_h));
+  const double i_auto(integrate(w * w, m)), i_ref(integrate<quad::triangle::qf5pT>(w * w, m));
+  check(std::abs(i_auto - i_ref) < 1.e-14, "triangle P2: the integrals differ");
+}
+
+void test_edge_p2() {
+  using fe_type = cell::edge::fe::lagrange_p2;
+  using fes_type = finite_element_space<fe_type>;
+  const fe_mesh<cell::edge> m(gen_segment_mesh(0.0, 1.0, 10));
+  const submesh<cell::edge> dm(m.get_boundary_submesh());
+  const fes_type fes(m);
+
+  bilinear_form<fes_type, fes_type> a(fes, fes), a_ref(fes, fes);
+  const auto u(a.get_trial_function());
+  const auto v(a.get_test_function());
+  static_assert(std::is_same<decltype(integrate(u * v, m))::quadrature_type, quad::edge::gauss3>::value, "");
+  static_assert(std::is_same<decltype(integrate(v, dm))::quadrature_type, quad::point::eval>::value, "");
+
+  a += integrate(u * v + d<1>(u) * d<1>(v), m);
+  a_ref += integrate<quad::edge::gauss5>(u * v + d<1>(u) * d<1>(v), m);
+  check_same_pattern(a.get_operator(), a_ref.get_operator(), "edge P2");
+  check_same_operator(a.get_operator(), a_ref.get_operator(), "edge P2", 1.e-12);
+
+  linear_form<fes_type> f(fes), f_ref(fes);
+  f += integrate(2.0 * v, dm);
+  f_ref += integrate<quad::point::eval>(2.0 * v, dm);
+  for (std::size_t i(0); i < fes.get_dof_number(); ++i)
+    check(f.get_coefficients().at(i) == f_ref.get_coefficients().at(i), "edge P2: the boundary terms differ");
+}
+
+void test_tetrahedron() {
+  using fe_type = cell::tetrahedron::fe::lagrange_p1_bubble;
+  using fes_type = finite_element_space<fe_type>;
+  const fe_mesh<cell::tetrahedron> m(gen_cube_mesh(1.0, 1.0, 1.0, 3, 3, 3));
+  const fes_type fes(m);
+
+  bilinear_form<fes_type, fes_type> a(fes, fes), a_ref(fes, fes);
+  const auto u(a.get_trial_function());
+  const auto v(a.get_test_function());
+  static_assert(std::is_same<decltype(integrate(d<1>(u) * d<1>(v), m))::quadrature_type,
+			     quad::tetrahedron::qfSym35pTet>::value, "");
+
+  a += integrate(d<1>(u) * d<1>(v) + d<2>(u) * d<2>(v) + d<3>(u) * d<3>(v), m);
+  a_ref += integrate<quad::tetrahedron::qfSym56pTet>(d<1>(u) * d<1>(v) + d<2>(u) * d<2>(v) + d<3>(u) * d<3>(v), m);
+  check_same_pattern(a.get_operator(), a_ref.get_operator(), "tetrahedron P1-bubble");
+  check_same_operator(a.get_operator(), a_ref.get_operator(), "tetrahedron P1-bubble", 1.e-12);
+}
+
+int main(int argc, char *argv[]) {
+  return run_tests("test_automatic_quadrature", []() {
+      test_degrees();
+      test_edge_p2();
+      test_triangle_p2();
+      test_tetrahedron();
+    });
+}
@@ -0,0 +1,393 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <numeric>
+#include <chrono>
+#include <ctime>
+#include <thread>
+#include <random>
+
+#include "../src/core/cell.hpp"
+#include "../src/core/mesh.hpp"
+#include "../src/core/fe.hpp"
+#include "../src/core/fes.hpp"
+#include "../src/core/composite_fe.hpp"
+#include "../src/core/composite_fes.hpp"
+#include "../src/core/composite_form.hpp"
+#include "../src/core/quadrature.hpp"
+#include "../src/core/solver.hpp"
+#include "../src/core/projector.hpp"
+#include "../src/core/export.hpp"
+
+
+/*
+ * Benchmark suite of the main building blocks of the library. Each
+ * benchmark is run 'warmup' times, and then timed 'repetitions'
+ * times. The statistics are printed on the standard output, and
+ * written in csv or json format for regression tracking:
+ *
+ *   test_benchmark [--warmup n] [--repetitions n] [--format csv|json]
+ *                  [--output filename] [--filter prefix] [--quick]
+ */
+
+struct benchmark_result {
+  std::string name;
+  std::size_t n;
+  std::size_t items;
+  std::vector<double> samples;
+
+  double min() const { return *std::min_element(samples.begin(), samples.end()); }
+  double max() const { return *std::max_element(samples.begin(), samples.end()); }
+  double mean() const { return std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size(); }
+  double median() const {
+    std::vector<double> s(samples);
+    std::sort(s.begin(), s.end());
+    const std::size_t m(s.size() / 2);
+    return s.size() % 2 ? s[m] : 0.5 * (s[m - 1] + s[m]);
+  }
+};
+
+
+class benchmark_suite {
+public:
+  benchmark_suite(std::size_t warmup, std::size_t repetitions, const std::string& filter)
+    : warmup(warmup), repetitions(repetitions), filter(filter) {}
+
+  /*
+   * A benchmark is enabled when its name starts with the filter. A
+   * group (name prefix) is enabled when it may contain an enabled
+   * benchmark.
+   */
+  bool enabled(const std::string& name) const {
+    return name.compare(0, filter.size(), filter) == 0;
+  }
+
+  bool group_enabled(const std::string& prefix) const {
+    return enabled(prefix) or filter.compare(0, prefix.size(), prefix) == 0;
+  }
+
+  /*
+   * Time f, which processes 'items' entities (cells, dofs, points)
+   * of a problem of size n.
+   */
+  void run(const std::string& name, std::size_t n, std::size_t items, const std::function<void()>& f) {
+    if (not enabled(name))
+      return;
+
+    for (std::size_t r(0); r < warmup; ++r)
+      f();
+
+    benchmark_result result{name, n, items, std::vector<double>()};
+    for (std::size_t r(0); r < repetitions; ++r) {
+      const auto start(std::chrono::steady_clock::now());
+      f();
+      const auto stop(std::chrono::steady_clock::now());
+      result.samples.push_back(std::chrono::duration<double, std::milli>(stop - start).count());
+    }
+
+    std::cout << std::setw(36) << std::left << name
+	      << std::setw(8) << std::right << n
+	      << std::setw(12) << std::right << items
+	      << std::setw(14) << std::right << std::fixed << std::setprecision(3) << result.min()
+	      << std::setw(14) << std::right << result.median() << " [ms]" << std::endl;
+
+    results.push_back(result);
+  }
+
+  void write_csv(std::ostream& stream) const {
+    stream << "name,n,items,repetitions,min_ms,median_ms,mean_ms,max_ms\n";
+    stream.precision(6);
+    for (const auto& r: results)
+      stream << r.name << ',' << r.n << ',' << r.items << ',' << r.samples.size() << ','
+	     << r.min() << ',' << r.median() << ',' << r.mean() << ',' << r.max() << '\n';
+  }
+
+  void write_json(std::ostream& stream) const {
+    std::time_t now(std::time(nullptr));
+    char date[32];
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+    stream.precision(6);
+    stream << "{\n"
+	   << "  \"context\": {\n"
+	   << "    \"date\": \"" << date << "\",\n"
+	   << "    \"compiler\": \"" << __VERSION__ << "\",\n"
+	   << "    \"hardware_concurrency\": " << std::thread::hardware_concurrency() << ",\n"
+	   << "    \"thread_number\": " << parallel::get_thread_number() << ",\n"
+	   << "    \"warmup\": " << warmup << ",\n"
+	   << "    \"repetitions\": " << repetitions << "\n"
+	   << "  },\n"
+	   << "  \"benchmarks\": [";
+    for (std::size_t i(0); i < results.size(); ++i) {
+      const auto& r(results[i]);
+      stream << (i ? ",\n" : "\n")
+	     << "    {\"name\": \"" << r.name << "\", \"n\": " << r.n << ", \"items\": " << r.items
+	     << ", \"unit\": \"ms\", \"min\": " << r.min() << ", \"median\": " << r.median()
+	     << ", \"mean\": " << r.mean() << ", \"max\": " << r.max() << ", \"samples\": [";
+      for (std::size_t s(0); s < r.samples.size(); ++s)
+	stream << (s ? ", " : "") << r.samples[s];
+      stream << "]}";
+    }
+    stream << "\n  ]\n}\n";
+  }
+
+private:
+  std::size_t warmup, repetitions;
+  std::string filter;
+  std::vector<benchmark_result> results;
+};
+
+
+volatile double sink;
+
+double f(const double* x) {
+  return std::sin(M_PI * x[0]) * std::sin(M_PI * x[1]);
+}
+
+dictionary solver_parameters() {
+  return dictionary()
+    .set("maxits",  2000u)
+    .set("restart", 1000u)
+    .set("rtol",    1.e-8)
+    .set("atol",    1.e-50)
+    .set("dtol",    1.e20)
+    .set("ilufill", 2u);
+}
+
+
+void bench_mesh(benchmark_suite& s, std::size_t n_2d, std::size_t n_3d) {
+  s.run("mesh/gen_square_mesh", n_2d, 2 * n_2d * n_2d, [n_2d] () {
+      const fe_mesh<cell::triangle> m(gen_square_mesh(1.0, 1.0, n_2d, n_2d));
+      sink = m.get_h_max();
+    });
+
+  s.run("mesh/gen_cube_mesh", n_3d, 6 * n_3d * n_3d * n_3d, [n_3d] () {
+      const fe_mesh<cell::tetrahedron> m(gen_cube_mesh(1.0, 1.0, 1.0, n_3d, n_3d, n_3d));
+      sink = m.get_h_max();
+    });
+
+  if (s.enabled("mesh/boundary_submesh")) {
+    const fe_mesh<cell::triangle> m(gen_square_mesh(1.0, 1.0, n_2d, n_2d));
+    s.run("mesh/boundary_submesh", n_2d, m.get_cell_number(), [&m] () {
+	const submesh<cell::triangle> dm(m.get_boundary_submesh());
+	sink = dm.get_cell_number();
+      });
+  }
+
+  if (s.enabled("mesh/get_cell_at")) {
+    const fe_mesh<cell::triangle> m(gen_square_mesh(1.0, 1.0, n_2d, n_2d));
+    std::mt19937 generator(0);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::vector<double> points(2 * 100);
+    for (auto& x: points)
+      x = uniform(generator);
+
+    s.run("mesh/get_cell_at", n_2d, points.size() / 2, [&m, &points] () {
+	std::size_t sum(0);
+	for (std::size_t i(0); i < points.size() / 2; ++i)
+	  sum += m.get_cell_at(&points[2 * i]);
+	sink = sum;
+      });
+  }
+}
+
+template<typename fe_type>
+void bench_lagrange_projection(benchmark_suite& s, const std::string& prefix, std::size_t n,
+			       const finite_element_space<fe_type>& fes, std::true_type) {
+  s.run(prefix + "lagrange_projection", n, fes.get_dof_number(), [&fes] () {
+      const typename finite_element_space<fe_type>::element g(projector::lagrange<fe_type>(f, fes));
+      sink = g.get_coefficients().at(0);
+    });
+}
+
+template<typename fe_type>
+void bench_lagrange_projection(benchmark_suite&, const std::string&, std::size_t,
+			       const finite_element_space<fe_type>&, std::false_type) {}
+
+template<typename fe_type>
+void bench_scalar(benchmark_suite& s, const std::string& fe_name, std::size_t n) {
+  using cell_type = cell::triangle;
+  using fes_type = finite_element_space<fe_type>;
+  using quad_type = quad::triangle::qf5pT;
+
+  const std::string prefix("scalar_" + fe_name + "/");
+  if (not s.group_enabled(prefix))
+    return;
+
+  const fe_mesh<cell_type> m(gen_square_mesh(1.0, 1.0, n, n));
+  const submesh<cell_type> dm(m.get_boundary_submesh());
+
+  s.run(prefix + "fes", n, m.get_cell_number(), [&m] () {
+      const fes_type fes(m);
+      sink = fes.get_dof_number();
+    });
+
+  fes_type fes(m);
+  fes.add_dirichlet_boundary(dm, 0.0);
+
+  s.run(prefix + "linear_form", n, m.get_cell_number(), [&m, &fes] () {
+      linear_form<fes_type> b(fes);
+      auto v(b.get_test_function());
+      b += integrate<quad_type>(f * v, m);
+      sink = b.get_coefficients().at(0);
+    });
+
+  s.run(prefix + "bilinear_form", n, m.get_cell_number(), [&m, &fes] () {
+      bilinear_form<fes_type, fes_type> a(fes, fes);
+      auto u(a.get_trial_function());
+      auto v(a.get_test_function());
+      a += integrate<quad_type>(d<1>(u) * d<1>(v) + d<2>(u) * d<2>(v), m);
+      sink = a.get_operator().get_nz_element_number();
+    });
+
+  bilinear_form<fes_type, fes_type> a(fes, fes); {
+    auto u(a.get_trial_function());
+    auto v(a.get_test_function());
+    a += integrate<quad_type>(d<1>(u) * d<1>(v) + d<2>(u) * d<2>(v), m);
+  }
+
+  linear_form<fes_type> b(fes); {
+    auto v(b.get_test_function());
+    b += integrate<quad_type>(f * v, m);
+  }
+
+  s.run(prefix + "solver_setup", n, fes.get_dof_number(), [&a] () {
+      solver::petsc::gmres_ilu solver(solver_parameters());
+      solver.set_operator(a.get_operator());
+    });
+
+  typename fes_type::element u_h(fes);
+  s.run(prefix + "solve", n, fes.get_dof_number(), [&a, &b, &u_h] () {
+      solver::petsc::gmres_ilu solver(solver_parameters());
+      u_h = a.solve(b, solver);
+    });
+
+  s.run(prefix + "integrate", n, m.get_cell_number(), [&m, &u_h] () {
+      sink = integrate<quad_type>(make_expr<fe_type>(u_h) * make_expr<fe_type>(u_h), m);
+    });
+
+  bench_lagrange_projection(s, prefix, n, fes, std::integral_constant<bool, fe_type::is_lagrangian>());
+
+  const mesh_data<double, fe_mesh<cell_type> > data(to_mesh_vertex_data<fe_type>(u_h));
+  s.run(prefix + "export_ensight6", n, m.get_vertex_number(), [&data] () {
+      exporter::ensight6("benchmark_export", data, "u");
+    });
+
+  s.run(prefix + "export_vtu", n, m.get_vertex_number(), [&data] () {
+      exporter::vtu("benchmark_export", data, "u");
+    });
+}
+
+template<typename u_fe_type, typename p_fe_type>
+void bench_stokes(benchmark_suite& s, const std::string& fe_name, std::size_t n) {
+  using cell_type = cell::triangle;
+  using quad_type = quad::triangle::qf5pT;
+  using fe_type = composite_finite_element<u_fe_type, u_fe_type, p_fe_type>;
+  using fes_type = composite_finite_element_space<fe_type>;
+
+  const std::string prefix("stokes_" + fe_name + "/");
+  if (not s.group_enabled(prefix))
+    return;
+
+  const fe_mesh<cell_type> m(gen_square_mesh(1.0, 1.0, n, n));
+  const submesh<cell_type> dm(m.get_boundary_submesh());
+
+  s.run(prefix + "fes", n, m.get_cell_number(), [&m] () {
+      const fes_type fes(m);
+      sink = fes.get_total_dof_number();
+    });
+
+  fes_type fes(m);
+  fes.template add_dirichlet_boundary<0>(dm, f);
+  fes.template add_dirichlet_boundary<1>(dm, f);
+
+  s.run(prefix + "bilinear_form", n, m.get_cell_number(), [&m, &fes] () {
+      bilinear_form<fes_type, fes_type> a(fes, fes);
+      auto v0(a.template get_test_function<0>());
+      auto v1(a.template get_test_function<1>());
+      auto q (a.template get_test_function<2>());
+      auto u0(a.template get_trial_function<0>());
+      auto u1(a.template get_trial_function<1>());
+      auto p (a.template get_trial_function<2>());
+
+      a += integrate<quad_type>(  d<1>(u0) * d<1>(v0) + d<2>(u0) * d<2>(v0)
+				+ d<1>(u1) * d<1>(v1) + d<2>(u1) * d<2>(v1)
+				+ p * (d<1>(v0) + d<2>(v1))
+				+ q * (d<1>(u0) + d<2>(u1))
+				, m);
+    });
+
+  s.run(prefix + "linear_form", n, m.get_cell_number(), [&m, &fes] () {
+      linear_form<fes_type> b(fes);
+      auto v0(b.template get_test_function<0>());
+      auto v1(b.template get_test_function<1>());
+      b += integrate<quad_type>(f * v0 + f * v1, m);
+    });
+}
+
+
+int main(int argc, char *argv[]) {
+  try {
+    std::size_t warmup(1), repetitions(5);
+    std::string format("json"), output, filter;
+    bool quick(false);
+
+    for (int i(1); i < argc; ++i) {
+      const std::string arg(argv[i]);
+      if (arg == "--quick") {
+	quick = true;
+	continue;
+      }
+      if (i + 1 == argc)
+	throw std::string("missing value for option ") + arg;
+      const std::string value(argv[++i]);
+
+      if (arg == "--warmup") warmup = std::stoul(value);
+      else if (arg == "--repetitions") repetitions = std::stoul(value);
+      else if (arg == "--format") format = value;
+      else if (arg == "--output") output = value;
+      else if (arg == "--filter") filter = value;
+      else throw std::string("unknown option ") + arg;
+    }
+
+    if (format != "json" and format != "csv")
+      throw std::string("unknown output format ") + format;
+    if (repetitions == 0)
+      throw std::string("at least one repetition is required");
+    if (output.empty())
+      output = "benchmark." + format;
+
+    benchmark_suite s(warmup, repetitions, filter);
+
+    const std::size_t
+      n_2d(quick ? 32 : 128),
+      n_3d(quick ? 8 : 24);
+
+    bench_mesh(s, n_2d, n_3d);
+    bench_scalar<cell::triangle::fe::lagrange_p1>(s, "p1", n_2d);
+    bench_scalar<cell::triangle::fe::lagrange_p2>(s, "p2", n_2d / 2);
+    bench_scalar<cell::triangle::fe::lagrange_p1_bubble>(s, "p1_bubble", n_2d);
+    bench_stokes<cell::triangle::fe::lagrange_p2, cell::triangle::fe::lagrange_p1>(s, "p2_p1", n_2d / 2);
+    bench_stokes<cell::triangle::fe::lagrange_p1_bubble, cell::triangle::fe::lagrange_p1>(s, "p1_bubble_p1", n_2d / 2);
+
+    std::ofstream file(output.c_str(), std::ios::out);
+    if (not file)
+      throw std::string("failed to open ") + output + " for output";
+
+    if (format == "json")
+      s.write_json(file);
+    else
+      s.write_csv(file);
+  }
+  catch (const std::string& e) {
+    std::cout << e << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,91 @@
+#ifndef _TEST_CHECK_H_
+#define _TEST_CHECK_H_
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+
+#include <spikes/array.hpp>
+
+#include "../src/core/solver.hpp"
+
+
+/*
+ * The checks of the tests. A failed check throws its message, which
+ * run_tests prints after the name of the test:
+ *   int main(int argc, char *argv[]) {
+ *     return run_tests("test_x", []() {
+ *         test_1();
+ *         test_2();
+ *       });
+ *   }
+ */
+inline void check(bool condition, const std::string& message) {
+  if (not condition)
+    throw message;
+}
+
+template<typename F>
+int run_tests(const std::string& name, F tests) {
+  try {
+    tests();
+  } catch (const std::string& e) {
+    std::cout << name << ": " << e << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
+
+/*
+ * The entries of a and b differ by at most tolerance times the largest
+ * entry of b, the missing entries being zeros.
+ */
+inline void check_same_operator(const sparse_matrix& a, const sparse_matrix& b, const std::string& name,
+				double tolerance = 1.e-13) {
+  double max_value(0.0), max_difference(0.0);
+  for (const auto& v: b.get_values()) {
+    max_value = std::max(max_value, std::abs(v.second));
+    max_difference = std::max(max_difference, std::abs(a.get(v.first.first, v.first.second) - v.second));
+  }
+  for (const auto& v: a.get_values())
+    max_difference = std::max(max_difference, std::abs(b.get(v.first.first, v.first.second) - v.second));
+
+  check(max_difference <= tolerance * max_value, name + ": the operators differ by " + std::to_string(max_difference));
+}
+
+inline void check_same_operator(const crs_matrix& a, const sparse_matrix& b, const std::string& name,
+				double tolerance = 1.e-13) {
+  double max_value(0.0), max_difference(0.0);
+  for (const auto& v: b.get_values()) {
+    max_value = std::max(max_value, std::abs(v.second));
+    max_difference = std::max(max_difference, std::abs(a.get(v.first.first, v.first.second) - v.second));
+  }
+
+  const auto& p(*a.get_pattern());
+  for (std::size_t i(0); i < p.n_row; ++i)
+    for (std::size_t n(p.row[i]); n < p.row[i + 1]; ++n)
+      max_difference = std::max(max_difference, std::abs(a.get_values()[n] - b.get(i, p.column[n])));
+
+  check(max_difference <= tolerance * max_value, name + ": the operators differ by " + std::to_string(max_difference));
+}
+
+// the same entries are stored, whatever their values
+inline void check_same_pattern(const sparse_matrix& a, const sparse_matrix& b, const std::string& name) {
+  check(a.get_values().size() == b.get_values().size(), name + ": the patterns differ");
+  for (const auto& v: b.get_values())
+    check(a.get_values().count(v.first) == 1, name + ": the patterns differ");
+}
+
+inline void check_same_vector(const array<double>& a, const array<double>& b, const std::string& name,
+			      double tolerance = 1.e-13) {
+  double max_value(0.0), max_difference(0.0);
+  for (std::size_t i(0); i < a.get_size(0); ++i) {
+    max_value = std::max(max_value, std::abs(b.at(i)));
+    max_difference = std::max(max_difference, std::abs(a.at(i) - b.at(i)));
+  }
+  check(max_difference <= tolerance * max_value, name + ": the vectors differ by " + std::to_string(max_difference));
+}
+
+#endif /* _TEST_CHECK_H_ */
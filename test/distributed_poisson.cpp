@@ -0,0 +1,104 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "../src/core/mesh.hpp"
+#include "../src/core/quadrature.hpp"
+#include "../src/core/form.hpp"
+#include "../src/core/distributed.hpp"
+
+/*
+ * Solve -\Delta u = f on the unit square, distributed over the ranks of
+ * MPI_COMM_WORLD, with an exact solution which belongs to the discrete
+ * space. Run with mpirun -np <n> bin/test_distributed_poisson.
+ */
+
+template<typename fe_type>
+double solve_poisson(const distributed::partitioned_mesh<cell::triangle>& pm,
+		     double (*u_exact)(const double*), double f_value) {
+  using fes_type = finite_element_space<fe_type>;
+
+  distributed::distributed_fes<fe_type> dfes(pm, u_exact);
+  const fes_type& fes(dfes.get_local_fes());
+
+  bilinear_form<fes_type, fes_type> a(fes, fes); {
+    const auto u(a.get_trial_function());
+    const auto v(a.get_test_function());
+
+    a += integrate<quad::triangle::qf5pT>(d<1>(u) * d<1>(v) + d<2>(u) * d<2>(v),
+					  pm.get_owned_mesh());
+  }
+
+  linear_form<fes_type> f(fes); {
+    const auto v(f.get_test_function());
+
+    f += integrate<quad::triangle::qf5pT>(f_value * v, pm.get_owned_mesh());
+  }
+
+  dictionary p(dictionary()
+	       .set("maxits",  2000u)
+	       .set("restart", 200u)
+	       .set("rtol",    1.e-12)
+	       .set("atol",    1.e-50)
+	       .set("dtol",    1.e20));
+  const auto u_h(distributed::solve(dfes, a, f, p));
+
+  double error(0.0);
+  for (std::size_t i(0); i < fes.get_dof_number(); ++i)
+    if (dfes.is_relevant(i)) {
+      const array<double> x(fes.get_dof_space_coordinate(i));
+      error = std::max(error, std::abs(u_h.get_coefficients().at(i) - u_exact(&x.at(0, 0))));
+    }
+
+  double global_error(0.0);
+  MPI_Allreduce(&error, &global_error, 1, MPI_DOUBLE, MPI_MAX, dfes.get_communicator());
+  return global_error;
+}
+
+double u_p1(const double* x) {
+  return x[0] + 2.0 * x[1];
+}
+
+double u_p2(const double* x) {
+  return x[0] * x[0] - x[1] * x[1] + x[0] * x[1];
+}
+
+// -\Delta u = -4: the right-hand sides of the rows shared by several
+// ranks are summed
+double u_p2_source(const double* x) {
+  return x[0] * x[0] + x[1] * x[1] + x[0];
+}
+
+int main(int argc, char *argv[]) {
+  using cell_type = cell::triangle;
+
+  const auto& petsc_init(solver::petsc::initialize::instance());
+  ignore_unused(petsc_init);
+
+  int rc(0);
+  try {
+    const fe_mesh<cell_type> m(gen_square_mesh(1.0, 1.0, 12, 12));
+    distributed::partitioned_mesh<cell_type> pm(m);
+
+    if (pm.get_owned_cell_number() + pm.get_ghost_cell_number() != pm.get_local_mesh().get_cell_number())
+      throw std::string("test_distributed_poisson: inconsistent local mesh");
+
+    const double error_p1(solve_poisson<cell_type::fe::lagrange_p1>(pm, u_p1, 0.0));
+    const double error_p2(solve_poisson<cell_type::fe::lagrange_p2>(pm, u_p2, 0.0));
+    const double error_source(solve_poisson<cell_type::fe::lagrange_p2>(pm, u_p2_source, -4.0));
+    if (pm.get_rank() == 0)
+      std::cout << "ranks: " << pm.get_size()
+		<< ", P1 error: " << error_p1
+		<< ", P2 error: " << error_p2
+		<< ", P2 error with a source: " << error_source << std::endl;
+
+    if (error_p1 > 1.e-8 or error_p2 > 1.e-8 or error_source > 1.e-8)
+      throw std::string("test_distributed_poisson: the discrete solution is not exact");
+  } catch (const std::string& e) {
+    std::cout << e << std::endl;
+    rc = 1;
+  }
+
+  solver::petsc::initialize::release();
+  return rc;
+}
@@ -0,0 +1,186 @@
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../src/core/mesh.hpp"
+#include "../src/core/fe.hpp"
+#include "../src/core/fes.hpp"
+#include "../src/core/composite_fe.hpp"
+#include "../src/core/composite_fes.hpp"
+#include "../src/core/projector.hpp"
+
+#include "check.hpp"
+
+
+double g(const double* x) {
+  return std::sin(2.0 * x[0]) + x[1];
+}
+
+double h(const double* x) {
+  return x[0] * x[1];
+}
+
+/*
+ * The coordinates of the table are the images of the nodes of the
+ * reference cell, and do not depend on the thread number.
+ */
+template<typename fe_type>
+void check_coordinates(const fe_mesh<typename fe_type::cell_type>& m, const std::string& name) {
+  using cell_type = typename fe_type::cell_type;
+  const std::size_t n_dim(cell_type::n_dimension);
+
+  parallel::set_thread_number(1);
+  const finite_element_space<fe_type> serial(m);
+  parallel::set_thread_number(4);
+  const finite_element_space<fe_type> fes(m);
+
+  const array<double>& x(fes.get_dof_space_coordinates());
+  check(x.get_size(0) == fes.get_dof_number() and x.get_size(1) == n_dim, name + ": wrong table size");
+
+  for (std::size_t k(0); k < m.get_cell_number(); ++k)
+    for (std::size_t n(0); n < fe_type::n_dof_per_element; ++n) {
+      const std::size_t i(fes.get_dof(k, n));
+      for (std::size_t d(0); d < n_dim; ++d) {
+	double x_d(m.get_vertices().at(m.get_cells().at(k, 0), d));
+	for (std::size_t v(0); v < n_dim; ++v)
+	  x_d += fe_type::x[n][v] * (m.get_vertices().at(m.get_cells().at(k, v + 1), d)
+				     - m.get_vertices().at(m.get_cells().at(k, 0), d));
+	check(std::abs(x.at(i, d) - x_d) < 1.e-13, name + ": wrong dof coordinate");
+	check(x.at(i, d) == serial.get_dof_space_coordinates().at(i, d), name + ": the table depends on the thread number");
+	check(fes.get_dof_space_coordinate(i).at(0, d) == x.at(i, d), name + ": get_dof_space_coordinate differs");
+      }
+    }
+}
+
+void test_coordinates() {
+  check_coordinates<cell::triangle::fe::lagrange_p2>(gen_square_mesh(2.0, 1.0, 5, 4), "triangle");
+  check_coordinates<cell::tetrahedron::fe::lagrange_p1_bubble>(gen_cube_mesh(1.0, 1.0, 2.0, 2, 3, 2), "tetrahedron");
+}
+
+/*
+ * The interpolations of a function and of an expression are the values
+ * on the nodes, evaluated in order or concurrently.
+ */
+void test_lagrange() {
+  using fe_type = cell::triangle::fe::lagrange_p2;
+  using p1_type = cell::triangle::fe::lagrange_p1;
+
+  const fe_mesh<cell::triangle> m(gen_square_mesh(1.0, 1.0, 8, 8));
+  const finite_element_space<fe_type> fes(m);
+  const finite_element_space<p1_type> p1_fes(m);
+  const array<double>& x(fes.get_dof_space_coordinates());
+
+  parallel::set_thread_number(3);
+  const auto g_serial(projector::lagrange<fe_type>(g, fes));
+  const auto g_h(projector::lagrange<fe_type>(g, fes, parallel::thread_safe));
+  const auto g_expr(projector::lagrange<fe_type>(make_expr(g) * make_expr(h), fes, parallel::thread_safe));
+  const auto g_expr_serial(projector::lagrange<fe_type>(make_expr(g) * make_expr(h), fes));
+
+  // P1 is in P2: the interpolation of a P1 function is the function
+  const auto u_h(projector::lagrange<p1_type>(h, p1_fes));
+  const auto u_p2(projector::lagrange<fe_type>(make_expr<p1_type>(u_h), fes));
+
+  for (std::size_t i(0); i < fes.get_dof_number(); ++i) {
+    check(g_h.get_coefficients().at(i) == g(&x.at(i, 0)), "wrong interpolation");
+    check(g_h.get_coefficients().at(i) == g_serial.get_coefficients().at(i), "the interpolation depends on the thread number");
+    check(std::abs(g_expr.get_coefficients().at(i) - g(&x.at(i, 0)) * h(&x.at(i, 0))) < 1.e-14,
+	  "wrong interpolation of an expression");
+    check(g_expr.get_coefficients().at(i) == g_expr_serial.get_coefficients().at(i),
+	  "the interpolation of an expression depends on the thread number");
+    check(std::abs(u_p2.get_coefficients().at(i) - u_h.evaluate(&x.at(i, 0))) < 1.e-13,
+	  "wrong interpolation of a finite element function");
+  }
+}
+
+/*
+ * The values of the dirichlet dofs are the ones of the function on the
+ * dofs, and are replaced by update_dirichlet_boundary.
+ */
+void test_dirichlet() {
+  using fe_type = cell::triangle::fe::lagrange_p2;
+
+  const fe_mesh<cell::triangle> m(gen_square_mesh(1.0, 1.0, 6, 6));
+  const submesh<cell::triangle> dm(m.get_boundary_submesh());
+  finite_element_space<fe_type> fes(m, dm, g);
+  const array<double>& x(fes.get_dof_space_coordinates());
+
+  check(not fes.get_dirichlet_dof_values().empty(), "no dirichlet dofs");
+  for (const auto& i: fes.get_dirichlet_dof_values()) {
+    check(i.second == g(&x.at(i.first, 0)), "wrong dirichlet value");
+    check(std::abs(x.at(i.first, 0) * (1.0 - x.at(i.first, 0)) * x.at(i.first, 1) * (1.0 - x.at(i.first, 1))) < 1.e-14,
+	  "a dirichlet dof is not on the boundary");
+  }
+
+  // add_dirichlet_boundary keeps the first values
+  const std::size_t n_dirichlet(fes.get_dirichlet_dof_values().size());
+  fes.add_dirichlet_boundary(dm, h);
+  for (const auto& i: fes.get_dirichlet_dof_values())
+    check(i.second == g(&x.at(i.first, 0)), "add_dirichlet_boundary replaces the values");
+
+  fes.update_dirichlet_boundary(dm, h);
+  check(fes.get_dirichlet_dof_values().size() == n_dirichlet, "update_dirichlet_boundary adds dofs");
+  for (const auto& i: fes.get_dirichlet_dof_values())
+    check(i.second == h(&x.at(i.first, 0)), "update_dirichlet_boundary does not replace the values");
+
+  fes.update_dirichlet_boundary(dm, g, parallel::thread_safe);
+  for (const auto& i: fes.get_dirichlet_dof_values())
+    check(i.second == g(&x.at(i.first, 0)), "wrong concurrent dirichlet value");
+
+  // the components of a composite space
+  using cfe_type = composite_finite_element<fe_type, fe_type>;
+  composite_finite_element_space<cfe_type> cfes(m);
+  cfes.add_dirichlet_boundary<0>(dm, g);
+  cfes.update_dirichlet_boundary<0>(dm, h);
+  const array<double>& cx(cfes.get_dof_space_coordinates<0>());
+  check(cfes.get_dirichlet_dof_values<0>().size() == n_dirichlet, "composite: wrong dirichlet dofs");
+  check(cfes.get_dirichlet_dof_values<1>().empty(), "composite: the other component has dirichlet dofs");
+  for (const auto& i: cfes.get_dirichlet_dof_values<0>())
+    check(i.second == h(&cx.at(i.first, 0)), "composite: wrong dirichlet value");
+}
+
+/*
+ * Without parallel::thread_safe, the functions are called in the order
+ * of the dofs, from the calling thread: they may have a state.
+ */
+void test_call_order() {
+  using fe_type = cell::triangle::fe::lagrange_p2;
+
+  parallel::set_thread_number(4);
+  const fe_mesh<cell::triangle> m(gen_square_mesh(1.0, 1.0, 6, 6));
+  const submesh<cell::triangle> dm(m.get_boundary_submesh());
+  finite_element_space<fe_type> fes(m);
+  const array<double>& x(fes.get_dof_space_coordinates());
+
+  std::vector<const double*> calls;
+  const auto count([&calls](const double* x) -> double {
+      calls.push_back(x);
+      return calls.size() - 1;
+    });
+
+  const auto u_h(projector::lagrange<fe_type>(count, fes));
+  check(calls.size() == fes.get_dof_number(), "wrong call number");
+  for (std::size_t i(0); i < fes.get_dof_number(); ++i) {
+    check(calls[i] == &x.at(i, 0), "the dofs are not interpolated in order");
+    check(u_h.get_coefficients().at(i) == i, "wrong interpolation of a function with a state");
+  }
+
+  calls.clear();
+  fes.add_dirichlet_boundary(dm, count);
+  check(calls.size() >= fes.get_dirichlet_dof_values().size(), "wrong call number on the boundary");
+  std::vector<bool> seen(calls.size(), false);
+  for (const auto& i: fes.get_dirichlet_dof_values()) {
+    check(not seen[i.second], "a value of the boundary is given to two dofs");
+    check(calls[i.second] == &x.at(i.first, 0), "a boundary value is not the one of its dof");
+    seen[i.second] = true;
+  }
+}
+
+int main(int argc, char *argv[]) {
+  return run_tests("test_dof_coordinates", []() {
+      test_coordinates();
+      test_lagrange();
+      test_dirichlet();
+      test_call_order();
+    });
+}
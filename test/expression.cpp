@@ -237,10 +237,43 @@ void test_basis_function() {
   argument<2>(1.0, 'c', 67ul);
 }
 
+struct is_even {
+  template<typename IC>
+  struct apply: bool_constant<IC::value % 2 == 0> {};
+};
+
+void test_argument_dependency() {
+  const expression<form<0, 1, 0> > v0((form<0, 1, 0>()));
+  const expression<form<1, 1, 0> > v1((form<1, 1, 0>()));
+  const expression<form<2, 2, 0> > u0((form<2, 2, 0>()));
+  const expression<form<3, 2, 0> > u1((form<3, 2, 0>()));
+
+  const auto a(d<1>(u0) * d<1>(v0) + u1 * v1 + 2.0 * (u0 * v1 - g * u1 * v1));
+  using a_type = std::decay<decltype(a)>::type;
+
+  static_assert(expression_couples<a_type, 0, 2>::value, "");
+  static_assert(not expression_couples<a_type, 0, 3>::value, "");
+  static_assert(expression_couples<a_type, 1, 2>::value, "");
+  static_assert(expression_couples<a_type, 1, 3>::value, "");
+  static_assert(not expression_couples<a_type, 2, 3>::value, "");
+
+  const auto f(g * v1 + compose(std::sqrt, make_expr(g)) * d<2>(v1));
+  using f_type = std::decay<decltype(f)>::type;
+
+  static_assert(not expression_depends_on<f_type, 0>::value, "");
+  static_assert(expression_depends_on<f_type, 1>::value, "");
+
+  static_assert(std::is_same<filter_t<is_even, make_integral_list_t<std::size_t, 5> >,
+			     type_list<integral_constant<std::size_t, 0>,
+				       integral_constant<std::size_t, 2>,
+				       integral_constant<std::size_t, 4> > >::value, "");
+}
+
 int main(int argc, char *argv[]) {
   //test_basis_function();
   test_expression();
   test_valuation_selection();
+  test_argument_dependency();
   //  test_expression_call_wrapper();
   
   return 0;
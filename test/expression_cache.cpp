@@ -0,0 +1,65 @@
+#include <cmath>
+#include <iostream>
+#include <string>
+
+#include "../src/core/mesh.hpp"
+#include "../src/core/fe.hpp"
+#include "../src/core/fes.hpp"
+#include "../src/core/form.hpp"
+#include "../src/core/quadrature.hpp"
+
+#include "check.hpp"
+
+
+double u_0(const double* x) {
+  return 1.0 + x[0] * x[1] - 0.5 * x[0] * x[0];
+}
+
+/*
+ * The nodes of the same function share their coefficients and values
+ * on each cell: a form where the function appears several times is the
+ * one where each occurrence is a distinct function with the same
+ * coefficients.
+ */
+template<typename fe_type, typename quad_type>
+void test_convection(const fe_mesh<typename fe_type::cell_type>& m, const std::string& name) {
+  using fes_type = finite_element_space<fe_type>;
+
+  const fes_type fes(m);
+  array<double> coefficients{fes.get_dof_number()};
+  for (std::size_t i(0); i < fes.get_dof_number(); ++i) {
+    const auto x(fes.get_dof_space_coordinate(i));
+    coefficients.at(i) = u_0(&x.at(0, 0));
+  }
+  const typename fes_type::element u_h(fes, coefficients), w_h(fes, coefficients);
+
+  const auto u(make_expr<fe_type>(u_h));
+  const auto w(make_expr<fe_type>(w_h));
+
+  linear_form<fes_type> shared(fes), distinct(fes);
+  const auto v(shared.get_test_function());
+  shared += integrate<quad_type>(u * u * v + u * d<1>(u) * v + d<1>(u) * d<1>(u) * d<1>(v), m);
+  distinct += integrate<quad_type>(u * w * v + w * d<1>(u) * v + d<1>(w) * d<1>(u) * d<1>(v), m);
+
+  double max_difference(0.0), max_value(0.0);
+  for (std::size_t i(0); i < fes.get_dof_number(); ++i) {
+    max_difference = std::max(max_difference, std::abs(shared.get_coefficients().at(i)
+							- distinct.get_coefficients().at(i)));
+    max_value = std::max(max_value, std::abs(shared.get_coefficients().at(i)));
+  }
+  check(max_value > 0.0, name + ": empty form");
+  check(max_difference < 1.e-14 * max_value, name + ": the shared evaluation differs");
+
+  // and the integrals of the squares are the same
+  const double a(integrate<quad_type>(u * u * u + d<1>(u) * u, m));
+  const double b(integrate<quad_type>(u * w * u + d<1>(w) * w, m));
+  check(std::abs(a - b) < 1.e-14 * std::abs(a), name + ": the shared integral differs");
+}
+
+int main(int argc, char *argv[]) {
+  return run_tests("test_expression_cache", []() {
+      test_convection<cell::triangle::fe::lagrange_p2, quad::triangle::qf5pT>(gen_square_mesh(1.0, 1.0, 8, 8), "triangle");
+      test_convection<cell::tetrahedron::fe::lagrange_p1_bubble, quad::tetrahedron::qfSym10pTet>(
+	gen_cube_mesh(1.0, 1.0, 1.0, 3, 3, 3), "tetrahedron");
+    });
+}
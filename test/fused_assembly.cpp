@@ -0,0 +1,169 @@
+#include <cmath>
+#include <iostream>
+#include <string>
+
+#include "../src/core/mesh.hpp"
+#include "../src/core/fe.hpp"
+#include "../src/core/fes.hpp"
+#include "../src/core/form.hpp"
+#include "../src/core/quadrature.hpp"
+#include "../src/core/projector.hpp"
+#include "../src/core/fused_assembly.hpp"
+
+#include "check.hpp"
+
+
+double g(const double* x) {
+  return std::sin(2.0 * x[0]) + x[1];
+}
+
+/*
+ * The Newton step of -div((1 + u^2) grad u) = g and two norms of the
+ * iterate, in one pass, are the ones of the separate assemblies.
+ */
+void test_triangle() {
+  using fe_type = cell::triangle::fe::lagrange_p2;
+  using fes_type = finite_element_space<fe_type>;
+  using quad_type = quad::triangle::qf5pT;
+
+  const fe_mesh<cell::triangle> m(gen_square_mesh(1.0, 1.0, 8, 8));
+  const fes_type fes(m);
+  const auto u_h(projector::lagrange<fe_type>(g, fes));
+  const auto w(make_expr<fe_type>(u_h));
+
+  bilinear_form<fes_type, fes_type> a(fes, fes), a_ref(fes, fes);
+  linear_form<fes_type> f(fes), f_ref(fes);
+  const auto u(a.get_trial_function());
+  const auto v(a.get_test_function());
+
+  const auto jacobian((make_expr(1.0) + w * w) * (d<1>(u) * d<1>(v) + d<2>(u) * d<2>(v))
+		      + 2.0 * w * u * (d<1>(w) * d<1>(v) + d<2>(w) * d<2>(v)));
+  const auto residual(make_expr(g) * v - (make_expr(1.0) + w * w) * (d<1>(w) * d<1>(v) + d<2>(w) * d<2>(v)));
+
+  double l2(0.0), h1(0.0);
+  fused_assembly::assemble(fused_assembly::make_term(a, integrate<quad_type>(jacobian, m)),
+			   fused_assembly::make_term(f, integrate<quad_type>(residual, m)),
+			   fused_assembly::make_term<quad_type>(l2, w * w, m),
+			   fused_assembly::make_term<quad_type>(h1, d<1>(w) * d<1>(w) + d<2>(w) * d<2>(w), m));
+
+  a_ref += integrate<quad_type>(jacobian, m);
+  f_ref += integrate<quad_type>(residual, m);
+  const double l2_ref(integrate<quad_type>(w * w, m));
+  const double h1_ref(integrate<quad_type>(d<1>(w) * d<1>(w) + d<2>(w) * d<2>(w), m));
+
+  check_same_pattern(a.get_operator(), a_ref.get_operator(), "triangle");
+  check_same_operator(a.get_operator(), a_ref.get_operator(), "triangle", 1.e-14);
+  check_same_vector(f.get_coefficients(), f_ref.get_coefficients(), "triangle", 1.e-14);
+  check(std::abs(l2 - l2_ref) <= 1.e-14 * l2_ref, "triangle: the L2 norms differ");
+  check(std::abs(h1 - h1_ref) <= 1.e-14 * h1_ref, "triangle: the H1 seminorms differ");
+
+  // the functionals alone
+  double l2_only(0.0);
+  fused_assembly::assemble(fused_assembly::make_term<quad_type>(l2_only, w * w, m));
+  check(std::abs(l2_only - l2_ref) <= 1.e-14 * l2_ref, "triangle: the functional alone differs");
+
+  // the terms are on the same mesh
+  const fe_mesh<cell::triangle> other(gen_square_mesh(1.0, 1.0, 8, 8));
+  double other_l2(0.0);
+  bool thrown(false);
+  try {
+    fused_assembly::assemble(fused_assembly::make_term(f, integrate<quad_type>(residual, m)),
+			     fused_assembly::make_term<quad_type>(other_l2, w * w, other));
+  } catch (const std::string&) {
+    thrown = true;
+  }
+  check(thrown, "triangle: the terms on different meshes are accepted");
+}
+
+/*
+ * Forms on different spaces of the same mesh.
+ */
+void test_tetrahedron() {
+  using p1_type = cell::tetrahedron::fe::lagrange_p1;
+  using bubble_type = cell::tetrahedron::fe::lagrange_p1_bubble;
+  using p1_fes_type = finite_element_space<p1_type>;
+  using bubble_fes_type = finite_element_space<bubble_type>;
+  using quad_type = quad::tetrahedron::qfSym20pTet;
+
+  const fe_mesh<cell::tetrahedron> m(gen_cube_mesh(1.0, 1.0, 1.0, 3, 3, 3));
+  const p1_fes_type p1_fes(m);
+  const bubble_fes_type bubble_fes(m);
+  const auto c_h(projector::lagrange<p1_type>(g, p1_fes));
+  const auto c(make_expr<p1_type>(c_h));
+
+  bilinear_form<bubble_fes_type, p1_fes_type> a(bubble_fes, p1_fes), a_ref(bubble_fes, p1_fes);
+  linear_form<p1_fes_type> f(p1_fes), f_ref(p1_fes);
+  const auto u(a.get_trial_function());
+  const auto v(a.get_test_function());
+  const auto q(f.get_test_function());
+
+  fused_assembly::assemble(fused_assembly::make_term(a, integrate<quad_type>(c * (d<1>(u) * d<1>(v) + u * v), m)),
+			   fused_assembly::make_term(f, integrate<quad_type>(c * d<3>(c) * q, m)));
+  a_ref += integrate<quad_type>(c * (d<1>(u) * d<1>(v) + u * v), m);
+  f_ref += integrate<quad_type>(c * d<3>(c) * q, m);
+
+  check_same_pattern(a.get_operator(), a_ref.get_operator(), "tetrahedron");
+  check_same_operator(a.get_operator(), a_ref.get_operator(), "tetrahedron", 1.e-14);
+  check_same_vector(f.get_coefficients(), f_ref.get_coefficients(), "tetrahedron", 1.e-14);
+}
+
+/*
+ * The functionals are the separate integrals, and do not depend on the
+ * thread number.
+ */
+void test_functionals() {
+  using fe_type = cell::triangle::fe::lagrange_p2;
+  using fes_type = finite_element_space<fe_type>;
+  using quad_type = quad::triangle::qf5pT;
+
+  const fe_mesh<cell::triangle> m(gen_square_mesh(1.0, 1.0, 16, 16));
+  const fes_type fes(m);
+  const auto u_h(projector::lagrange<fe_type>(g, fes));
+  const auto u(make_expr<fe_type>(u_h));
+
+  parallel::set_thread_number(1);
+  const auto serial(fused_assembly::integrate_functionals<quad_type>(m, u * u, d<1>(u) * d<1>(u), make_expr(g) * u));
+  const double l2_serial(integrate<quad_type>(u * u, m));
+  check(std::abs(serial[0] - l2_serial) <= 1.e-14 * l2_serial, "functionals: the L2 norms differ");
+  check(std::abs(serial[1] - integrate<quad_type>(d<1>(u) * d<1>(u), m)) <= 1.e-14 * serial[1],
+	"functionals: the derivative norms differ");
+
+  for (std::size_t n_thread: {2, 3, 8}) {
+    parallel::set_thread_number(n_thread);
+    const auto values(fused_assembly::integrate_functionals<quad_type>(m, u * u, d<1>(u) * d<1>(u), make_expr(g) * u));
+    for (std::size_t i(0); i < values.size(); ++i)
+      check(values[i] == serial[i], "functionals: the result depends on the thread number");
+    check(integrate<quad_type>(u * u, m) == l2_serial, "functionals: the integral depends on the thread number");
+  }
+}
+
+/*
+ * The compensation recovers the terms lost in the rounding.
+ */
+void test_compensated_sum() {
+  compensated_sum s;
+  for (double x: {1.0, 1.e100, 1.0, -1.e100})
+    s.add(x);
+  check(s.get_value() == 2.0, "compensated_sum: the small terms are lost");
+
+  compensated_sum t, t_0, t_1;
+  double naive(0.0);
+  for (std::size_t i(0); i < 1000000; ++i) {
+    t.add(0.1);
+    (i % 2 ? t_1 : t_0).add(0.1);
+    naive += 0.1;
+  }
+  t_0.add(t_1);
+  check(std::abs(t.get_value() - 1.e5) <= 1.e-10, "compensated_sum: inaccurate sum");
+  check(std::abs(t_0.get_value() - 1.e5) <= 1.e-10, "compensated_sum: inaccurate merged sum");
+  check(std::abs(naive - 1.e5) > 1.e-8, "compensated_sum: the naive sum is exact");
+}
+
+int main(int argc, char *argv[]) {
+  return run_tests("test_fused_assembly", []() {
+      test_triangle();
+      test_tetrahedron();
+      test_functionals();
+      test_compensated_sum();
+    });
+}
@@ -0,0 +1,149 @@
+#include <iostream>
+#include <fstream>
+#include <cstdint>
+
+#include "../src/core/mesh.hpp"
+#include "../src/core/mesh_data.hpp"
+#include "../src/core/export.hpp"
+#include "../src/utility/gmsh_importer.hpp"
+
+
+/*
+ * Unit square split in two triangles, with the physical surface 10
+ * ("domain"), and the physical curves 1 ("bottom") and 2 ("wall").
+ * Node 5 does not belong to any cell.
+ */
+void write_square_ascii(const std::string& filename) {
+  std::ofstream file(filename.c_str());
+  file << "$MeshFormat\n4.1 0 8\n$EndMeshFormat\n"
+       << "$PhysicalNames\n3\n1 1 \"bottom\"\n1 2 \"wall\"\n2 10 \"domain\"\n$EndPhysicalNames\n"
+       << "$Entities\n0 2 1 0\n"
+       << "1 0 0 0 1 0 0 1 1 0\n"
+       << "2 0 0 0 1 1 0 1 2 0\n"
+       << "1 0 0 0 1 1 0 1 10 0\n"
+       << "$EndEntities\n"
+       << "$Nodes\n1 5 1 5\n2 1 0 5\n1\n2\n3\n4\n5\n"
+       << "0 0 0\n1 0 0\n1 1 0\n0 1 0\n2 2 0\n$EndNodes\n"
+       << "$Elements\n3 7 1 7\n"
+       << "1 1 1 1\n1 1 2\n"
+       << "1 2 1 3\n2 2 3\n3 3 4\n4 4 1\n"
+       << "2 1 2 2\n6 1 2 3\n7 1 3 4\n"
+       << "$EndElements\n";
+}
+
+template<typename T>
+void write_binary(std::ostream& stream, T value) {
+  stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void write_square_binary(const std::string& filename) {
+  std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary);
+  file << "$MeshFormat\n4.1 1 8\n";
+  write_binary<int>(file, 1);
+  file << "\n$EndMeshFormat\n";
+  file << "$PhysicalNames\n3\n1 1 \"bottom\"\n1 2 \"wall\"\n2 10 \"domain\"\n$EndPhysicalNames\n";
+
+  file << "$Entities\n";
+  for (std::size_t n: {0, 2, 1, 0})
+    write_binary<std::size_t>(file, n);
+  const int curve_physical[] = {1, 2};
+  for (int c(0); c < 2; ++c) {
+    write_binary<int>(file, c + 1);
+    for (double x: {0.0, 0.0, 0.0, 1.0, 1.0, 0.0})
+      write_binary<double>(file, x);
+    write_binary<std::size_t>(file, 1);
+    write_binary<int>(file, curve_physical[c]);
+    write_binary<std::size_t>(file, 0);
+  }
+  write_binary<int>(file, 1);
+  for (double x: {0.0, 0.0, 0.0, 1.0, 1.0, 0.0})
+    write_binary<double>(file, x);
+  write_binary<std::size_t>(file, 1);
+  write_binary<int>(file, 10);
+  write_binary<std::size_t>(file, 0);
+  file << "\n$EndEntities\n";
+
+  file << "$Nodes\n";
+  for (std::size_t n: {1, 5, 1, 5})
+    write_binary<std::size_t>(file, n);
+  for (int n: {2, 1, 0})
+    write_binary<int>(file, n);
+  write_binary<std::size_t>(file, 5);
+  for (std::size_t n: {1, 2, 3, 4, 5})
+    write_binary<std::size_t>(file, n);
+  for (double x: {0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 1.0, 1.0, 0.0, 0.0, 1.0, 0.0, 2.0, 2.0, 0.0})
+    write_binary<double>(file, x);
+  file << "\n$EndNodes\n";
+
+  file << "$Elements\n";
+  for (std::size_t n: {3, 7, 1, 7})
+    write_binary<std::size_t>(file, n);
+  for (int n: {1, 1, 1})
+    write_binary<int>(file, n);
+  write_binary<std::size_t>(file, 1);
+  for (std::size_t n: {1, 1, 2})
+    write_binary<std::size_t>(file, n);
+  for (int n: {1, 2, 1})
+    write_binary<int>(file, n);
+  write_binary<std::size_t>(file, 3);
+  for (std::size_t n: {2, 2, 3, 3, 3, 4, 4, 4, 1})
+    write_binary<std::size_t>(file, n);
+  for (int n: {2, 1, 2})
+    write_binary<int>(file, n);
+  write_binary<std::size_t>(file, 2);
+  for (std::size_t n: {6, 1, 2, 3, 7, 1, 3, 4})
+    write_binary<std::size_t>(file, n);
+  file << "\n$EndElements\n";
+}
+
+void check_square(const std::string& filename) {
+  using cell_type = cell::triangle;
+
+  importer::gmsh::mesh_file<cell_type> f(filename);
+  const fe_mesh<cell_type>& m(f.get_mesh());
+
+  if (m.get_vertex_number() != 4 or m.get_cell_number() != 2)
+    throw std::string("check_square: unexpected mesh size");
+
+  if (m.get_references().at(0) != 10 or m.get_references().at(1) != 10)
+    throw std::string("check_square: unexpected cell references");
+
+  submesh<cell_type>
+    bottom(f.get_boundary_submesh("bottom")),
+    wall(f.get_boundary_submesh(f.get_physical_tag("wall"))),
+    boundary(f.get_tagged_facets_submesh());
+
+  if (bottom.get_cell_number() != 1 or wall.get_cell_number() != 3 or boundary.get_cell_number() != 4)
+    throw std::string("check_square: unexpected boundary submesh size");
+
+  for (std::size_t n(0); n < 2; ++n)
+    if (bottom.get_vertices().at(bottom.get_cells().at(0, n), 1) != 0.0)
+      throw std::string("check_square: unexpected bottom facet");
+
+  std::cout << filename << ": " << m.get_vertex_number() << " vertices, "
+	    << m.get_cell_number() << " cells, "
+	    << boundary.get_cell_number() << " tagged facets" << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+  try {
+    write_square_ascii("gmsh_square_ascii.msh");
+    check_square("gmsh_square_ascii.msh");
+
+    write_square_binary("gmsh_square_binary.msh");
+    check_square("gmsh_square_binary.msh");
+
+    if (argc == 2) {
+      importer::gmsh::mesh_file<cell::tetrahedron> f(argv[1]);
+      std::cout << argv[1] << ": " << f.get_mesh().get_vertex_number() << " vertices, "
+		<< f.get_mesh().get_cell_number() << " cells, "
+		<< f.get_tagged_facets_submesh().get_cell_number() << " tagged facets" << std::endl;
+      exporter::vtu_geometry("gmsh_import", f.get_mesh());
+    }
+  } catch (const std::string& e) {
+    std::cout << e << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,96 @@
+#include <cmath>
+#include <iostream>
+#include <string>
+
+#include "../src/core/mesh.hpp"
+#include "../src/core/fe.hpp"
+#include "../src/core/fes.hpp"
+#include "../src/core/quadrature.hpp"
+#include "../src/core/projector.hpp"
+
+#include "check.hpp"
+
+
+double f_0(const double* x) {
+  return std::sin(3.0 * x[0]) + x[1] * x[1];
+}
+
+double f_1(const double* x) {
+  return 1.0 + 2.0 * x[0] - x[1];
+}
+
+double f_2(const double* x) {
+  return x[0] * x[1] - x[0] * x[0] + 0.5 * x[1];
+}
+
+/*
+ * The cell-local projection on P0 is the mean value of the function on
+ * each cell, computed with the quadrature.
+ */
+template<typename cell_type, typename quad_type>
+void test_p0(const fe_mesh<cell_type>& m, const std::string& name) {
+  using fe_type = typename cell_type::fe::lagrange_p0;
+  using fes_type = finite_element_space<fe_type>;
+  fes_type fes(m);
+
+  const projector::l2_projector<fe_type, quad_type> l2(fes);
+  const auto u(l2(f_0));
+
+  double max_difference(0.0);
+  for (std::size_t k(0); k < m.get_cell_number(); ++k) {
+    array<double> x_hat{quad_type::n_point, cell_type::n_dimension};
+    x_hat.set_data(&quad_type::x[0][0]);
+    const array<double> x(cell_type::map_points_to_space_coordinates(m.get_vertices(), m.get_cells(), k, x_hat));
+
+    double mean(0.0);
+    for (std::size_t q(0); q < quad_type::n_point; ++q)
+      mean += quad_type::w[q] * f_0(&x.at(q, 0));
+
+    max_difference = std::max(max_difference, std::abs(u.get_coefficients().at(fes.get_dof(k, 0)) - mean));
+  }
+  check(max_difference < 1.e-12, name + ": the projection is not the cell mean value");
+
+  // the free function takes the same path
+  const auto v(projector::l2<fe_type, quad_type>(f_0, fes));
+  for (std::size_t i(0); i < fes.get_dof_number(); ++i)
+    check(u.get_coefficients().at(i) == v.get_coefficients().at(i), name + ": projections differ");
+}
+
+/*
+ * A projector on a continuous space reuses its mass matrix for several
+ * functions, and reproduces the functions of the space.
+ */
+void test_continuous() {
+  using cell_type = cell::triangle;
+  using fe_type = cell_type::fe::lagrange_p2;
+  using fes_type = finite_element_space<fe_type>;
+  using quad_type = quad::triangle::qf5pT;
+
+  const fe_mesh<cell_type> m(gen_square_mesh(1.0, 1.0, 8, 8));
+  fes_type fes(m);
+
+  std::unique_ptr<solver::lapack::lu> s(new solver::lapack::lu());
+  s->set_operator_size(fes.get_dof_number());
+  const projector::l2_projector<fe_type, quad_type> l2(fes, std::move(s));
+  check(not l2.cell_local, "p2 space considered as cell local");
+
+  for (const auto f: {f_1, f_2}) {
+    const auto u(l2(f));
+    double max_difference(0.0);
+    for (std::size_t i(0); i < fes.get_dof_number(); ++i) {
+      const auto x(fes.get_dof_space_coordinate(i));
+      max_difference = std::max(max_difference, std::abs(u.get_coefficients().at(i) - f(&x.at(0, 0))));
+    }
+    check(max_difference < 1.e-10, "the projection of a function of the space differs from it by "
+	  + std::to_string(max_difference));
+  }
+}
+
+int main(int argc, char *argv[]) {
+  return run_tests("test_l2_projector", []() {
+      test_p0<cell::triangle, quad::triangle::qf5pT>(gen_square_mesh(1.0, 1.0, 20, 20), "triangle p0");
+      test_p0<cell::tetrahedron, quad::tetrahedron::qfSym4pTet>(gen_cube_mesh(1.0, 1.0, 1.0, 5, 5, 5),
+								"tetrahedron p0");
+      test_continuous();
+    });
+}
@@ -1,3 +1,8 @@
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
 #include "../src/core/mesh_data.hpp"
 #include "../src/core/export.hpp"
 #include "../src/core/fe.hpp"
@@ -73,12 +78,78 @@ void test_3() {
   exporter::ensight6("export_mesh_data_to_fes_element", data, "data");
 }
 
+void test_4() {
+  using cell_type = cell::triangle;
+  using mesh_type = fe_mesh<cell_type>;
+
+  mesh_type m(gen_square_mesh(1.0, 1.0, 10, 10));
+  submesh<cell_type> dm(m.get_boundary_submesh());
+
+  mesh_data<double, mesh_type>
+    vertex_data(evaluate_on_vertices(m, b0, b1)),
+    cell_data(evaluate_on_cells(m, b2));
+
+  exporter::vtu("vtu_export", vertex_data, "b", cell_data, "c");
+  exporter::vtu_geometry("vtu_export_boundary", dm);
+
+  exporter::pvtu("pvtu_export", 0, 2, vertex_data, "b");
+  exporter::pvtu("pvtu_export", 1, 2, vertex_data, "b");
+
+  exporter::pvd_transient series("pvd_export");
+  for (std::size_t n(0); n < 3; ++n)
+    series.export_time_step(0.1 * n, vertex_data, "b", cell_data, "c");
+}
+
+bool file_exists(const std::string& filename) {
+  std::ifstream file(filename.c_str());
+  return bool(file);
+}
+
+/*
+ * A time series written in two pieces: the collection of the piece 0
+ * refers to the .pvtu indices, which refer to the two pieces.
+ */
+void test_5() {
+  using cell_type = cell::triangle;
+  using mesh_type = fe_mesh<cell_type>;
+
+  mesh_type m(gen_square_mesh(1.0, 1.0, 10, 10));
+  mesh_data<double, mesh_type> vertex_data(evaluate_on_vertices(m, b0, b1));
+
+  exporter::pvd_transient series_0("pvd_piece_export"), series_1("pvd_piece_export");
+  for (std::size_t n(0); n < 2; ++n) {
+    series_0.export_time_step_piece(0.1 * n, 0, 2, vertex_data, "b");
+    series_1.export_time_step_piece(0.1 * n, 1, 2, vertex_data, "b");
+  }
+
+  std::ifstream file("pvd_piece_export.pvd");
+  std::stringstream collection;
+  collection << file.rdbuf();
+  for (const std::string step: {"pvd_piece_export_000000", "pvd_piece_export_000001"}) {
+    if (collection.str().find("file=\"" + step + ".pvtu\"") == std::string::npos)
+      throw std::string("test_mesh_data: ") + step + ".pvtu is not in the collection";
+
+    std::ifstream index((step + ".pvtu").c_str());
+    std::stringstream pieces;
+    pieces << index.rdbuf();
+    for (const std::string piece: {"_0000.vtu", "_0001.vtu"})
+      if (pieces.str().find(step + piece) == std::string::npos or not file_exists(step + piece))
+	throw std::string("test_mesh_data: missing piece ") + step + piece;
+  }
+}
+
 int main(int argc, char *argv[]) {
+  try {
+    test_1();
+    test_2();
+    test_3();
+    test_4();
+    test_5();
+  } catch (const std::string& e) {
+    std::cout << e << std::endl;
+    return 1;
+  }
 
-  test_1();
-  test_2();
-  test_3();
-  
   return 0;
 }
 
@@ -4,6 +4,8 @@
 #include "../src/core/composite_fe.hpp"
 #include "../src/core/composite_fes.hpp"
 #include "../src/core/composite_form.hpp"
+#include "../src/core/fused_assembly.hpp"
+#include "../src/core/newton.hpp"
 #include "../src/core/quadrature.hpp"
 #include "../src/core/export.hpp"
 
@@ -264,8 +266,7 @@ void navier_stokes(std::size_t n) {
   finite_element_space<p_fe_type>::element
     p(fes.get_finite_element_space<2>(), p_comp);
     
-  fes_type::element x(fes, u0, u1, p);
-  fes_type::element xp(x);
+  fes_type::element xp(fes, u0, u1, p);
 
   /*
    *  model and numerical parameters
@@ -278,163 +279,72 @@ void navier_stokes(std::size_t n) {
   const double newton_rtol(1.0e-8);
 
   /*
-   *  storage for timing statistics 
+   *  the residual of the time step, for the velocity v and the pressure
+   *  p of the next time, and the velocity u of the previous one, in u0
+   *  and u1
    */
-  double
-    bilinear_form_elapsed_time(0.0),
-    linear_form_elapsed_time(0.0),
-    linear_solve_elapsed_time(0.0);
+  newton_solver<fes_type> newton(fes);
+  newton.set_max_iteration_number(newton_max_step);
+  newton.set_tolerances(newton_rtol, 1.e-12);
 
-  /*
-   *  time iteration loop
-   */
-  double time(0.0);
-  for (std::size_t k(0); k < end_time_step; ++k) {
-    std::cout << "time step #" << k << "(time " << time << ")" << std::endl;
-      
-    time += time_step;
+  auto v0(newton.get_unknown<0>());
+  auto v1(newton.get_unknown<1>());
+  auto pn(newton.get_unknown<2>());
 
+  auto w0(newton.get_test_function<0>());
+  auto w1(newton.get_test_function<1>());
+  auto q (newton.get_test_function<2>());
 
-    /*
-     *  newton iteration loop
-     */
-    bool newton_done(false);
-    for (std::size_t j(0); j < newton_max_step and not newton_done; ++j) {
-      std::cout << "newton step #" << j << " of " << newton_max_step << std::endl;
+  auto un0(make_expr<u_fe_type>(u0));
+  auto un1(make_expr<u_fe_type>(u1));
 
-      auto v0_h(xp.template get_component<0>());
-      auto v1_h(xp.template get_component<1>());
+  const auto r((v0 - un0) * w0 + (v1 - un1) * w1 +
 
-      auto v0(make_expr<u_fe_type>(v0_h));
-      auto v1(make_expr<u_fe_type>(v1_h)); 
+               time_step * ((v0 * d<1>(v0) + v1 * d<2>(v0)) * w0 +
+                            (v0 * d<1>(v1) + v1 * d<2>(v1)) * w1) +
 
-        
-      bilinear_form<fes_type, fes_type> a(fes, fes); {
-        timer t;
-          
-        auto w0(a.get_test_function<0>());
-        auto w1(a.get_test_function<1>());
-        auto q (a.get_test_function<2>());
-      
-        auto vn0(a.get_trial_function<0>());
-        auto vn1(a.get_trial_function<1>());
-        auto pn (a.get_trial_function<2>());
+               (time_step / reynolds) * (d<1>(v0) * d<1>(w0) + d<2>(v0) * d<2>(w0) +
+                                         d<1>(v1) * d<1>(w1) + d<2>(v1) * d<2>(w1)) +
 
-        a += integrate<quad_type>(vn0 * w0 + vn1 * w1 +
-          
-                                  time_step * (vn0 * d<1>(v0) * w0 +
-                                               vn0 * d<1>(v1) * w1 +
-                                               vn1 * d<2>(v0) * w0 +
-                                               vn1 * d<2>(v1) * w1) +
-
-                                  time_step * (v0 * d<1>(vn0) * w0 +
-                                               v0 * d<1>(vn1) * w1 +
-                                               v1 * d<2>(vn0) * w0 +
-                                               v1 * d<2>(vn1) * w1) +
-
-                                  (time_step / reynolds) * (d<1>(vn0) * d<1>(w0) + d<2>(vn0) * d<2>(w0) +
-                                                            d<1>(vn1) * d<1>(w1) + d<2>(vn1) * d<2>(w1)) +
-                                    
-                                  time_step * pn * (d<1>(w0) + d<2>(w1)) +
-                                    
-                                  time_step * q * (d<1>(vn0) + d<2>(vn1))
-                                  , m);
+               time_step * pn * (d<1>(w0) + d<2>(w1)) +
 
-        bilinear_form_elapsed_time = t.tic();
-      }
+               time_step * q * (d<1>(v0) + d<2>(v1)) -
 
-      linear_form<fes_type> f(fes); {
-        timer t;
-          
-        auto w0(f.get_test_function<0>());
-        auto w1(f.get_test_function<1>());
+               time_step * (f0 * w0 + f1 * w1));
 
-        auto u0_h(x.template get_component<0>());
-        auto u1_h(x.template get_component<1>());
+  dictionary param(dictionary()
+                   .set("maxits",  2000u)
+                   .set("restart", 1000u)
+                   .set("rtol",    1.e-8)
+                   .set("abstol",  1.e-50)
+                   .set("dtol",    1.e20)
+                   .set("ilufill", 2u));
+  solver::petsc::gmres_ilu s(param);
 
-        auto u0(make_expr<u_fe_type>(u0_h));
-        auto u1(make_expr<u_fe_type>(u1_h));
+  /*
+   *  time iteration loop
+   */
+  double time(0.0);
+  for (std::size_t k(0); k < end_time_step; ++k) {
+    std::cout << "time step #" << k << "(time " << time << ")" << std::endl;
+      
+    time += time_step;
 
-        f += integrate<quad_type>( u0 * w0 + u1 * w1 +
+    timer t;
+    dictionary report;
+    const bool converged(newton.solve<quad_type>(xp, r, s, &report));
+    const double newton_elapsed_time(t.tic());
 
-                                   time_step * (f0 * w0 +
-                                                f1 * w1) + 
+    std::cout << "newton steps " << report.get<std::size_t>("iterations")
+              << ", residual norm " << report.get<double>("residual_norm")
+              << (converged ? "" : " (not converged)") << std::endl;
 
-                                   time_step * (v0 * d<1>(v0) * w0 +
-                                                v0 * d<1>(v1) * w1 +
-                                                v1 * d<2>(v0) * w0 +
-                                                v1 * d<2>(v1) * w1)
-                                   , m);
-        /*
-          f += integrate<quad_type>( u0 * w0 + u1 * w1
-          , m);
-      
-          f += integrate<quad_type>( time_step * (f0 * w0 +
-          f1 * w1)
-          , m);
-
-          f += integrate<quad_type>( time_step * (v0 * d<1>(v0) * w0 +
-          v0 * d<1>(v1) * w1 +
-          v1 * d<2>(v0) * w0 +
-          v1 * d<2>(v1) * w1)
-          , m);
-        */
-        linear_form_elapsed_time = t.tic();
-      }
-
-      dictionary param(dictionary()
-                       .set("maxits",  2000u)
-                       .set("restart", 1000u)
-                       .set("rtol",    1.e-8)
-                       .set("abstol",  1.e-50)
-                       .set("dtol",    1.e20)
-                       .set("ilufill", 2u));
-      solver::petsc::gmres_ilu s(param);
-      
-      timer t;
-      auto xpp(a.solve(f, s));
-      linear_solve_elapsed_time = t.tic();
+    u0 = xp.template get_component<0>();
+    u1 = xp.template get_component<1>();
 
-        
-      /*
-       *  compute the velocity step norm, velocity norm and relative step norm
-       */
-      auto vn0_h(xpp.template get_component<0>());
-      auto vn1_h(xpp.template get_component<1>());
-
-      const double
-        newton_step_0_norm(std::sqrt(integrate<quad_type>((make_expr<u_fe_type>(vn0_h) - make_expr<u_fe_type>(v0_h)) *
-                                                          (make_expr<u_fe_type>(vn0_h) - make_expr<u_fe_type>(v0_h))
-                                                          , m))),
-        newton_step_1_norm(std::sqrt(integrate<quad_type>((make_expr<u_fe_type>(vn1_h) - make_expr<u_fe_type>(v1_h)) *
-                                                          (make_expr<u_fe_type>(vn1_h) - make_expr<u_fe_type>(v1_h))
-                                                          , m)));
-      const double
-        velocity_0_norm(std::sqrt(integrate<quad_type>(make_expr<u_fe_type>(vn0_h) * make_expr<u_fe_type>(vn0_h), m))),
-        velocity_1_norm(std::sqrt(integrate<quad_type>(make_expr<u_fe_type>(vn1_h) * make_expr<u_fe_type>(vn1_h), m)));
-
-      std::cout << "newton step norm (" << newton_step_0_norm << ", " << newton_step_1_norm << ")" << std::endl;
-      std::cout << "velocity norm (" << velocity_0_norm << ", " << velocity_1_norm << ")" << std::endl;
-      std::cout << "newton relative step norm ("
-                << newton_step_0_norm / velocity_0_norm << ", "
-                << newton_step_1_norm / velocity_1_norm << ")"
-                << std::endl;
-
-      const double
-        newton_relative_step_0_norm(newton_step_0_norm / velocity_0_norm),
-        newton_relative_step_1_norm(newton_step_1_norm / velocity_1_norm);
-        
-      newton_done = (newton_relative_step_0_norm < newton_rtol and
-                     newton_relative_step_1_norm < newton_rtol);
-        
-      xp = xpp;
-      std::cout << "elapsed time (bilinear, linear, solve): ("
-                << bilinear_form_elapsed_time << ", "
-                << linear_form_elapsed_time << ", "
-                << linear_solve_elapsed_time << ")" << std::endl;
-    }
-
-    x = xp;
+    const auto norms(fused_assembly::integrate_functionals<quad_type>(m, un0 * un0, un1 * un1));
+    std::cout << "velocity norm (" << std::sqrt(norms[0]) << ", " << std::sqrt(norms[1]) << ")" << std::endl;
+    std::cout << "elapsed time (newton): " << newton_elapsed_time << std::endl;
   }
 
   /*
@@ -0,0 +1,300 @@
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../src/core/mesh.hpp"
+#include "../src/core/fe.hpp"
+#include "../src/core/fes.hpp"
+#include "../src/core/form.hpp"
+#include "../src/core/quadrature.hpp"
+#include "../src/core/projector.hpp"
+#include "../src/core/composite_fe.hpp"
+#include "../src/core/composite_fes.hpp"
+#include "../src/core/newton.hpp"
+
+#include "check.hpp"
+
+
+using fe_type = cell::triangle::fe::lagrange_p2;
+using fes_type = finite_element_space<fe_type>;
+using quad_type = quad::triangle::qf5pT;
+
+double g(const double* x) {
+  return std::sin(2.0 * x[0]) + x[1];
+}
+
+// -div((1 + u^2) grad u) = source for u = x + y
+double exact(const double* x) {
+  return x[0] + x[1];
+}
+
+double source(const double* x) {
+  return -4.0 * (x[0] + x[1]);
+}
+
+/*
+ * A direct solver which records the tolerances and the operators it
+ * is given, with the relative tolerance of an iterative one.
+ */
+class recording_solver: public solver::lapack::lu {
+public:
+  recording_solver(): n_operator(0), rtol(1.e-6) {}
+
+  void set_operator(const sparse_matrix& m) {
+    ++n_operator;
+    solver::lapack::lu::set_operator(m);
+  }
+
+  void set_relative_tolerance(double rtol) {
+    tolerances.push_back(rtol);
+    this->rtol = rtol;
+  }
+
+  double get_relative_tolerance() const { return rtol; }
+
+  std::size_t n_operator;
+  std::vector<double> tolerances;
+  double rtol;
+};
+
+/*
+ * The derivative of the residual is the hand-derived jacobian, and the
+ * finite element functions other than the unknown are constant.
+ */
+void test_linearize() {
+  const fe_mesh<cell::triangle> m(gen_square_mesh(1.0, 1.0, 6, 6));
+  const fes_type fes(m);
+  const auto w_h(projector::lagrange<fe_type>(g, fes));
+  const auto z_h(projector::lagrange<fe_type>(exact, fes));
+  const auto w(make_unknown<fe_type>(w_h));
+  const auto z(make_expr<fe_type>(z_h));
+  const auto w_0(make_expr<fe_type>(w_h));
+
+  bilinear_form<fes_type, fes_type> a(fes, fes), a_ref(fes, fes);
+  const auto u(a.get_trial_function());
+  const auto v(a.get_test_function());
+
+  const auto r((make_expr(1.0) + w * w) * (d<1>(w) * d<1>(v) + d<2>(w) * d<2>(v)) - z * w * w * v + w_0 * w_0 * v);
+  a += integrate<quad_type>(linearize(r), m);
+  a_ref += integrate<quad_type>((make_expr(1.0) + w * w) * (d<1>(u) * d<1>(v) + d<2>(u) * d<2>(v))
+				+ 2.0 * w * u * (d<1>(w) * d<1>(v) + d<2>(w) * d<2>(v))
+				- 2.0 * z * w * u * v, m);
+  check_same_operator(a.get_operator(), a_ref.get_operator(), "linearize");
+
+  static_assert(decltype(linearize(z * w * v))::rank == 2, "");
+}
+
+double cube(double x) {
+  return x * x * x;
+}
+
+double cube_derivative(double x) {
+  return 3.0 * x * x;
+}
+
+/*
+ * The quotients and the compositions are derived by the quotient and
+ * the chain rules, and the derivatives in space by the product rule.
+ */
+void test_linearize_rules() {
+  const fe_mesh<cell::triangle> m(gen_square_mesh(1.0, 1.0, 6, 6));
+  const fes_type fes(m);
+  const auto w_h(projector::lagrange<fe_type>(g, fes));
+  const auto z_h(projector::lagrange<fe_type>(exact, fes));
+  const auto w(make_unknown<fe_type>(w_h));
+  const auto z(make_expr<fe_type>(z_h));
+
+  bilinear_form<fes_type, fes_type> a(fes, fes), a_ref(fes, fes);
+  const auto u(a.get_trial_function());
+  const auto v(a.get_test_function());
+
+  const auto q(make_expr(1.0) + w * w);
+  const auto r(compose(std::exp, w) / q * v + compose(std::sin, d<1>(w)) * d<1>(v)
+	       + z / q * d<2>(v) + compose(cube, cube_derivative, w) * v);
+  a += integrate<quad_type>(linearize(r), m);
+  a_ref += integrate<quad_type>((compose(std::exp, w) * u * q - compose(std::exp, w) * (2.0 * w * u)) / (q * q) * v
+				+ compose(std::cos, d<1>(w)) * d<1>(u) * d<1>(v)
+				- 2.0 * z * w * u / (q * q) * d<2>(v)
+				+ 3.0 * w * w * u * v, m);
+  check_same_operator(a.get_operator(), a_ref.get_operator(), "linearize: quotient and chain rules", 1.e-12);
+
+  bool thrown(false);
+  try {
+    linearize(compose(cube, w) * v);
+  } catch (const std::string&) {
+    thrown = true;
+  }
+  check(thrown, "a composition without derivative is linearized");
+
+  linear_form<fes_type> l(fes), l_ref(fes);
+  l += integrate<quad_type>(d<1>(z * z) * v, m);
+  l_ref += integrate<quad_type>(2.0 * z * d<1>(z) * v, m);
+  check_same_vector(l.get_coefficients(), l_ref.get_coefficients(), "differentiate: product rule");
+}
+
+double max_error(const fes_type::element& u, const fes_type& fes) {
+  const auto u_exact(projector::lagrange<fe_type>(exact, fes));
+  double e(0.0);
+  for (std::size_t i(0); i < fes.get_dof_number(); ++i)
+    e = std::max(e, std::abs(u.get_coefficients().at(i) - u_exact.get_coefficients().at(i)));
+  return e;
+}
+
+fes_type::element zero(const fes_type& fes) {
+  array<double> c{fes.get_dof_number()};
+  c.fill(0.0);
+  return fes_type::element(fes, c);
+}
+
+/*
+ * The solution of the discrete problem is the exact one, from an
+ * iterate which does not satisfy the boundary conditions.
+ */
+void test_solve() {
+  const fe_mesh<cell::triangle> m(gen_square_mesh(1.0, 1.0, 8, 8));
+  const submesh<cell::triangle> dm(m.get_boundary_submesh());
+  const fes_type fes(m, dm, exact);
+
+  newton_solver<fes_type> newton(fes);
+  auto u(zero(fes));
+  const auto w(newton.get_unknown());
+  const auto v(newton.get_test_function());
+  const auto r((make_expr(1.0) + w * w) * (d<1>(w) * d<1>(v) + d<2>(w) * d<2>(v)) - make_expr(source) * v);
+
+  // exact Newton: quadratic convergence
+  recording_solver s;
+  dictionary report;
+  check(newton.solve<quad_type>(u, r, s, &report), "exact steps: no convergence");
+  check(max_error(u, fes) < 1.e-10, "exact steps: wrong solution");
+  const std::size_t n_exact(report.get<std::size_t>("iterations"));
+  check(n_exact <= 8, "exact steps: " + std::to_string(n_exact) + " iterations");
+  check(s.n_operator == n_exact, "exact steps: a jacobian per step expected");
+  check(s.tolerances.empty(), "exact steps: the tolerance of the linear solver is changed");
+  check(report.get<double>("forcing") == 1.e-6, "exact steps: wrong reported tolerance");
+
+  // inexact steps: the forcing terms decrease from the maximum one
+  u = zero(fes);
+  recording_solver s_inexact;
+  newton.set_inexact_steps(true, 0.5);
+  check(newton.solve<quad_type>(u, r, s_inexact, &report), "inexact steps: no convergence");
+  check(max_error(u, fes) < 1.e-10, "inexact steps: wrong solution");
+  check(s_inexact.tolerances.size() >= 3, "inexact steps: too few linear solves");
+  check(s_inexact.tolerances.front() == 0.5, "inexact steps: the first forcing term is not the maximum one");
+  check(s_inexact.tolerances.end()[-2] < 0.5, "inexact steps: the forcing term does not decrease");
+  for (double eta: s_inexact.tolerances)
+    check(eta > 0.0 and eta <= 0.5, "inexact steps: forcing term out of range");
+  check(s_inexact.tolerances.back() == 1.e-6 and s_inexact.get_relative_tolerance() == 1.e-6,
+	"inexact steps: the tolerance of the linear solver is not restored");
+  newton.set_inexact_steps(false);
+
+  // the jacobian of a step serves the next ones
+  u = zero(fes);
+  recording_solver s_lagged;
+  newton.set_jacobian_lag(2);
+  check(newton.solve<quad_type>(u, r, s_lagged, &report), "lagged jacobian: no convergence");
+  check(max_error(u, fes) < 1.e-10, "lagged jacobian: wrong solution");
+  check(report.get<std::size_t>("jacobian_assemblies") == s_lagged.n_operator, "lagged jacobian: wrong count");
+  check(s_lagged.n_operator < report.get<std::size_t>("iterations"), "lagged jacobian: assembled at each step");
+  newton.set_jacobian_lag(0);
+
+  // far from the solution, the line search keeps the residual decreasing
+  array<double> c{fes.get_dof_number()};
+  c.fill(20.0);
+  u = fes_type::element(fes, c);
+  recording_solver s_line_search;
+  newton.set_line_search(true);
+  newton.set_max_iteration_number(100);
+  check(newton.solve<quad_type>(u, r, s_line_search, &report), "line search: no convergence");
+  check(max_error(u, fes) < 1.e-10, "line search: wrong solution");
+
+  // the iterate is in the space of the solver
+  const fes_type other(m, dm, exact);
+  auto u_other(zero(other));
+  bool thrown(false);
+  try {
+    newton.solve<quad_type>(u_other, r, s, &report);
+  } catch (const std::string&) {
+    thrown = true;
+  }
+  check(thrown, "an iterate of another space is accepted");
+}
+
+// -laplacian(u_0) + u_0 u_1 = source_0 and -laplacian(u_1) + u_0^2 = source_1
+// for u_0 = x + y and u_1 = x - y
+double exact_1(const double* x) {
+  return x[0] - x[1];
+}
+
+double source_0(const double* x) {
+  return (x[0] + x[1]) * (x[0] - x[1]);
+}
+
+double source_1(const double* x) {
+  return (x[0] + x[1]) * (x[0] + x[1]);
+}
+
+/*
+ * The unknowns of a composite space are the trial functions of their
+ * components, and the Newton iterations on the space find the exact
+ * solution.
+ */
+void test_composite() {
+  using cfe_type = composite_finite_element<fe_type, fe_type>;
+  using cfes_type = composite_finite_element_space<cfe_type>;
+
+  const fe_mesh<cell::triangle> m(gen_square_mesh(1.0, 1.0, 6, 6));
+  const submesh<cell::triangle> dm(m.get_boundary_submesh());
+  cfes_type cfes(m);
+  cfes.add_dirichlet_boundary<0>(dm, exact);
+  cfes.add_dirichlet_boundary<1>(dm, exact_1);
+
+  const auto w_h(projector::lagrange<fe_type>(g, cfes.get_finite_element_space<0>()));
+  const auto z_h(projector::lagrange<fe_type>(exact, cfes.get_finite_element_space<1>()));
+  const auto w_0(make_unknown<fe_type, 2>(w_h));
+  const auto w_1(make_unknown<fe_type, 3>(z_h));
+
+  bilinear_form<cfes_type, cfes_type> a(cfes, cfes), a_ref(cfes, cfes);
+  const auto u_0(a.get_trial_function<0>());
+  const auto u_1(a.get_trial_function<1>());
+  const auto v_0(a.get_test_function<0>());
+  const auto v_1(a.get_test_function<1>());
+
+  a += integrate<quad_type>(linearize(d<1>(w_0) * d<1>(v_0) + d<2>(w_0) * d<2>(v_0) + w_0 * w_1 * v_0
+				      + d<1>(w_1) * d<1>(v_1) + d<2>(w_1) * d<2>(v_1) + w_0 * w_0 * v_1), m);
+  a_ref += integrate<quad_type>(d<1>(u_0) * d<1>(v_0) + d<2>(u_0) * d<2>(v_0) + (u_0 * w_1 + w_0 * u_1) * v_0
+				+ d<1>(u_1) * d<1>(v_1) + d<2>(u_1) * d<2>(v_1) + 2.0 * w_0 * u_0 * v_1, m);
+  check_same_operator(a.get_operator(), a_ref.get_operator(), "composite linearize");
+
+  newton_solver<cfes_type> newton(cfes);
+  const auto x_0(newton.get_unknown<0>());
+  const auto x_1(newton.get_unknown<1>());
+  const auto t_0(newton.get_test_function<0>());
+  const auto t_1(newton.get_test_function<1>());
+  const auto r(d<1>(x_0) * d<1>(t_0) + d<2>(x_0) * d<2>(t_0) + x_0 * x_1 * t_0 - make_expr(source_0) * t_0
+	       + d<1>(x_1) * d<1>(t_1) + d<2>(x_1) * d<2>(t_1) + x_0 * x_0 * t_1 - make_expr(source_1) * t_1);
+
+  array<double> c{cfes.get_total_dof_number()};
+  c.fill(0.0);
+  cfes_type::element x(cfes, c);
+  recording_solver s;
+  dictionary report;
+  check(newton.solve<quad_type>(x, r, s, &report), "composite: no convergence");
+  check(report.get<std::size_t>("iterations") <= 8, "composite: too many iterations");
+
+  const auto exact_0_h(projector::lagrange<fe_type>(exact, cfes.get_finite_element_space<0>()));
+  const auto exact_1_h(projector::lagrange<fe_type>(exact_1, cfes.get_finite_element_space<1>()));
+  check_same_vector(x.get_component<0>().get_coefficients(), exact_0_h.get_coefficients(),
+		    "composite: wrong first component", 1.e-10);
+  check_same_vector(x.get_component<1>().get_coefficients(), exact_1_h.get_coefficients(),
+		    "composite: wrong second component", 1.e-10);
+}
+
+int main(int argc, char *argv[]) {
+  return run_tests("test_newton", []() {
+      test_linearize();
+      test_linearize_rules();
+      test_solve();
+      test_composite();
+    });
+}
@@ -0,0 +1,153 @@
+#include <cmath>
+#include <iostream>
+#include <string>
+
+#include "../src/core/mesh.hpp"
+#include "../src/core/fe.hpp"
+#include "../src/core/fes.hpp"
+#include "../src/core/form.hpp"
+#include "../src/core/quadrature.hpp"
+#include "../src/core/projector.hpp"
+#include "../src/core/operator_cache.hpp"
+
+#include "check.hpp"
+
+
+using cell_type = cell::triangle;
+using fe_type = cell_type::fe::lagrange_p1;
+using fes_type = finite_element_space<fe_type>;
+using quad_type = quad::triangle::qf5pT;
+
+
+double boundary_value(const double* x) {
+  return x[0] + x[1];
+}
+
+double initial_value(const double* x) {
+  return std::sin(3.0 * x[0]) * x[1];
+}
+
+/*
+ * The combination of the cached mass and stiffness matrices, and the
+ * right hand side computed with the cached mass matrix, are the ones of
+ * the assembled forms, and so is the solution.
+ */
+void test_1() {
+  const double dt(0.01);
+  const fe_mesh<cell_type> m(gen_square_mesh(1.0, 1.0, 10, 10));
+  const submesh<cell_type> dm(m.get_boundary_submesh());
+  const fes_type fes(m, dm, boundary_value);
+
+  bilinear_form<fes_type, fes_type> mass(fes, fes), stiffness(fes, fes), a(fes, fes);
+  const auto u(a.get_trial_function());
+  const auto v(a.get_test_function());
+  mass += integrate<quad_type>(u * v, m);
+  stiffness += integrate<quad_type>(d<1>(u) * d<1>(v) + d<2>(u) * d<2>(v), m);
+  a += integrate<quad_type>((1.0 / dt) * u * v + 0.5 * (d<1>(u) * d<1>(v) + d<2>(u) * d<2>(v)), m);
+
+  operator_cache operators(fes.get_dof_number(), fes.get_dof_number());
+  operators.set_identity_rows(fes.get_dirichlet_dof_values());
+  operators.store("mass", mass.get_operator());
+  operators.store("stiffness", stiffness.get_operator());
+  check(operators.get("mass").get_pattern() == operators.get("stiffness").get_pattern(),
+	"the matrices do not share their pattern");
+
+  const crs_matrix op(operators.combine({{"mass", 1.0 / dt}, {"stiffness", 0.5}}));
+  check_same_operator(op, a.get_operator(), "mass / dt + stiffness / 2");
+
+  // the time derivative term of the right hand side
+  const auto u_old(projector::lagrange<fe_type>(initial_value, fes));
+  linear_form<fes_type> f(fes), g(fes);
+  f += integrate<quad_type>((1.0 / dt) * make_expr<fe_type>(u_old) * v, m);
+  g.axpy(1.0 / dt, operators.get("mass").multiply(u_old.get_coefficients()));
+
+  double max_difference(0.0);
+  for (std::size_t j(0); j < fes.get_dof_number(); ++j)
+    if (fes.get_dirichlet_dof_values().count(j) == 0)
+      max_difference = std::max(max_difference, std::abs(f.get_coefficients().at(j) - g.get_coefficients().at(j)));
+  check(max_difference < 1.e-10, "the right hand side differs from the assembly");
+
+  solver::lapack::lu s_1, s_2;
+  s_1.set_operator_size(fes.get_dof_number());
+  s_2.set_operator_size(fes.get_dof_number());
+  const auto x_1(a.solve(f, s_1));
+  const auto x_2(mass.solve(op, g, s_2));
+
+  max_difference = 0.0;
+  for (std::size_t j(0); j < fes.get_dof_number(); ++j)
+    max_difference = std::max(max_difference,
+			      std::abs(x_1.get_coefficients().at(j) - x_2.get_coefficients().at(j)));
+  check(max_difference < 1.e-10, "the solutions differ by " + std::to_string(max_difference));
+
+  for (const auto& i: fes.get_dirichlet_dof_values())
+    check(std::abs(x_2.get_coefficients().at(i.first) - i.second) < 1.e-12,
+	  "dirichlet condition not satisfied");
+}
+
+/*
+ * Storing a matrix again updates its values in place, and the pattern
+ * is extended for the entries which are not in it.
+ */
+void test_2() {
+  sparse_matrix a(4, 4), b(4, 4);
+  a.set(0, 1, 2.0);
+  a.set(3, 2, -1.0);
+  b.set(1, 0, 3.0);
+
+  operator_cache operators(4, 4);
+  operators.store("a", a);
+  const auto p(operators.get_pattern());
+  check(p->column.size() == 6, "unexpected pattern size");
+
+  a.set(0, 1, 4.0);
+  operators.store("a", a);
+  check(operators.get_pattern() == p, "pattern rebuilt for the same entries");
+  check(operators.get("a").get(0, 1) == 4.0, "values not updated");
+
+  operators.store("b", b);
+  check(operators.get_pattern() != p and operators.get_pattern()->column.size() == 7,
+	"pattern not extended");
+  check(operators.get("a").get(0, 1) == 4.0 and operators.get("a").get(3, 2) == -1.0
+	and operators.get("a").get(1, 0) == 0.0, "values not preserved by the extension");
+
+  crs_matrix c(operators.combine({{"a", 1.0}, {"b", 2.0}}));
+  check(c.get(0, 1) == 4.0 and c.get(1, 0) == 6.0 and c.get(3, 2) == -1.0, "unexpected combination");
+
+  array<double> x{4};
+  for (std::size_t j(0); j < 4; ++j)
+    x.at(j) = j + 1.0;
+  const array<double> y(c.multiply(x));
+  check(y.at(0) == 8.0 and y.at(1) == 6.0 and y.at(2) == 0.0 and y.at(3) == -3.0,
+	"unexpected product");
+
+  bool caught(false);
+  try {
+    c.set(0, 3, 1.0);
+  } catch (const std::string&) {
+    caught = true;
+  }
+  check(caught, "entry set out of the pattern");
+
+  caught = false;
+  try {
+    c.axpy(1.0, crs_matrix(a));
+  } catch (const std::string&) {
+    caught = true;
+  }
+  check(caught, "sum of matrices of different patterns");
+
+  caught = false;
+  try {
+    operators.get("c");
+  } catch (const std::string&) {
+    caught = true;
+  }
+  check(caught, "unknown matrix name");
+}
+
+int main(int argc, char *argv[]) {
+  return run_tests("test_operator_cache", []() {
+      test_1();
+      test_2();
+    });
+}
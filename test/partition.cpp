@@ -0,0 +1,108 @@
+#include <cmath>
+#include <iostream>
+#include <string>
+
+#include "../src/core/mesh.hpp"
+#include "../src/core/mesh_data.hpp"
+#include "../src/core/partition.hpp"
+
+#include "check.hpp"
+
+
+template<typename cell_type>
+void check_partition(const mesh_data<double, fe_mesh<cell_type> >& part, std::size_t n_part,
+		     double max_imbalance) {
+  const auto s(partition::compute_statistics(part));
+  check(s.part_number == n_part, "unexpected part number");
+  for (const auto n: s.part_size)
+    check(n > 0, "empty part");
+  check(s.imbalance <= max_imbalance, "imbalance " + std::to_string(s.imbalance) + " too large");
+}
+
+/*
+ * The bisections produce balanced partitions for any part number, and
+ * the refinement never increases the edge cut beyond the tolerance.
+ */
+void test_1() {
+  using cell_type = cell::triangle;
+  const fe_mesh<cell_type> m(gen_square_mesh(1.0, 1.0, 20, 20));
+
+  for (std::size_t n_part: {1, 2, 3, 4, 7}) {
+    // each bisection rounds the sizes down by less than one cell
+    const double max_imbalance(1.0 + n_part * std::ceil(std::log2(n_part)) / m.get_cell_number() + 1.e-12);
+
+    auto rcb(partition::recursive_coordinate_bisection(m, n_part));
+    check_partition(rcb, n_part, max_imbalance);
+
+    auto rib(partition::recursive_inertial_bisection(m, n_part));
+    check_partition(rib, n_part, max_imbalance);
+
+    const auto s(partition::compute_statistics(rib));
+    partition::refine(rib, 0.05);
+    const auto s_refined(partition::compute_statistics(rib));
+    check_partition(rib, n_part, std::max(1.05 + 1.0 * n_part / m.get_cell_number(), s.imbalance));
+    check(s_refined.edge_cut <= s.edge_cut, "refinement increased the edge cut");
+
+    const std::vector<unsigned int> cell_part(partition::get_cell_partition(rib));
+    for (std::size_t k(0); k < m.get_cell_number(); ++k)
+      check(cell_part[k] == rib.value(k, 0), "inconsistent cell partition");
+  }
+
+  // two halves of the square: one cut per triangle pair along x = 1/2
+  const auto s(partition::compute_statistics(partition::recursive_coordinate_bisection(m, 2)));
+  check(s.edge_cut == 20, "unexpected edge cut " + std::to_string(s.edge_cut));
+}
+
+/*
+ * On a thin strip rotated by 30 degrees, the inertial bisection cuts
+ * across the strip, and the refinement repairs a bad partition.
+ */
+void test_2() {
+  using cell_type = cell::triangle;
+  const fe_mesh<cell_type> strip(gen_square_mesh(8.0, 1.0, 80, 10));
+
+  array<double> vertices(strip.get_vertices());
+  const double c(std::cos(M_PI / 6.0)), s(std::sin(M_PI / 6.0));
+  for (std::size_t i(0); i < vertices.get_size(0); ++i) {
+    const double x(vertices.at(i, 0)), y(vertices.at(i, 1));
+    vertices.at(i, 0) = c * x - s * y;
+    vertices.at(i, 1) = s * x + c * y;
+  }
+  array<unsigned int> cells(strip.get_cells()), references(strip.get_references());
+  const fe_mesh<cell_type> m(std::move(vertices), std::move(cells), std::move(references));
+
+  const auto rib(partition::compute_statistics(partition::recursive_inertial_bisection(m, 2)));
+  check(rib.edge_cut <= 25, "inertial bisection does not cut across the strip");
+
+  // alternate rows of cells: every face is cut
+  mesh_data<double, fe_mesh<cell_type> > part(m, mesh_data_kind::cell);
+  for (std::size_t k(0); k < m.get_cell_number(); ++k)
+    part.value(k, 0) = k % 2;
+  const auto before(partition::compute_statistics(part));
+  check(partition::refine(part, 0.1, 100) > 0, "no cell moved");
+  const auto after(partition::compute_statistics(part));
+  check(after.edge_cut < before.edge_cut / 2, "refinement did not reduce the edge cut");
+  check(after.imbalance <= 1.1 + 1.e-12, "refinement exceeded the tolerance");
+}
+
+/*
+ * Tetrahedra.
+ */
+void test_3() {
+  using cell_type = cell::tetrahedron;
+  const fe_mesh<cell_type> m(gen_cube_mesh(1.0, 1.0, 1.0, 6, 6, 6));
+
+  auto part(partition::recursive_inertial_bisection(m, 8));
+  check_partition(part, 8, 1.0 + 8.0 * 3 / m.get_cell_number() + 1.e-12);
+  const auto s(partition::compute_statistics(part));
+  partition::refine(part);
+  check(partition::compute_statistics(part).edge_cut <= s.edge_cut, "refinement increased the edge cut");
+}
+
+int main(int argc, char *argv[]) {
+  return run_tests("test_partition", []() {
+      test_1();
+      test_2();
+      test_3();
+    });
+}
@@ -0,0 +1,134 @@
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../src/core/mesh.hpp"
+#include "../src/core/fe.hpp"
+#include "../src/core/fes.hpp"
+#include "../src/core/projector.hpp"
+#include "../src/core/probe.hpp"
+
+#include "check.hpp"
+
+
+using fe_type = cell::triangle::fe::lagrange_p2;
+using fes_type = finite_element_space<fe_type>;
+
+// in P2: the samples are exact
+double f(const double* x) {
+  return x[0] * x[0] - 2.0 * x[0] * x[1] + 3.0 * x[1] + 1.0;
+}
+
+array<double> make_points() {
+  const double x[][2] = {{0.1, 0.2}, {0.73, 0.31}, {0.5, 0.5}, {0.0, 0.0}, {1.0, 0.45}, {0.333, 0.999}};
+  array<double> points{6, 2};
+  for (std::size_t p(0); p < 6; ++p)
+    for (std::size_t d(0); d < 2; ++d)
+      points.at(p, d) = x[p][d];
+  return points;
+}
+
+/*
+ * The samples are the values of the function, found in the cell of the
+ * mesh search.
+ */
+void test_sample() {
+  const fe_mesh<cell::triangle> m(gen_square_mesh(1.0, 1.0, 7, 5));
+  const fes_type fes(m);
+  const auto u(projector::lagrange<fe_type>(f, fes));
+  const array<double> points(make_points());
+
+  parallel::set_thread_number(1);
+  const probe_set<fes_type> serial(fes, points);
+  parallel::set_thread_number(4);
+  const probe_set<fes_type> probes(fes, points);
+  check(probes.get_probe_number() == 6, "wrong probe number");
+
+  const array<double> values(probes.sample(u));
+  for (std::size_t p(0); p < probes.get_probe_number(); ++p) {
+    const double* x(&points.at(p, 0));
+    check(probes.get_cell(p) == m.get_cell_at(x), "wrong cell");
+    check(serial.get_cell(p) == probes.get_cell(p), "the cell depends on the thread number");
+    check(std::abs(values.at(p) - f(x)) < 1.e-12, "wrong sample");
+    check(std::abs(values.at(p) - u.evaluate(x)) < 1.e-13, "the sample differs from evaluate");
+    check(values.at(p) == serial.sample(u, p), "the sample depends on the thread number");
+  }
+
+  // the points are in the mesh
+  array<double> outside(make_points());
+  outside.at(4, 0) = 1.5;
+  bool thrown(false);
+  try {
+    probe_set<fes_type> p(fes, outside);
+  } catch (const std::string& e) {
+    thrown = (e.find("the point 4 is out of the mesh") != std::string::npos);
+  }
+  check(thrown, "a point out of the mesh is accepted");
+
+  // the functions are in the space of the probes
+  const fes_type other(m);
+  const auto v(projector::lagrange<fe_type>(f, other));
+  thrown = false;
+  try {
+    probes.sample(v);
+  } catch (const std::string&) {
+    thrown = true;
+  }
+  check(thrown, "a function of another space is accepted");
+}
+
+/*
+ * The file has the header, and a record per time step.
+ */
+void test_series() {
+  const fe_mesh<cell::triangle> m(gen_square_mesh(1.0, 1.0, 4, 4));
+  const fes_type fes(m);
+  const array<double> points(make_points());
+  const probe_set<fes_type> probes(fes, points);
+  const std::string filename("test_probe.bin");
+
+  const std::size_t n_step(3);
+  {
+    probe_series<fes_type> series(probes, filename);
+    auto u(projector::lagrange<fe_type>(f, fes));
+    for (std::size_t n(0); n < n_step; ++n) {
+      series.record(0.1 * n, u);
+      u *= 2.0;
+    }
+    check(series.get_record_number() == n_step, "wrong record number");
+  }
+
+  std::ifstream file(filename.c_str(), std::ios::in | std::ios::binary);
+  std::uint64_t sizes[2];
+  file.read(reinterpret_cast<char*>(sizes), sizeof(sizes));
+  check(file and sizes[0] == 6 and sizes[1] == 2, "wrong header");
+
+  std::vector<double> x(12);
+  file.read(reinterpret_cast<char*>(x.data()), x.size() * sizeof(double));
+  for (std::size_t i(0); i < x.size(); ++i)
+    check(x[i] == points.get_data()[i], "wrong points");
+
+  std::vector<double> record(7);
+  for (std::size_t n(0); n < n_step; ++n) {
+    file.read(reinterpret_cast<char*>(record.data()), record.size() * sizeof(double));
+    check(bool(file), "missing record");
+    check(record[0] == 0.1 * n, "wrong time");
+    for (std::size_t p(0); p < 6; ++p)
+      check(std::abs(record[p + 1] - std::pow(2.0, n) * f(&points.at(p, 0))) < 1.e-11, "wrong recorded sample");
+  }
+  check(file.peek() == std::ifstream::traits_type::eof(), "trailing data");
+
+  file.close();
+  std::remove(filename.c_str());
+}
+
+int main(int argc, char *argv[]) {
+  return run_tests("test_probe", []() {
+      test_sample();
+      test_series();
+    });
+}
@@ -0,0 +1,101 @@
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/core/cell.hpp"
+#include "../src/core/mesh.hpp"
+#include "../src/core/fe.hpp"
+#include "../src/core/fes.hpp"
+#include "../src/core/composite_fe.hpp"
+#include "../src/core/composite_fes.hpp"
+#include "../src/core/composite_form.hpp"
+#include "../src/core/quadrature.hpp"
+#include "../src/core/solver.hpp"
+#include "../src/core/profiler.hpp"
+
+#include "check.hpp"
+
+
+double f(const double* x) {
+  return 1.0;
+}
+
+/*
+ * Nested scopes and counters recorded from several threads.
+ */
+void test_1() {
+  profiler::clear();
+
+  const std::size_t n_thread(4), n_iteration(100);
+  std::vector<std::thread> threads;
+  for (std::size_t n(0); n < n_thread; ++n)
+    threads.push_back(std::thread([n_iteration]() {
+	  profiler::scope outer("outer");
+	  for (std::size_t i(0); i < n_iteration; ++i) {
+	    profiler::phase inner("inner");
+	    profiler::count("iterations");
+	  }
+	}));
+  for (auto& t: threads)
+    t.join();
+
+  dictionary d;
+  profiler::report(d);
+  profiler::export_chrome_trace("profiler_trace_1.json");
+
+  if (profiler::enabled) {
+    check(d.get<std::size_t>("profile/calls/outer") == n_thread, "unexpected number of outer calls");
+    check(d.get<std::size_t>("profile/calls/outer/inner") == n_thread * n_iteration,
+	  "unexpected number of inner calls");
+    check(d.get<std::size_t>("profile/count/iterations") == n_thread * n_iteration,
+	  "unexpected iteration counter");
+    check(d.get<double>("profile/time/outer") >= d.get<double>("profile/time/outer/inner"),
+	  "inner phase longer than the enclosing scope");
+  } else {
+    check(not d.key_exists("profile/calls/outer"), "unexpected measurement");
+  }
+}
+
+/*
+ * Phases and counters of the assembly of a bilinear form.
+ */
+void test_2() {
+  using cell_type = cell::triangle;
+  using fe_type = cell_type::fe::lagrange_p1;
+  using fes_type = finite_element_space<fe_type>;
+  using quad_type = quad::triangle::qf5pT;
+
+  profiler::clear();
+
+  fe_mesh<cell_type> m(gen_square_mesh(1.0, 1.0, 8, 8));
+  fes_type fes(m);
+
+  bilinear_form<fes_type, fes_type> a(fes, fes);
+  auto u(a.get_trial_function());
+  auto v(a.get_test_function());
+  a += integrate<quad_type>(u * v, m);
+
+  dictionary d;
+  profiler::report(d);
+  profiler::export_chrome_trace("profiler_trace_2.json");
+
+  if (profiler::enabled) {
+    for (const std::string p: {"geometry", "tabulation", "kernel", "scatter"})
+      check(d.get<std::size_t>("profile/calls/bilinear_form::assembly/" + p) == m.get_cell_number(),
+	    "unexpected number of " + p + " calls");
+    check(d.get<std::size_t>("profile/count/cells") == m.get_cell_number(),
+	  "unexpected cell counter");
+    check(d.get<std::size_t>("profile/count/quadrature_points") == m.get_cell_number() * quad_type::n_point,
+	  "unexpected quadrature point counter");
+  }
+
+  d.print(std::cout);
+}
+
+int main(int argc, char *argv[]) {
+  return run_tests("test_profiler", []() {
+      test_1();
+      test_2();
+    });
+}
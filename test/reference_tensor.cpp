@@ -0,0 +1,110 @@
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <string>
+
+#include "../src/core/mesh.hpp"
+#include "../src/core/fe.hpp"
+#include "../src/core/fes.hpp"
+#include "../src/core/form.hpp"
+#include "../src/core/quadrature.hpp"
+#include "../src/core/composite_fe.hpp"
+#include "../src/core/composite_fes.hpp"
+#include "../src/core/composite_form.hpp"
+
+#include "check.hpp"
+
+
+/*
+ *  A free function coefficient disables the reference tensors.
+ */
+double one(const double* x) {
+  return 1.0;
+}
+
+/*
+ * Mass, stiffness and mixed terms on the scalar spaces.
+ */
+template<typename fe_type, typename quad_type, typename mesh_type>
+void test_scalar(const mesh_type& m, const std::string& name) {
+  using fes_type = finite_element_space<fe_type>;
+  fes_type fes(m);
+
+  bilinear_form<fes_type, fes_type> a(fes, fes), b(fes, fes);
+  const auto u(a.get_trial_function());
+  const auto v(a.get_test_function());
+
+  const auto start(std::chrono::steady_clock::now());
+  a += integrate<quad_type>(d<1>(u) * d<1>(v) + 2.0 * u * v - 0.5 * (d<1>(u) * v), m);
+  const auto middle(std::chrono::steady_clock::now());
+  b += integrate<quad_type>(one * (d<1>(u) * d<1>(v) + 2.0 * u * v - 0.5 * (d<1>(u) * v)), m);
+  const auto end(std::chrono::steady_clock::now());
+
+  check_same_operator(a.get_operator(), b.get_operator(), name);
+  std::cout << name << ": reference tensor "
+	    << std::chrono::duration<double>(middle - start).count() << " s, quadrature "
+	    << std::chrono::duration<double>(end - middle).count() << " s" << std::endl;
+}
+
+template<typename fe_type, typename quad_type>
+void test_stiffness_3d(const fe_mesh<cell::tetrahedron>& m, const std::string& name) {
+  using fes_type = finite_element_space<fe_type>;
+  fes_type fes(m);
+
+  bilinear_form<fes_type, fes_type> a(fes, fes), b(fes, fes);
+  const auto u(a.get_trial_function());
+  const auto v(a.get_test_function());
+
+  a += integrate<quad_type>(d<1>(u) * d<1>(v) + d<2>(u) * d<2>(v) + d<3>(u) * d<3>(v) + d<1>(u) * d<3>(v), m);
+  b += integrate<quad_type>(one * (d<1>(u) * d<1>(v) + d<2>(u) * d<2>(v) + d<3>(u) * d<3>(v) + d<1>(u) * d<3>(v)), m);
+  check_same_operator(a.get_operator(), b.get_operator(), name);
+}
+
+/*
+ * The Stokes blocks of a composite space.
+ */
+void test_stokes() {
+  using cell_type = cell::triangle;
+  using u_fe_type = cell_type::fe::lagrange_p2;
+  using p_fe_type = cell_type::fe::lagrange_p1;
+  using quad_type = quad::triangle::qf5pT;
+  using cfe_type = composite_finite_element<u_fe_type, u_fe_type, p_fe_type>;
+  using cfes_type = composite_finite_element_space<cfe_type>;
+
+  fe_mesh<cell_type> m(gen_square_mesh(1.0, 1.0, 12, 12));
+  submesh<cell_type> dm(m.get_boundary_submesh());
+  cfes_type fes(m);
+  fes.add_dirichlet_boundary<0>(dm, one);
+
+  bilinear_form<cfes_type, cfes_type> a(fes, fes), b(fes, fes);
+  auto v0(a.get_test_function<0>());
+  auto v1(a.get_test_function<1>());
+  auto q(a.get_test_function<2>());
+  auto u0(a.get_trial_function<0>());
+  auto u1(a.get_trial_function<1>());
+  auto p(a.get_trial_function<2>());
+
+  a += integrate<quad_type>(d<1>(u0) * d<1>(v0) + d<2>(u0) * d<2>(v0) + d<1>(u1) * d<1>(v1) + d<2>(u1) * d<2>(v1)
+			    - p * (d<1>(v0) + d<2>(v1)) - q * (d<1>(u0) + d<2>(u1)), m);
+  b += integrate<quad_type>(one * (d<1>(u0) * d<1>(v0) + d<2>(u0) * d<2>(v0) + d<1>(u1) * d<1>(v1) + d<2>(u1) * d<2>(v1))
+			    - one * p * (d<1>(v0) + d<2>(v1)) - one * q * (d<1>(u0) + d<2>(u1)), m);
+  check_same_operator(a.get_operator(), b.get_operator(), "stokes p2-p1");
+}
+
+int main(int argc, char *argv[]) {
+  return run_tests("test_reference_tensor", []() {
+      const fe_mesh<cell::edge> edges(gen_segment_mesh(0.0, 1.0, 50));
+      test_scalar<cell::edge::fe::lagrange_p2, quad::edge::gauss3>(edges, "edge p2");
+
+      const fe_mesh<cell::triangle> triangles(gen_square_mesh(1.0, 1.0, 60, 60));
+      test_scalar<cell::triangle::fe::lagrange_p1, quad::triangle::qf5pT>(triangles, "triangle p1");
+      test_scalar<cell::triangle::fe::lagrange_p2, quad::triangle::qf5pT>(triangles, "triangle p2");
+      test_scalar<cell::triangle::fe::lagrange_p1_bubble, quad::triangle::qf5pT>(triangles, "triangle p1 bubble");
+
+      const fe_mesh<cell::tetrahedron> tetrahedra(gen_cube_mesh(1.0, 1.0, 1.0, 6, 6, 6));
+      test_stiffness_3d<cell::tetrahedron::fe::lagrange_p1, quad::tetrahedron::qfSym4pTet>(tetrahedra, "tetrahedron p1");
+      test_stiffness_3d<cell::tetrahedron::fe::lagrange_p1_bubble, quad::tetrahedron::qfSym10pTet>(tetrahedra, "tetrahedron p1 bubble");
+
+      test_stokes();
+    });
+}
@@ -0,0 +1,237 @@
+#include <atomic>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/core/scheduler.hpp"
+#include "../src/core/mesh.hpp"
+
+#include "check.hpp"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+
+/*
+ * The threads which use the scheduler first at the same time share
+ * the same one.
+ */
+void test_0() {
+  const std::size_t n_caller(8);
+  std::vector<const parallel::scheduler*> instances(n_caller);
+  std::vector<std::thread> callers;
+  for (std::size_t n(0); n < n_caller; ++n)
+    callers.push_back(std::thread([&instances, n]() {
+	  std::atomic<std::size_t> sum(0);
+	  parallel::parallel_for(0, 100, [&sum](std::size_t k_begin, std::size_t k_end) {
+	      sum += k_end - k_begin;
+	    });
+	  if (sum == 100)
+	    instances[n] = &parallel::scheduler::instance();
+	}));
+  for (auto& c: callers)
+    c.join();
+
+  for (std::size_t n(0); n < n_caller; ++n)
+    check(instances[n] == &parallel::scheduler::instance(), "several schedulers created");
+}
+
+/*
+ * Every index of the range is visited exactly once.
+ */
+void test_1() {
+  const std::size_t n(10007);
+  std::vector<std::atomic<unsigned int> > visits(n);
+  for (auto& v: visits)
+    v = 0;
+
+  for (std::size_t grain: {0, 1, 13, 20000})
+    parallel::parallel_for(0, n, [&visits](std::size_t k_begin, std::size_t k_end) {
+	for (std::size_t k(k_begin); k < k_end; ++k)
+	  ++visits[k];
+      }, grain);
+
+  for (std::size_t k(0); k < n; ++k)
+    check(visits[k] == 4, "index visited " + std::to_string(visits[k]) + " times instead of 4");
+
+  parallel::parallel_for(5, 5, [](std::size_t, std::size_t) {
+      throw std::string("empty range visited");
+    });
+}
+
+/*
+ * The reduction does not depend on the thread number.
+ */
+void test_2() {
+  const std::size_t n(100000);
+  auto map = [](std::size_t k_begin, std::size_t k_end) {
+    double s(0.0);
+    for (std::size_t k(k_begin); k < k_end; ++k)
+      s += 1.0 / (1.0 + k);
+    return s;
+  };
+  auto reduce = [](double a, double b) { return a + b; };
+
+  parallel::set_thread_number(1);
+  const double serial(parallel::parallel_reduce(0, n, 0.0, map, reduce, 64));
+
+  for (std::size_t n_thread: {2, 3, 8}) {
+    parallel::set_thread_number(n_thread);
+    check(parallel::get_thread_number() == n_thread, "unexpected thread number");
+
+    for (unsigned int r(0); r < 10; ++r)
+      check(parallel::parallel_reduce(0, n, 0.0, map, reduce, 64) == serial,
+	    "reduction depends on the scheduling");
+  }
+}
+
+/*
+ * Nested loops run serially in the calling chunk, and exceptions are
+ * propagated to the caller.
+ */
+void test_3() {
+  parallel::set_thread_number(4);
+
+  std::atomic<std::size_t> count(0);
+  parallel::parallel_for(0, 64, [&count](std::size_t i_begin, std::size_t i_end) {
+      check(parallel::scheduler::in_parallel_region(), "chunk not in a parallel region");
+      for (std::size_t i(i_begin); i < i_end; ++i)
+	parallel::parallel_for(0, 100, [&count](std::size_t j_begin, std::size_t j_end) {
+	    count += j_end - j_begin;
+	  });
+    }, 1);
+  check(count == 6400, "unexpected number of nested iterations");
+  check(not parallel::scheduler::in_parallel_region(), "parallel region not left");
+
+  bool caught(false);
+  try {
+    parallel::parallel_for(0, 1000, [](std::size_t k_begin, std::size_t k_end) {
+	if (k_begin <= 500 and 500 < k_end)
+	  throw std::string("failure");
+      }, 10);
+  } catch (const std::string& e) {
+    caught = (e == "failure");
+  }
+  check(caught, "exception not propagated");
+
+  // the scheduler is still usable
+  std::atomic<std::size_t> sum(0);
+  parallel::parallel_for(0, 1000, [&sum](std::size_t k_begin, std::size_t k_end) {
+      sum += k_end - k_begin;
+    });
+  check(sum == 1000, "scheduler unusable after an exception");
+}
+
+#ifdef __linux__
+cpu_set_t get_affinity() {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  pthread_getaffinity_np(pthread_self(), sizeof(cpu_set_t), &set);
+  return set;
+}
+
+bool same_affinity(const cpu_set_t& a, const cpu_set_t& b) {
+  return CPU_EQUAL(&a, &b);
+}
+
+/*
+ * The affinity of the participants of each partition.
+ */
+std::vector<cpu_set_t> get_participant_affinities(std::size_t n_thread) {
+  std::vector<cpu_set_t> sets(n_thread);
+  parallel::for_each_partition(0, n_thread, [&sets](std::size_t k_begin, std::size_t k_end) {
+      for (std::size_t k(k_begin); k < k_end; ++k)
+	sets[k] = get_affinity();
+    });
+  return sets;
+}
+#endif
+
+/*
+ * Each partition is executed once, by a distinct thread, and the
+ * first-touch copies preserve the content of the arrays. The geometry
+ * of a mesh built with first touch is the one of its cells.
+ */
+void test_4() {
+  const std::size_t n_thread(4), n(1001);
+#ifdef __linux__
+  const cpu_set_t caller_set(get_affinity());
+#endif
+  parallel::set_thread_number(n_thread, true);
+  check(parallel::first_touch_enabled(), "first touch placement not enabled");
+#ifdef __linux__
+  const std::vector<cpu_set_t> pinned(get_participant_affinities(n_thread));
+  check(same_affinity(pinned[0], get_affinity()), "the calling thread is not the participant 0");
+  for (std::size_t p(0); p < n_thread; ++p)
+    check(CPU_COUNT(&pinned[p]) == 1, "a participant is not pinned");
+#endif
+
+  std::mutex mutex;
+  std::set<std::thread::id> threads;
+  std::vector<unsigned int> visits(n, 0);
+  for (unsigned int r(0); r < 20; ++r) {
+    threads.clear();
+    parallel::for_each_partition(0, n, [&](std::size_t k_begin, std::size_t k_end) {
+	const auto& s(parallel::scheduler::instance());
+	for (std::size_t p(0); p < n_thread; ++p)
+	  if (s.get_partition_bound(0, n, p) == k_begin)
+	    check(s.get_partition_bound(0, n, p + 1) == k_end, "unexpected partition");
+
+	for (std::size_t k(k_begin); k < k_end; ++k)
+	  ++visits[k];
+
+	std::lock_guard<std::mutex> lock(mutex);
+	threads.insert(std::this_thread::get_id());
+      });
+    check(threads.size() == n_thread, "partitions not executed by distinct threads");
+  }
+  for (std::size_t k(0); k < n; ++k)
+    check(visits[k] == 20, "index not visited once per loop");
+
+  array<unsigned int> a{n, 3};
+  for (std::size_t k(0); k < n; ++k)
+    for (std::size_t j(0); j < 3; ++j)
+      a.at(k, j) = 3 * k + j;
+  const array<unsigned int> b(parallel::first_touch_copy(a));
+  for (std::size_t k(0); k < n; ++k)
+    for (std::size_t j(0); j < 3; ++j)
+      check(b.at(k, j) == 3 * k + j, "first touch copy differs from the original");
+
+  array<double> c{n};
+  parallel::first_touch_fill(c, 2.0);
+  for (std::size_t k(0); k < n; ++k)
+    check(c.at(k) == 2.0, "first touch fill failed");
+
+  // the geometry of the cells is written by the owners of the partitions
+  const fe_mesh<cell::tetrahedron> m(gen_cube_mesh(1.0, 1.0, 1.0, 5, 6, 7));
+  for (std::size_t k(0); k < m.get_cell_number(); ++k) {
+    const cell::tetrahedron::jacobian_type jmt(cell::tetrahedron::get_jmt(m.get_vertices(), m.get_cells(), k));
+    for (std::size_t i(0); i < jmt.get_element_number(); ++i)
+      check(m.get_jmt(k).get_data()[i] == jmt.get_data()[i], "first touch jacobian differs");
+  }
+
+  parallel::set_thread_number(n_thread);
+  check(not parallel::first_touch_enabled(), "first touch placement without pinning");
+#ifdef __linux__
+  // the calling thread recovers its affinity, and the workers created
+  // after pinned ones are not pinned
+  check(same_affinity(caller_set, get_affinity()), "the calling thread does not recover its affinity");
+  for (const auto& set: get_participant_affinities(n_thread))
+    check(same_affinity(caller_set, set), "an unpinned worker has a restricted affinity");
+#endif
+}
+
+int main(int argc, char *argv[]) {
+  return run_tests("test_scheduler", []() {
+      test_0();
+      test_1();
+      test_2();
+      test_3();
+      test_4();
+    });
+}
@@ -0,0 +1,139 @@
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "../src/core/mesh.hpp"
+#include "../src/core/fe.hpp"
+#include "../src/core/small_tensor.hpp"
+
+#include "check.hpp"
+
+
+/*
+ * The heap allocations of the calls to the cell geometry are counted.
+ */
+std::atomic<std::size_t> n_allocation(0);
+
+// called through a pointer, or the compiler warns that the memory of
+// operator new is given to free
+void (* volatile release)(void*) = std::free;
+
+void* operator new(std::size_t n) {
+  ++n_allocation;
+  if (void* p = std::malloc(n ? n : 1))
+    return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+  release(p);
+}
+
+/*
+ * The layout and the sizes are the ones of array.
+ */
+void test_layout() {
+  small_tensor<double, 2, 3, 4> t;
+  array<double> a{2, 3, 4};
+  for (std::size_t i(0); i < t.get_element_number(); ++i) {
+    t.get_data()[i] = i;
+    a.get_data()[i] = i;
+  }
+
+  check(t.get_rank() == 3 and t.get_element_number() == 24, "wrong rank or size");
+  for (std::size_t d(0); d < 3; ++d)
+    check(t.get_size(d) == a.get_size(d), "wrong extent");
+  for (std::size_t i(0); i < 2; ++i)
+    for (std::size_t j(0); j < 3; ++j)
+      for (std::size_t k(0); k < 4; ++k)
+	check(t.at(i, j, k) == a.at(i, j, k), "not in row major order");
+
+  const array<double> b(t);
+  check(b.get_rank() == 3 and b.get_size(2) == 4 and b.at(1, 2, 3) == 23.0, "wrong conversion to array");
+
+  check(reinterpret_cast<std::uintptr_t>(t.get_data()) % alignof(std::max_align_t) == 0, "misaligned storage");
+
+  small_tensor<double, 3> u, v;
+  u.fill(0.0);
+  v.fill(0.0);
+  u.at(0) = 1.0;
+  v.at(1) = 1.0;
+  const auto w(crossp(u, v));
+  check(w.at(0) == 0.0 and w.at(1) == 0.0 and w.at(2) == 1.0, "wrong cross product");
+  check(dotp(w, w) == 1.0 and dotp(u, v) == 0.0, "wrong dot product");
+}
+
+/*
+ * The geometry of the cells is computed without heap allocation, and is
+ * the one of the mapping of the reference cell.
+ */
+void test_triangle() {
+  const fe_mesh<cell::triangle> m(gen_square_mesh(2.0, 1.0, 4, 3));
+  const auto& vertices(m.get_vertices());
+  const auto& cells(m.get_cells());
+
+  for (std::size_t k(0); k < m.get_cell_number(); ++k) {
+    const std::size_t n_before(n_allocation);
+    const cell::triangle::jacobian_type jmt(cell::triangle::get_jmt(vertices, cells, k));
+    const auto bc_hat(cell::triangle::barycenter());
+    double x[2];
+    for (std::size_t n(0); n < 2; ++n)
+      x[n] = (vertices.at(cells.at(k, 0), n) + vertices.at(cells.at(k, 1), n) + vertices.at(cells.at(k, 2), n)) / 3.0;
+    const auto bc(cell::triangle::get_barycentric_coordinates(vertices, cells, k, x));
+    const auto normal(cell::triangle::subdomain_normal(vertices, cells, k, 0));
+    const std::size_t n_after(n_allocation);
+    check(n_after == n_before, "the geometry of a triangle is allocated");
+
+    // jmt^T is the inverse of the jacobian of the mapping
+    double j[2][2];
+    for (std::size_t n(0); n < 2; ++n)
+      for (std::size_t i(0); i < 2; ++i)
+	j[n][i] = vertices.at(cells.at(k, i + 1), n) - vertices.at(cells.at(k, 0), n);
+    for (std::size_t s(0); s < 2; ++s)
+      for (std::size_t t(0); t < 2; ++t)
+	check(std::abs(jmt.at(0, s) * j[0][t] + jmt.at(1, s) * j[1][t] - (s == t)) < 1.e-13, "wrong jmt");
+
+    for (std::size_t i(0); i < 3; ++i)
+      check(std::abs(bc.at(i) - 1.0 / 3.0) < 1.e-13, "wrong barycentric coordinates");
+    check(std::abs(bc.at(1) - bc_hat.at(0)) < 1.e-13, "wrong reference barycenter");
+
+    // the outward normal is orthogonal to the edge
+    const auto edge(cell::triangle::get_edge(cells, k, 0));
+    const std::vector<unsigned int> ids(edge.begin(), edge.end());
+    const unsigned int a(ids[0]), b(ids[1]);
+    check(std::abs(normal.at(0) * (vertices.at(b, 0) - vertices.at(a, 0))
+		   + normal.at(1) * (vertices.at(b, 1) - vertices.at(a, 1))) < 1.e-13, "wrong normal");
+
+    for (std::size_t s(0); s < 2; ++s)
+      for (std::size_t t(0); t < 2; ++t)
+	check(m.get_jmt(k).at(s, t) == jmt.at(s, t), "the jmt of the mesh differs");
+  }
+}
+
+void test_tetrahedron() {
+  const fe_mesh<cell::tetrahedron> m(gen_cube_mesh(1.0, 2.0, 3.0, 2, 2, 2));
+
+  double volume(0.0);
+  for (std::size_t k(0); k < m.get_cell_number(); ++k) {
+    const std::size_t n_before(n_allocation);
+    volume += cell::tetrahedron::get_cell_volume(m.get_vertices(), m.get_cells(), k);
+    const auto jmt(cell::tetrahedron::get_jmt(m.get_vertices(), m.get_cells(), k));
+    const std::size_t n_after(n_allocation);
+    check(n_after == n_before, "the geometry of a tetrahedron is allocated");
+    check(jmt.get_size(0) == 3 and jmt.get_size(1) == 3, "wrong jmt extents");
+  }
+  check(std::abs(volume - 6.0) < 1.e-13, "wrong volume");
+}
+
+int main(int argc, char *argv[]) {
+  return run_tests("test_small_tensor", []() {
+      test_layout();
+      test_triangle();
+      test_tetrahedron();
+    });
+}
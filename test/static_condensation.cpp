@@ -0,0 +1,148 @@
+#include <cmath>
+#include <iostream>
+#include <string>
+
+#include "../src/core/mesh.hpp"
+#include "../src/core/fe.hpp"
+#include "../src/core/fes.hpp"
+#include "../src/core/form.hpp"
+#include "../src/core/quadrature.hpp"
+#include "../src/core/composite_fe.hpp"
+#include "../src/core/composite_fes.hpp"
+#include "../src/core/composite_form.hpp"
+
+#include "check.hpp"
+
+
+double source(const double* x) {
+  return 1.0 + x[0] * x[1];
+}
+
+double boundary_value(const double* x) {
+  return x[0] - x[1];
+}
+
+double lid_velocity(const double* x) {
+  return x[1] > 1.0 - 1.e-10 ? 1.0 : 0.0;
+}
+
+// a solver whose solves fail
+class failing_solver: public solver::basic_solver {
+public:
+  void set_operator(const sparse_matrix&) {}
+  void set_operator(const dense_matrix&) {}
+  void set_operator(const crs_matrix&) {}
+
+  bool solve(const array<double>&, array<double>&, dictionary& report) {
+    report.set("error", "failed");
+    return false;
+  }
+};
+
+template<typename form_type, typename rhs_type>
+void check_failed_solve(const form_type& a, const rhs_type& f, const std::string& name) {
+  failing_solver s;
+  bool thrown(false);
+  try {
+    a.solve(f, s);
+  } catch (const std::string& e) {
+    thrown = (e.find("the solve of the condensed system failed") != std::string::npos);
+  }
+  check(thrown, name + ": a failed condensed solve is accepted");
+}
+
+double max_difference(const array<double>& a, const array<double>& b) {
+  double d(0.0);
+  for (std::size_t i(0); i < a.get_size(0); ++i)
+    d = std::max(d, std::abs(a.at(i) - b.at(i)));
+  return d;
+}
+
+/*
+ * A reaction-diffusion problem on a P1-bubble space gives the same
+ * solution with and without the condensation of the bubbles, and a
+ * failed solve of the condensed system throws.
+ */
+template<typename cell_type, typename quad_type>
+void test_scalar(const fe_mesh<cell_type>& m, const std::string& name) {
+  using fe_type = typename cell_type::fe::lagrange_p1_bubble;
+  using fes_type = finite_element_space<fe_type>;
+
+  const submesh<cell_type> dm(m.get_boundary_submesh());
+  const fes_type fes(m, dm, boundary_value);
+  check(fes.get_cell_interior_dofs().get_size(1) == 1, name + ": one bubble per cell expected");
+
+  bilinear_form<fes_type, fes_type> a(fes, fes);
+  const auto u(a.get_trial_function());
+  const auto v(a.get_test_function());
+  a += integrate<quad_type>(d<1>(u) * d<1>(v) + d<2>(u) * d<2>(v) + 0.5 * d<1>(u) * v + u * v, m);
+
+  linear_form<fes_type> f(fes);
+  f += integrate<quad_type>(make_expr(source) * f.get_test_function(), m);
+
+  solver::lapack::lu s_full, s_condensed;
+  s_full.set_operator_size(fes.get_dof_number());
+  const auto u_full(a.solve(f, s_full));
+
+  a.set_static_condensation(true);
+  const auto u_condensed(a.solve(f, s_condensed));
+
+  const double d(max_difference(u_full.get_coefficients(), u_condensed.get_coefficients()));
+  check(d < 1.e-10, name + ": the condensed solution differs by " + std::to_string(d));
+
+  check_failed_solve(a, f, name);
+}
+
+/*
+ * MINI element for the Stokes driven cavity: the velocity bubbles of
+ * both components are condensed.
+ */
+void test_stokes() {
+  using cell_type = cell::triangle;
+  using u_fe_type = cell_type::fe::lagrange_p1_bubble;
+  using p_fe_type = cell_type::fe::lagrange_p1;
+  using quad_type = quad::triangle::qf5pT;
+  using cfe_type = composite_finite_element<u_fe_type, u_fe_type, p_fe_type>;
+  using cfes_type = composite_finite_element_space<cfe_type>;
+
+  const fe_mesh<cell_type> m(gen_square_mesh(1.0, 1.0, 8, 8));
+  const submesh<cell_type> dm(m.get_boundary_submesh());
+  cfes_type fes(m);
+  fes.add_dirichlet_boundary<0>(dm, lid_velocity);
+  fes.add_dirichlet_boundary<1>(dm, 0.0);
+  check(fes.get_cell_interior_dofs().get_size(1) == 2, "stokes: two bubbles per cell expected");
+
+  bilinear_form<cfes_type, cfes_type> a(fes, fes);
+  auto v0(a.get_test_function<0>());
+  auto v1(a.get_test_function<1>());
+  auto q(a.get_test_function<2>());
+  auto u0(a.get_trial_function<0>());
+  auto u1(a.get_trial_function<1>());
+  auto p(a.get_trial_function<2>());
+
+  // the small pressure mass term fixes the pressure constant
+  a += integrate<quad_type>(d<1>(u0) * d<1>(v0) + d<2>(u0) * d<2>(v0) + d<1>(u1) * d<1>(v1) + d<2>(u1) * d<2>(v1)
+			    - p * (d<1>(v0) + d<2>(v1)) - q * (d<1>(u0) + d<2>(u1)) - 1.e-4 * p * q, m);
+  linear_form<cfes_type> f(fes);
+
+  solver::lapack::lu s_full, s_condensed;
+  s_full.set_operator_size(fes.get_total_dof_number());
+  const auto x_full(a.solve(f, s_full));
+
+  a.set_static_condensation(true);
+  const auto x_condensed(a.solve(f, s_condensed));
+
+  const double d(max_difference(x_full.get_coefficients(), x_condensed.get_coefficients()));
+  check(d < 1.e-10, "stokes: the condensed solution differs by " + std::to_string(d));
+
+  check_failed_solve(a, f, "stokes");
+}
+
+int main(int argc, char *argv[]) {
+  return run_tests("test_static_condensation", []() {
+      test_scalar<cell::triangle, quad::triangle::qf5pT>(gen_square_mesh(1.0, 1.0, 12, 12), "triangle");
+      test_scalar<cell::tetrahedron, quad::tetrahedron::qfSym10pTet>(gen_cube_mesh(1.0, 1.0, 1.0, 4, 4, 4),
+								     "tetrahedron");
+      test_stokes();
+    });
+}
@@ -0,0 +1,153 @@
+#include <cmath>
+#include <iostream>
+#include <string>
+
+#include "../src/core/mesh.hpp"
+#include "../src/core/fe.hpp"
+#include "../src/core/quadrature.hpp"
+#include "../src/core/fe_value_manager.hpp"
+#include "../src/core/fes.hpp"
+#include "../src/core/form.hpp"
+#include "../src/core/tabulation.hpp"
+
+#include "check.hpp"
+
+
+/*
+ * The tables hold the values of the basis functions and of their
+ * reference derivatives on each set of points.
+ */
+template<typename fe_type, typename point_set_type>
+void test_table(const std::string& name) {
+  using table_type = tabulation::table<fe_type, point_set_type>;
+  const std::size_t n_dim(fe_type::cell_type::n_dimension);
+
+  for (std::size_t s(0); s < point_set_type::n_set; ++s) {
+    const array<double>& x(point_set_type::get_points(s));
+    check(x.get_size(0) == point_set_type::n_point, name + ": wrong number of points");
+
+    const double* t(table_type::get(s));
+    for (std::size_t q(0); q < point_set_type::n_point; ++q)
+      for (std::size_t i(0); i < fe_type::n_dof_per_element; ++i) {
+	const double* v(t + (q * fe_type::n_dof_per_element + i) * (n_dim + 1));
+	check(v[0] == fe_type::phi(i, &x.at(q, 0)), name + ": wrong value");
+	for (std::size_t d(0); d < n_dim; ++d)
+	  check(v[1 + d] == fe_type::dphi(d, i, &x.at(q, 0)), name + ": wrong derivative");
+      }
+  }
+}
+
+/*
+ * The values set from a table are the ones evaluated on the points.
+ */
+template<typename fe_type, typename point_set_type>
+void test_value_manager(const std::string& name) {
+  using manager_type = fe_value_manager<type_list<fe_type> >;
+  const std::size_t n_dim(fe_type::cell_type::n_dimension);
+
+  array<double> jmt{n_dim, n_dim};
+  for (std::size_t s(0); s < n_dim; ++s)
+    for (std::size_t t(0); t < n_dim; ++t)
+      jmt.at(s, t) = 1.0 + s - 0.5 * t + (s == t ? 2.0 : 0.0);
+
+  for (std::size_t s(0); s < point_set_type::n_set; ++s) {
+    manager_type tabulated(point_set_type::n_point), evaluated(point_set_type::n_point);
+    tabulated.template set_point_set<point_set_type>(s);
+    evaluated.set_points(point_set_type::get_points(s));
+    tabulated.prepare(jmt);
+    evaluated.prepare(jmt);
+
+    const array<double>& a(tabulated.template get_values<0>());
+    const array<double>& b(evaluated.template get_values<0>());
+    for (std::size_t n(0); n < a.get_element_number(); ++n)
+      check(std::abs(a.get_data()[n] - b.get_data()[n]) < 1.e-14, name + ": the prepared values differ");
+  }
+}
+
+template<typename fe_type, typename quadrature_type>
+void test_cell(const std::string& name) {
+  using cell_set = tabulation::cell_point_set<quadrature_type>;
+
+  test_table<fe_type, cell_set>(name);
+  test_value_manager<fe_type, cell_set>(name);
+}
+
+/*
+ * The sets of the boundary points of an edge.
+ */
+template<typename fe_type>
+void test_boundary(const std::string& name) {
+  using boundary_set = tabulation::subdomain_point_set<cell::edge, quad::point::eval>;
+  check(boundary_set::n_set == 2, "an edge has two vertices");
+  check(boundary_set::get_points(0).at(0, 0) == 0.0 and boundary_set::get_points(1).at(0, 0) == 1.0,
+	"wrong points on the vertices of an edge");
+
+  test_table<fe_type, boundary_set>(name);
+  test_value_manager<fe_type, boundary_set>(name);
+}
+
+/*
+ * A finite element function reads the tables of the assembly: the
+ * integrals of a function of the space and of its derivatives are exact.
+ */
+void test_coefficient_function() {
+  using fe_type = cell::triangle::fe::lagrange_p2;
+  using fes_type = finite_element_space<fe_type>;
+  using quad_type = quad::triangle::qf5pT;
+
+  const fe_mesh<cell::triangle> m(gen_square_mesh(1.0, 1.0, 6, 6));
+  const fes_type fes(m);
+
+  array<double> coefficients{fes.get_dof_number()};
+  for (std::size_t i(0); i < fes.get_dof_number(); ++i) {
+    const auto x(fes.get_dof_space_coordinate(i));
+    coefficients.at(i) = x.at(0, 0) * x.at(0, 1);
+  }
+  const typename fes_type::element u_h(fes, coefficients);
+  const auto u(make_expr<fe_type>(u_h));
+
+  const double i_0(integrate<quad_type>(u * u, m));
+  const double i_1(integrate<quad_type>(d<1>(u) + 2.0 * d<2>(u), m));
+  check(std::abs(i_0 - 1.0 / 9.0) < 1.e-12, "wrong integral of a squared function");
+  check(std::abs(i_1 - 1.5) < 1.e-12, "wrong integral of derivatives");
+
+  // on the points of the tables, the values are the ones evaluated out
+  // of an assembly
+  const auto w(d<2>(u));
+  double max_difference(0.0);
+  for (std::size_t k(0); k < m.get_cell_number(); ++k) {
+    expression_cache cache;
+    w.template prepare_cell<tabulation::cell_point_set<quad_type> >(k, 0, cache);
+    for (std::size_t q(0); q < quad_type::n_point; ++q) {
+      const double* x_hat(&quad_type::x[q][0]);
+      const auto evaluated(d<2>(u));
+      evaluated.prepare(k, q, x_hat, x_hat);
+      w.prepare(k, q, x_hat, x_hat);
+      max_difference = std::max(max_difference, std::abs(w(k, x_hat, x_hat) - evaluated(k, x_hat, x_hat)));
+    }
+  }
+  check(max_difference < 1.e-12, "the tabulated values differ from the evaluated ones");
+}
+
+int main(int argc, char *argv[]) {
+  return run_tests("test_tabulation", []() {
+      using quad::triangle::qf2pT;
+      using quad::triangle::qf5pT;
+      using quad::tetrahedron::qfSym4pTet;
+      using quad::tetrahedron::qfSym10pTet;
+
+      test_cell<cell::edge::fe::lagrange_p2, quad::edge::gauss3>("edge p2 gauss3");
+      test_cell<cell::triangle::fe::lagrange_p1, qf2pT>("triangle p1 qf2pT");
+      test_cell<cell::triangle::fe::lagrange_p1, qf5pT>("triangle p1 qf5pT");
+      test_cell<cell::triangle::fe::lagrange_p2, qf2pT>("triangle p2 qf2pT");
+      test_cell<cell::triangle::fe::lagrange_p2, qf5pT>("triangle p2 qf5pT");
+      test_cell<cell::triangle::fe::lagrange_p1_bubble, qf5pT>("triangle p1 bubble qf5pT");
+      test_cell<cell::tetrahedron::fe::lagrange_p1, qfSym4pTet>("tetrahedron p1 qfSym4pTet");
+      test_cell<cell::tetrahedron::fe::lagrange_p1_bubble, qfSym10pTet>("tetrahedron p1 bubble qfSym10pTet");
+
+      test_boundary<cell::edge::fe::lagrange_p1>("edge p1 boundary");
+      test_boundary<cell::edge::fe::lagrange_p2>("edge p2 boundary");
+
+      test_coefficient_function();
+    });
+}